@@ -3,12 +3,40 @@
 
 #include <stddef.h> // 引入size_t、NULL类型
 #include <stdint.h>
+#include <stdbool.h>
 #include "u4g_state.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "u4g_core.h"
+#include "u4g_uart.h"
 
-extern SemaphoreHandle_t u4g_at_cmd_semaphore_sync;
+#define U4G_AT_CMD_TIMEOUT_DEFAULT 3000 // 未指定超时时的默认应答超时(ms)
+#define U4G_AT_CMD_IDLE_WAIT_MS 1000    // 发送前等待模块空闲(上一条指令的最终结果码)的最长时间(ms)
+#define U4G_AT_CMD_LOCK_TIMEOUT 5000    // 排队获取指令执行权的最长时间(ms)
+
+// 自适应超时：按指令统计往返时间(RTT)，超时 = SRTT + max(粒度, 4*RTTVAR)，限制在[下限, 调用方给定的上限]之间
+#define U4G_AT_RTO_MIN_MS 200           // 自适应超时下限(ms)
+#define U4G_AT_RTO_GRANULARITY_MS 50    // 超时余量下限(ms)，覆盖任务调度与串口分包的抖动
+#define U4G_AT_RTT_MIN_SAMPLES 4        // 样本数达到后才启用自适应超时，此前使用上限
+#define U4G_AT_RTT_SAVE_EVERY 64        // 每积累多少个新样本写一次NVS
+#define U4G_AT_RTT_NVS_NAMESPACE "u4g"  // NVS命名空间（与波特率共用）
+#define U4G_AT_RTT_NVS_KEY "rtt"        // NVS键名
+
+/**
+ * AT指令通道：每个通道同一时间执行一条指令。未启用CMUX时只有一个通道（串口本身）；
+ * 启用后控制类指令（注册检查、信号查询）与数据类指令（HTTP收发）分别在两个虚拟通道上并行执行
+ */
+typedef enum
+{
+    U4G_AT_CHAN_CTRL, // 控制通道，CMUX未建立时全部指令都在此通道
+    U4G_AT_CHAN_DATA, // 数据通道
+} u4g_at_chan_t;
+#if U4G_CMUX_ENABLE
+#define U4G_AT_CHAN_NUM 2
+#else
+#define U4G_AT_CHAN_NUM 1
+#endif
+#define U4G_AT_CHAN_ANY 0xFF // 行来源不属于任何指令通道（CMUX的URC通道、复用帧之外的数据）
 
 /**
  * @brief 接受到应答数据后的用户处理回调函数原型定义
@@ -37,6 +65,25 @@ typedef enum
     U4G_AT_CMD_TIME,          // NTP网络时间获取
     U4G_AT_CMD_MCCID,         // 读取ICCID(AT+MCCID)SIM卡号
     U4G_AT_CMD_CSQ,           // AT+CSQ信号值
+    U4G_AT_CMD_CEREG_SET,     // 网络注册状态主动上报设置（AT+CEREG=<n>）
+    U4G_AT_CMD_IPR,           // 设置模块串口波特率（AT+IPR=<rate>）
+    U4G_AT_CMD_IFC,           // 设置模块串口流控（AT+IFC=<dce_by_dte>,<dte_by_dce>）
+    U4G_AT_CMD_CPIN,          // SIM卡状态查询（AT+CPIN?）
+    U4G_AT_CMD_CGATT,         // 分组域附着状态查询（AT+CGATT?）
+    U4G_AT_CMD_CMUX,          // 进入CMUX复用模式（AT+CMUX=<mode>,<subset>,<port_speed>,<N1>）
+    U4G_AT_CMD_CGDCONT,       // 设置PDP上下文（AT+CGDCONT=<cid>,"IP",<apn>）
+    U4G_AT_CMD_DIAL,          // 拨号进入PPP数据模式（ATD*99***<cid>#），收到 CONNECT 结束
+    U4G_AT_CMD_MQTT_CFG,      // MQTT-连接参数配置（AT+MQTTCFG=<type>,<id>,...）
+    U4G_AT_CMD_MQTT_CONN,     // MQTT-连接服务器（AT+MQTTCONN），结果由 +MQTTURC: "conn" 上报
+    U4G_AT_CMD_MQTT_SUB,      // MQTT-订阅（AT+MQTTSUB），应答由 +MQTTURC: "suback" 上报
+    U4G_AT_CMD_MQTT_PUB,      // MQTT-发布（AT+MQTTPUB），QoS 1 应答由 +MQTTURC: "puback" 上报
+    U4G_AT_CMD_MQTT_DISC,     // MQTT-断开连接（AT+MQTTDISC=<id>）
+    U4G_AT_CMD_SOCK_CFG,      // 套接字-参数配置（AT+MIPCFG=<type>,<id>,...）
+    U4G_AT_CMD_SOCK_OPEN,     // 套接字-建立连接（AT+MIPOPEN），结果由 +MIPOPEN: <id>,<result> 上报
+    U4G_AT_CMD_SOCK_SEND,     // 套接字-发送数据（AT+MIPSEND=<id>,<len>,<data>）
+    U4G_AT_CMD_SOCK_CLOSE,    // 套接字-关闭连接（AT+MIPCLOSE=<id>）
+    U4G_AT_CMD_SAVE,          // 保存当前配置到用户配置，复位后保持（AT&W）
+    U4G_AT_CMD_MAX,           // 指令数量，非实际指令
 } emATCmd;
 
 typedef struct
@@ -44,9 +91,38 @@ typedef struct
     emATCmd name;                 // AT别名
     char *cmd;                    // 要发送的AT命令
     size_t cmd_len;               // AT命令的数据长度，不需要用户赋值
-    uint32_t timeout;             // 得到应答的超时时间，达到超时时间为执行失败， 默认10000，即10秒
-    u4g_at_rsp_handler_t handler; // 接受到应答数据后的用户自定义处理回调函数
+    uint32_t timeout;             // 应答超时上限，从发送或最近一次收到本指令的应答行起算，为0时使用 U4G_AT_CMD_TIMEOUT_DEFAULT；实际超时由RTT估计得出
+    u4g_at_rsp_handler_t handler; // 接受到应答数据后的用户自定义处理回调函数，为NULL时使用应答描述表中的默认处理函数
 } u4g_at_cmd_t;
+
+// 最终结果码策略
+typedef enum
+{
+    U4G_AT_FINAL_OK,  // OK 结束指令；ERROR/+CME ERROR 为失败
+    U4G_AT_FINAL_ANY, // OK 与 ERROR 均视为成功（AT/ATE 等探测类指令）
+    U4G_AT_FINAL_URC, // OK 仅表示受理，由处理函数根据后续 URC 决定结束
+} u4g_at_final_t;
+
+// 多行应答策略
+typedef enum
+{
+    U4G_AT_LINES_SINGLE, // 只有带前缀的信息行交给处理函数
+    U4G_AT_LINES_CONT,   // 前缀行之后无法识别的行作为续行交给处理函数
+} u4g_at_lines_t;
+
+/**
+ * @brief AT指令应答描述：新增指令只需在 u4g_at_cmd.c 的描述表中增加一项
+ */
+typedef struct
+{
+    const char *prefix;           // 期望的信息行前缀，NULL 表示只有最终结果码
+    u4g_at_final_t final;         // 最终结果码策略
+    u4g_at_lines_t lines;         // 多行应答策略
+    u4g_at_rsp_handler_t handler; // 默认处理函数，u4g_at_cmd_t.handler 非空时以其为准
+    bool network;                 // 应答取决于网络/服务器（建连、发送确认等），始终使用配置的超时
+    bool prompt;                  // 发送后等待">"数据输入提示符再写入数据（目前的指令都随指令内联发送数据）
+} u4g_at_desc_t;
+
 /**
  * @brief AT组件上下文数据结构体
  * 这是AT组件的主要上下文结构，包含了AT模块的所有状态和配置信息。
@@ -56,19 +132,50 @@ typedef struct
     const u4g_at_cmd_t *cmd_content; // 当前正在处理的AT命令
     // volatile emATMsg state;          // 消息状态
     emU4GResult result;              // 命令处理结果
+    bool matched;                    // 已收到期望前缀的信息行
+    emU4GResult rsp;                 // 处理函数对信息行的处理结果，收到最终结果码时作为命令结果
+    volatile uint32_t progress;      // 已交给处理函数的应答行数，有进展时延长等待（大响应分包持续到达）
 } u4g_at_cmd_handle_t;
-extern u4g_at_cmd_handle_t u4g_at_cmd_handle;
+extern u4g_at_cmd_handle_t u4g_at_cmd_handle[U4G_AT_CHAN_NUM]; // 按通道索引
+
+/**
+ * @brief 单条AT指令的耗时统计（从发送到收到最终应答）
+ */
+typedef struct
+{
+    uint32_t count;     // 执行次数
+    uint32_t fail;      // 失败次数（含超时）
+    uint32_t timeout;   // 超时次数
+    uint32_t last_us;   // 最近一次耗时(us)
+    uint32_t max_us;    // 最大耗时(us)
+    uint64_t total_us;  // 累计耗时(us)，除以 count 得平均值
+    uint32_t srtt_us;   // 平滑往返时间(us)
+    uint32_t rttvar_us; // 往返时间偏差(us)
+    uint32_t rto_ms;    // 按默认上限计算的当前自适应超时(ms)
+} u4g_at_cmd_stat_t;
 
 
 emU4GResult u4g_at_cmd_init(void);
 emU4GResult u4g_at_cmd_sync(const u4g_at_cmd_t *config);
+void u4g_at_cmd_finish(uint8_t chan, emU4GResult result);
+void u4g_at_cmd_idle_notify(uint8_t chan);
+emU4GResult u4g_at_cmd_stat_get(emATCmd name, u4g_at_cmd_stat_t *out);
+const u4g_at_desc_t *u4g_at_desc_get(emATCmd name);
 emU4GResult u4g_at(void);
 emU4GResult u4g_at_imei_get(void);
 emU4GResult u4g_at_netstatus(void);
+emU4GResult u4g_at_cereg_parse(const char *line, int *stat, bool *query);
+emU4GResult u4g_at_netstatus_report(uint8_t n);
+emU4GResult u4g_at_flowctrl(bool enable);
 emU4GResult u4g_at_time_get(void);
 emU4GResult u4g_at_mccid_get(void);
 emU4GResult u4g_at_reboot_soft(void);
 emU4GResult u4g_at_reboot_hard(void);
 emU4GResult u4g_at_csq(void);
+emU4GResult u4g_at_sim_status(void);
+emU4GResult u4g_at_attach_status(void);
+emU4GResult u4g_at_cmux(uint16_t n1, emU4GResult (*open)(void));
+emU4GResult u4g_at_pdp_set(uint8_t cid, const char *apn);
+emU4GResult u4g_at_dial(uint8_t cid, uint32_t timeout, u4g_at_rsp_handler_t on_connect);
 
 #endif
\ No newline at end of file
@@ -2,8 +2,82 @@
 #define U4G_AT_HTTP_H
 
 #include "u4g_state.h"
+#include "u4g_segbuf.h"
+#include "u4g_at_sched.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define U4G_HTTP_QUEUE_LEN 4       // 异步请求队列深度
+#define U4G_HTTP_TASK_PRIO 5       // 异步请求执行任务优先级
+#define U4G_HTTP_TASK_STACK 6144   // 异步请求执行任务栈（完成回调在该任务中解析JSON）
+#define U4G_HTTP_CONTENT_MAX 480 // 单次POST内容长度上限（模块单条AT指令512字节，扣除指令本身），binary 内容以十六进制发送，上限减半
+#define U4G_HTTP_POST_MAX(binary) ((binary) ? U4G_HTTP_CONTENT_MAX / 2 : U4G_HTTP_CONTENT_MAX) // 按内容格式的body长度上限
+#ifndef U4G_HTTP_BODY_MAX
+#define U4G_HTTP_BODY_MAX (256 * 1024) // 默认接收器的响应长度上限（PSRAM分段缓冲区），可在编译选项中覆盖
+#endif
+
+typedef struct u4g_http_req *u4g_http_handle_t; // 异步请求句柄
+
+/**
+ * 请求内容格式：缺省为JSON文本。binary 为true时内容与响应都以十六进制与模块交互，
+ * 可以发送/接收含'\0'的二进制内容（如CBOR）；字符串需长期有效（一般为常量）
+ */
+typedef struct
+{
+    const char *content_type; // POST内容类型，NULL 为 application/json
+    const char *accept;       // 可接受的响应类型（Accept 头部），NULL 不发送
+    bool binary;              // 内容/响应可能为二进制
+    size_t body_len;          // binary 时的POST内容长度
+} u4g_http_fmt_t;
+
+/**
+ * HTTP响应接收器：分包数据从串口行缓冲直接写入，不经过中间缓冲
+ * write 非NULL时为流式模式，数据逐段交给 write；否则写入 buf 并保持'\0'结尾
+ */
+typedef struct
+{
+    char *buf;                                                     // 缓冲区模式：调用方提供的缓冲区
+    size_t size;                                                   // 缓冲区大小（含'\0'）
+    size_t len;                                                    // 已接收字节数
+    emU4GResult (*begin)(void *arg);                               // 每次发送请求前调用（含失败重试），可为NULL
+    emU4GResult (*write)(const char *data, size_t len, void *arg); // 流式模式：写入一段数据，返回非U4G_OK时中止请求
+    void *arg;                                                     // begin/write 的参数
+} u4g_http_sink_t;
+
+/**
+ * @brief 异步请求完成回调，运行在HTTP执行任务中；回调返回后句柄自动释放
+ * @param handle 请求句柄
+ * @param result 请求结果
+ * @param data 响应内容（result 为 U4G_OK 且为缓冲区模式或默认接收器时有效，仅在回调内有效），否则为NULL
+ * @param arg 提交时传入的用户参数
+ */
+typedef void (*u4g_http_done_cb_t)(u4g_http_handle_t handle, emU4GResult result, const char *data, void *arg);
+
+/**
+ * @brief 异步请求描述，提交时 url/path/body 会被复制，调用方可立即复用自己的缓冲区
+ */
+typedef struct
+{
+    const char *url;         // 服务器地址
+    const char *path;        // 请求路径
+    const char *body;        // POST内容，NULL 为GET
+    u4g_http_sink_t *sink;   // 响应接收器，NULL 写入PSRAM分段缓冲区；需保持有效直到请求完成
+    u4g_http_done_cb_t cb;   // 完成回调，非NULL时由执行任务在回调后释放句柄
+    void *arg;               // 回调参数
+    TaskHandle_t notify;     // 完成后通知的任务（cb 为NULL时使用），需调用 u4g_http_result/u4g_http_release
+    uint32_t notify_bits;    // 通知值，按位或到 notify 任务的通知值上
+    u4g_at_class_t cls;      // 执行时AT指令的等级，NONE 为默认等级；告警请求排到异步队列最前（时延见 u4g_http_submit）
+    const u4g_http_fmt_t *fmt; // 内容格式，NULL 为JSON文本；提交时复制
+} u4g_http_req_t;
 
 emU4GResult u4g_at_http_init(void);
 emU4GResult u4g_at_http_request(const char *url, const char *path, const char *body);
+emU4GResult u4g_at_http_request_sink(const char *url, const char *path, const char *body, u4g_http_sink_t *sink);
+emU4GResult u4g_at_http_request_fmt(const char *url, const char *path, const char *body, const u4g_http_fmt_t *fmt, u4g_http_sink_t *sink);
+u4g_http_handle_t u4g_http_submit(const u4g_http_req_t *req);
+emU4GResult u4g_http_result(u4g_http_handle_t handle, const char **data);
+const u4g_segbuf_t *u4g_http_body(u4g_http_handle_t handle);
+const u4g_segbuf_t *u4g_at_http_body(void);
+void u4g_http_release(u4g_http_handle_t handle);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,47 @@
+#ifndef U4G_AT_SCHED_H
+#define U4G_AT_SCHED_H
+
+#include <stdint.h>
+#include "u4g_state.h"
+
+#define U4G_AT_SCHED_TASK_MAX 8 // 可单独设置优先等级的任务数
+
+/**
+ * AT指令优先等级：每个等级一条等待队列，当前指令结束（指令边界）时总是交给最高等级的队首，
+ * 同等级内先到先得。正在执行的指令不会被打断。
+ * 这里的抢占只在AT指令之间：HTTP请求由若干条指令组成且全程持有HTTP锁，告警请求要等进行中的请求结束（见 u4g_http_submit）。
+ * 启用CMUX后每个AT通道各有一份执行权：告警与上报在数据通道，其余在控制通道，两个通道互不阻塞
+ */
+typedef enum
+{
+    U4G_AT_CLASS_NONE,       // 未指定：沿用调用任务的等级
+    U4G_AT_CLASS_ALARM,      // 告警（漏水等），最高
+    U4G_AT_CLASS_CONTROL,    // 控制（驻网、鉴权、配置下发）
+    U4G_AT_CLASS_TELEMETRY,  // 周期上报，未设置等级的任务默认使用
+    U4G_AT_CLASS_BACKGROUND, // 后台（对时等），最低
+    U4G_AT_CLASS_MAX,        // 等级数量，非实际等级
+} u4g_at_class_t;
+
+/**
+ * @brief 单个等级的排队与占用统计
+ */
+typedef struct
+{
+    uint32_t count;         // 获得执行权次数
+    uint32_t timeout;       // 排队超时次数
+    uint32_t preempt;       // 越过低等级等待者获得执行权的次数
+    uint32_t wait_last_us;  // 最近一次排队耗时(us)
+    uint32_t wait_max_us;   // 最大排队耗时(us)
+    uint64_t wait_total_us; // 累计排队耗时(us)，除以 count 得平均值
+    uint32_t hold_max_us;   // 最长占用时间(us)
+    uint64_t hold_total_us; // 累计占用时间(us)
+} u4g_at_sched_stat_t;
+
+u4g_at_class_t u4g_at_sched_class_set(u4g_at_class_t cls);
+u4g_at_class_t u4g_at_sched_class_get(void);
+emU4GResult u4g_at_sched_acquire(uint32_t timeout_ms, uint8_t *chan);
+void u4g_at_sched_release(uint8_t chan);
+emU4GResult u4g_at_sched_stat_get(u4g_at_class_t cls, u4g_at_sched_stat_t *out);
+void u4g_at_sched_stat_log(void);
+
+#endif
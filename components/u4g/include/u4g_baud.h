@@ -0,0 +1,21 @@
+#ifndef _U4G_BAUD_H_
+#define _U4G_BAUD_H_
+
+#include "u4g_state.h" // 状态码
+#include "u4g_uart.h"  // U4G_UART_HW_FLOWCTRL
+#include <stdint.h>
+
+// 协商的目标波特率：高速率下没有RTS/CTS时解析任务一旦来不及处理就会丢数据，只在启用硬件流控时使用
+#if U4G_UART_HW_FLOWCTRL
+#define U4G_BAUD_TARGET 921600
+#else
+#define U4G_BAUD_TARGET 115200
+#endif
+#define U4G_BAUD_NVS_NAMESPACE "u4g" // NVS命名空间
+#define U4G_BAUD_NVS_KEY "baud"      // 模块复位后的波特率（AT&W 保存成功时即目标速率）
+#define U4G_BAUD_BOOT_WAIT_MS 6000   // 模块复位后等待AT响应的最长时间(ms)
+#define U4G_BAUD_PROBE_TIMEOUT 300   // 单次AT探测超时(ms)
+
+emU4GResult u4g_baud_negotiate(void);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef _U4G_CBOR_H_
+#define _U4G_CBOR_H_
+
+#include "u4g_state.h" // 状态码
+#include "u4g_json.h"  // 值回调与值类型，解码结果与JSON解析器一致
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define U4G_CBOR_DOC_MAX 512 // 解码缓冲区大小（单个响应内容最大长度）
+
+/**
+ * CBOR(RFC 8949) 编码器：直接写入调用方提供的缓冲区（可在栈上），不分配内存。
+ * 缓冲区不足时只记录溢出，由 u4g_cbor_enc_finish 统一返回错误，调用处不需要逐个检查
+ */
+typedef struct
+{
+    uint8_t *buf;  // 输出缓冲区
+    size_t size;   // 缓冲区大小
+    size_t len;    // 已写入长度
+    bool overflow; // 缓冲区不足
+} u4g_cbor_enc_t;
+
+/**
+ * CBOR 解码器：内容先收入缓冲区，结束时一次解码；按与 u4g_json 相同的键路径和值类型回调，
+ * 两种格式的响应可以共用同一组字段定义。只支持定长的映射/数组
+ */
+typedef struct
+{
+    u4g_json_cb_t cb;               // 值回调
+    void *arg;                      // 用户参数
+    uint8_t buf[U4G_CBOR_DOC_MAX];  // 已收到的内容
+    size_t len;                     // 已收到的长度
+    bool overflow;                  // 内容超过缓冲区
+} u4g_cbor_t;
+
+void u4g_cbor_enc_init(u4g_cbor_enc_t *enc, uint8_t *buf, size_t size);
+void u4g_cbor_enc_map(u4g_cbor_enc_t *enc, uint32_t pairs);
+void u4g_cbor_enc_array(u4g_cbor_enc_t *enc, uint32_t items);
+void u4g_cbor_enc_text(u4g_cbor_enc_t *enc, const char *text);
+void u4g_cbor_enc_int(u4g_cbor_enc_t *enc, int64_t value);
+void u4g_cbor_enc_bool(u4g_cbor_enc_t *enc, bool value);
+void u4g_cbor_enc_float(u4g_cbor_enc_t *enc, float value);
+emU4GResult u4g_cbor_enc_finish(const u4g_cbor_enc_t *enc, size_t *len);
+
+void u4g_cbor_init(u4g_cbor_t *cbor, u4g_json_cb_t cb, void *arg);
+emU4GResult u4g_cbor_feed(u4g_cbor_t *cbor, const uint8_t *data, size_t len);
+emU4GResult u4g_cbor_finish(u4g_cbor_t *cbor);
+emU4GResult u4g_cbor_decode(const uint8_t *data, size_t len, u4g_json_cb_t cb, void *arg);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef _U4G_CMUX_H_
+#define _U4G_CMUX_H_
+
+#include "u4g_state.h" // 状态码
+#include "u4g_uart.h"  // U4G_CMUX_ENABLE
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 3GPP 27.010 CMUX 基本选项：一条串口上复用多个虚拟通道，每帧 F9 | 地址 | 控制 | 长度 | 信息 | FCS | F9
+ * DLCI 0 为复用控制通道；DLCI 1/2 分别承载控制类、数据类AT指令（u4g_at_chan_t + 1），DLCI 3 用于URC
+ */
+#define U4G_CMUX_N1 127                     // 每帧最大信息字段长度，进入复用时通过 AT+CMUX 通知模块
+#define U4G_CMUX_DLCI_NUM 4                 // 使用的DLCI数量（含控制通道0）
+#define U4G_CMUX_DLCI_AT(chan) ((chan) + 1) // AT指令通道 -> DLCI
+#define U4G_CMUX_DLCI_URC 3                 // URC通道
+#define U4G_CMUX_T1_MS 300                  // 等待 UA 应答的时间(ms)
+#define U4G_CMUX_N2 3                       // SABM 重发次数
+#define U4G_CMUX_FLOW_WAIT_MS 2000          // 模块流控暂停发送时最长等待时间(ms)
+
+/**
+ * 复用状态
+ */
+typedef enum
+{
+    U4G_CMUX_OFF,     // 未复用，串口按行收发AT
+    U4G_CMUX_OPENING, // 已发送 AT+CMUX，正在建立虚拟通道（接收侧已按帧解析）
+    U4G_CMUX_ON,      // 虚拟通道已建立
+} u4g_cmux_state_t;
+
+/**
+ * 复用统计
+ */
+typedef struct
+{
+    uint32_t rx_frames; // 收到的有效帧
+    uint32_t rx_fcs;    // FCS 校验失败的帧
+    uint32_t rx_drop;   // 长度非法或结束标志缺失而丢弃的帧
+    uint32_t tx_frames; // 发送的帧
+} u4g_cmux_stat_t;
+
+/**
+ * @brief 透传数据接收函数，在解析任务中调用，data 仅在调用期间有效
+ */
+typedef void (*u4g_cmux_raw_cb_t)(const uint8_t *data, size_t len, void *arg);
+
+emU4GResult u4g_cmux_start(void);
+void u4g_cmux_reset(void);
+u4g_cmux_state_t u4g_cmux_state_get(void);
+int32_t u4g_cmux_write(uint8_t dlci, const uint8_t *data, size_t len);
+void u4g_cmux_feed(const uint8_t *data, size_t len);
+void u4g_cmux_rx_reset(void);
+void u4g_cmux_stat_get(u4g_cmux_stat_t *out);
+void u4g_cmux_raw_set(uint8_t dlci, u4g_cmux_raw_cb_t cb, void *arg);
+bool u4g_cmux_raw_active(uint8_t dlci);
+emU4GResult u4g_cmux_dlci_reopen(uint8_t dlci);
+
+#endif
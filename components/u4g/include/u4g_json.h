@@ -0,0 +1,81 @@
+#ifndef _U4G_JSON_H_
+#define _U4G_JSON_H_
+
+#include "u4g_state.h" // 状态码
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define U4G_JSON_PATH_MAX 64   // 键路径最大长度
+#define U4G_JSON_TOKEN_MAX 128 // 单个键/值最大长度
+#define U4G_JSON_DEPTH_MAX 8   // 最大嵌套层数
+
+// 值类型
+typedef enum
+{
+    U4G_JSON_STRING,
+    U4G_JSON_NUMBER,
+    U4G_JSON_BOOL,
+    U4G_JSON_NULL,
+    U4G_JSON_OBJECT, // 对象开始
+    U4G_JSON_ARRAY,  // 数组开始
+} u4g_json_type_t;
+
+/**
+ * @brief 值回调
+ * @param path 以'.'连接的键路径，如 "data.flush.power_on"，数组元素用下标 "list.0"
+ * @param type 值类型
+ * @param value 值文本：字符串已去引号并反转义，数字/布尔/null为原文；对象/数组开始时为NULL
+ * @param arg 用户参数
+ */
+typedef void (*u4g_json_cb_t)(const char *path, u4g_json_type_t type, const char *value, void *arg);
+
+/**
+ * 关注的字段：按路径和类型匹配
+ */
+typedef struct
+{
+    const char *path;     // 键路径
+    u4g_json_type_t type; // 期望类型
+} u4g_json_field_t;
+
+/**
+ * 增量JSON解析器：数据分几次输入都可以，不需要先拼出完整文本，也不建树。
+ * 登记了关注字段时，超长的键/值、超长的路径和超过层数的嵌套只要不涉及关注字段就跳过（不回调）；
+ * 未登记时按全部关注处理，遇到即报错
+ */
+typedef struct
+{
+    u4g_json_cb_t cb;                // 值回调
+    void *arg;                       // 用户参数
+    const u4g_json_field_t *fields;  // 关注的字段，NULL 为全部关注
+    uint8_t field_num;               // 关注的字段数
+    uint8_t state;    // 解析状态
+    uint8_t depth;    // 当前嵌套层数
+    struct
+    {
+        bool array;        // 数组/对象
+        uint16_t index;    // 数组元素下标
+        uint8_t base_len;  // 容器自身路径长度
+    } stack[U4G_JSON_DEPTH_MAX];
+    char path[U4G_JSON_PATH_MAX + 1];   // 当前键路径
+    uint8_t path_len;                   // 当前键路径长度
+    char token[U4G_JSON_TOKEN_MAX + 1]; // 当前键/值
+    uint16_t token_len;                 // 当前键/值长度
+    uint8_t escape;                     // 转义状态：0 无，1 反斜杠后，2-5 \uXXXX 十六进制位
+    uint16_t ucode;                     // \uXXXX 码点
+    bool truncated;                     // 当前键/值超长已截断
+    bool skip_value;                    // 下一个值的路径无法表示，整体跳过
+    uint8_t skip;                       // 跳过的容器层数（不入栈，不回调）
+    uint32_t skip_array;                // 跳过的各层是否为数组，按位记录
+} u4g_json_t;
+
+void u4g_json_init(u4g_json_t *json, u4g_json_cb_t cb, void *arg);
+void u4g_json_watch(u4g_json_t *json, const u4g_json_field_t *fields, int num);
+emU4GResult u4g_json_feed(u4g_json_t *json, const char *data, size_t len);
+emU4GResult u4g_json_finish(u4g_json_t *json);
+int u4g_json_field_find(const u4g_json_field_t *fields, int num, const char *path, u4g_json_type_t type);
+emU4GResult u4g_json_sink_begin(void *arg);
+emU4GResult u4g_json_sink_write(const char *data, size_t len, void *arg);
+
+#endif
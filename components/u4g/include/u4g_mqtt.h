@@ -0,0 +1,60 @@
+#ifndef _U4G_MQTT_H_
+#define _U4G_MQTT_H_
+
+#include "u4g_state.h" // 状态码
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef U4G_MQTT_ENABLE
+#define U4G_MQTT_ENABLE 0 // 1: 通过模块的 MQTT AT 指令保持长连接，配置由服务器推送，上报走 QoS 1 发布
+#endif
+
+/**
+ * MQTT 客户端：基于模块 AT+MQTTCFG/MQTTCONN/MQTTSUB/MQTTPUB 指令，使用一个持久会话(clean=0)。
+ * 数据就绪后自动连接并重新订阅，断开、模块重启或离开数据就绪后按退避间隔重连。
+ * 发布内容以十六进制编码下发给模块，内容中的引号、逗号不需要转义；收到的消息按ASCII输出
+ */
+#define U4G_MQTT_CONN_ID 0            // 模块MQTT连接编号
+#define U4G_MQTT_TOPIC_MAX 64         // 主题最大长度
+#define U4G_MQTT_PAYLOAD_MAX 256      // 单条发布内容最大长度（编码后指令约为两倍）
+#define U4G_MQTT_SUB_MAX 4            // 订阅主题数量上限
+#define U4G_MQTT_KEEPALIVE_S 120      // 心跳间隔(s)
+#define U4G_MQTT_CMD_TIMEOUT 5000     // 配置类指令超时(ms)
+#define U4G_MQTT_CONN_TIMEOUT 20000   // 等待连接结果的时间(ms)
+#define U4G_MQTT_ACK_TIMEOUT 10000    // 等待 SUBACK/PUBACK 的时间(ms)
+#define U4G_MQTT_RETRY_MIN_MS 5000    // 重连间隔下限(ms)，连续失败时加倍
+#define U4G_MQTT_RETRY_MAX_MS 300000  // 重连间隔上限(ms)
+#define U4G_MQTT_TASK_PRIO 5          // 连接任务优先级
+#define U4G_MQTT_TASK_STACK 4096
+
+/**
+ * @brief 收到订阅主题的消息，运行在URC分发任务中，可以在回调里发送AT指令
+ * @param topic 主题
+ * @param payload 消息内容（以'\0'结尾），回调返回后释放
+ * @param len 消息长度
+ * @param arg 启动时传入的用户参数
+ */
+typedef void (*u4g_mqtt_msg_cb_t)(const char *topic, const char *payload, size_t len, void *arg);
+
+/**
+ * @brief 连接参数，启动时复制
+ */
+typedef struct
+{
+    const char *host;      // 服务器地址
+    uint16_t port;         // 端口
+    bool tls;              // 使用TLS（模块默认的SSL配置）
+    const char *client_id; // 客户端标识（持久会话按此区分，一般为IMEI）
+    const char *username;  // 用户名，可为NULL
+    const char *password;  // 密码，可为NULL
+    u4g_mqtt_msg_cb_t cb;  // 消息回调
+    void *arg;             // 回调参数
+} u4g_mqtt_config_t;
+
+emU4GResult u4g_mqtt_start(const u4g_mqtt_config_t *config);
+emU4GResult u4g_mqtt_subscribe(const char *topic, uint8_t qos);
+emU4GResult u4g_mqtt_publish(const char *topic, const char *payload, size_t len, uint8_t qos);
+bool u4g_mqtt_is_connected(void);
+
+#endif
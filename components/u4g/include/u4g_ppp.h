@@ -0,0 +1,49 @@
+#ifndef _U4G_PPP_H_
+#define _U4G_PPP_H_
+
+#include "u4g_state.h" // 状态码
+#include "u4g_uart.h"  // U4G_CMUX_ENABLE
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef U4G_PPP_ENABLE
+#define U4G_PPP_ENABLE 0 // 1: 数据就绪后在CMUX数据通道上拨号进入PPP，HTTP改由本机lwIP/mbedTLS协议栈请求
+#endif
+
+#if U4G_PPP_ENABLE && !U4G_CMUX_ENABLE
+#error "PPP模式需要启用CMUX：拨号后数据通道被PPP占用，控制类AT指令仍需在控制通道上执行"
+#endif
+
+/**
+ * PPP 拨号：数据就绪后在 CMUX 数据通道(DLCI 2)上 ATD*99# 进入数据模式，通道上的数据直接交给 esp_netif 的 PPP 接口；
+ * 控制类AT指令与 URC 继续在控制、URC通道上收发。链路断开或模块离开数据就绪时挂断并重新建立该通道，
+ * 数据就绪后重新拨号。需在 sdkconfig 中启用 CONFIG_LWIP_PPP_SUPPORT
+ */
+#ifndef U4G_PPP_APN
+#define U4G_PPP_APN "" // 接入点名称，空字符串表示使用模块默认的PDP上下文
+#endif
+#define U4G_PPP_CID 1                 // 拨号使用的PDP上下文编号
+#define U4G_PPP_TASK_PRIO 5           // 拨号任务优先级
+#define U4G_PPP_TASK_STACK 4096
+#define U4G_PPP_DIAL_TIMEOUT 10000    // 等待 CONNECT 的时间(ms)
+#define U4G_PPP_UP_TIMEOUT 30000      // 拨号后等待获得IP的时间(ms)
+#define U4G_PPP_STOP_WAIT_MS 3000     // 断开时等待LCP终止完成的时间(ms)
+#define U4G_PPP_RETRY_MS 10000        // 拨号失败或链路断开后重新拨号的间隔(ms)
+#define U4G_PPP_HTTP_SESSION_MAX 2    // 保持连接的HTTP客户端数量（每个服务器地址一个）
+#define U4G_PPP_HTTP_TIMEOUT 10000    // HTTP请求超时(ms)
+#define U4G_PPP_HTTP_BUF_SIZE 1024    // HTTP客户端收发缓冲区
+
+/**
+ * @brief 接收器适配：由 u4g_at_http 传入，请求开始前重置接收状态、逐段写入响应内容
+ */
+typedef emU4GResult (*u4g_ppp_http_begin_t)(void);
+typedef emU4GResult (*u4g_ppp_http_write_t)(const char *data, size_t len);
+
+emU4GResult u4g_ppp_init(void);
+bool u4g_ppp_is_up(void);
+emU4GResult u4g_ppp_http_request(const char *url, const char *path, const char *body, size_t body_len,
+                                 const char *content_type, const char *accept,
+                                 u4g_ppp_http_begin_t begin, u4g_ppp_http_write_t write);
+
+#endif
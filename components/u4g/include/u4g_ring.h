@@ -0,0 +1,44 @@
+#ifndef _U4G_RING_H_
+#define _U4G_RING_H_
+
+#include "u4g_state.h" // 状态码
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 单生产者/单消费者无锁字节环形缓冲区
+ * head 只由生产者写，tail 只由消费者写，双方各自用 acquire 读取对方的下标，无需互斥锁；
+ * 下标单调递增，取模得到位置，容量必须是2的幂
+ */
+typedef struct
+{
+    uint8_t *buf;          // 数据区
+    size_t size;           // 容量（2的幂）
+    atomic_size_t head;    // 已写入总字节数（生产者）
+    atomic_size_t tail;    // 已读出总字节数（消费者）
+    size_t high_water;     // 最高占用字节数（生产者统计）
+    uint32_t overrun;      // 写入时空间不足的次数（生产者统计）
+} u4g_ring_t;
+
+/**
+ * 环形缓冲区统计
+ */
+typedef struct
+{
+    size_t size;       // 容量
+    size_t used;       // 当前占用
+    size_t high_water; // 最高占用
+    uint32_t overrun;  // 空间不足次数
+} u4g_ring_stat_t;
+
+emU4GResult u4g_ring_init(u4g_ring_t *ring, uint8_t *buf, size_t size);
+void u4g_ring_reset(u4g_ring_t *ring);
+uint8_t *u4g_ring_write_span(u4g_ring_t *ring, size_t *len);
+void u4g_ring_commit(u4g_ring_t *ring, size_t len);
+size_t u4g_ring_write(u4g_ring_t *ring, const uint8_t *data, size_t len);
+const uint8_t *u4g_ring_read_span(u4g_ring_t *ring, size_t *len);
+void u4g_ring_consume(u4g_ring_t *ring, size_t len);
+void u4g_ring_stat_get(u4g_ring_t *ring, u4g_ring_stat_t *out);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef _U4G_SEGBUF_H_
+#define _U4G_SEGBUF_H_
+
+#include "u4g_state.h" // 状态码
+#include <stddef.h>
+
+#define U4G_SEGBUF_SEG_SIZE 4096 // 单个分段数据容量
+
+/**
+ * 分段：数据区后多留1字节，用于保持'\0'结尾
+ */
+typedef struct u4g_segbuf_seg
+{
+    struct u4g_segbuf_seg *next; // 下一分段
+    size_t len;                  // 已用字节数
+    char data[];                 // 数据区 U4G_SEGBUF_SEG_SIZE + 1
+} u4g_segbuf_seg_t;
+
+/**
+ * 分段缓冲区：按需从PSRAM逐段申请，增长时不搬移已有数据，也不需要大块连续内存
+ */
+typedef struct
+{
+    u4g_segbuf_seg_t *head; // 首分段
+    u4g_segbuf_seg_t *tail; // 末分段（追加位置）
+    size_t len;             // 总字节数
+    size_t cap;             // 总字节数上限
+    char *flat;             // u4g_segbuf_flatten 生成的连续副本（PSRAM）
+} u4g_segbuf_t;
+
+void u4g_segbuf_init(u4g_segbuf_t *sb, size_t cap);
+void u4g_segbuf_reset(u4g_segbuf_t *sb);
+void u4g_segbuf_free(u4g_segbuf_t *sb);
+emU4GResult u4g_segbuf_append(u4g_segbuf_t *sb, const char *data, size_t len);
+size_t u4g_segbuf_copy(const u4g_segbuf_t *sb, size_t offset, char *out, size_t len);
+const char *u4g_segbuf_flatten(u4g_segbuf_t *sb);
+emU4GResult u4g_segbuf_sink_begin(void *arg);
+emU4GResult u4g_segbuf_sink_write(const char *data, size_t len, void *arg);
+
+#endif
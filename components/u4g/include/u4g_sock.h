@@ -0,0 +1,60 @@
+#ifndef _U4G_SOCK_H_
+#define _U4G_SOCK_H_
+
+#include "u4g_state.h" // 状态码
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef U4G_SOCK_ENABLE
+#define U4G_SOCK_ENABLE 0 // 1: 通过模块的 TCP/UDP AT 指令保持一条套接字连接，收发二进制数据
+#endif
+
+/**
+ * 套接字连接：基于模块 AT+MIPCFG/MIPOPEN/MIPSEND/MIPCLOSE 指令，收发内容均以十六进制编码，二进制数据不需要转义。
+ * 数据就绪后自动连接，对端断开、模块重启或离开数据就绪后按退避间隔重连。
+ * 收到的数据通过 +MIPURC: "rtcp"/"rudp" 上报；TCP 为字节流，一次上报不一定对应一次发送，由上层自行分帧
+ */
+#define U4G_SOCK_CONN_ID 1            // 模块套接字连接编号（HTTP/MQTT 使用各自的实例）
+#define U4G_SOCK_PAYLOAD_MAX 256      // 单次发送/接收最大字节数（编码后约为两倍）
+#define U4G_SOCK_CMD_TIMEOUT 5000     // 配置、发送类指令超时(ms)
+#define U4G_SOCK_CONN_TIMEOUT 20000   // 等待连接结果的时间(ms)
+#define U4G_SOCK_RETRY_MIN_MS 5000    // 重连间隔下限(ms)，连续失败时加倍
+#define U4G_SOCK_RETRY_MAX_MS 300000  // 重连间隔上限(ms)
+#define U4G_SOCK_TASK_PRIO 5          // 连接任务优先级
+#define U4G_SOCK_TASK_STACK 4096
+
+/**
+ * @brief 收到数据，运行在URC分发任务中，可以在回调里发送数据
+ * @param data 数据，回调返回后释放
+ * @param len 数据长度
+ * @param arg 启动时传入的用户参数
+ */
+typedef void (*u4g_sock_rx_cb_t)(const uint8_t *data, size_t len, void *arg);
+
+/**
+ * @brief 连接建立/断开，运行在连接任务中，建立时可以在回调里发送数据（如登录帧）
+ * @param connected 已建立为true
+ * @param arg 启动时传入的用户参数
+ */
+typedef void (*u4g_sock_state_cb_t)(bool connected, void *arg);
+
+/**
+ * @brief 连接参数，启动时复制
+ */
+typedef struct
+{
+    const char *host;          // 服务器地址
+    uint16_t port;             // 端口
+    bool udp;                  // 使用UDP，否则TCP
+    u4g_sock_rx_cb_t rx;       // 数据回调
+    u4g_sock_state_cb_t state; // 连接状态回调，可为NULL
+    void *arg;                 // 回调参数
+} u4g_sock_config_t;
+
+emU4GResult u4g_sock_start(const u4g_sock_config_t *config);
+emU4GResult u4g_sock_send(const uint8_t *data, size_t len);
+void u4g_sock_reset(void);
+bool u4g_sock_is_connected(void);
+
+#endif
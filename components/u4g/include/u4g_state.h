@@ -25,6 +25,7 @@ typedef enum
     // U4G_STATE_HTTP_NOT_CLIENT = -1024, // 无空闲客户端
     U4G_STATE_AT_NO_CLIENT_IDLE = -1024, // 无空闲客户端
     U4G_STATE_AT_NET_NOT,                // 未驻网/未联网
+    U4G_STATE_AT_SIM_NOT,                // SIM卡未插入/未就绪
 
     // U4G_STATE_AT_ALREADY_INIT = (-4099),       // 表示AT模块已初始化
     // U4G_STATE_SYS_DEPEND_MALLOC_FAILED = -513, // 申请内存失败 (-0x0201)
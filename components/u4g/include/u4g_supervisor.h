@@ -0,0 +1,60 @@
+#ifndef _U4G_SUPERVISOR_H_
+#define _U4G_SUPERVISOR_H_
+
+#include "u4g_state.h" // 状态码
+#include <stdbool.h>
+#include <stdint.h>
+
+#define U4G_SUP_TASK_PRIO 6           // 监管任务优先级
+#define U4G_SUP_TASK_STACK 4096
+#define U4G_SUP_SUB_MAX 4             // 状态变化订阅数量上限
+#define U4G_SUP_BACKOFF_BASE_MS 500   // 退避基数(ms)，第n次失败等待 base*2^n 并加随机抖动
+#define U4G_SUP_BACKOFF_MAX_MS 30000  // 退避上限(ms)
+#define U4G_SUP_FAIL_MAX 5            // 同一状态连续失败次数达到后进入降级并升级恢复手段
+#define U4G_SUP_REG_TIMEOUT_MS 600000 // 持续未注册多久视为异常(ms)，每升级一级加倍，信号中断时不频繁复位
+#define U4G_SUP_CHECK_MS 60000        // 数据就绪后主动复查注册状态的间隔(ms)
+#define U4G_SUP_BOOT_WAIT_MS 10000    // 复位后等待 +MATREADY 的最长时间(ms)
+#define U4G_SUP_DATA_FAIL_MAX 3       // 上层连续报告数据业务失败达到后重新检查链路
+#define U4G_SUP_RESTART_INTERVAL_S (6 * 3600) // 因模块故障重启系统的最短间隔(s)，未到间隔时只硬复位模块
+
+/**
+ * 模块连接状态：前五个状态逐级推进，任一级检查失败回退到能重新检查的位置
+ */
+typedef enum
+{
+    U4G_SUP_OFFLINE,    // 模块无响应（上电、复位中）
+    U4G_SUP_AT_ALIVE,   // 模块响应AT
+    U4G_SUP_SIM_READY,  // SIM卡就绪
+    U4G_SUP_REGISTERED, // 已注册网络
+    U4G_SUP_DATA_READY, // 已附着分组域，数据业务可用
+    U4G_SUP_DEGRADED,   // 连续失败，正在升级恢复（软重启 -> 硬复位 -> 系统重启）；无SIM卡/无信号只复位模块
+    U4G_SUP_STATE_MAX,
+} u4g_sup_state_t;
+
+/**
+ * 恢复手段，按顺序升级；到达数据就绪后回到最低级。
+ * 当前等级保存在RTC内存中，系统重启后继续（掉电后从最低级开始）
+ */
+typedef enum
+{
+    U4G_SUP_ACTION_SOFT_RESET, // AT+MREBOOT
+    U4G_SUP_ACTION_HARD_RESET, // 复位引脚
+    U4G_SUP_ACTION_RESTART,    // esp_restart
+} u4g_sup_action_t;
+
+/**
+ * @brief 状态变化回调，运行在监管任务中，不要在回调里长时间阻塞
+ * @param from 原状态
+ * @param to 新状态
+ * @param arg 订阅时传入的用户参数
+ */
+typedef void (*u4g_sup_cb_t)(u4g_sup_state_t from, u4g_sup_state_t to, void *arg);
+
+emU4GResult u4g_sup_start(void);
+emU4GResult u4g_sup_subscribe(u4g_sup_cb_t cb, void *arg);
+u4g_sup_state_t u4g_sup_state_get(void);
+bool u4g_sup_wait(u4g_sup_state_t state, uint32_t timeout_ms);
+void u4g_sup_data_report(bool ok);
+const char *u4g_sup_state_name(u4g_sup_state_t state);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _U4G_TRACE_H_
+#define _U4G_TRACE_H_
+
+#include "u4g_state.h" // 状态码
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define U4G_TRACE_ENABLE 1          // 1: 记录AT收发轨迹 0: 不记录（接口保留为空操作）
+#define U4G_TRACE_REC_MAX 4096      // 记录条数，存放在PSRAM，写满后覆盖最旧的记录
+#define U4G_TRACE_DATA_MAX 48       // 每条记录保存的数据字节数上限，超出部分只记录长度
+#define U4G_TRACE_DUMP_PER_LINE 4   // 导出时每行包含的记录数
+#define U4G_TRACE_CMD_NONE 0xFF     // 没有正在执行的指令（URC、透传数据等）
+#define U4G_TRACE_VERSION 1         // 导出格式版本，主机解析脚本据此校验
+
+/**
+ * 记录类型
+ */
+typedef enum
+{
+    U4G_TRACE_TX,   // 发往模块的数据块
+    U4G_TRACE_RX,   // 从模块收到的数据块（驱动一次读出的原始字节，不按行切分）
+    U4G_TRACE_DONE, // 指令结束，数据为 int32_t 结果码
+} u4g_trace_dir_t;
+
+/**
+ * 一条轨迹记录，导出时按小端原样输出，格式变化需同步修改 U4G_TRACE_VERSION 与解析脚本
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t t_us;                    // esp_timer 时间戳低32位(us)，约71分钟回绕一次，解析时按顺序展开
+    uint16_t len;                     // 数据块原始长度
+    uint8_t dir;                      // u4g_trace_dir_t
+    uint8_t cmd;                      // 记录时正在执行的 emATCmd，无则为 U4G_TRACE_CMD_NONE
+    uint8_t data[U4G_TRACE_DATA_MAX]; // 数据前 U4G_TRACE_DATA_MAX 字节
+} u4g_trace_rec_t;
+
+emU4GResult u4g_trace_init(void);
+void u4g_trace_record(u4g_trace_dir_t dir, const void *data, size_t len);
+void u4g_trace_record_cmd(u4g_trace_dir_t dir, uint8_t cmd, const void *data, size_t len);
+void u4g_trace_enable(bool enable);
+void u4g_trace_clear(void);
+uint32_t u4g_trace_dump(void);
+
+#endif
@@ -13,14 +13,30 @@
 #define UART_H
 
 #include "esp_err.h"
+#include "u4g_ring.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#define U4G_UART_BAUD_DEFAULT 9600 // 模块出厂波特率
+#ifndef U4G_UART_PATTERN_MODE
+#define U4G_UART_PATTERN_MODE 1 // 1: 按'\n'模式检测唤醒接收任务，只在收到完整行时处理；0: 每次 UART_DATA 都读取
+#endif
+#ifndef U4G_UART_HW_FLOWCTRL
+#define U4G_UART_HW_FLOWCTRL 0 // 1: 启用RTS/CTS硬件流控（需连接RTS/CTS引脚）
+#endif
+#ifndef U4G_CMUX_ENABLE
+#define U4G_CMUX_ENABLE 0 // 1: 模块就绪后切换到 27.010 CMUX 复用，控制与数据类指令在不同虚拟通道上并行（见 u4g_cmux.h）
+#endif
+
 extern TaskHandle_t uart_recv_task_handle;
 
 esp_err_t u4g_uart_init(void);
 int32_t u4g_uart_send(const char *p_data, uint16_t len);
 void u4g_uart_reset(void);
+esp_err_t u4g_uart_baud_set(uint32_t baud);
+uint32_t u4g_uart_baud_get(void);
+uint32_t u4g_uart_overflow_get(void);
+void u4g_uart_ring_stat_get(u4g_ring_stat_t *out);
 
 #endif
\ No newline at end of file
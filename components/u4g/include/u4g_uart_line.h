@@ -0,0 +1,50 @@
+#ifndef _U4G_UART_LINE_H_
+#define _U4G_UART_LINE_H_
+
+#include "u4g_state.h" // 状态码
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define U4G_UART_LINE_MAX (U4G_UART_RX_BUF_SIZE + 128) // 单行最大长度（HTTP分包数据+URC头部）
+
+/**
+ * @brief 完整行回调
+ * @param line 行数据，保留结尾的"\r\n"并以'\0'结尾；提示符">"单独成行；超长行按 U4G_UART_LINE_MAX 分段输出（无"\r\n"结尾）
+ * @param len  行数据长度
+ * @param raw  为 true 时是透传的内容数据（按字节数截取，不按换行切分）
+ * @param arg  初始化时传入的用户参数
+ * @return 紧随本行之后需原样透传的字节数（URC 声明了长度的内容数据），0 表示继续按行切分；透传数据的返回值被忽略
+ */
+typedef size_t (*u4g_uart_line_cb_t)(char *line, size_t len, bool raw, void *arg);
+
+/**
+ * @brief 行首收到">"时询问是否有指令正在等待数据输入提示符
+ * @param arg 初始化时传入的用户参数
+ * @return 正在等待提示符返回 true，否则">"按普通字符处理
+ */
+typedef bool (*u4g_uart_line_prompt_cb_t)(void *arg);
+
+/**
+ * 增量行切分器
+ * UART 读到多少字节就喂多少字节，按"\r\n"切分为完整行后交给 AT 层；
+ * 一条应答跨多次读取时自动拼接。只有指令正在等待数据输入提示符时，行首的">"才立即作为提示符输出，无需等待换行；
+ * 行回调声明随后有多少字节内容时进入透传模式，这些字节（可能含空行、">"）原样输出，不做切分。
+ * 每个字节流（串口、CMUX各虚拟通道）各用一个实例
+ */
+typedef struct
+{
+    char buf[U4G_UART_LINE_MAX + 1];     // 当前行缓存（+1 给'\0'）
+    size_t len;                          // 当前行已缓存长度
+    size_t raw;                          // 透传模式下剩余的字节数，0 表示按行切分
+    bool prompt;                         // 刚输出过">"提示符，忽略紧随其后的一个空格
+    u4g_uart_line_cb_t cb;               // 完整行回调
+    u4g_uart_line_prompt_cb_t prompt_cb; // 提示符询问回调，为NULL时不识别提示符
+    void *arg;                           // 回调参数
+} u4g_uart_line_t;
+
+void u4g_uart_line_init(u4g_uart_line_t *ctx, u4g_uart_line_cb_t cb, u4g_uart_line_prompt_cb_t prompt_cb, void *arg);
+void u4g_uart_line_reset(u4g_uart_line_t *ctx);
+void u4g_uart_line_feed(u4g_uart_line_t *ctx, const uint8_t *data, size_t len);
+
+#endif
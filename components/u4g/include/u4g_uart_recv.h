@@ -3,9 +3,15 @@
 
 #include "u4g_state.h" // 状态码
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+emU4GResult u4g_uart_recv_init(void);
 // int32_t u4g_uart_recv_process(uint8_t *pdata, uint32_t size);
-emU4GResult u4g_uart_recv_process(char *data, uint32_t size);
+emU4GResult u4g_uart_recv_process(uint8_t chan, char *data, uint32_t size);
+emU4GResult u4g_uart_recv_content(char *data, uint32_t size);
+void u4g_uart_recv_raw(size_t n);
+size_t u4g_uart_recv_raw_take(void);
+bool u4g_uart_recv_prompt_wait(uint8_t chan);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef _U4G_URC_H_
+#define _U4G_URC_H_
+
+#include "u4g_state.h" // 状态码
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define U4G_URC_SUB_MAX 12    // 订阅数量上限
+#define U4G_URC_QUEUE_LEN 8   // 待分发URC队列深度
+#define U4G_URC_TASK_PRIO 3   // 分发任务优先级（低于串口接收任务）
+#define U4G_URC_TASK_STACK 4096
+
+// 常用URC前缀
+#define U4G_URC_CEREG "+CEREG: "        // 网络注册状态变化（需 AT+CEREG=1 开启上报）
+#define U4G_URC_MHTTPURC "+MHTTPURC: "  // HTTP 请求结果/内容
+#define U4G_URC_MATREADY "+MATREADY"    // 模块启动完成（上电或重启）
+#define U4G_URC_MQTTURC "+MQTTURC: "    // MQTT 连接状态、订阅/发布应答与收到的消息
+#define U4G_URC_MIPOPEN "+MIPOPEN: "    // 套接字连接结果
+#define U4G_URC_MIPURC "+MIPURC: "      // 套接字收到的数据与对端断开
+
+/**
+ * @brief URC回调，运行在URC分发任务中，可以在回调里发送AT指令
+ * @param line URC整行（含"\r\n"，以'\0'结尾），回调返回后释放
+ * @param arg  订阅时传入的用户参数
+ */
+typedef void (*u4g_urc_cb_t)(const char *line, void *arg);
+
+emU4GResult u4g_urc_init(void);
+emU4GResult u4g_urc_subscribe(const char *prefix, u4g_urc_cb_t cb, void *arg);
+bool u4g_urc_dispatch(const char *line, size_t len);
+
+#endif
@@ -1,8 +1,14 @@
 #include "u4g.h"
 #include "u4g_state.h"
 #include "u4g_uart.h"
+#include "u4g_uart_recv.h"
+#include "u4g_urc.h"
 #include "u4g_at_cmd.h"
 #include "u4g_at_http.h"
+#include "u4g_baud.h"
+#include "u4g_supervisor.h"
+#include "u4g_trace.h"
+#include "u4g_ppp.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 
@@ -10,6 +16,23 @@
 
 emU4GResult u4g_init(void)
 {
+    // 收发轨迹需在UART启动前就绪，才能记录到复位与波特率协商过程；失败不影响通信
+    u4g_trace_init();
+
+    // 应答匹配表需在接收任务启动前就绪
+    if (u4g_uart_recv_init() != U4G_OK)
+    {
+        ESP_LOGE(TAG, "应答匹配表初始化失败");
+        return U4G_FAIL;
+    }
+
+    // URC分发任务需在接收任务启动前就绪
+    if (u4g_urc_init() != U4G_OK)
+    {
+        ESP_LOGE(TAG, "URC分发初始化失败");
+        return U4G_FAIL;
+    }
+
     // 初始化UART
     if (u4g_uart_init() != U4G_OK)
     {
@@ -24,10 +47,35 @@ emU4GResult u4g_init(void)
         return U4G_FAIL;
     }
 
+    // 协商高速波特率，失败时保持当前速率继续运行
+    if (u4g_baud_negotiate() != U4G_OK)
+    {
+        ESP_LOGW(TAG, "波特率协商失败");
+    }
+#if U4G_UART_HW_FLOWCTRL
+    // 本端已启用RTS/CTS，模块侧同步开启
+    u4g_at_flowctrl(true);
+#endif
+
     if (u4g_at_http_init() != U4G_OK)
     {
         ESP_LOGE(TAG, "u4g_at_http_init初始化失败");
         return U4G_FAIL;
     }
+
+#if U4G_PPP_ENABLE
+    // 需在监管任务启动前订阅状态变化，数据就绪后自动拨号
+    if (u4g_ppp_init() != U4G_OK)
+    {
+        ESP_LOGW(TAG, "PPP初始化失败，HTTP继续使用模块协议栈");
+    }
+#endif
+
+    // 模块连接状态监管：SIM、注册、附着检查与故障恢复
+    if (u4g_sup_start() != U4G_OK)
+    {
+        ESP_LOGE(TAG, "模块监管任务启动失败");
+        return U4G_FAIL;
+    }
     return U4G_OK;
 }
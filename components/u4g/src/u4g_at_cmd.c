@@ -2,38 +2,131 @@
 #include "u4g_state.h"
 #include "u4g_uart.h"
 #include "u4g_data.h"
+#include "u4g_urc.h"
+#include "u4g_at_sched.h"
+#include "u4g_trace.h"
+#include "u4g_cmux.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "esp_task_wdt.h" // 包含看门狗相关库
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>       // 增加字符串操作支持
 #include "driver/uart.h"  // 包含 UART 驱动头文件
+#include "esp_timer.h"    // 指令耗时统计
+#include "nvs.h"          // RTT估计值跨重启保存
 
 #define TAG "U4G-AT-CMD"
 
-static SemaphoreHandle_t cmd_mutex = NULL;          // 发送数据互斥锁
-SemaphoreHandle_t u4g_at_cmd_semaphore_sync = NULL; // 发送数据响应同步信号量
-u4g_at_cmd_handle_t u4g_at_cmd_handle = {0};
+#define U4G_AT_IDLE_BIT(chan) (1 << (chan))          // 通道空闲：已收到上一条指令的最终结果码
+#define U4G_AT_IDLE_ALL ((1 << U4G_AT_CHAN_NUM) - 1) // 全部通道空闲
+
+static SemaphoreHandle_t cmd_sync[U4G_AT_CHAN_NUM];  // 各通道的应答同步信号量
+static EventGroupHandle_t cmd_event = NULL;          // 各通道空闲状态
+static portMUX_TYPE stat_lock = portMUX_INITIALIZER_UNLOCKED; // 耗时统计与RTT估计（多个通道共用）
+static u4g_at_cmd_stat_t cmd_stat[U4G_AT_CMD_MAX]; // 各指令耗时统计
+
+/**
+ * 单条指令的往返时间估计（RFC 6298 的 SRTT/RTTVAR），按 emATCmd 索引写入NVS
+ * 调整 emATCmd 后长度变化，旧数据整体丢弃
+ */
+typedef struct
+{
+    uint32_t srtt_us;   // 平滑往返时间(us)
+    uint32_t rttvar_us; // 往返时间偏差(us)
+    uint16_t samples;   // 已采样次数（饱和）
+    uint8_t backoff;    // 连续超时次数，每次超时超时时间加倍，成功后清零（不保存）
+    uint8_t reserved;
+} u4g_at_rtt_t;
+static u4g_at_rtt_t cmd_rtt[U4G_AT_CMD_MAX];
+static uint32_t rtt_unsaved = 0; // 上次写NVS后的新样本数
+u4g_at_cmd_handle_t u4g_at_cmd_handle[U4G_AT_CHAN_NUM] = {0};
+
+static emU4GResult handler_imei(char *rsp);
+static emU4GResult handler_cereg(char *rsp);
+static emU4GResult handler_time(char *rsp);
+static emU4GResult handler_mccid(char *rsp);
+static emU4GResult handler_csq(char *rsp);
+static emU4GResult handler_cpin(char *rsp);
+static emU4GResult handler_cgatt(char *rsp);
+static void rtt_load(void);
+
+/**
+ * AT指令应答描述表（按 emATCmd 索引）
+ * 前缀会在初始化时编入接收侧的前缀树，每行应答按行长度一次匹配完成分类
+ */
+static const u4g_at_desc_t at_desc_table[U4G_AT_CMD_MAX] = {
+    [U4G_AT_CMD] = {NULL, U4G_AT_FINAL_ANY, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_CEREG] = {"+CEREG: ", U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, handler_cereg},
+    [U4G_AT_CMD_REBOOT] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_IMEI] = {"+CGSN: ", U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, handler_imei},
+    [U4G_AT_CMD_ATE] = {NULL, U4G_AT_FINAL_ANY, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_SSL_AUTH] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_HTTP_CREATE] = {"+MHTTPCREATE:", U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_HTTP_HEADER] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_HTTP_TIMEOUT] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_HTTP_ENCODING] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_HTTP_SSL] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_HTTP_FRAGMENT] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_HTTP_BODY] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_HTTP_REQUEST] = {"+MHTTPURC: ", U4G_AT_FINAL_URC, U4G_AT_LINES_CONT, NULL},
+    [U4G_AT_CMD_HTTP_DELETE] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_TIME] = {"+CCLK: ", U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, handler_time},
+    [U4G_AT_CMD_MCCID] = {"+MCCID: ", U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, handler_mccid},
+    [U4G_AT_CMD_CSQ] = {"+CSQ: ", U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, handler_csq},
+    [U4G_AT_CMD_CEREG_SET] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_IPR] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_IFC] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_CPIN] = {"+CPIN: ", U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, handler_cpin},
+    [U4G_AT_CMD_CGATT] = {"+CGATT: ", U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, handler_cgatt},
+    [U4G_AT_CMD_CMUX] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_CGDCONT] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_DIAL] = {"CONNECT", U4G_AT_FINAL_URC, U4G_AT_LINES_SINGLE, NULL, true},
+    [U4G_AT_CMD_MQTT_CFG] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_MQTT_CONN] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL, true},
+    [U4G_AT_CMD_MQTT_SUB] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL, true},
+    [U4G_AT_CMD_MQTT_PUB] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL, true},
+    [U4G_AT_CMD_MQTT_DISC] = {NULL, U4G_AT_FINAL_ANY, U4G_AT_LINES_SINGLE, NULL, true},
+    [U4G_AT_CMD_SOCK_CFG] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+    [U4G_AT_CMD_SOCK_OPEN] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL, true},
+    [U4G_AT_CMD_SOCK_SEND] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL, true},
+    [U4G_AT_CMD_SOCK_CLOSE] = {NULL, U4G_AT_FINAL_ANY, U4G_AT_LINES_SINGLE, NULL, true},
+    [U4G_AT_CMD_SAVE] = {NULL, U4G_AT_FINAL_OK, U4G_AT_LINES_SINGLE, NULL},
+};
 
 /**
  * @brief 初始化AT命令处理模块
  * @return emU4GResult 状态码，成功返回U4G_OK，否则返回错误码
  */
+// 模块重启后不会再回复重启前的指令，直接视为空闲
+static void urc_matready(const char *line, void *arg)
+{
+    ESP_LOGW(TAG, "4G模块已重启");
+    u4g_at_cmd_idle_notify(U4G_AT_CHAN_ANY);
+}
+
 emU4GResult u4g_at_cmd_init(void)
 {
-    cmd_mutex = xSemaphoreCreateMutex();
-    if (cmd_mutex == NULL)
-    { // 互斥锁创建失败
-        ESP_LOGE(TAG, "创建命令互斥锁失败");
-        return U4G_FAIL;
+    for (int i = 0; i < U4G_AT_CHAN_NUM; i++)
+    {
+        cmd_sync[i] = xSemaphoreCreateBinary();
+        if (!cmd_sync[i])
+        {
+            ESP_LOGE(TAG, "发送数据响应同步信号量创建失败");
+            return U4G_FAIL;
+        }
     }
-    u4g_at_cmd_semaphore_sync = xSemaphoreCreateBinary();
-    if (!u4g_at_cmd_semaphore_sync)
+    cmd_event = xEventGroupCreate();
+    if (!cmd_event)
     {
-        ESP_LOGE(TAG, "发送数据响应同步信号量创建失败");
-        vSemaphoreDelete(cmd_mutex);
+        ESP_LOGE(TAG, "模块空闲事件组创建失败");
         return U4G_FAIL;
     }
+    xEventGroupSetBits(cmd_event, U4G_AT_IDLE_ALL); // 上电后没有未完成的指令
+    u4g_urc_subscribe(U4G_URC_MATREADY, urc_matready, NULL);
+    memset(cmd_stat, 0, sizeof(cmd_stat));
+    rtt_load();
     if (u4g_data_init() != U4G_OK)
     {
         ESP_LOGE(TAG, "数据模块初始化失败");
@@ -43,88 +136,328 @@ emU4GResult u4g_at_cmd_init(void)
     return U4G_OK;
 }
 
+// 读取上次保存的RTT估计值，没有或长度不符时从零开始
+static void rtt_load(void)
+{
+    memset(cmd_rtt, 0, sizeof(cmd_rtt));
+    nvs_handle_t handle;
+    if (nvs_open(U4G_AT_RTT_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK)
+    {
+        return;
+    }
+    size_t len = sizeof(cmd_rtt);
+    if (nvs_get_blob(handle, U4G_AT_RTT_NVS_KEY, cmd_rtt, &len) != ESP_OK || len != sizeof(cmd_rtt))
+    {
+        memset(cmd_rtt, 0, sizeof(cmd_rtt));
+    }
+    nvs_close(handle);
+    for (int i = 0; i < U4G_AT_CMD_MAX; i++)
+    {
+        cmd_rtt[i].backoff = 0;
+    }
+}
+
+static void rtt_save(void)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(U4G_AT_RTT_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK)
+    {
+        err = nvs_set_blob(handle, U4G_AT_RTT_NVS_KEY, cmd_rtt, sizeof(cmd_rtt));
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "保存RTT估计值失败: %s", esp_err_to_name(err));
+    }
+}
+
 /**
- * @brief 同步发送AT命令并等待响应
- * @param cmd 指向AT命令结构体的指针
- * @return emU4GResult 发送结果，成功返回U4G_OK，否则返回错误码
+ * @brief 指令是否由模块自身应答：只有这类指令的耗时稳定，按RTT估计缩短超时。
+ * 以 URC 结束或取决于网络的指令（HTTP请求、拨号、MQTT/Socket建连与发送）等待期间没有中间行，
+ * 耗时随网络变化，缩短后会把正常的慢响应误判为超时
  */
-emU4GResult u4g_at_cmd_sync(const u4g_at_cmd_t *config)
+static bool rtt_adaptive(emATCmd name)
 {
-    ESP_LOGW(TAG, "u4g_at_cmd_sync 开始");
-    if (config == NULL)
+    return name < U4G_AT_CMD_MAX && at_desc_table[name].final != U4G_AT_FINAL_URC && !at_desc_table[name].network;
+}
+
+/**
+ * @brief 由RTT估计计算本次的应答超时
+ * @param name 指令别名
+ * @param max_ms 调用方给定的上限
+ * @return 超时(ms)，样本不足或非模块自身应答的指令为上限
+ */
+static uint32_t rtt_timeout(emATCmd name, uint32_t max_ms)
+{
+    if (!rtt_adaptive(name) || cmd_rtt[name].samples < U4G_AT_RTT_MIN_SAMPLES)
     {
-        ESP_LOGE(TAG, "AT命令指针为空");
-        return U4G_ERR_INVALID_ARG;
+        return max_ms;
     }
-    // 获取互斥锁成功，可以访问共享资源
-    if (xSemaphoreTake(cmd_mutex, pdMS_TO_TICKS(5000)) != pdTRUE)
+    const u4g_at_rtt_t *rtt = &cmd_rtt[name];
+    uint32_t var_ms = rtt->rttvar_us * 4 / 1000;
+    uint32_t rto = rtt->srtt_us / 1000 + (var_ms > U4G_AT_RTO_GRANULARITY_MS ? var_ms : U4G_AT_RTO_GRANULARITY_MS);
+    rto <<= rtt->backoff;
+    if (rto < U4G_AT_RTO_MIN_MS)
     {
-        ESP_LOGE(TAG, "u4g_at_cmd_sync-获取命令锁超时");
-        xSemaphoreGive(cmd_mutex);
-        return U4G_ERR_TIMEOUT;
+        rto = U4G_AT_RTO_MIN_MS;
+    }
+    return rto < max_ms ? rto : max_ms;
+}
+
+/**
+ * @brief 用一次完成的指令更新RTT估计
+ * 只采样模块自身应答且正常完成的指令（含 ERROR 应答）；超时没有有效样本，只加倍下次的超时
+ */
+static void rtt_update(emATCmd name, emU4GResult result, uint32_t elapsed_us)
+{
+    if (!rtt_adaptive(name))
+    {
+        return;
+    }
+    u4g_at_rtt_t *rtt = &cmd_rtt[name];
+    if (result == U4G_ERR_TIMEOUT)
+    {
+        if (rtt->backoff < 4)
+        {
+            rtt->backoff++;
+        }
+        return;
+    }
+    if (result == U4G_STATE_AT_UART_TX_FAILED)
+    {
+        return;
+    }
+    rtt->backoff = 0;
+    if (rtt->samples == 0)
+    {
+        rtt->srtt_us = elapsed_us;
+        rtt->rttvar_us = elapsed_us / 2;
+    }
+    else
+    {
+        // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|，SRTT = 7/8 SRTT + 1/8 R
+        uint32_t err = rtt->srtt_us > elapsed_us ? rtt->srtt_us - elapsed_us : elapsed_us - rtt->srtt_us;
+        rtt->rttvar_us = rtt->rttvar_us - rtt->rttvar_us / 4 + err / 4;
+        rtt->srtt_us = rtt->srtt_us - rtt->srtt_us / 8 + elapsed_us / 8;
+    }
+    if (rtt->samples < UINT16_MAX)
+    {
+        rtt->samples++;
+    }
+    rtt_unsaved++;
+}
+
+/**
+ * @brief 记录一次指令耗时
+ */
+static void cmd_stat_record(emATCmd name, emU4GResult result, uint32_t elapsed_us)
+{
+    if (name >= U4G_AT_CMD_MAX)
+    {
+        return;
+    }
+    u4g_at_cmd_stat_t *stat = &cmd_stat[name];
+    stat->count++;
+    if (result != U4G_OK)
+    {
+        stat->fail++;
+    }
+    if (result == U4G_ERR_TIMEOUT)
+    {
+        stat->timeout++;
     }
-    vTaskDelay(pdMS_TO_TICKS(2500));
+    stat->last_us = elapsed_us;
+    stat->total_us += elapsed_us;
+    if (elapsed_us > stat->max_us)
+    {
+        stat->max_us = elapsed_us;
+    }
+}
 
-    // 获取当前任务的优先级
-    UBaseType_t uxCurrentPriority = uxTaskPriorityGet(NULL);
-    // 提升任务优先级
-    vTaskPrioritySet(NULL, 15); // 假设 10 是较高的优先级
-    ESP_LOGI(TAG, "为u4g_at_cmd_sync临时提升优先级原 %d|现%d", uxCurrentPriority, 15);
+// 按通道发出数据：CMUX已建立（或正在建立）时封装为对应虚拟通道的帧，否则直接写串口
+static int32_t cmd_chan_send(uint8_t chan, const char *data, uint16_t len)
+{
+#if U4G_CMUX_ENABLE
+    if (u4g_cmux_state_get() != U4G_CMUX_OFF)
+    {
+        return u4g_cmux_write(U4G_CMUX_DLCI_AT(chan), (const uint8_t *)data, len);
+    }
+#endif
+    return u4g_uart_send(data, len);
+}
+
+/**
+ * @brief 在已获得执行权的通道上执行一条指令，释放执行权前调用
+ * @param save 输出是否需要在释放执行权后保存RTT估计值
+ */
+static emU4GResult cmd_exec(uint8_t chan, const u4g_at_cmd_t *config, bool *save)
+{
+    u4g_at_cmd_handle_t *h = &u4g_at_cmd_handle[chan];
+    EventBits_t idle_bit = U4G_AT_IDLE_BIT(chan);
+    // 等待模块空闲：上一条指令超时后其最终结果码可能仍在路上，避免与本条应答混淆
+    if (!(xEventGroupWaitBits(cmd_event, idle_bit, pdFALSE, pdTRUE, pdMS_TO_TICKS(U4G_AT_CMD_IDLE_WAIT_MS)) & idle_bit))
+    {
+        ESP_LOGW(TAG, "等待模块空闲超时，继续发送: %s", config->cmd);
+    }
+    xSemaphoreTake(cmd_sync[chan], 0); // 丢弃上一条指令迟到的应答信号
 
     // 初始化命令上下文
-    u4g_at_cmd_handle.cmd_content = config;
-    // u4g_at_cmd_handle.state = AT_MSG_NOT; // 无数据
-    u4g_at_cmd_handle.result = U4G_ERR_INVALID_ARG;
+    h->cmd_content = config;
+    h->result = U4G_ERR_INVALID_ARG;
+    h->matched = false;
+    h->rsp = U4G_OK;
+    h->progress = 0;
+    xEventGroupClearBits(cmd_event, idle_bit);
 
-    ESP_LOGI(TAG, "发送 AT 指令: %s | 字节%d", config->cmd, config->cmd_len); // 发送AT命令
-    int32_t send = u4g_uart_send(config->cmd, config->cmd_len);               // 发送命令
+    portENTER_CRITICAL(&stat_lock); // 另一通道可能正在更新同一指令的RTT估计
+    uint32_t timeout = rtt_timeout(config->name, config->timeout ? config->timeout : U4G_AT_CMD_TIMEOUT_DEFAULT);
+    portEXIT_CRITICAL(&stat_lock);
+    int64_t start_us = esp_timer_get_time();
+    ESP_LOGD(TAG, "发送 AT 指令[通道%d]: %s | 字节%d", chan, config->cmd, config->cmd_len); // 发送AT命令
+    int32_t send = cmd_chan_send(chan, config->cmd, config->cmd_len);                       // 发送命令
+    emU4GResult result;
     if (send < U4G_OK)
     {
         ESP_LOGE(TAG, "发送AT命令失败: %ld", send);
-        xSemaphoreGive(cmd_mutex);
-        return AT_FAIL;
+        result = U4G_STATE_AT_UART_TX_FAILED;
+        xEventGroupSetBits(cmd_event, idle_bit); // 未发出，模块仍空闲
     }
-
-    emU4GResult result = U4G_STATE_AT_GET_RSP_FAILED; // 响应超时
-    // ESP_LOGW(TAG, "AT测试阶段：1");
-    TickType_t start_time = xTaskGetTickCount();
-    // ESP_LOGW(TAG, "AT测试阶段：2");
-    while ((xTaskGetTickCount() - start_time) < pdMS_TO_TICKS(config->timeout + 1000))
+    else
     {
-        vTaskDelay(pdMS_TO_TICKS(10));
-        // ESP_LOGW(TAG, "AT测试阶段：3");
-        // esp_task_wdt_reset();
-        // if (xSemaphoreTake(u4g_at_cmd_semaphore_sync, portMAX_DELAY)) // 等待信号量
-        if (xSemaphoreTake(u4g_at_cmd_semaphore_sync, pdMS_TO_TICKS(3000))) // 等待信号量
+        // 超时内仍有应答行到达则继续等待，长响应的总耗时不受单次超时限制
+        uint32_t progress = 0;
+        bool done;
+        while (!(done = (xSemaphoreTake(cmd_sync[chan], pdMS_TO_TICKS(timeout)) == pdTRUE)) && progress != h->progress)
+        {
+            progress = h->progress;
+            esp_task_wdt_reset();
+        }
+        if (done)
         {
-            // 获取信号量，处理数据
-            ESP_LOGI(TAG, "获取信号量，处理数据");
-            result = u4g_at_cmd_handle.result;
-            // ESP_LOGW(TAG, "AT测试阶段：4");
-            ESP_LOGD(TAG, "收到AT命令[%10s]响应: %d", u4g_at_cmd_handle.cmd_content->cmd, u4g_at_cmd_handle.result);
-            break;
+            result = h->result;
         }
         else
         {
-            // ESP_LOGW(TAG, "AT测试阶段：4-1");
-            ESP_LOGE(TAG, "AT命令[%20s]响应超时", config->cmd);
+            ESP_LOGE(TAG, "AT命令[%.20s]响应超时(%lums)", config->cmd, timeout);
+            result = U4G_ERR_TIMEOUT;
         }
-        vTaskDelay(pdMS_TO_TICKS(100));
-        // ESP_LOGW(TAG, "AT测试阶段：5");
-    }
-    // ESP_LOGW(TAG, "AT测试阶段：6");
-    // 执行完成后恢复原始优先级
-    vTaskPrioritySet(NULL, uxCurrentPriority);
-    ESP_LOGI(TAG, "u4g_at_cmd_sync临时优先级已恢复为%d", uxCurrentPriority);
-    // ESP_LOGW(TAG, "AT测试阶段：7");
+    }
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    u4g_trace_record_cmd(U4G_TRACE_DONE, config->name, &result, sizeof(result));
     // 清理上下文
-    u4g_at_cmd_handle.cmd_content = NULL;
-    // ESP_LOGW(TAG, "AT测试阶段：8");
-    xSemaphoreGive(cmd_mutex); // 释放互斥锁
-    // ESP_LOGW(TAG, "AT测试阶段：9");
+    h->cmd_content = NULL;
+    portENTER_CRITICAL(&stat_lock); // 多个通道同时结束指令
+    cmd_stat_record(config->name, result, elapsed_us);
+    rtt_update(config->name, result, elapsed_us);
+    *save = rtt_unsaved >= U4G_AT_RTT_SAVE_EVERY;
+    if (*save)
+    {
+        rtt_unsaved = 0;
+    }
+    portEXIT_CRITICAL(&stat_lock);
+    ESP_LOGI(TAG, "AT指令[%d]完成: 结果%d | 耗时%lu.%03lums | 超时%lums", config->name, result, elapsed_us / 1000, elapsed_us % 1000, timeout);
     return result;
 }
 
+/**
+ * @brief 同步发送AT命令并等待响应
+ * 按调用任务的等级排队获取执行权（见 u4g_at_sched.h），模块空闲（上一条指令已收到最终结果码）即发送，
+ * 随后在同步信号量上按指令的实际超时阻塞等待
+ * @param cmd 指向AT命令结构体的指针
+ * @return emU4GResult 发送结果，成功返回U4G_OK，否则返回错误码
+ */
+emU4GResult u4g_at_cmd_sync(const u4g_at_cmd_t *config)
+{
+    if (config == NULL || config->cmd == NULL)
+    {
+        ESP_LOGE(TAG, "AT命令指针为空");
+        return U4G_ERR_INVALID_ARG;
+    }
+    // 按等级排队，高等级在当前指令结束时优先获得执行权
+    uint8_t chan;
+    if (u4g_at_sched_acquire(U4G_AT_CMD_LOCK_TIMEOUT, &chan) != U4G_OK)
+    {
+        ESP_LOGE(TAG, "u4g_at_cmd_sync-获取命令执行权超时");
+        return U4G_ERR_TIMEOUT;
+    }
+    bool save = false;
+    emU4GResult result = cmd_exec(chan, config, &save);
+    u4g_at_sched_release(chan); // 交给等待中的最高等级
+    if (save)
+    {
+        rtt_save(); // 释放执行权后再写flash，不阻塞其他指令
+    }
+    return result;
+}
+
+/**
+ * @brief 接收侧通知当前指令已得到结果，唤醒 u4g_at_cmd_sync
+ * @param chan 指令所在通道
+ * @param result 指令处理结果
+ */
+void u4g_at_cmd_finish(uint8_t chan, emU4GResult result)
+{
+    if (chan >= U4G_AT_CHAN_NUM || u4g_at_cmd_handle[chan].cmd_content == NULL)
+    {
+        return; // 指令已超时返回，丢弃迟到的结果
+    }
+    u4g_at_cmd_handle[chan].result = result;
+    xSemaphoreGive(cmd_sync[chan]); // 释放信号量，通知消费者
+}
+
+/**
+ * @brief 接收侧收到最终结果码（OK/ERROR/+CME ERROR），该通道可接收下一条指令
+ * @param chan 通道，U4G_AT_CHAN_ANY 表示全部通道（模块重启）
+ */
+void u4g_at_cmd_idle_notify(uint8_t chan)
+{
+    if (cmd_event)
+    {
+        xEventGroupSetBits(cmd_event, chan < U4G_AT_CHAN_NUM ? U4G_AT_IDLE_BIT(chan) : U4G_AT_IDLE_ALL);
+    }
+}
+
+/**
+ * @brief 获取指令的应答描述
+ * @param name 指令别名
+ * @return 描述表项，非法别名返回NULL
+ */
+const u4g_at_desc_t *u4g_at_desc_get(emATCmd name)
+{
+    if (name >= U4G_AT_CMD_MAX)
+    {
+        return NULL;
+    }
+    return &at_desc_table[name];
+}
+
+/**
+ * @brief 获取指定指令的耗时统计
+ * @param name 指令别名
+ * @param out 输出统计数据
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_at_cmd_stat_get(emATCmd name, u4g_at_cmd_stat_t *out)
+{
+    if (name >= U4G_AT_CMD_MAX || out == NULL)
+    {
+        return U4G_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&stat_lock); // 与指令结束时的更新互斥，避免读到一半更新的统计
+    *out = cmd_stat[name];
+    out->srtt_us = cmd_rtt[name].srtt_us;
+    out->rttvar_us = cmd_rtt[name].rttvar_us;
+    out->rto_ms = rtt_timeout(name, U4G_AT_CMD_TIMEOUT_DEFAULT);
+    portEXIT_CRITICAL(&stat_lock);
+    return U4G_OK;
+}
+
 // 发送AT指令
 emU4GResult u4g_at(void)
 {
@@ -149,8 +482,10 @@ static emU4GResult handler_imei(char *rsp)
     if (pt)
     {
         pt += strlen("+CGSN: ");
-        sscanf(pt, "%s", u4g_data.imei);
-        ESP_LOGI(TAG, "IMEI = %s", u4g_data.imei);
+        u4g_data_t *data = u4g_data_write_begin();
+        sscanf(pt, "%23s", data->imei);
+        u4g_data_write_end();
+        ESP_LOGI(TAG, "IMEI = %s", data->imei);
         res = U4G_OK;
     }
     else
@@ -167,8 +502,7 @@ emU4GResult u4g_at_imei_get(void)
         .name = U4G_AT_CMD_IMEI,
         .cmd = "AT+CGSN=1\r\n",
         .cmd_len = 11,
-        .timeout = 5000,
-        .handler = handler_imei};
+        .timeout = 5000};
     emU4GResult ret = u4g_at_cmd_sync(&config);
     if (ret != U4G_OK)
     {
@@ -178,40 +512,55 @@ emU4GResult u4g_at_imei_get(void)
     return U4G_OK;
 }
 
-static emU4GResult handler_cereg(char *rsp)
+/**
+ * @brief 解析 +CEREG 行并区分来源：查询应答为 +CEREG: <n>,<stat>[,...]，
+ * 主动上报为 +CEREG: <stat>[,"<tac>",...]（第二项不是数字）
+ * @param line 整行
+ * @param stat 输出注册状态
+ * @param query 输出是否为查询应答
+ * @return emU4GResult 解析成功返回U4G_OK
+ */
+emU4GResult u4g_at_cereg_parse(const char *line, int *stat, bool *query)
 {
-    char *pt = strstr(rsp, "+CEREG: ");
-    if (pt)
+    const char *pt = strstr(line, "+CEREG: ");
+    if (pt == NULL)
     {
-        pt += strlen("+CEREG: "); // 添加这行，跳过前缀
-        int n = 0, stat = 0;
-        if (sscanf(pt, "%d,%d", &n, &stat) == 2)
-        {
-            ESP_LOGI(TAG, "CEREG: n=%d, stat=%d", n, stat);
-            if (stat == 1 || stat == 5) // 1: 已注册，本地网络; 5: 已注册，漫游
-            {
-                return U4G_OK;
-            }
-            else if (stat == 0)
-            { // 未联网
-                return U4G_STATE_AT_NET_NOT;
-            }
-            else
-            {
-                return U4G_FAIL;
-            }
-        }
-        else
-        {
-            ESP_LOGE(TAG, "字符串格式不正确，无法解析 CEREG 数据: [%s]", pt);
-            return U4G_FAIL;
-        }
+        return U4G_FAIL;
     }
-    else
+    pt += strlen("+CEREG: ");
+    char *end = NULL;
+    long first = strtol(pt, &end, 10);
+    if (end == pt)
+    {
+        return U4G_FAIL;
+    }
+    *query = end[0] == ',' && end[1] >= '0' && end[1] <= '9';
+    *stat = *query ? (int)strtol(end + 1, NULL, 10) : (int)first;
+    return U4G_OK;
+}
+
+static emU4GResult handler_cereg(char *rsp)
+{
+    int stat = 0;
+    bool query = false;
+    if (u4g_at_cereg_parse(rsp, &stat, &query) != U4G_OK)
     {
-        ESP_LOGE(TAG, "未找到 CEREG 字符串");
+        ESP_LOGE(TAG, "字符串格式不正确，无法解析 CEREG 数据: [%s]", rsp);
         return U4G_FAIL;
     }
+    if (!query)
+    {
+        // 查询期间恰好到达的主动上报：交给URC订阅者，继续等待查询应答
+        u4g_urc_dispatch(rsp, strlen(rsp));
+        return U4G_STATE_AT_RSP_WAITING;
+    }
+    ESP_LOGI(TAG, "CEREG: stat=%d", stat);
+    if (stat == 1 || stat == 5) // 1: 已注册，本地网络; 5: 已注册，漫游
+    {
+        return U4G_OK;
+    }
+    // 0 未注册 2 搜网中 3 拒绝 4 未知：均为未联网，由调用方等待而不是当作模块故障
+    return U4G_STATE_AT_NET_NOT;
 }
 
 // 驻网状态查询
@@ -220,8 +569,7 @@ emU4GResult u4g_at_netstatus(void)
     u4g_at_cmd_t config = {
         .name = U4G_AT_CMD_CEREG,
         .cmd = "AT+CEREG?\r\n",
-        .cmd_len = 11,
-        .handler = handler_cereg};
+        .cmd_len = 11};
     emU4GResult ret = u4g_at_cmd_sync(&config);
     if (ret == U4G_STATE_AT_NET_NOT)
     {
@@ -237,6 +585,47 @@ emU4GResult u4g_at_netstatus(void)
     return U4G_OK;
 }
 
+/**
+ * @brief 设置网络注册状态主动上报（AT+CEREG=<n>）
+ * @param n 0 关闭上报，1 注册状态变化时上报 +CEREG: <stat>
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_at_netstatus_report(uint8_t n)
+{
+    char cmd[16];
+    u4g_at_cmd_t config = {
+        .name = U4G_AT_CMD_CEREG_SET,
+        .cmd = cmd,
+        .cmd_len = snprintf(cmd, sizeof(cmd), "AT+CEREG=%u\r\n", n)};
+    emU4GResult ret = u4g_at_cmd_sync(&config);
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "驻网状态上报设置-失败:%d", ret);
+        return U4G_FAIL;
+    }
+    return U4G_OK;
+}
+
+/**
+ * @brief 设置模块串口硬件流控（AT+IFC=<dce_by_dte>,<dte_by_dce>）
+ * @param enable true 双向RTS/CTS，false 关闭
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_at_flowctrl(bool enable)
+{
+    u4g_at_cmd_t config = {
+        .name = U4G_AT_CMD_IFC,
+        .cmd = enable ? "AT+IFC=2,2\r\n" : "AT+IFC=0,0\r\n",
+        .cmd_len = 12};
+    emU4GResult ret = u4g_at_cmd_sync(&config);
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "串口流控设置-失败:%d", ret);
+        return U4G_FAIL;
+    }
+    return U4G_OK;
+}
+
 static emU4GResult handler_time(char *rsp)
 {
     emU4GResult res = U4G_STATE_AT_RSP_WAITING;
@@ -250,7 +639,7 @@ static emU4GResult handler_time(char *rsp)
         if (!start)
         {
             ESP_LOGE(TAG, "无法找到引号，解析失败");
-            res = U4G_FAIL;
+            return U4G_FAIL;
         }
         start++; // 移动到引号后的第一个字符
 
@@ -259,21 +648,23 @@ static emU4GResult handler_time(char *rsp)
         if (!end)
         {
             ESP_LOGE(TAG, "无法找到结束引号，解析失败");
-            res = U4G_FAIL;
+            return U4G_FAIL;
         }
 
         // 提取时间字符串
         size_t len = end - start;
-        if (len >= sizeof(u4g_data.time))
+        if (len >= sizeof(((u4g_data_t *)0)->time))
         {
             ESP_LOGE(TAG, "时间字符串过长或缓冲区无效");
-            res = U4G_FAIL;
+            return U4G_FAIL;
         }
 
-        strncpy(u4g_data.time, start, len);
-        u4g_data.time[len] = '\0';
+        u4g_data_t *data = u4g_data_write_begin();
+        strncpy(data->time, start, len);
+        data->time[len] = '\0';
+        u4g_data_write_end();
         res = U4G_OK;
-        ESP_LOGI(TAG, "解析后的时间字符串: %s", u4g_data.time);
+        ESP_LOGI(TAG, "解析后的时间字符串: %s", data->time);
     }
     else
     {
@@ -291,8 +682,7 @@ emU4GResult u4g_at_time_get(void)
     u4g_at_cmd_t config = {
         .name = U4G_AT_CMD_TIME,
         .cmd = "AT+CCLK?\r\n",
-        .cmd_len = 10,
-        .handler = handler_time};
+        .cmd_len = 10};
     emU4GResult ret = u4g_at_cmd_sync(&config);
     if (ret != U4G_OK)
     {
@@ -312,8 +702,10 @@ static emU4GResult handler_mccid(char *rsp)
         pt += strlen("+MCCID: ");
         // int pt_len = strlen(pt); // 计算数据长度
         // 使用 sscanf 读取数据
-        sscanf(pt, "%s", u4g_data.mccid);
-        ESP_LOGI(TAG, "MCCID = %s", u4g_data.mccid);
+        u4g_data_t *data = u4g_data_write_begin();
+        sscanf(pt, "%31s", data->mccid);
+        u4g_data_write_end();
+        ESP_LOGI(TAG, "MCCID = %s", data->mccid);
         res = U4G_OK;
     }
     else
@@ -329,8 +721,7 @@ emU4GResult u4g_at_mccid_get(void)
     u4g_at_cmd_t config = {
         .name = U4G_AT_CMD_MCCID,
         .cmd = "AT+MCCID\r\n",
-        .cmd_len = 10,
-        .handler = handler_mccid};
+        .cmd_len = 10};
     emU4GResult ret = u4g_at_cmd_sync(&config);
     if (ret != U4G_OK)
     {
@@ -379,8 +770,9 @@ static emU4GResult handler_csq(char *rsp)
             // 安全地存储结果
             if (rssi >= sizeof(int))
             {
-                u4g_data.csq = rssi;
-                ESP_LOGI(TAG, "解析到CSQ值: %d", u4g_data.csq);
+                u4g_data_write_begin()->csq = rssi;
+                u4g_data_write_end();
+                ESP_LOGI(TAG, "解析到CSQ值: %d", rssi);
                 res = U4G_OK;
             }
             else
@@ -408,8 +800,7 @@ emU4GResult u4g_at_csq(void)
     u4g_at_cmd_t config = {
         .name = U4G_AT_CMD_CSQ,
         .cmd = "AT+CSQ\r\n",
-        .cmd_len = 8,
-        .handler = handler_csq};
+        .cmd_len = 8};
     emU4GResult ret = u4g_at_cmd_sync(&config);
     if (ret != U4G_OK)
     {
@@ -417,4 +808,166 @@ emU4GResult u4g_at_csq(void)
         return U4G_FAIL;
     }
     return U4G_OK;
-}
\ No newline at end of file
+}
+
+static emU4GResult handler_cpin(char *rsp)
+{
+    char *pt = strstr(rsp, "+CPIN: ");
+    if (pt == NULL)
+    {
+        ESP_LOGE(TAG, "未找到 +CPIN: 字符串");
+        return U4G_FAIL;
+    }
+    pt += strlen("+CPIN: ");
+    if (strncmp(pt, "READY", 5) != 0)
+    {
+        ESP_LOGW(TAG, "SIM卡未就绪: %.16s", pt);
+        return U4G_STATE_AT_SIM_NOT;
+    }
+    return U4G_OK;
+}
+// SIM卡状态
+emU4GResult u4g_at_sim_status(void)
+{
+    u4g_at_cmd_t config = {
+        .name = U4G_AT_CMD_CPIN,
+        .cmd = "AT+CPIN?\r\n",
+        .cmd_len = 10};
+    emU4GResult ret = u4g_at_cmd_sync(&config);
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "SIM卡状态查询-失败:%d", ret);
+        return ret == U4G_STATE_AT_SIM_NOT ? ret : U4G_FAIL; // 未插卡属于外部状态，与模块故障区分
+    }
+    return U4G_OK;
+}
+
+static emU4GResult handler_cgatt(char *rsp)
+{
+    char *pt = strstr(rsp, "+CGATT: ");
+    int state = 0;
+    if (pt == NULL || sscanf(pt + strlen("+CGATT: "), "%d", &state) != 1)
+    {
+        ESP_LOGE(TAG, "无法解析 CGATT 数据");
+        return U4G_FAIL;
+    }
+    return state == 1 ? U4G_OK : U4G_STATE_AT_NET_NOT;
+}
+/**
+ * @brief 分组域附着状态查询，已附着时数据业务可用
+ * @return emU4GResult 已附着返回U4G_OK，未附着返回U4G_STATE_AT_NET_NOT
+ */
+emU4GResult u4g_at_attach_status(void)
+{
+    u4g_at_cmd_t config = {
+        .name = U4G_AT_CMD_CGATT,
+        .cmd = "AT+CGATT?\r\n",
+        .cmd_len = 11};
+    emU4GResult ret = u4g_at_cmd_sync(&config);
+    if (ret == U4G_STATE_AT_NET_NOT)
+    {
+        return ret;
+    }
+    else if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "分组域附着状态查询-失败:%d", ret);
+        return U4G_FAIL;
+    }
+    return U4G_OK;
+}
+
+/**
+ * @brief 进入CMUX复用模式（基本选项），成功后在释放执行权前调用 open 建立虚拟通道，
+ * 期间其他指令在控制通道上排队，不会以非复用方式发出
+ * @param n1 每帧最大信息字段长度
+ * @param open 模块应答OK后建立虚拟通道的函数
+ * @return emU4GResult 模块拒绝返回U4G_FAIL，否则为 open 的结果
+ */
+emU4GResult u4g_at_cmux(uint16_t n1, emU4GResult (*open)(void))
+{
+    char cmd[32];
+    u4g_at_cmd_t config = {
+        .name = U4G_AT_CMD_CMUX,
+        .cmd = cmd,
+        .cmd_len = snprintf(cmd, sizeof(cmd), "AT+CMUX=0,0,,%u\r\n", n1),
+    };
+    uint8_t chan;
+    if (u4g_at_sched_acquire(U4G_AT_CMD_LOCK_TIMEOUT, &chan) != U4G_OK)
+    {
+        ESP_LOGE(TAG, "AT+CMUX-获取命令执行权超时");
+        return U4G_ERR_TIMEOUT;
+    }
+    bool save = false;
+    emU4GResult ret = cmd_exec(chan, &config, &save);
+    if (ret == U4G_OK)
+    {
+        ret = open();
+    }
+    else
+    {
+        ESP_LOGE(TAG, "进入CMUX模式-失败:%d", ret);
+        ret = U4G_FAIL;
+    }
+    u4g_at_sched_release(chan);
+    if (save)
+    {
+        rtt_save();
+    }
+    return ret;
+}
+
+/**
+ * @brief 设置PDP上下文的APN（AT+CGDCONT=<cid>,"IP",<apn>）
+ * @param cid 上下文编号
+ * @param apn 接入点名称
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_at_pdp_set(uint8_t cid, const char *apn)
+{
+    char cmd[96];
+    int n = snprintf(cmd, sizeof(cmd), "AT+CGDCONT=%u,\"IP\",\"%s\"\r\n", cid, apn);
+    if (n <= 0 || n >= sizeof(cmd))
+    {
+        return U4G_ERR_INVALID_SIZE;
+    }
+    u4g_at_cmd_t config = {
+        .name = U4G_AT_CMD_CGDCONT,
+        .cmd = cmd,
+        .cmd_len = n,
+    };
+    emU4GResult ret = u4g_at_cmd_sync(&config);
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "设置PDP上下文-失败:%d", ret);
+        return U4G_FAIL;
+    }
+    return U4G_OK;
+}
+
+/**
+ * @brief 拨号进入PPP数据模式（ATD*99***<cid>#）
+ * 模块应答 CONNECT 后该通道转为透传，on_connect 在解析任务中收到 CONNECT 时调用，
+ * 需在其中把通道切换给PPP（之后的数据不再按行解析）
+ * @param cid 上下文编号
+ * @param timeout 等待 CONNECT 的时间(ms)
+ * @param on_connect CONNECT 处理函数，返回U4G_OK表示拨号成功
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_at_dial(uint8_t cid, uint32_t timeout, u4g_at_rsp_handler_t on_connect)
+{
+    char cmd[24];
+    u4g_at_cmd_t config = {
+        .name = U4G_AT_CMD_DIAL,
+        .cmd = cmd,
+        .cmd_len = snprintf(cmd, sizeof(cmd), "ATD*99***%u#\r\n", cid),
+        .timeout = timeout,
+        .handler = on_connect,
+    };
+    emU4GResult ret = u4g_at_cmd_sync(&config);
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "拨号-失败:%d", ret);
+        return U4G_FAIL;
+    }
+    return U4G_OK;
+}
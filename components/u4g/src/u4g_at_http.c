@@ -1,18 +1,82 @@
 #include "u4g_at_http.h"
 #include "u4g_state.h"
 #include "u4g_at_cmd.h"
-#include "u4g_data.h"
+#include "u4g_urc.h"
+#include "u4g_uart_recv.h" // 分包内容透传
+#include "u4g_ppp.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include <stdio.h>        //默认
+#include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>       // 增加字符串操作支持
 #include "esp_task_wdt.h" // 包含看门狗相关库
 
 #define TAG "U4G_AT_HTTP" // 日志TAG
 
-static u4g_at_cmd_t config;                 // 本文件内静态变量
-static SemaphoreHandle_t http_mutex = NULL; // 发送数据互斥锁
+// HTTP客户端协议配置
+#define AT_CMD_MAX_URL_LEN 128
+#define AT_CMD_MAX_LEN 512          // 模块单条AT指令长度上限
+#define U4G_HTTP_CFG_CMD_LEN 256    // 配置类指令缓冲区长度
+#define U4G_HTTP_ID_MAX 3           // 模块HTTP客户端实例ID范围 0-3
+#define U4G_HTTP_ID_INVALID 255     // 无效实例ID
+#define U4G_HTTP_SESSION_MAX 2      // 缓存的HTTP会话数量（不超过模块实例数）
+#define U4G_HTTP_CFG_TIMEOUT 3000   // 配置类指令超时(ms)
+#define U4G_HTTP_REQ_TIMEOUT 10000  // 请求超时(ms)
+#define U4G_HTTP_LOCK_TIMEOUT (U4G_HTTP_REQ_TIMEOUT * 2) // 等待其他请求完成的最长时间(ms)
+#define U4G_HTTP_HEX_FRAGMENT 256   // 十六进制输出时的分包大小：编码后一个分包不超过一行，不会从十六进制中间断开
+#define U4G_HTTP_CTYPE_JSON "application/json"
+
+/**
+ * HTTP会话：一个服务器地址对应一个模块客户端实例，SSL/编码/分包配置随实例保留
+ */
+typedef struct
+{
+    char url[AT_CMD_MAX_URL_LEN + 1]; // 服务器地址
+    uint8_t httpid;                   // 客户端实例ID，U4G_HTTP_ID_INVALID 表示会话无效
+    bool hex;                         // 内容与响应以十六进制交互
+    const char *header_ctype;         // 已配置的 Content-Type，NULL 为未配置
+    const char *header_accept;        // 已配置的 Accept，NULL 为未配置
+    TickType_t last_used;             // 最近使用时间，会话满时淘汰最久未用的
+} u4g_http_session_t;
+
+/**
+ * 异步请求：字符串紧跟在结构体之后，随结构体一次分配、一次释放
+ */
+struct u4g_http_req
+{
+    u4g_http_req_t req;    // 请求描述（字符串指向本结构体之后的副本）
+    volatile bool done;    // 已执行完成
+    emU4GResult result;    // 请求结果
+    u4g_segbuf_t body;     // 通知模式下从默认接收器转交的响应内容
+    u4g_http_fmt_t fmt;    // 内容格式副本（req.fmt 非NULL时指向这里）
+};
+
+static SemaphoreHandle_t http_mutex = NULL; // 发送数据互斥锁（递归：完成回调中可再发起同步请求）
+static QueueHandle_t http_queue = NULL;     // 待执行的异步请求
+static u4g_http_session_t http_session[U4G_HTTP_SESSION_MAX];
+static volatile uint32_t modem_epoch = 0; // 模块启动次数，收到 +MATREADY 加一
+static uint32_t session_epoch = 0;        // 会话缓存所属的启动次数
+static bool modem_prepared = false;       // 本次启动已关闭回显并配置SSL认证
+static uint8_t created_id = U4G_HTTP_ID_INVALID; // AT+MHTTPCREATE 返回的实例ID
+static u4g_segbuf_t http_body;                   // 默认接收器的响应内容
+
+// 请求已超时返回后才到达的 +MHTTPURC，丢弃
+static void urc_http_stale(const char *line, void *arg)
+{
+    ESP_LOGW(TAG, "丢弃过期的HTTP URC: %.32s", line);
+}
+
+// 模块重启后HTTP客户端实例全部失效，下次请求时重建会话
+static void urc_http_matready(const char *line, void *arg)
+{
+    ESP_LOGW(TAG, "4G模块重启，HTTP会话失效");
+    modem_epoch++;
+}
+
+static void http_task(void *pvParameters);
 
 emU4GResult u4g_at_http_init(void)
 {
@@ -20,55 +84,101 @@ emU4GResult u4g_at_http_init(void)
     {
         return U4G_OK;
     }
-    http_mutex = xSemaphoreCreateMutex();
+    http_mutex = xSemaphoreCreateRecursiveMutex();
     if (http_mutex == NULL)
     { // 互斥锁创建失败
         ESP_LOGE(TAG, "创建HTTP命令互斥锁失败");
         return U4G_FAIL;
     }
+    http_queue = xQueueCreate(U4G_HTTP_QUEUE_LEN, sizeof(u4g_http_handle_t));
+    if (http_queue == NULL)
+    {
+        ESP_LOGE(TAG, "HTTP请求队列创建失败");
+        vSemaphoreDelete(http_mutex);
+        http_mutex = NULL;
+        return U4G_FAIL;
+    }
+    if (xTaskCreate(http_task, "u4g_http_task", U4G_HTTP_TASK_STACK, NULL, U4G_HTTP_TASK_PRIO, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "创建 u4g_http_task 失败");
+        vQueueDelete(http_queue);
+        vSemaphoreDelete(http_mutex);
+        http_queue = NULL;
+        http_mutex = NULL;
+        return U4G_FAIL;
+    }
+    for (int i = 0; i < U4G_HTTP_SESSION_MAX; i++)
+    {
+        http_session[i].httpid = U4G_HTTP_ID_INVALID;
+    }
+    u4g_segbuf_init(&http_body, U4G_HTTP_BODY_MAX);
+    u4g_urc_subscribe(U4G_URC_MHTTPURC, urc_http_stale, NULL);
+    u4g_urc_subscribe(U4G_URC_MATREADY, urc_http_matready, NULL);
     return U4G_OK;
 }
 
 // 回调-客户端ID生成
-static uint8_t httpid = 255; // HTTP客户端ID
 static emU4GResult handler_http_client(char *rsp)
 {
     emU4GResult res = U4G_STATE_AT_RSP_WAITING;
     char *line = strstr(rsp, "+MHTTPCREATE:");
-    if (line != NULL && sscanf(line, "+MHTTPCREATE: %hhu\r\n", &httpid))
+    if (line != NULL && sscanf(line, "+MHTTPCREATE: %hhu\r\n", &created_id))
     {
-        if (httpid > 4)
+        if (created_id > U4G_HTTP_ID_MAX)
         {
             res = U4G_FAIL;
         }
         else
         {
-            ESP_LOGI(TAG, "httpid: %d", httpid);
+            ESP_LOGI(TAG, "httpid: %d", created_id);
             res = U4G_OK;
         }
     }
     return res;
 }
 
+/**
+ * @brief 格式化并同步发送一条HTTP相关AT指令
+ * @param name 指令别名
+ * @param timeout 应答超时(ms)
+ * @param handler 应答处理函数，NULL 使用描述表默认值
+ * @param fmt 指令格式
+ * @return emU4GResult 指令执行结果
+ */
+static emU4GResult http_cmd(emATCmd name, uint32_t timeout, u4g_at_rsp_handler_t handler, const char *fmt, ...)
+{
+    char cmd[U4G_HTTP_CFG_CMD_LEN];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(cmd, sizeof(cmd), fmt, args);
+    va_end(args);
+    if (len < 0 || len >= sizeof(cmd))
+    {
+        ESP_LOGE(TAG, "AT指令超出缓冲区: %d", len);
+        return U4G_ERR_INVALID_SIZE;
+    }
+    u4g_at_cmd_t config = {
+        .name = name,
+        .cmd = cmd,
+        .cmd_len = len,
+        .timeout = timeout,
+        .handler = handler,
+    };
+    return u4g_at_cmd_sync(&config);
+}
+
 /**
  * HTTP客户端-实例删除（对应 AT+MHTTPDEL=<httpid>）
  * <httpid> 整型，HTTP客户端实例id，0-3
  */
 static emU4GResult u4g_at_http_client_del(const uint8_t client_id)
 {
-    if (client_id > 3)
+    if (client_id > U4G_HTTP_ID_MAX)
     {
         ESP_LOGE(TAG, "删除拒绝：非法ID %d (允许0-3)", client_id);
         return U4G_ERR_INVALID_ARG; // 使用标准错误码
     }
-
-    u4g_at_cmd_t config2;
-    config2.name = U4G_AT_CMD_HTTP_DELETE;
-    char cmd[16];
-    config2.cmd_len = snprintf(cmd, 16, "AT+MHTTPDEL=%d\r\n", client_id);
-    config2.cmd = cmd;
-    config2.timeout = 3000;
-    emU4GResult ret = u4g_at_cmd_sync(&config2);
+    emU4GResult ret = http_cmd(U4G_AT_CMD_HTTP_DELETE, U4G_HTTP_CFG_TIMEOUT, NULL, "AT+MHTTPDEL=%d\r\n", client_id);
     if (ret != U4G_OK)
     {
         ESP_LOGE(TAG, "删除客户端-失败:%d", ret);
@@ -80,111 +190,201 @@ static emU4GResult u4g_at_http_client_del(const uint8_t client_id)
 typedef struct
 {
     uint32_t content_len; // 内容总长度
-    uint32_t old_sum_len; // 上一批已下载数据长度
-    uint32_t sum_len;     // 已下载数据长度
-    uint32_t cur_len;     // 当前下载的数据长度
-    uint32_t read_len;    // 剩余字节处理
+    uint32_t sum_len;     // 已下载数据长度（含当前分包）
+    uint32_t cur_len;     // 当前分包长度
+    uint32_t read_len;    // 当前分包已接收长度
 } u4g_at_http_data_t;
 static u4g_at_http_data_t httpData = {0};
+static bool http_content = false; // 正在接收 content 分包，续行属于响应体
+static bool http_hex = false;     // 当前请求的响应以十六进制输出
+static const u4g_http_fmt_t http_fmt_json = {0}; // 缺省格式：JSON文本
+
+// 未指定接收器时写入PSRAM分段缓冲区，响应长度只受 U4G_HTTP_BODY_MAX 限制
+static u4g_http_sink_t default_sink = {
+    .begin = u4g_segbuf_sink_begin,
+    .write = u4g_segbuf_sink_write,
+    .arg = &http_body,
+};
+static u4g_http_sink_t *http_sink = &default_sink; // 当前请求的响应接收器
+
+/**
+ * @brief 发送请求前重置接收状态
+ */
+static emU4GResult http_rsp_begin(void)
+{
+    memset(&httpData, 0, sizeof(httpData));
+    http_content = false;
+    http_sink->len = 0;
+    if (http_sink->buf && http_sink->size)
+    {
+        http_sink->buf[0] = '\0';
+    }
+    return http_sink->begin ? http_sink->begin(http_sink->arg) : U4G_OK;
+}
 
-static emU4GResult parse_data(char *rsp, size_t rsp_len)
+/**
+ * @brief 分包数据直接从串口行缓冲写入接收器
+ */
+static emU4GResult http_sink_write(const char *data, size_t len)
 {
-    // 不同数据时
-    if (httpData.old_sum_len != httpData.sum_len)
+    u4g_http_sink_t *sink = http_sink;
+    if (sink->write)
     {
-        // 验证已下载数据长度是否一致
-        if ((httpData.sum_len - httpData.old_sum_len) != httpData.cur_len)
+        emU4GResult ret = sink->write(data, len, sink->arg);
+        if (ret != U4G_OK)
         {
-            httpData.old_sum_len = 0;
-            ESP_LOGE(TAG, "下载数据数量不一致: sum_len=%lu, old_sum_len=%lu, cur_len=%lu", httpData.sum_len, httpData.old_sum_len, httpData.cur_len);
-            return U4G_FAIL;
+            ESP_LOGE(TAG, "HTTP响应接收器处理失败:%d", ret);
+            return ret;
         }
-        // 首次接收数据时
-        if (httpData.cur_len == httpData.sum_len)
+    }
+    else
+    {
+        if (sink->buf == NULL || sink->len + len + 1 > sink->size)
         {
-            memset(u4g_data.data, 0, U4G_UART_RX_BUF_SIZE); // 清空缓冲区
+            ESP_LOGE(TAG, "HTTP响应缓冲区溢出，无法追加数据 已有:%d | 追加:%d | 容量:%d", sink->len, len, sink->size);
+            return U4G_STATE_AT_RINGBUF_OVERFLOW;
         }
+        memcpy(sink->buf + sink->len, data, len);
+        sink->buf[sink->len + len] = '\0'; // 添加字符串终止符
     }
-    httpData.old_sum_len = httpData.sum_len; // 更新已下载数据长度
+    sink->len += len;
+    return U4G_OK;
+}
 
-    // 去掉尾部的回车换行字符
-    while (rsp_len > 0 && (rsp[rsp_len - 1] == '\r' || rsp[rsp_len - 1] == '\n'))
+// 十六进制字符转数值，非法字符返回-1
+static int hex_val(char c)
+{
+    if (c >= '0' && c <= '9')
     {
-        rsp_len--;
+        return c - '0';
     }
-    size_t copy_len = (rsp_len < U4G_UART_RX_BUF_SIZE - 1) ? rsp_len : (U4G_UART_RX_BUF_SIZE - 1);
-    size_t current_len = strlen((char *)u4g_data.data); // 计算当前数据长度
-
-    // 确保不会超出缓冲区
-    if (current_len + copy_len > U4G_UART_RX_BUF_SIZE - 1)
+    if (c >= 'A' && c <= 'F')
     {
-        ESP_LOGE(TAG, "HTTP回调缓冲区溢出，无法追加数据 复制copy_len: %d | current_len: %d | RX: %d", copy_len, current_len, U4G_UART_RX_BUF_SIZE - 1);
-        return U4G_STATE_AT_RINGBUF_OVERFLOW;
+        return c - 'A' + 10;
     }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
 
-    ESP_LOGI(TAG, "[HTTP]提取所需数据[%d]: %s", copy_len, rsp);
-
-    // 追加新数据
-    strncpy((char *)u4g_data.data + current_len, rsp, copy_len);
-    ((char *)u4g_data.data)[current_len + copy_len] = '\0'; // 添加字符串终止符
-
-    ESP_LOGI(TAG, "[HTTP]追加后新数据[%d]: %s", strlen((char *)u4g_data.data), (char *)u4g_data.data);
+/**
+ * @brief 十六进制输出的分包数据还原后写入接收器（分包长度按原始字节计）
+ * @param take 本次还原的字节数
+ */
+static emU4GResult http_sink_write_hex(const char *hex, size_t take)
+{
+    char buf[64];
+    while (take)
+    {
+        size_t n = take < sizeof(buf) ? take : sizeof(buf);
+        for (size_t i = 0; i < n; i++)
+        {
+            int hi = hex_val(hex[2 * i]);
+            int lo = hex_val(hex[2 * i + 1]);
+            if (hi < 0 || lo < 0)
+            {
+                ESP_LOGE(TAG, "十六进制响应内容无效: %.8s", hex + 2 * i);
+                return U4G_FAIL;
+            }
+            buf[i] = (hi << 4) | lo;
+        }
+        emU4GResult ret = http_sink_write(buf, n);
+        if (ret != U4G_OK)
+        {
+            return ret;
+        }
+        hex += 2 * n;
+        take -= n;
+    }
+    return U4G_OK;
+}
 
-    httpData.read_len += copy_len;
-    if (httpData.read_len > httpData.cur_len) // 接收数据大于预期数据
+/**
+ * @brief 处理分包中的一段数据
+ * @param rsp 数据起始位置
+ * @param rsp_len 本行剩余长度（含行尾"\r\n"）
+ */
+static emU4GResult parse_data(const char *rsp, size_t rsp_len)
+{
+    // 分包数据本身可能含换行，只取本分包剩余的字节，行尾多出的"\r\n"是URC结束符
+    size_t take = httpData.cur_len - httpData.read_len;
+    size_t avail = http_hex ? rsp_len / 2 : rsp_len; // 十六进制输出时两个字符一个字节
+    if (avail < take)
     {
-        ESP_LOGE(TAG, "[HTTP]接收数据大于预期数据");
-        return U4G_FAIL;
+        take = avail;
+    }
+    emU4GResult ret = http_hex ? http_sink_write_hex(rsp, take) : http_sink_write(rsp, take);
+    if (ret != U4G_OK)
+    {
+        return ret;
     }
-    else if (httpData.read_len != httpData.cur_len)
+    httpData.read_len += take;
+    if (httpData.read_len < httpData.cur_len)
     {
-        ESP_LOGW(TAG, "当前HTTP下载的数据长度有剩余-继续接收 | 预期长度=%lu，数据不完整，等待下一批数据", httpData.cur_len);
+        ESP_LOGD(TAG, "当前分包剩余%lu字节，等待续行", httpData.cur_len - httpData.read_len);
         return U4G_STATE_AT_RSP_WAITING; // 继续等待命令回执
     }
 
     // 检查是否已接收完所有内容
-    if (httpData.content_len == httpData.sum_len)
+    if (httpData.sum_len >= httpData.content_len)
     {
-        ESP_LOGI(TAG, "已接收完所有数据");
-        httpData.old_sum_len = 0;
+        ESP_LOGI(TAG, "已接收完所有数据: %lu字节", httpData.sum_len);
         return U4G_OK;
     }
-    return U4G_FAIL;
+    return U4G_STATE_AT_RSP_WAITING; // 等待下一分包
 }
 
 static emU4GResult handler_http(char *rsp)
 {
     emU4GResult res = U4G_STATE_AT_RSP_WAITING;
-    char *pt = strstr(rsp, "+MHTTPURC: \"content\"");
+    char *pt = NULL;
+    if (strncmp(rsp, "+MHTTPURC: \"err\"", strlen("+MHTTPURC: \"err\"")) == 0)
+    {
+        ESP_LOGE(TAG, "HTTP请求处理错误响应: %s", rsp);
+        http_content = false;
+        return U4G_FAIL;
+    }
+    if (strncmp(rsp, "+MHTTPURC: \"content\"", strlen("+MHTTPURC: \"content\"")) == 0)
+    {
+        pt = rsp;
+    }
+    else if (strncmp(rsp, "+MHTTPURC:", strlen("+MHTTPURC:")) == 0)
+    {
+        ESP_LOGD(TAG, "HTTP请求其他URC，忽略: %s", rsp);
+        http_content = false; // header 等其他类型，后续续行不属于响应体
+        return U4G_STATE_AT_RSP_WAITING;
+    }
     if (pt)
     {
+        http_content = true;
         pt += strlen("+MHTTPURC: \"content\"");
-        // ESP_LOGI(TAG, "CMD_HTTP_REQUEST 指令 HTTP请求成功");
-        // if (httpData.cur_len > 0)
-        // {
-        //     ESP_LOGD(TAG, "检测到不是全新数据，中断处理");
-        //     httpData.cur_len = 0;
-        //     return U4G_FAIL; // 继续等待命令回执
-        // }
 
         // 格式: +MHTTPURC: "content",<httpid>,<content_len>,<sum_len>,<cur_len>,<data>
         int httpid = 0;
         int offset = 0;
-        // 修正: 解析格式，跳过前缀后应该匹配逗号和四个数字
-        if (sscanf(pt, ",%d,%ld,%ld,%ld,%n", &httpid, &httpData.content_len, &httpData.sum_len, &httpData.cur_len, &offset) == 4)
+        uint32_t sum_len = 0;
+        if (sscanf(pt, ",%d,%lu,%lu,%lu,%n", &httpid, &httpData.content_len, &sum_len, &httpData.cur_len, &offset) == 4 && offset > 0)
         {
-            ESP_LOGW(TAG, "HTTP请求| httpid: %d | content_len: %ld | sum_len: %ld | cur_len: %ld | offset: %d", httpid, httpData.content_len, httpData.sum_len, httpData.cur_len, offset);
-            if (offset > 0 && offset < strlen(pt))
+            ESP_LOGI(TAG, "HTTP请求| httpid: %d | content_len: %lu | sum_len: %lu | cur_len: %lu", httpid, httpData.content_len, sum_len, httpData.cur_len);
+            // 验证已下载数据长度是否连续
+            if (sum_len != httpData.sum_len + httpData.cur_len)
             {
-                httpData.read_len = 0; // 重置剩余字节处理
-                // 计算数据起始位置并安全地复制数据
-                char *data_ptr = pt + offset;
-                res = parse_data(data_ptr, strlen(data_ptr));
+                ESP_LOGE(TAG, "下载数据数量不一致: sum_len=%lu, 已接收=%lu, cur_len=%lu", sum_len, httpData.sum_len, httpData.cur_len);
+                res = U4G_FAIL;
             }
             else
             {
-                ESP_LOGE(TAG, "HTTP数据偏移量无效: %d", offset);
-                res = U4G_FAIL;
+                httpData.sum_len = sum_len;
+                httpData.read_len = 0; // 重置分包已接收长度
+                res = parse_data(pt + offset, strlen(pt + offset));
+                if (res == U4G_STATE_AT_RSP_WAITING && httpData.read_len < httpData.cur_len)
+                {
+                    // 分包剩余数据可能含空行或以">"开头，让行切分器按字节数透传，不再按行切分
+                    uint32_t rest = httpData.cur_len - httpData.read_len;
+                    u4g_uart_recv_raw(http_hex ? rest * 2 : rest);
+                }
             }
         }
         else
@@ -193,53 +393,29 @@ static emU4GResult handler_http(char *rsp)
             res = U4G_FAIL;
         }
     }
-    else
+    else if (http_content)
     {
-        ESP_LOGI(TAG, "HTTP请求数据-接收剩余数据处理");
         res = parse_data(rsp, strlen(rsp));
     }
+    if (res != U4G_STATE_AT_RSP_WAITING)
+    {
+        http_content = false; // 接收完毕，关闭数据处理
+    }
     return res;
 }
 
-// HTTP客户端协议配置
-#define AT_CMD_MAX_URL_LEN 128
-#define AT_CMD_HTTP_CLIENT_BUFFER_SIZE (sizeof("AT+MHTTPCREATE=\"") - 1 + AT_CMD_MAX_URL_LEN + sizeof("\"\r\n") - 1 + 1)
-// // 编译期静态检查
-// _Static_assert(AT_CMD_HTTP_CLIENT_BUFFER_SIZE == 16 + 128 + 4, "HTTP客户端缓冲区尺寸计算错误");
-static bool task_wdt_reset_send = false;
-
-/** HTTP 请求 */
-emU4GResult u4g_at_http_request(const char *url, const char *path, const char *body)
+/**
+ * @brief 模块启动后执行一次：关闭回显、SSL认证方式设置为无需认证
+ * @return emU4GResult 成功返回U4G_OK
+ */
+static emU4GResult http_modem_prepare(void)
 {
-    ESP_LOGD(TAG, "开始HTTP 请求");
-    if (!url || !path || strlen(url) == 0 || strlen(path) == 0)
-    {
-        ESP_LOGE(TAG, "无效参数 url 或 path");
-        return U4G_ERR_INVALID_ARG;
-    }
-    if (strlen(url) > AT_CMD_MAX_URL_LEN)
-    {
-        ESP_LOGE(TAG, "URL 长度超限 %d > %d", strlen(url), AT_CMD_MAX_URL_LEN);
-        return U4G_ERR_INVALID_SIZE;
-    }
-    // 获取锁
-    if (xSemaphoreTake(http_mutex, pdMS_TO_TICKS(5000)) != pdTRUE)
+    if (modem_prepared)
     {
-        ESP_LOGE(TAG, "HTTP 锁获取超时");
-        // xSemaphoreGive(http_mutex);
-        return U4G_ERR_TIMEOUT;
+        return U4G_OK;
     }
-    // esp_task_wdt_add(NULL);
-
-    esp_task_wdt_reset();
-
-    emU4GResult ret;
     // ATE回显关闭
-    config.name = U4G_AT_CMD_ATE;
-    config.cmd = "ATE0\r\n";
-    config.cmd_len = 6;
-    config.timeout = 3000;
-    ret = u4g_at_cmd_sync(&config);
+    emU4GResult ret = http_cmd(U4G_AT_CMD_ATE, U4G_HTTP_CFG_TIMEOUT, NULL, "ATE0\r\n");
     if (ret != U4G_OK)
     {
         ESP_LOGE(TAG, "关闭回显-失败:%d", ret);
@@ -253,40 +429,78 @@ emU4GResult u4g_at_http_request(const char *url, const char *path, const char *b
      * <cert_verify> 整型，证书认证方式，默认值0
      * -0无身份认证，默认值 -1单向认证 -2双向认证
      */
-    config.name = U4G_AT_CMD_SSL_AUTH;
-    config.cmd = "AT+MSSLCFG=\"auth\",0,0\r\n";
-    config.cmd_len = 23;
-    config.timeout = 3000;
-    ret = u4g_at_cmd_sync(&config);
+    ret = http_cmd(U4G_AT_CMD_SSL_AUTH, U4G_HTTP_CFG_TIMEOUT, NULL, "AT+MSSLCFG=\"auth\",0,0\r\n");
     if (ret != U4G_OK)
     {
         ESP_LOGE(TAG, "设置SSL认证方式无需认证-失败:%d", ret);
         return ret;
     }
+    modem_prepared = true;
+    return U4G_OK;
+}
+
+/**
+ * @brief 使会话失效
+ * @param session 会话
+ * @param del 是否同时删除模块中的客户端实例（模块重启后实例已不存在，无需删除）
+ */
+static void http_session_drop(u4g_http_session_t *session, bool del)
+{
+    if (session->httpid == U4G_HTTP_ID_INVALID)
+    {
+        return;
+    }
+    ESP_LOGW(TAG, "释放HTTP会话[%d]: %s", session->httpid, session->url);
+    if (del)
+    {
+        u4g_at_http_client_del(session->httpid);
+    }
+    session->httpid = U4G_HTTP_ID_INVALID;
+    session->hex = false;
+    session->header_ctype = NULL;
+    session->header_accept = NULL;
+}
+
+/**
+ * @brief 模块无空闲客户端实例时，删除不属于任何缓存会话的实例（如ESP重启前遗留的实例）
+ * @return 至少删除一个返回true
+ */
+static bool http_orphan_del(void)
+{
+    bool freed = false;
+    for (uint8_t id = 0; id <= U4G_HTTP_ID_MAX; id++)
+    {
+        bool used = false;
+        for (int i = 0; i < U4G_HTTP_SESSION_MAX; i++)
+        {
+            used |= (http_session[i].httpid == id);
+        }
+        if (!used && u4g_at_http_client_del(id) == U4G_OK)
+        {
+            freed = true;
+        }
+    }
+    return freed;
+}
 
+/**
+ * @brief 创建客户端实例并完成SSL/编码/分包配置
+ * @param session 空闲会话
+ * @param url 服务器地址
+ * @return emU4GResult 成功返回U4G_OK
+ */
+static emU4GResult http_session_create(u4g_http_session_t *session, const char *url)
+{
     /**
      * @brief HTTP客户端-创建HTTP客户端实例（对应 AT+MHTTPCREATE）
      * @param url 字符串，HTTP服务器地址，例如：https://api.iot.zsyxlife.cn
-     * @param timeout 超时，单位毫秒
      * httpid 返回值：-1 失败，其他值为httpid 0-3，用于后续的HTTP请求
-     * @return at_cmd_t
      */
-    static char buf[256];
-    int len = snprintf(buf, sizeof(buf), "AT+MHTTPCREATE=\"%s\"\r\n", url);
-    u4g_at_cmd_t cmd_table_httpcreate = {
-        .name    = U4G_AT_CMD_HTTP_CREATE,
-        .cmd     = buf,
-        .cmd_len = len,
-        .timeout = 3000,
-        .handler = handler_http_client
-    };
-    // 带重试机制执行
-    ret = U4G_ERR_INVALID_STATE;
-    esp_task_wdt_reset();
+    emU4GResult ret = U4G_ERR_INVALID_STATE;
     for (uint8_t retry = 0; retry < 3; retry++)
     {
-        // ESP_LOGI("AT_CMD", "发送命令: %.*s", config.cmd_len, config.cmd);
-        ret = u4g_at_cmd_sync(&cmd_table_httpcreate);
+        created_id = U4G_HTTP_ID_INVALID;
+        ret = http_cmd(U4G_AT_CMD_HTTP_CREATE, U4G_HTTP_CFG_TIMEOUT, handler_http_client, "AT+MHTTPCREATE=\"%s\"\r\n", url);
         esp_task_wdt_reset();
         if (ret == U4G_OK)
         {
@@ -294,42 +508,37 @@ emU4GResult u4g_at_http_request(const char *url, const char *path, const char *b
         }
         else if (ret == U4G_STATE_AT_NO_CLIENT_IDLE)
         {
-            ESP_LOGE(TAG, "创建HTTP客户端实例-执行删除客户端ID为0:%d", ret);
-            ret = u4g_at_http_client_del(0); // 删除客户端
-            vTaskDelay(pdMS_TO_TICKS(100));
-            if (ret == U4G_OK)
-            {
-                httpid = 0;
-                continue; // 继续循环
-            }
-            else
+            ESP_LOGE(TAG, "创建HTTP客户端实例-无空闲实例，删除遗留实例");
+            if (!http_orphan_del())
             {
                 ESP_LOGE(TAG, "删除客户端失败");
             }
+            continue; // 继续循环
         }
-        else
-        {
-            ESP_LOGE(TAG, "创建HTTP客户端实例-失败:%d", ret);
-        }
-        esp_task_wdt_reset();
+        ESP_LOGE(TAG, "创建HTTP客户端实例-失败:%d", ret);
         vTaskDelay(pdMS_TO_TICKS(100 * (retry + 1))); // 指数退避
     }
-    // ESP_LOGE(TAG, "测试到这里");
+    if (ret != U4G_OK)
+    {
+        return ret;
+    }
+    session->httpid = created_id;
+    session->hex = false;
+    session->header_ctype = NULL;
+    session->header_accept = NULL;
+    strncpy(session->url, url, sizeof(session->url) - 1);
+    session->url[sizeof(session->url) - 1] = '\0';
 
     /**
      * HTTP客户端-SSL模式设置（对应 AT+MHTTPCFG）
      * <ssl> 整型，0-关闭，1-开启，默认值0
      * <cert_verify> 整型，证书认证方式，0-无认证，1-单向认证，2-双向认证
      */
-    config.name = U4G_AT_CMD_HTTP_SSL;
-    config.cmd_len = snprintf(config.cmd, 26, "AT+MHTTPCFG=\"ssl\",%u,1,0\r\n", httpid);
-    config.timeout = 3000;
-    config.handler = NULL;
-    ret = u4g_at_cmd_sync(&config);
-    vTaskDelay(pdMS_TO_TICKS(100));
+    ret = http_cmd(U4G_AT_CMD_HTTP_SSL, U4G_HTTP_CFG_TIMEOUT, NULL, "AT+MHTTPCFG=\"ssl\",%u,1,0\r\n", session->httpid);
     if (ret != U4G_OK)
     {
         ESP_LOGE(TAG, "HTTP客户端-SSL模式设置-失败:%d", ret);
+        http_session_drop(session, true);
         return U4G_FAIL;
     }
 
@@ -341,15 +550,11 @@ emU4GResult u4g_at_http_request(const char *url, const char *path, const char *b
      * <output_format> 数据输出编码模式，默认值0。模组将按设置的编码格式把原始数据转换为指定编码格式数据然后输出
      * -0ASCII字符串（原始数据） -1HEX字符串
      */
-    config.name = U4G_AT_CMD_HTTP_ENCODING;
-    config.cmd_len = snprintf(config.cmd, 31, "AT+MHTTPCFG=\"encoding\",%u,%d,%d\r\n", httpid, 0, 0);
-    config.timeout = 3000;
-    config.handler = NULL;
-    ret = u4g_at_cmd_sync(&config);
-    vTaskDelay(pdMS_TO_TICKS(100));
+    ret = http_cmd(U4G_AT_CMD_HTTP_ENCODING, U4G_HTTP_CFG_TIMEOUT, NULL, "AT+MHTTPCFG=\"encoding\",%u,%d,%d\r\n", session->httpid, 0, 0);
     if (ret != U4G_OK)
     {
         ESP_LOGE(TAG, "HTTP客户端-设置输入输出编码-失败:%d", ret);
+        http_session_drop(session, true);
         return U4G_FAIL;
     }
 
@@ -359,202 +564,521 @@ emU4GResult u4g_at_http_request(const char *url, const char *path, const char *b
      * <frag_size> 接收到数据后，数据上报的最大分包大小，0~1024，默认值0（实际接收包大小输出）
      * <interval> 接收到数据后，数据分包输出的时间间隔，0~2000ms，默认值0（无间隔）
      */
-    config.name = U4G_AT_CMD_HTTP_FRAGMENT;
-    config.cmd_len = snprintf(config.cmd, 37, "AT+MHTTPCFG=\"fragment\",%u,%d,%d\r\n", httpid, 0, 100);
-    config.timeout = 3000;
-    config.handler = NULL;
-    ret = u4g_at_cmd_sync(&config);
-    vTaskDelay(pdMS_TO_TICKS(100));
+    ret = http_cmd(U4G_AT_CMD_HTTP_FRAGMENT, U4G_HTTP_CFG_TIMEOUT, NULL, "AT+MHTTPCFG=\"fragment\",%u,%d,%d\r\n", session->httpid, 0, 100);
     if (ret != U4G_OK)
     {
         ESP_LOGE(TAG, "HTTP客户端-设置数据输出流控-失败:%d", ret);
+        http_session_drop(session, true);
         return U4G_FAIL;
     }
+    ESP_LOGI(TAG, "HTTP会话[%d]已建立: %s", session->httpid, url);
+    return U4G_OK;
+}
 
-    if (body == NULL)
+/**
+ * @brief 按服务器地址取缓存会话，没有则新建（会话已满时淘汰最久未用的）
+ * @param url 服务器地址
+ * @param[out] reused 是否复用了已有会话
+ * @return 会话，失败返回NULL
+ */
+static u4g_http_session_t *http_session_get(const char *url, bool *reused)
+{
+    u4g_http_session_t *slot = NULL;
+    for (int i = 0; i < U4G_HTTP_SESSION_MAX; i++)
     {
-        /**
-         * HTTP客户端-发送HTTP请求（对应 AT+MHTTPREQUEST=<httpid>,<method>[,<length>[,<path>[,<local_path>]]]）
-         * <httpid> 整型，HTTP客户端实例id，0~3
-         * <method> 整型，1-GET，2-POST，3-PUT，4-DELETE，5-HEAD
-         * <path> 字符串，HTTP请求路径，例如：/api/device/info
-         */
-        config.name = U4G_AT_CMD_HTTP_REQUEST;
-        // Step 1: 计算需要的缓冲区大小（包含转义字符）
-        int required_space = snprintf(NULL, 0, "AT+MHTTPREQUEST=%d,1,0,\"", httpid) + 1; // 基础部分
-        required_space += strlen(path) * 2;                                              // 预留双倍空间（应对特殊字符转义）
-        required_space += 3;                                                             // 结尾的 "\"\r\n" 和终止符
-
-        // Step 2: 动态分配缓冲区（避免栈溢出）
-        char *temp_buffer = malloc(required_space);
-        if (!temp_buffer)
-        {
-            ESP_LOGE(TAG, "Memory allocation failed");
-            return ESP_ERR_NO_MEM;
-        }
-        // Step 3: 转义双引号并构建路径
-        char *escaped_path = temp_buffer + snprintf(temp_buffer, required_space, "AT+MHTTPREQUEST=%d,1,0,\"", httpid);
-        for (const char *src = path; *src; src++)
+        u4g_http_session_t *s = &http_session[i];
+        if (s->httpid != U4G_HTTP_ID_INVALID && strcmp(s->url, url) == 0)
         {
-            if (*src == '"')
-            { // 转义双引号
-                *escaped_path++ = '\\';
-                *escaped_path++ = '"';
-            }
-            else
-            {
-                *escaped_path++ = *src;
-            }
+            *reused = true;
+            s->last_used = xTaskGetTickCount();
+            return s;
         }
-        *escaped_path++ = '"';
-        *escaped_path++ = '\r';
-        *escaped_path++ = '\n';
-        *escaped_path = '\0'; // 终止符
-
-        // Step 4: 验证总长度是否超出模块限制
-        size_t final_len = strlen(temp_buffer);
-        if (final_len > 512)
-        { // 根据模块手册调整
-            ESP_LOGE(TAG, "AT command exceeds module limit (%d > 512)", final_len);
-            free(temp_buffer);
-            return ESP_ERR_INVALID_SIZE;
-        }
-        config.cmd = temp_buffer;
-        config.cmd_len = final_len;
-        ESP_LOGI(TAG, "链接长度%s-字节%d-指令:%s", path, strlen(path), config.cmd);
-
-        // config.cmd_len = 155;
-        config.handler = handler_http;
-        //     // config.handler = handler_http_client;
-        config.timeout = 10000;
-        ret = u4g_at_cmd_sync(&config);
-        vTaskDelay(pdMS_TO_TICKS(100));
-        if (ret != U4G_OK)
+        if (slot == NULL || (slot->httpid != U4G_HTTP_ID_INVALID &&
+                             (s->httpid == U4G_HTTP_ID_INVALID || s->last_used < slot->last_used)))
         {
-            ESP_LOGE(TAG, "HTTP客户端-发送HTTP请求-失败:%d", ret);
-            return U4G_FAIL;
+            slot = s; // 优先空闲会话，其次最久未用的会话
         }
     }
-    else
+    *reused = false;
+    http_session_drop(slot, true);
+    if (http_session_create(slot, url) != U4G_OK)
     {
-        // POST请求
-        /**
-         * @brief HTTP客户端-配置头部（对应 AT+MHTTPCFG="header",<httpid>,<header>）
-         * @param httpid 整型，HTTP客户端实例id，0-3
-         * @param header 字符串，HTTP头部，例如：Content-Type: application/json
-         */
-        config.name = U4G_AT_CMD_HTTP_HEADER;
-        config.cmd_len = snprintf(config.cmd, 61, "AT+MHTTPCFG=\"header\",%u,\"%s\"\r\n", httpid, "Content-Type: application/json");
-        config.timeout = 3000;
-        config.handler = NULL;
-        ret = u4g_at_cmd_sync(&config);
-        vTaskDelay(pdMS_TO_TICKS(100));
+        return NULL;
+    }
+    slot->last_used = xTaskGetTickCount();
+    return slot;
+}
+
+// 两个头部值相同（均为NULL也算相同）
+static bool header_same(const char *a, const char *b)
+{
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+/**
+ * @brief 按请求的内容格式调整会话的编码与头部，与上次相同时不发送指令
+ * @param session 会话
+ * @param fmt 内容格式
+ * @param post 是否为POST（GET 不关心 Content-Type，沿用已配置的）
+ * @return emU4GResult 成功返回U4G_OK
+ */
+static emU4GResult http_session_format(u4g_http_session_t *session, const u4g_http_fmt_t *fmt, bool post)
+{
+    emU4GResult ret;
+    if (session->hex != fmt->binary)
+    {
+        // 输入输出编码：1-HEX字符串；十六进制输出时限制分包大小，编码后的一个分包不超过串口一行
+        ret = http_cmd(U4G_AT_CMD_HTTP_ENCODING, U4G_HTTP_CFG_TIMEOUT, NULL, "AT+MHTTPCFG=\"encoding\",%u,%d,%d\r\n", session->httpid, fmt->binary, fmt->binary);
+        if (ret == U4G_OK)
+        {
+            ret = http_cmd(U4G_AT_CMD_HTTP_FRAGMENT, U4G_HTTP_CFG_TIMEOUT, NULL, "AT+MHTTPCFG=\"fragment\",%u,%d,%d\r\n", session->httpid, fmt->binary ? U4G_HTTP_HEX_FRAGMENT : 0, 100);
+        }
         if (ret != U4G_OK)
         {
-            ESP_LOGE(TAG, "HTTP客户端-配置头部-失败:%d", ret);
+            ESP_LOGE(TAG, "HTTP客户端-切换编码-失败:%d", ret);
             return U4G_FAIL;
         }
+        session->hex = fmt->binary;
+    }
+
+    /**
+     * @brief HTTP客户端-配置头部（对应 AT+MHTTPCFG="header",<httpid>[,<header>]）
+     * 头部随实例保留，格式不变时只需配置一次；多次配置为追加，不带<header>时清空已配置的头部
+     */
+    const char *ctype = post ? (fmt->content_type ? fmt->content_type : U4G_HTTP_CTYPE_JSON) : session->header_ctype;
+    if (header_same(ctype, session->header_ctype) && header_same(fmt->accept, session->header_accept))
+    {
+        return U4G_OK;
+    }
+    ret = U4G_OK;
+    if (session->header_ctype || session->header_accept)
+    {
+        ret = http_cmd(U4G_AT_CMD_HTTP_HEADER, U4G_HTTP_CFG_TIMEOUT, NULL, "AT+MHTTPCFG=\"header\",%u\r\n", session->httpid);
+        session->header_ctype = NULL;
+        session->header_accept = NULL;
+    }
+    if (ret == U4G_OK && ctype)
+    {
+        ret = http_cmd(U4G_AT_CMD_HTTP_HEADER, U4G_HTTP_CFG_TIMEOUT, NULL, "AT+MHTTPCFG=\"header\",%u,\"Content-Type: %s\"\r\n", session->httpid, ctype);
+        session->header_ctype = ret == U4G_OK ? ctype : NULL;
+    }
+    if (ret == U4G_OK && fmt->accept)
+    {
+        ret = http_cmd(U4G_AT_CMD_HTTP_HEADER, U4G_HTTP_CFG_TIMEOUT, NULL, "AT+MHTTPCFG=\"header\",%u,\"Accept: %s\"\r\n", session->httpid, fmt->accept);
+        session->header_accept = ret == U4G_OK ? fmt->accept : NULL;
+    }
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "HTTP客户端-配置头部-失败:%d", ret);
+        return U4G_FAIL;
+    }
+    return U4G_OK;
+}
 
+/**
+ * @brief 在已建立的会话上发送一次请求，稳态下GET只有 AT+MHTTPREQUEST，POST 另加 AT+MHTTPCONTENT
+ * @param session 会话
+ * @param path 请求路径
+ * @param body POST内容，NULL 为GET
+ * @param fmt 内容格式
+ * @return emU4GResult 成功返回U4G_OK
+ */
+static emU4GResult http_session_send(u4g_http_session_t *session, const char *path, const char *body, const u4g_http_fmt_t *fmt)
+{
+    emU4GResult ret = http_session_format(session, fmt, body != NULL);
+    if (ret != U4G_OK)
+    {
+        return ret;
+    }
+    if (body != NULL)
+    {
         /**
          * HTTP客户端-配置body参数（对应 AT+MHTTPCONTENT=<httpid>,<eof>,<length>,<data>）
-         * <httpid> 整型，HTTP客户端实例id，0-3
-         * <eof> 数据输入指示
-         * -0-content输入结束标记，需请求完成或清空后才可再次输入
-         * -1后续还有content数据输入
-         * -2清空已有content内容，只对非Chunked模式有效
+         * <eof> 0-content输入结束标记，需请求完成或清空后才可再次输入
          * <length> 整型，body长度，0-4096
-         * <data> 字符串，body参数，例如：{"key":"value"}
+         * 二进制内容按十六进制输入，长度加倍
          */
-        if ((strlen(body) + 61) > 512)
+        size_t body_len = fmt->binary ? fmt->body_len : strlen(body);
+        size_t content_len = fmt->binary ? body_len * 2 : body_len;
+        if (body_len > U4G_HTTP_POST_MAX(fmt->binary))
         {
-            ESP_LOGE(TAG, "HTTP客户端-配置头部-超过512");
+            ESP_LOGE(TAG, "HTTP客户端-body超过%d", U4G_HTTP_CONTENT_MAX);
             return U4G_ERR_INVALID_SIZE;
         }
-        config.name = U4G_AT_CMD_HTTP_BODY;
-        config.cmd_len = snprintf(config.cmd, (strlen(body) + 61), "AT+MHTTPCONTENT=%d,0,0,\"%s\"\r\n", httpid, body);
-        config.timeout = 3000;
-        config.handler = NULL;
+        size_t cmd_size = content_len + 32;
+        char *cmd = malloc(cmd_size);
+        if (!cmd)
+        {
+            ESP_LOGE(TAG, "Memory allocation failed");
+            return U4G_FAIL;
+        }
+        int n;
+        if (fmt->binary)
+        {
+            static const char hex[] = "0123456789ABCDEF";
+            n = snprintf(cmd, cmd_size, "AT+MHTTPCONTENT=%d,0,0,\"", session->httpid);
+            for (size_t i = 0; i < body_len; i++)
+            {
+                cmd[n++] = hex[(uint8_t)body[i] >> 4];
+                cmd[n++] = hex[(uint8_t)body[i] & 0x0F];
+            }
+            n += snprintf(cmd + n, cmd_size - n, "\"\r\n");
+        }
+        else
+        {
+            n = snprintf(cmd, cmd_size, "AT+MHTTPCONTENT=%d,0,0,\"%s\"\r\n", session->httpid, body);
+        }
+        u4g_at_cmd_t config = {
+            .name = U4G_AT_CMD_HTTP_BODY,
+            .cmd = cmd,
+            .cmd_len = n,
+            .timeout = U4G_HTTP_CFG_TIMEOUT,
+        };
         ret = u4g_at_cmd_sync(&config);
-        vTaskDelay(pdMS_TO_TICKS(100));
+        free(cmd);
         if (ret != U4G_OK)
         {
-            ESP_LOGE(TAG, "HTTP客户端-发送HTTP请求-失败:%d", ret);
+            ESP_LOGE(TAG, "HTTP客户端-配置body-失败:%d", ret);
             return U4G_FAIL;
         }
+    }
 
-        /**
-         * HTTP客户端-发送HTTP请求（对应 AT+MHTTPREQUEST=<httpid>,<method>[,<length>[,<path>[,<local_path>]]]）
-         * <httpid> 整型，HTTP客户端实例id，0~3
-         * <method> 整型，1-GET，2-POST，3-PUT，4-DELETE，5-HEAD
-         * <path> 字符串，HTTP请求路径，例如：/api/device/info
-         */
-        config.name = U4G_AT_CMD_HTTP_REQUEST;
-
-        // 1. 添加保护符号后的格式化字符串
-        const char *format = "#AT+MHTTPREQUEST=%d,%d,0,\"%s\"#\r\n"; // 前后添加#
-        // 2. 临时缓冲区（比目标大2倍，防止溢出）
-        char temp_buffer[283 * 2] = {0};
-        // 3. 使用snprintf生成带保护符号的指令
-        int required_len = snprintf(temp_buffer, sizeof(temp_buffer),
-                                    format, httpid, 2, path);
-        // 4. 检查snprintf是否失败或溢出
-        if (required_len < 0)
-        {
-            ESP_LOGE(TAG, "snprintf格式化失败");
-            return U4G_FAIL;
+    /**
+     * HTTP客户端-发送HTTP请求（对应 AT+MHTTPREQUEST=<httpid>,<method>[,<length>[,<path>[,<local_path>]]]）
+     * <method> 整型，1-GET，2-POST，3-PUT，4-DELETE，5-HEAD
+     * <path> 字符串，HTTP请求路径，例如：/api/device/info，其中的双引号需转义
+     */
+    int method = body ? 2 : 1;
+    size_t cmd_size = snprintf(NULL, 0, "AT+MHTTPREQUEST=%d,%d,0,\"", session->httpid, method) + strlen(path) * 2 + sizeof("\"\r\n");
+    char *cmd = malloc(cmd_size);
+    if (!cmd)
+    {
+        ESP_LOGE(TAG, "Memory allocation failed");
+        return U4G_FAIL;
+    }
+    char *p = cmd + snprintf(cmd, cmd_size, "AT+MHTTPREQUEST=%d,%d,0,\"", session->httpid, method);
+    for (const char *src = path; *src; src++)
+    {
+        if (*src == '"')
+        { // 转义双引号
+            *p++ = '\\';
         }
-        if (required_len >= sizeof(temp_buffer))
+        *p++ = *src;
+    }
+    *p++ = '"';
+    *p++ = '\r';
+    *p++ = '\n';
+    *p = '\0'; // 终止符
+    size_t final_len = p - cmd;
+    if (final_len > AT_CMD_MAX_LEN)
+    { // 根据模块手册调整
+        ESP_LOGE(TAG, "AT command exceeds module limit (%d > %d)", final_len, AT_CMD_MAX_LEN);
+        free(cmd);
+        return U4G_ERR_INVALID_SIZE;
+    }
+    u4g_at_cmd_t config = {
+        .name = U4G_AT_CMD_HTTP_REQUEST,
+        .cmd = cmd,
+        .cmd_len = final_len,
+        .timeout = U4G_HTTP_REQ_TIMEOUT,
+        .handler = handler_http,
+    };
+    ret = http_rsp_begin();
+    http_hex = session->hex;
+    if (ret == U4G_OK)
+    {
+        ret = u4g_at_cmd_sync(&config);
+    }
+    free(cmd);
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "HTTP客户端-发送HTTP请求-失败:%d", ret);
+        return ret;
+    }
+    return U4G_OK;
+}
+
+/** HTTP 请求，响应写入默认接收器，通过 u4g_at_http_body 读取 */
+emU4GResult u4g_at_http_request(const char *url, const char *path, const char *body)
+{
+    return u4g_at_http_request_sink(url, path, body, NULL);
+}
+
+/**
+ * @brief HTTP 请求，响应分包直接写入调用方的接收器
+ * @param url 服务器地址
+ * @param path 请求路径
+ * @param body POST内容，NULL 为GET
+ * @param sink 响应接收器，NULL 写入默认接收器
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_at_http_request_sink(const char *url, const char *path, const char *body, u4g_http_sink_t *sink)
+{
+    return u4g_at_http_request_fmt(url, path, body, NULL, sink);
+}
+
+/**
+ * @brief 指定内容格式的 HTTP 请求，响应分包直接写入调用方的接收器
+ * @param url 服务器地址
+ * @param path 请求路径
+ * @param body POST内容，NULL 为GET
+ * @param fmt 内容格式，NULL 为JSON文本
+ * @param sink 响应接收器，NULL 写入默认接收器
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_at_http_request_fmt(const char *url, const char *path, const char *body, const u4g_http_fmt_t *fmt, u4g_http_sink_t *sink)
+{
+    ESP_LOGD(TAG, "开始HTTP 请求");
+    if (fmt == NULL)
+    {
+        fmt = &http_fmt_json;
+    }
+    if (!url || !path || strlen(url) == 0 || strlen(path) == 0)
+    {
+        ESP_LOGE(TAG, "无效参数 url 或 path");
+        return U4G_ERR_INVALID_ARG;
+    }
+    if (strlen(url) > AT_CMD_MAX_URL_LEN)
+    {
+        ESP_LOGE(TAG, "URL 长度超限 %d > %d", strlen(url), AT_CMD_MAX_URL_LEN);
+        return U4G_ERR_INVALID_SIZE;
+    }
+    // 获取锁
+    if (xSemaphoreTakeRecursive(http_mutex, pdMS_TO_TICKS(U4G_HTTP_LOCK_TIMEOUT)) != pdTRUE)
+    {
+        ESP_LOGE(TAG, "HTTP 锁获取超时");
+        return U4G_ERR_TIMEOUT;
+    }
+    esp_task_wdt_reset();
+
+    // 模块重启过：缓存的实例与配置均已失效
+    if (session_epoch != modem_epoch)
+    {
+        session_epoch = modem_epoch;
+        modem_prepared = false;
+        for (int i = 0; i < U4G_HTTP_SESSION_MAX; i++)
         {
-            ESP_LOGE(TAG, "临时缓冲区溢出! 需要%d字节", required_len + 1);
-            return U4G_FAIL;
+            http_session_drop(&http_session[i], false);
         }
-        // 5. 查找保护符号位置
-        char *start_ptr = strchr(temp_buffer, '#'); // 第一个#
-        char *end_ptr = strrchr(temp_buffer, '#');  // 最后一个#
-        // 6. 校验保护符号完整性
-        if (!start_ptr || !end_ptr || start_ptr >= end_ptr)
+    }
+
+    http_sink = sink ? sink : &default_sink;
+    emU4GResult ret = U4G_FAIL;
+    bool done = false;
+#if U4G_PPP_ENABLE
+    // PPP已建立：由本机协议栈直接请求，失败时改用模块HTTP
+    if (u4g_ppp_is_up())
+    {
+        ret = u4g_ppp_http_request(url, path, body, fmt->binary ? fmt->body_len : (body ? strlen(body) : 0),
+                                   fmt->content_type ? fmt->content_type : U4G_HTTP_CTYPE_JSON, fmt->accept,
+                                   http_rsp_begin, http_sink_write);
+        done = ret == U4G_OK || (http_sink->len && http_sink->begin == NULL && http_sink->write);
+        if (!done)
         {
-            ESP_LOGE(TAG, "保护符号#缺失或位置错误");
-            ESP_LOG_BUFFER_HEXDUMP(TAG, temp_buffer, strlen(temp_buffer), ESP_LOG_ERROR);
-            return U4G_FAIL;
+            ESP_LOGW(TAG, "PPP请求失败:%d，改用模块HTTP", ret);
+        }
+    }
+#endif
+    if (!done)
+    {
+        ret = http_modem_prepare();
+    }
+    for (uint8_t attempt = 0; !done && ret == U4G_OK && attempt < 2; attempt++)
+    {
+        bool reused = false;
+        u4g_http_session_t *session = http_session_get(url, &reused);
+        if (session == NULL)
+        {
+            ret = U4G_FAIL;
+            break;
         }
-        // 7. 计算有效指令范围
-        size_t cmd_len = end_ptr - start_ptr - 1; // 去掉两个#
-        if (cmd_len >= 283)
+        esp_task_wdt_reset();
+        ret = http_session_send(session, path, body, fmt);
+        if (ret == U4G_OK || ret == U4G_ERR_INVALID_SIZE)
         {
-            ESP_LOGE(TAG, "有效指令超出缓冲区! 最大允许%d字节", 283 - 1);
-            return U4G_FAIL;
+            break;
         }
-        // 8. 拷贝有效部分到目标缓冲区
-        strncpy(config.cmd, start_ptr + 1, cmd_len); // 跳过第一个#
-        config.cmd[cmd_len] = '\0';                  // 确保终止符
-
-        // 9. 添加换行符
-        strncat(config.cmd, "\r\n", sizeof(config.cmd) - strlen(config.cmd) - 1); // 添加换行符
-        config.cmd_len = strlen(config.cmd);                                      // 更新长度
-        // config.cmd_len = cmd_len;
-        // 9. 调试日志（可选）
-        ESP_LOGI(TAG, "原始指令: %s", temp_buffer);
-        ESP_LOGI(TAG, "处理后指令: %s (长度=%d)", config.cmd, config.cmd_len);
-
-        // config.cmd_len = snprintf(config.cmd, 283, "#AT+MHTTPREQUEST=%d,%d,0,\"%s#\"\r\n", httpid, 2, path);
-        config.handler = handler_http;
-        config.timeout = 10000;
-        ret = u4g_at_cmd_sync(&config);
-        if (ret != U4G_OK)
+        // 模块报错：会话可能已被服务器或模块关闭，重建后仅对复用的会话重试一次
+        http_session_drop(session, true);
+        if (!reused || (http_sink->len && http_sink->begin == NULL && http_sink->write))
         {
-            ESP_LOGE(TAG, "HTTP客户端-发送HTTP请求-失败:%d", ret);
-            return U4G_FAIL;
+            break; // 流式接收器已收到部分数据且无法重置，不重试
         }
+        ESP_LOGW(TAG, "复用的HTTP会话请求失败，重建会话后重试");
+        ret = U4G_OK;
     }
-
-    ret = u4g_at_http_client_del(httpid);
+    http_sink = &default_sink;
+    xSemaphoreGiveRecursive(http_mutex);
     if (ret != U4G_OK)
     {
-        ESP_LOGE(TAG, "HTTP客户端-删除客户端-失败:%d", ret);
+        ESP_LOGE(TAG, "HTTP-请求失败:%d", ret);
         return U4G_FAIL;
     }
-    xSemaphoreGive(http_mutex);
     ESP_LOGI(TAG, "HTTP-请求执行完成...");
     return U4G_OK;
-}
\ No newline at end of file
+}
+
+// 异步请求执行任务：按提交顺序逐个执行，请求之间不插入等待
+static void http_task(void *pvParameters)
+{
+    u4g_http_handle_t handle = NULL;
+    while (1)
+    {
+        if (xQueueReceive(http_queue, &handle, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+        const u4g_http_req_t *req = &handle->req;
+        // 持锁到回调/复制结束，避免响应内容被其他同步请求覆盖
+        xSemaphoreTakeRecursive(http_mutex, portMAX_DELAY);
+        u4g_at_class_t cls = u4g_at_sched_class_set(req->cls); // 本请求的AT指令按提交时的等级排队
+        handle->result = u4g_at_http_request_fmt(req->url, req->path, req->body, req->fmt, req->sink);
+        u4g_at_sched_class_set(cls);
+        if (req->cb)
+        {
+            const char *data = NULL;
+            if (handle->result == U4G_OK)
+            {
+                data = req->sink ? (req->sink->write ? NULL : req->sink->buf) : u4g_segbuf_flatten(&http_body);
+            }
+            req->cb(handle, handle->result, data, req->arg);
+            if (req->sink == NULL)
+            {
+                u4g_segbuf_reset(&http_body); // 只保留首分段，大响应占用的PSRAM及时归还
+            }
+            xSemaphoreGiveRecursive(http_mutex);
+            free(handle);
+            continue;
+        }
+        if (req->sink == NULL && handle->result == U4G_OK)
+        {
+            // 默认接收器会被下一个请求覆盖，通知模式下把分段整体转交给句柄，不复制数据
+            handle->body = http_body;
+            u4g_segbuf_init(&http_body, U4G_HTTP_BODY_MAX);
+        }
+        xSemaphoreGiveRecursive(http_mutex);
+        handle->done = true;
+        if (req->notify)
+        {
+            xTaskNotify(req->notify, req->notify_bits, eSetBits);
+        }
+    }
+}
+
+/**
+ * @brief 提交异步HTTP请求，立即返回
+ * 告警等级的请求插到队列最前，但不打断正在执行的请求：一次请求从第一条到最后一条AT指令都持有HTTP锁，
+ * 告警最坏要等它结束。会话已建立时一次POST为 MHTTPCONTENT + MHTTPREQUEST，最长
+ * U4G_HTTP_CFG_TIMEOUT + U4G_HTTP_REQ_TIMEOUT（13s）；复用的会话失败重建后重试，再加一次建会话的配置指令与请求，约翻倍
+ * @param req 请求描述，cb 与 notify 至少设置一个
+ * @return 请求句柄，失败返回NULL
+ */
+u4g_http_handle_t u4g_http_submit(const u4g_http_req_t *req)
+{
+    if (http_queue == NULL || req == NULL || req->url == NULL || req->path == NULL || (req->cb == NULL && req->notify == NULL))
+    {
+        ESP_LOGE(TAG, "异步请求参数无效");
+        return NULL;
+    }
+    size_t url_len = strlen(req->url) + 1;
+    size_t path_len = strlen(req->path) + 1;
+    size_t body_len = req->body ? ((req->fmt && req->fmt->binary) ? req->fmt->body_len : strlen(req->body) + 1) : 0;
+    u4g_http_handle_t handle = malloc(sizeof(struct u4g_http_req) + url_len + path_len + body_len);
+    if (handle == NULL)
+    {
+        ESP_LOGE(TAG, "异步请求内存分配失败");
+        return NULL;
+    }
+    char *str = (char *)(handle + 1);
+    handle->req = *req;
+    handle->req.url = memcpy(str, req->url, url_len);
+    handle->req.path = memcpy(str + url_len, req->path, path_len);
+    handle->req.body = req->body ? memcpy(str + url_len + path_len, req->body, body_len) : NULL;
+    if (req->fmt)
+    {
+        handle->fmt = *req->fmt;
+        handle->req.fmt = &handle->fmt;
+    }
+    handle->done = false;
+    handle->result = U4G_STATE_AT_RSP_WAITING;
+    u4g_segbuf_init(&handle->body, U4G_HTTP_BODY_MAX);
+    // 告警请求越过已排队的普通请求
+    BaseType_t queued = req->cls == U4G_AT_CLASS_ALARM ? xQueueSendToFront(http_queue, &handle, 0) : xQueueSend(http_queue, &handle, 0);
+    if (queued != pdTRUE)
+    {
+        ESP_LOGE(TAG, "HTTP请求队列已满");
+        free(handle);
+        return NULL;
+    }
+    return handle;
+}
+
+/**
+ * @brief 查询通知模式请求的结果
+ * @param handle 请求句柄
+ * @param[out] data 响应内容，可为NULL；句柄释放前有效
+ * @return 未完成返回 U4G_STATE_AT_RSP_WAITING，否则返回请求结果
+ */
+emU4GResult u4g_http_result(u4g_http_handle_t handle, const char **data)
+{
+    if (handle == NULL)
+    {
+        return U4G_ERR_INVALID_ARG;
+    }
+    if (!handle->done)
+    {
+        return U4G_STATE_AT_RSP_WAITING;
+    }
+    if (data)
+    {
+        const u4g_http_sink_t *sink = handle->req.sink;
+        if (sink)
+        {
+            *data = sink->write ? NULL : sink->buf;
+        }
+        else
+        {
+            *data = handle->result == U4G_OK ? u4g_segbuf_flatten(&handle->body) : NULL;
+        }
+    }
+    return handle->result;
+}
+
+/**
+ * @brief 取通知模式请求的响应分段（未指定接收器时有效），大响应可逐段读取，不必拼接
+ * @return 分段缓冲区，未完成或指定了接收器时返回NULL；句柄释放前有效
+ */
+const u4g_segbuf_t *u4g_http_body(u4g_http_handle_t handle)
+{
+    if (handle == NULL || !handle->done || handle->req.sink)
+    {
+        return NULL;
+    }
+    return &handle->body;
+}
+
+/**
+ * @brief 取同步请求 u4g_at_http_request 的响应分段，下一次请求前有效
+ */
+const u4g_segbuf_t *u4g_at_http_body(void)
+{
+    return &http_body;
+}
+
+/**
+ * @brief 释放通知模式请求的句柄，需在请求完成后调用
+ */
+void u4g_http_release(u4g_http_handle_t handle)
+{
+    if (handle == NULL)
+    {
+        return;
+    }
+    if (!handle->done)
+    {
+        ESP_LOGE(TAG, "请求未完成，不能释放句柄");
+        return;
+    }
+    u4g_segbuf_free(&handle->body);
+    free(handle);
+}
@@ -0,0 +1,338 @@
+#include "u4g_at_sched.h"
+#include "u4g_at_cmd.h"
+#include "u4g_cmux.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+#define TAG "U4G-AT-SCHED"
+
+#define SCHED_CLASS_DEFAULT U4G_AT_CLASS_TELEMETRY // 未设置等级的任务
+#define SCHED_IDX(cls) ((cls) - U4G_AT_CLASS_ALARM) // 等级 -> 队列下标，0 为最高
+#define SCHED_NUM (U4G_AT_CLASS_MAX - U4G_AT_CLASS_ALARM)
+
+/**
+ * 等待者：位于等待任务的栈上，交接执行权时由释放方置 granted 并释放信号量
+ */
+typedef struct sched_waiter
+{
+    struct sched_waiter *next;
+    SemaphoreHandle_t sem;
+    StaticSemaphore_t sem_buf;
+    u4g_at_class_t cls;
+    int64_t enqueue_us;
+    bool granted;
+} sched_waiter_t;
+
+typedef struct
+{
+    TaskHandle_t task;
+    u4g_at_class_t cls;
+} sched_task_class_t;
+
+/**
+ * 每个AT通道一份执行权，各自按等级排队
+ */
+typedef struct
+{
+    bool busy;                             // 执行权已被占用
+    u4g_at_class_t owner_cls;              // 当前持有者的等级
+    int64_t owner_start_us;                // 当前持有者获得执行权的时间
+    sched_waiter_t *queue_head[SCHED_NUM]; // 各等级等待队列
+    sched_waiter_t *queue_tail[SCHED_NUM];
+} sched_chan_t;
+
+static portMUX_TYPE sched_lock = portMUX_INITIALIZER_UNLOCKED;
+static sched_chan_t sched_chan[U4G_AT_CHAN_NUM];
+static sched_task_class_t task_class[U4G_AT_SCHED_TASK_MAX]; // 任务 -> 等级
+static u4g_at_sched_stat_t sched_stat[SCHED_NUM];
+
+static const char *class_name[U4G_AT_CLASS_MAX] = {"none", "alarm", "control", "telemetry", "background"};
+
+/**
+ * @brief 设置当前任务发起AT指令时使用的等级
+ * @param cls 等级，U4G_AT_CLASS_NONE 恢复默认
+ * @return 之前的等级，用于恢复（未设置过返回 U4G_AT_CLASS_NONE）
+ */
+u4g_at_class_t u4g_at_sched_class_set(u4g_at_class_t cls)
+{
+    if (cls >= U4G_AT_CLASS_MAX)
+    {
+        return U4G_AT_CLASS_NONE;
+    }
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    u4g_at_class_t prev = U4G_AT_CLASS_NONE;
+    sched_task_class_t *slot = NULL;
+    portENTER_CRITICAL(&sched_lock);
+    for (int i = 0; i < U4G_AT_SCHED_TASK_MAX; i++)
+    {
+        if (task_class[i].task == self)
+        {
+            slot = &task_class[i];
+            break;
+        }
+        if (slot == NULL && task_class[i].task == NULL)
+        {
+            slot = &task_class[i];
+        }
+    }
+    if (slot)
+    {
+        prev = slot->task == self ? slot->cls : U4G_AT_CLASS_NONE;
+        slot->task = cls == U4G_AT_CLASS_NONE ? NULL : self;
+        slot->cls = cls;
+    }
+    portEXIT_CRITICAL(&sched_lock);
+    if (slot == NULL)
+    {
+        ESP_LOGW(TAG, "任务等级表已满，忽略等级设置: %s", class_name[cls]);
+    }
+    return prev;
+}
+
+/**
+ * @brief 获取当前任务的等级，未设置时为默认等级
+ */
+u4g_at_class_t u4g_at_sched_class_get(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    u4g_at_class_t cls = SCHED_CLASS_DEFAULT;
+    portENTER_CRITICAL(&sched_lock);
+    for (int i = 0; i < U4G_AT_SCHED_TASK_MAX; i++)
+    {
+        if (task_class[i].task == self)
+        {
+            cls = task_class[i].cls;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&sched_lock);
+    return cls;
+}
+
+/**
+ * @brief 按等级选择通道：CMUX已建立时告警与上报走数据通道，其余走控制通道
+ */
+static uint8_t sched_chan_of(u4g_at_class_t cls)
+{
+#if U4G_CMUX_ENABLE
+    // 数据通道拨号进入PPP后不再承载AT指令
+    if (u4g_cmux_state_get() == U4G_CMUX_ON && !u4g_cmux_raw_active(U4G_CMUX_DLCI_AT(U4G_AT_CHAN_DATA)) &&
+        (cls == U4G_AT_CLASS_ALARM || cls == U4G_AT_CLASS_TELEMETRY))
+    {
+        return U4G_AT_CHAN_DATA;
+    }
+#endif
+    return U4G_AT_CHAN_CTRL;
+}
+
+// 通道上低于 cls 的等级中有等待者（需在临界区内调用）
+static bool sched_lower_waiting(sched_chan_t *ch, u4g_at_class_t cls)
+{
+    for (int i = SCHED_IDX(cls) + 1; i < SCHED_NUM; i++)
+    {
+        if (ch->queue_head[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 记录获得执行权（需在临界区内调用）
+static void sched_grant(sched_chan_t *ch, u4g_at_class_t cls, int64_t enqueue_us, int64_t now_us)
+{
+    u4g_at_sched_stat_t *stat = &sched_stat[SCHED_IDX(cls)];
+    uint32_t wait_us = (uint32_t)(now_us - enqueue_us);
+    ch->busy = true;
+    ch->owner_cls = cls;
+    ch->owner_start_us = now_us;
+    stat->count++;
+    stat->wait_last_us = wait_us;
+    stat->wait_total_us += wait_us;
+    if (wait_us > stat->wait_max_us)
+    {
+        stat->wait_max_us = wait_us;
+    }
+    if (sched_lower_waiting(ch, cls))
+    {
+        stat->preempt++;
+    }
+}
+
+/**
+ * @brief 按当前任务的等级获取发送AT指令的执行权
+ * 空闲时立即获得；否则进入本等级队列，由持有者在指令结束时交给最高等级的队首
+ * @param timeout_ms 最长排队时间(ms)
+ * @param chan 输出获得执行权的通道，释放时原样传回
+ * @return emU4GResult 获得执行权返回U4G_OK，超时返回U4G_ERR_TIMEOUT
+ */
+emU4GResult u4g_at_sched_acquire(uint32_t timeout_ms, uint8_t *chan)
+{
+    sched_waiter_t waiter = {
+        .cls = u4g_at_sched_class_get(),
+        .enqueue_us = esp_timer_get_time(),
+    };
+    int idx = SCHED_IDX(waiter.cls);
+    *chan = sched_chan_of(waiter.cls);
+    sched_chan_t *ch = &sched_chan[*chan];
+
+    portENTER_CRITICAL(&sched_lock);
+    if (!ch->busy)
+    {
+        // 空闲时队列必为空：释放方总是直接交接给队首
+        sched_grant(ch, waiter.cls, waiter.enqueue_us, waiter.enqueue_us);
+        portEXIT_CRITICAL(&sched_lock);
+        return U4G_OK;
+    }
+    portEXIT_CRITICAL(&sched_lock);
+
+    waiter.sem = xSemaphoreCreateBinaryStatic(&waiter.sem_buf);
+    portENTER_CRITICAL(&sched_lock);
+    if (!ch->busy) // 创建信号量期间持有者已释放
+    {
+        sched_grant(ch, waiter.cls, waiter.enqueue_us, esp_timer_get_time());
+        portEXIT_CRITICAL(&sched_lock);
+        vSemaphoreDelete(waiter.sem);
+        return U4G_OK;
+    }
+    if (ch->queue_tail[idx])
+    {
+        ch->queue_tail[idx]->next = &waiter;
+    }
+    else
+    {
+        ch->queue_head[idx] = &waiter;
+    }
+    ch->queue_tail[idx] = &waiter;
+    portEXIT_CRITICAL(&sched_lock);
+
+    emU4GResult ret = U4G_OK;
+    if (xSemaphoreTake(waiter.sem, pdMS_TO_TICKS(timeout_ms)) != pdTRUE)
+    {
+        portENTER_CRITICAL(&sched_lock);
+        bool granted = waiter.granted;
+        if (!granted)
+        {
+            // 从队列中摘除自己
+            sched_waiter_t **pp = &ch->queue_head[idx];
+            sched_waiter_t *prev = NULL;
+            while (*pp && *pp != &waiter)
+            {
+                prev = *pp;
+                pp = &(*pp)->next;
+            }
+            if (*pp)
+            {
+                *pp = waiter.next;
+                if (ch->queue_tail[idx] == &waiter)
+                {
+                    ch->queue_tail[idx] = prev;
+                }
+            }
+            sched_stat[idx].timeout++;
+        }
+        portEXIT_CRITICAL(&sched_lock);
+        if (granted)
+        {
+            xSemaphoreTake(waiter.sem, portMAX_DELAY); // 超时瞬间已被交接，信号量马上到达
+        }
+        else
+        {
+            ESP_LOGE(TAG, "[%s]等待AT执行权超时(%lums)", class_name[waiter.cls], timeout_ms);
+            ret = U4G_ERR_TIMEOUT;
+        }
+    }
+    vSemaphoreDelete(waiter.sem);
+    return ret;
+}
+
+/**
+ * @brief 指令结束，释放执行权：交给该通道最高等级的队首，没有等待者则空闲
+ * @param chan u4g_at_sched_acquire 输出的通道
+ */
+void u4g_at_sched_release(uint8_t chan)
+{
+    if (chan >= U4G_AT_CHAN_NUM)
+    {
+        return;
+    }
+    sched_chan_t *ch = &sched_chan[chan];
+    sched_waiter_t *next = NULL;
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&sched_lock);
+    u4g_at_sched_stat_t *stat = &sched_stat[SCHED_IDX(ch->owner_cls)];
+    uint32_t hold_us = (uint32_t)(now_us - ch->owner_start_us);
+    stat->hold_total_us += hold_us;
+    if (hold_us > stat->hold_max_us)
+    {
+        stat->hold_max_us = hold_us;
+    }
+    for (int i = 0; i < SCHED_NUM && next == NULL; i++)
+    {
+        next = ch->queue_head[i];
+        if (next)
+        {
+            ch->queue_head[i] = next->next;
+            if (ch->queue_head[i] == NULL)
+            {
+                ch->queue_tail[i] = NULL;
+            }
+        }
+    }
+    if (next)
+    {
+        next->granted = true;
+        sched_grant(ch, next->cls, next->enqueue_us, now_us);
+    }
+    else
+    {
+        ch->busy = false;
+    }
+    portEXIT_CRITICAL(&sched_lock);
+    if (next)
+    {
+        xSemaphoreGive(next->sem); // 等待者在收到信号量前不会离开，栈上的 waiter 仍有效
+    }
+}
+
+/**
+ * @brief 获取指定等级的排队统计
+ * @param cls 等级
+ * @param out 输出统计数据
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_at_sched_stat_get(u4g_at_class_t cls, u4g_at_sched_stat_t *out)
+{
+    if (cls == U4G_AT_CLASS_NONE || cls >= U4G_AT_CLASS_MAX || out == NULL)
+    {
+        return U4G_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&sched_lock);
+    *out = sched_stat[SCHED_IDX(cls)];
+    portEXIT_CRITICAL(&sched_lock);
+    return U4G_OK;
+}
+
+/**
+ * @brief 输出各等级的排队统计
+ */
+void u4g_at_sched_stat_log(void)
+{
+    for (u4g_at_class_t cls = U4G_AT_CLASS_ALARM; cls < U4G_AT_CLASS_MAX; cls++)
+    {
+        u4g_at_sched_stat_t stat;
+        u4g_at_sched_stat_get(cls, &stat);
+        if (stat.count == 0 && stat.timeout == 0)
+        {
+            continue;
+        }
+        ESP_LOGI(TAG, "[%s] 次数%lu 超时%lu 插队%lu | 排队 平均%lluus 最大%luus | 占用 平均%lluus 最大%luus",
+                 class_name[cls], stat.count, stat.timeout, stat.preempt,
+                 stat.count ? stat.wait_total_us / stat.count : 0, stat.wait_max_us,
+                 stat.count ? stat.hold_total_us / stat.count : 0, stat.hold_max_us);
+    }
+}
@@ -0,0 +1,202 @@
+#include "u4g_baud.h"
+#include "u4g_uart.h"
+#include "u4g_at_cmd.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+
+#define TAG "U4G-BAUD"
+
+// 自动探测时依次尝试的波特率：目标速率、出厂速率优先（与目标速率相同的项跳过）
+static const uint32_t baud_candidates[] = {U4G_BAUD_TARGET, U4G_UART_BAUD_DEFAULT, 115200, 921600, 460800, 230400, 57600, 38400, 19200};
+
+/**
+ * @brief 以当前波特率发送AT探测模块
+ * @param tries 尝试次数
+ * @return emU4GResult 收到 OK/ERROR 返回U4G_OK
+ */
+static emU4GResult baud_probe(uint8_t tries)
+{
+    u4g_at_cmd_t config = {
+        .name = U4G_AT_CMD,
+        .cmd = "AT\r\n",
+        .cmd_len = 4,
+        .timeout = U4G_BAUD_PROBE_TIMEOUT,
+    };
+    for (uint8_t i = 0; i < tries; i++)
+    {
+        if (u4g_at_cmd_sync(&config) == U4G_OK)
+        {
+            return U4G_OK;
+        }
+        u4g_at_cmd_idle_notify(U4G_AT_CHAN_ANY); // 波特率不对时不会有最终结果码，不必等待空闲
+    }
+    return U4G_FAIL;
+}
+
+// 读取上次协商成功的波特率，没有返回0
+static uint32_t baud_load(void)
+{
+    nvs_handle_t handle;
+    uint32_t baud = 0;
+    if (nvs_open(U4G_BAUD_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK)
+    {
+        nvs_get_u32(handle, U4G_BAUD_NVS_KEY, &baud);
+        nvs_close(handle);
+    }
+    return baud;
+}
+
+static void baud_save(uint32_t baud)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(U4G_BAUD_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK)
+    {
+        err = nvs_set_u32(handle, U4G_BAUD_NVS_KEY, baud);
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "保存波特率失败: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief 模块复位后以当前波特率等待其响应AT
+ */
+static emU4GResult baud_wait_alive(void)
+{
+    TickType_t start = xTaskGetTickCount();
+    while (xTaskGetTickCount() - start < pdMS_TO_TICKS(U4G_BAUD_BOOT_WAIT_MS))
+    {
+        if (baud_probe(1) == U4G_OK)
+        {
+            return U4G_OK;
+        }
+    }
+    return U4G_FAIL;
+}
+
+/**
+ * @brief 自动探测：依次切换本端波特率并发送AT，直到模块响应
+ */
+static emU4GResult baud_scan(void)
+{
+    for (size_t i = 0; i < sizeof(baud_candidates) / sizeof(baud_candidates[0]); i++)
+    {
+        if (i > 0 && baud_candidates[i] == U4G_BAUD_TARGET)
+        {
+            continue;
+        }
+        if (u4g_uart_baud_set(baud_candidates[i]) == ESP_OK && baud_probe(2) == U4G_OK)
+        {
+            ESP_LOGI(TAG, "探测到模块波特率: %lu", baud_candidates[i]);
+            return U4G_OK;
+        }
+    }
+    u4g_uart_baud_set(U4G_UART_BAUD_DEFAULT);
+    return U4G_FAIL;
+}
+
+/**
+ * @brief 以 AT&W 保存模块当前配置，模块复位后仍使用当前波特率
+ * @return emU4GResult 成功返回U4G_OK
+ */
+static emU4GResult baud_persist(void)
+{
+    u4g_at_cmd_t config = {
+        .name = U4G_AT_CMD_SAVE,
+        .cmd = "AT&W\r\n",
+        .cmd_len = 6,
+        .timeout = 1000,
+    };
+    return u4g_at_cmd_sync(&config);
+}
+
+/**
+ * @brief 通过 AT+IPR 切换模块波特率，本端随后切换并用AT验证
+ */
+static emU4GResult baud_switch(uint32_t baud)
+{
+    char cmd[32];
+    u4g_at_cmd_t config = {
+        .name = U4G_AT_CMD_IPR,
+        .cmd = cmd,
+        .cmd_len = snprintf(cmd, sizeof(cmd), "AT+IPR=%lu\r\n", baud),
+        .timeout = 1000,
+    };
+    emU4GResult ret = u4g_at_cmd_sync(&config); // OK 以旧波特率返回，之后模块切换
+    if (ret != U4G_OK)
+    {
+        ESP_LOGW(TAG, "模块不接受波特率%lu: %d", baud, ret);
+        return ret;
+    }
+    vTaskDelay(pdMS_TO_TICKS(50));
+    if (u4g_uart_baud_set(baud) != ESP_OK)
+    {
+        return U4G_FAIL;
+    }
+    return baud_probe(3);
+}
+
+/**
+ * @brief 协商模块串口波特率，需在AT命令模块初始化后调用
+ * 先以NVS中保存的波特率连接，不是目标速率时用 AT+IPR 切换并以AT验证，再用 AT&W 保存到模块；
+ * 验证失败则自动探测模块当前的实际波特率。每次启动都会硬复位模块，NVS中记录的是模块复位后的波特率：
+ * AT&W 成功时为目标速率，下次启动直接连接；否则为切换前的速率，下次启动在该速率下连上后再切换
+ * @return emU4GResult 与模块建立通信返回U4G_OK（不一定是目标速率）
+ */
+emU4GResult u4g_baud_negotiate(void)
+{
+    uint32_t saved = baud_load();
+    if (saved && saved != u4g_uart_baud_get())
+    {
+        u4g_uart_baud_set(saved);
+    }
+    if (baud_wait_alive() != U4G_OK)
+    {
+        ESP_LOGW(TAG, "模块在波特率%lu下无响应，开始自动探测", u4g_uart_baud_get());
+        if (baud_scan() != U4G_OK)
+        {
+            ESP_LOGE(TAG, "自动探测波特率失败，保持%lu", u4g_uart_baud_get());
+            return U4G_FAIL;
+        }
+    }
+    uint32_t boot = u4g_uart_baud_get(); // 模块复位后的波特率
+    if (boot != U4G_BAUD_TARGET)
+    {
+        if (baud_switch(U4G_BAUD_TARGET) != U4G_OK)
+        {
+            ESP_LOGW(TAG, "切换到%lu后验证失败，重新探测", (uint32_t)U4G_BAUD_TARGET);
+            if (baud_scan() != U4G_OK)
+            {
+                ESP_LOGE(TAG, "自动探测波特率失败，保持%lu", u4g_uart_baud_get());
+                return U4G_FAIL;
+            }
+        }
+        if (u4g_uart_baud_get() == U4G_BAUD_TARGET)
+        {
+            if (baud_persist() == U4G_OK)
+            {
+                boot = U4G_BAUD_TARGET;
+            }
+            else
+            {
+                ESP_LOGW(TAG, "模块不支持保存波特率，复位后回到%lu", boot);
+            }
+        }
+    }
+    if (boot != saved)
+    {
+        baud_save(boot);
+    }
+    ESP_LOGI(TAG, "模块串口波特率: %lu", u4g_uart_baud_get());
+    return U4G_OK;
+}
@@ -0,0 +1,498 @@
+#include "u4g_cbor.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TAG "U4G-CBOR"
+
+// 主类型
+enum
+{
+    CBOR_UINT = 0,
+    CBOR_NINT = 1,
+    CBOR_BYTES = 2,
+    CBOR_TEXT = 3,
+    CBOR_ARRAY = 4,
+    CBOR_MAP = 5,
+    CBOR_TAG = 6,
+    CBOR_SIMPLE = 7,
+};
+
+#define CBOR_FALSE 20
+#define CBOR_TRUE 21
+#define CBOR_NULL 22
+#define CBOR_UNDEFINED 23
+#define CBOR_HALF 25
+#define CBOR_FLOAT 26
+#define CBOR_DOUBLE 27
+
+static void enc_put(u4g_cbor_enc_t *enc, const uint8_t *data, size_t len)
+{
+    if (enc->overflow || enc->len + len > enc->size)
+    {
+        enc->overflow = true;
+        return;
+    }
+    memcpy(enc->buf + enc->len, data, len);
+    enc->len += len;
+}
+
+// 类型头部：参数按最短形式编码
+static void enc_head(u4g_cbor_enc_t *enc, uint8_t major, uint64_t arg)
+{
+    uint8_t h[9];
+    size_t n;
+    if (arg < 24)
+    {
+        h[0] = (major << 5) | arg;
+        n = 1;
+    }
+    else if (arg <= UINT8_MAX)
+    {
+        h[0] = (major << 5) | 24;
+        h[1] = arg;
+        n = 2;
+    }
+    else if (arg <= UINT16_MAX)
+    {
+        h[0] = (major << 5) | 25;
+        h[1] = arg >> 8;
+        h[2] = arg;
+        n = 3;
+    }
+    else if (arg <= UINT32_MAX)
+    {
+        h[0] = (major << 5) | 26;
+        for (int i = 0; i < 4; i++)
+        {
+            h[1 + i] = arg >> (24 - 8 * i);
+        }
+        n = 5;
+    }
+    else
+    {
+        h[0] = (major << 5) | 27;
+        for (int i = 0; i < 8; i++)
+        {
+            h[1 + i] = arg >> (56 - 8 * i);
+        }
+        n = 9;
+    }
+    enc_put(enc, h, n);
+}
+
+/**
+ * @brief 初始化编码器
+ * @param buf 输出缓冲区
+ * @param size 缓冲区大小
+ */
+void u4g_cbor_enc_init(u4g_cbor_enc_t *enc, uint8_t *buf, size_t size)
+{
+    enc->buf = buf;
+    enc->size = size;
+    enc->len = 0;
+    enc->overflow = false;
+}
+
+/** 映射开始，之后依次写入 pairs 组键和值 */
+void u4g_cbor_enc_map(u4g_cbor_enc_t *enc, uint32_t pairs)
+{
+    enc_head(enc, CBOR_MAP, pairs);
+}
+
+/** 数组开始，之后依次写入 items 个元素 */
+void u4g_cbor_enc_array(u4g_cbor_enc_t *enc, uint32_t items)
+{
+    enc_head(enc, CBOR_ARRAY, items);
+}
+
+void u4g_cbor_enc_text(u4g_cbor_enc_t *enc, const char *text)
+{
+    size_t len = strlen(text);
+    enc_head(enc, CBOR_TEXT, len);
+    enc_put(enc, (const uint8_t *)text, len);
+}
+
+void u4g_cbor_enc_int(u4g_cbor_enc_t *enc, int64_t value)
+{
+    if (value >= 0)
+    {
+        enc_head(enc, CBOR_UINT, value);
+    }
+    else
+    {
+        enc_head(enc, CBOR_NINT, (uint64_t)(-1 - value));
+    }
+}
+
+void u4g_cbor_enc_bool(u4g_cbor_enc_t *enc, bool value)
+{
+    enc_head(enc, CBOR_SIMPLE, value ? CBOR_TRUE : CBOR_FALSE);
+}
+
+// 半精度转单精度
+static float half_to_float(uint16_t h)
+{
+    int exp = (h >> 10) & 0x1F;
+    int mant = h & 0x3FF;
+    float v;
+    if (exp == 0)
+    {
+        v = ldexpf(mant, -24);
+    }
+    else if (exp != 31)
+    {
+        v = ldexpf(mant + 1024, exp - 25);
+    }
+    else
+    {
+        v = mant == 0 ? INFINITY : NAN;
+    }
+    return (h & 0x8000) ? -v : v;
+}
+
+// 单精度能否无损表示为半精度（只处理规格化数）
+static bool float_to_half(float v, uint16_t *h)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    int exp = (int)((bits >> 23) & 0xFF) - 127;
+    uint32_t mant = bits & 0x7FFFFF;
+    if (exp < -14 || exp > 15 || (mant & 0x1FFF))
+    {
+        return false;
+    }
+    *h = ((bits >> 16) & 0x8000) | ((exp + 15) << 10) | (mant >> 13);
+    return true;
+}
+
+/**
+ * @brief 写入数值：整数值按整数编码，其余能无损表示时用半精度，否则单精度
+ */
+void u4g_cbor_enc_float(u4g_cbor_enc_t *enc, float value)
+{
+    if (value == truncf(value) && fabsf(value) < 2147483648.0f)
+    {
+        u4g_cbor_enc_int(enc, (int64_t)value);
+        return;
+    }
+    uint8_t b[5];
+    uint16_t h;
+    if (float_to_half(value, &h))
+    {
+        b[0] = (CBOR_SIMPLE << 5) | CBOR_HALF;
+        b[1] = h >> 8;
+        b[2] = h;
+        enc_put(enc, b, 3);
+        return;
+    }
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    b[0] = (CBOR_SIMPLE << 5) | CBOR_FLOAT;
+    for (int i = 0; i < 4; i++)
+    {
+        b[1 + i] = bits >> (24 - 8 * i);
+    }
+    enc_put(enc, b, 5);
+}
+
+/**
+ * @brief 结束编码
+ * @param len 输出编码长度，可为NULL
+ * @return 缓冲区不足返回 U4G_ERR_INVALID_SIZE
+ */
+emU4GResult u4g_cbor_enc_finish(const u4g_cbor_enc_t *enc, size_t *len)
+{
+    if (enc->overflow)
+    {
+        ESP_LOGE(TAG, "编码超过缓冲区%d字节", enc->size);
+        return U4G_ERR_INVALID_SIZE;
+    }
+    if (len)
+    {
+        *len = enc->len;
+    }
+    return U4G_OK;
+}
+
+/**
+ * 解码状态：按层递归，键路径与 u4g_json 的规则一致
+ */
+typedef struct
+{
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+    u4g_json_cb_t cb;
+    void *arg;
+    char path[U4G_JSON_PATH_MAX + 1];
+} cbor_dec_t;
+
+static bool dec_head(cbor_dec_t *dec, uint8_t *major, uint8_t *info, uint64_t *arg)
+{
+    if (dec->pos >= dec->len)
+    {
+        return false;
+    }
+    uint8_t b = dec->data[dec->pos++];
+    *major = b >> 5;
+    *info = b & 0x1F;
+    if (*info < 24)
+    {
+        *arg = *info;
+        return true;
+    }
+    if (*info > 27)
+    {
+        return false; // 不定长或保留值
+    }
+    size_t n = 1u << (*info - 24);
+    if (n > dec->len - dec->pos)
+    {
+        return false;
+    }
+    *arg = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        *arg = (*arg << 8) | dec->data[dec->pos++];
+    }
+    return true;
+}
+
+// 路径截回 len 后追加一段
+static bool dec_path(cbor_dec_t *dec, size_t len, const char *seg, size_t seg_len)
+{
+    if (len + (len ? 1 : 0) + seg_len > U4G_JSON_PATH_MAX)
+    {
+        return false;
+    }
+    char *p = dec->path + len;
+    if (len)
+    {
+        *p++ = '.';
+    }
+    memcpy(p, seg, seg_len);
+    p[seg_len] = '\0';
+    return true;
+}
+
+static void dec_emit(cbor_dec_t *dec, u4g_json_type_t type, const char *value)
+{
+    if (dec->cb)
+    {
+        dec->cb(dec->path, type, value, dec->arg);
+    }
+}
+
+static emU4GResult dec_item(cbor_dec_t *dec, uint8_t depth);
+
+// 映射的键：文本或整数
+static emU4GResult dec_key(cbor_dec_t *dec, size_t base_len)
+{
+    uint8_t major, info;
+    uint64_t arg;
+    if (!dec_head(dec, &major, &info, &arg))
+    {
+        return U4G_FAIL;
+    }
+    char seg[24];
+    if (major == CBOR_TEXT)
+    {
+        if (arg > dec->len - dec->pos) // 不能写成 pos + arg：arg 来自报文，可达 2^64-1，相加会回绕
+        {
+            return U4G_FAIL;
+        }
+        bool ok = dec_path(dec, base_len, (const char *)dec->data + dec->pos, arg);
+        dec->pos += arg;
+        return ok ? U4G_OK : U4G_FAIL;
+    }
+    if (major == CBOR_UINT || major == CBOR_NINT)
+    {
+        int n = major == CBOR_UINT ? snprintf(seg, sizeof(seg), "%" PRIu64, arg) : snprintf(seg, sizeof(seg), "-%" PRIu64, arg + 1);
+        return dec_path(dec, base_len, seg, n) ? U4G_OK : U4G_FAIL;
+    }
+    return U4G_FAIL;
+}
+
+static emU4GResult dec_item(cbor_dec_t *dec, uint8_t depth)
+{
+    uint8_t major, info;
+    uint64_t arg;
+    char value[U4G_JSON_TOKEN_MAX + 1];
+    if (!dec_head(dec, &major, &info, &arg))
+    {
+        return U4G_FAIL;
+    }
+    size_t base_len = strlen(dec->path);
+    switch (major)
+    {
+    case CBOR_UINT:
+        snprintf(value, sizeof(value), "%" PRIu64, arg);
+        dec_emit(dec, U4G_JSON_NUMBER, value);
+        return U4G_OK;
+    case CBOR_NINT:
+        snprintf(value, sizeof(value), "-%" PRIu64, arg + 1);
+        dec_emit(dec, U4G_JSON_NUMBER, value);
+        return U4G_OK;
+    case CBOR_BYTES:
+    case CBOR_TEXT:
+        if (arg > dec->len - dec->pos) // 同上，防止回绕
+        {
+            return U4G_FAIL;
+        }
+        if (major == CBOR_TEXT)
+        {
+            size_t n = arg < U4G_JSON_TOKEN_MAX ? arg : U4G_JSON_TOKEN_MAX; // 过长的文本截断，与JSON解析器一致只保留关注的短字段
+            memcpy(value, dec->data + dec->pos, n);
+            value[n] = '\0';
+            dec_emit(dec, U4G_JSON_STRING, value);
+        }
+        dec->pos += arg; // 字节串没有对应的JSON类型，跳过
+        return U4G_OK;
+    case CBOR_ARRAY:
+    case CBOR_MAP:
+        if (depth >= U4G_JSON_DEPTH_MAX)
+        {
+            ESP_LOGE(TAG, "嵌套超过%d层: %s", U4G_JSON_DEPTH_MAX, dec->path);
+            return U4G_FAIL;
+        }
+        dec_emit(dec, major == CBOR_MAP ? U4G_JSON_OBJECT : U4G_JSON_ARRAY, NULL);
+        for (uint64_t i = 0; i < arg; i++)
+        {
+            emU4GResult ret;
+            if (major == CBOR_MAP)
+            {
+                ret = dec_key(dec, base_len);
+            }
+            else
+            {
+                char seg[12];
+                int n = snprintf(seg, sizeof(seg), "%u", (unsigned)i);
+                ret = dec_path(dec, base_len, seg, n) ? U4G_OK : U4G_FAIL;
+            }
+            if (ret == U4G_OK)
+            {
+                ret = dec_item(dec, depth + 1);
+            }
+            if (ret != U4G_OK)
+            {
+                return ret;
+            }
+        }
+        dec->path[base_len] = '\0';
+        return U4G_OK;
+    case CBOR_TAG:
+        if (depth >= U4G_JSON_DEPTH_MAX) // 标签可以无限串联，同样计入嵌套层数，防止递归耗尽栈
+        {
+            ESP_LOGE(TAG, "嵌套超过%d层: %s", U4G_JSON_DEPTH_MAX, dec->path);
+            return U4G_FAIL;
+        }
+        return dec_item(dec, depth + 1); // 标签不影响取值
+    default:
+        break;
+    }
+    // 简单值与浮点数
+    if (info == CBOR_FALSE || info == CBOR_TRUE)
+    {
+        dec_emit(dec, U4G_JSON_BOOL, info == CBOR_TRUE ? "true" : "false");
+        return U4G_OK;
+    }
+    if (info == CBOR_NULL || info == CBOR_UNDEFINED)
+    {
+        dec_emit(dec, U4G_JSON_NULL, "null");
+        return U4G_OK;
+    }
+    double v;
+    if (info == CBOR_HALF)
+    {
+        v = half_to_float(arg);
+    }
+    else if (info == CBOR_FLOAT)
+    {
+        uint32_t bits = arg;
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        v = f;
+    }
+    else if (info == CBOR_DOUBLE)
+    {
+        memcpy(&v, &arg, sizeof(v));
+    }
+    else
+    {
+        return U4G_FAIL;
+    }
+    snprintf(value, sizeof(value), info == CBOR_DOUBLE ? "%.17g" : "%.7g", v); // 按来源精度输出，单精度的 25.3 不会变成 25.2999992
+    dec_emit(dec, U4G_JSON_NUMBER, value);
+    return U4G_OK;
+}
+
+/**
+ * @brief 解码一段完整的CBOR内容，按键路径回调
+ * @param data 内容
+ * @param len 内容长度
+ * @param cb 值回调（与 u4g_json 相同）
+ * @param arg 用户参数
+ * @return emU4GResult 内容完整且格式正确返回U4G_OK
+ */
+emU4GResult u4g_cbor_decode(const uint8_t *data, size_t len, u4g_json_cb_t cb, void *arg)
+{
+    cbor_dec_t dec = {
+        .data = data,
+        .len = len,
+        .cb = cb,
+        .arg = arg,
+    };
+    emU4GResult ret = dec_item(&dec, 0);
+    if (ret != U4G_OK || dec.pos != len)
+    {
+        ESP_LOGE(TAG, "CBOR解码失败: 位置%d/%d 路径:%s", dec.pos, len, dec.path);
+        return U4G_FAIL;
+    }
+    return U4G_OK;
+}
+
+/**
+ * @brief 初始化解码器
+ */
+void u4g_cbor_init(u4g_cbor_t *cbor, u4g_json_cb_t cb, void *arg)
+{
+    cbor->cb = cb;
+    cbor->arg = arg;
+    cbor->len = 0;
+    cbor->overflow = false;
+}
+
+/**
+ * @brief 输入一段内容，分几次输入都可以
+ */
+emU4GResult u4g_cbor_feed(u4g_cbor_t *cbor, const uint8_t *data, size_t len)
+{
+    if (cbor->overflow || cbor->len + len > sizeof(cbor->buf))
+    {
+        if (!cbor->overflow)
+        {
+            ESP_LOGE(TAG, "CBOR内容超过%d字节", sizeof(cbor->buf));
+        }
+        cbor->overflow = true;
+        return U4G_ERR_INVALID_SIZE;
+    }
+    memcpy(cbor->buf + cbor->len, data, len);
+    cbor->len += len;
+    return U4G_OK;
+}
+
+/**
+ * @brief 输入结束，解码全部内容
+ * @return emU4GResult 完整返回U4G_OK
+ */
+emU4GResult u4g_cbor_finish(u4g_cbor_t *cbor)
+{
+    if (cbor->overflow)
+    {
+        return U4G_ERR_INVALID_SIZE;
+    }
+    return u4g_cbor_decode(cbor->buf, cbor->len, cbor->cb, cbor->arg);
+}
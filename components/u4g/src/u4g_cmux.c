@@ -0,0 +1,592 @@
+#include "u4g_cmux.h"
+#include "u4g_at_cmd.h"
+#include "u4g_uart_line.h"
+#include "u4g_uart_recv.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <stdbool.h>
+#include <string.h>
+
+#if U4G_CMUX_ENABLE
+
+#define TAG "U4G-CMUX"
+
+#define CMUX_FLAG 0xF9
+#define CMUX_EA 0x01 // 地址/长度字节的扩展位：1 表示最后一个字节
+#define CMUX_CR 0x02 // 命令/响应位
+#define CMUX_PF 0x10 // 控制字段的 P/F 位
+
+// 帧类型（控制字段去掉 P/F 位）
+#define CMUX_SABM 0x2F
+#define CMUX_UA 0x63
+#define CMUX_DM 0x0F
+#define CMUX_DISC 0x43
+#define CMUX_UIH 0xEF
+#define CMUX_UI 0x03
+
+// 控制通道消息类型（类型字节去掉 EA 与 C/R 位后右移两位）
+#define CMUX_MSG_CLD 0x30 // 关闭复用
+#define CMUX_MSG_TEST 0x08
+#define CMUX_MSG_FCON 0x28  // 全部通道恢复发送
+#define CMUX_MSG_FCOFF 0x18 // 全部通道暂停发送
+#define CMUX_MSG_MSC 0x38   // 通道的 V.24 信号状态
+#define CMUX_MSC_FC 0x02    // V.24 信号：FC 对端无法接收
+#define CMUX_MSC_V24 0x0D   // 本端信号：EA | RTC | RTR，FC=0
+
+#define CMUX_FCS_GOOD 0xCF // 含 FCS 在内重新计算后的余数
+
+// 事件位：第 d 位为 DLCI d 收到 UA，第 8+d 位为收到 DM
+#define CMUX_UA_BIT(d) (1 << (d))
+#define CMUX_DM_BIT(d) (1 << (8 + (d)))
+
+// 接收状态机
+typedef enum
+{
+    RX_HUNT, // 寻找起始标志，期间的字节为非复用数据
+    RX_ADDR,
+    RX_CTRL,
+    RX_LEN1,
+    RX_LEN2,
+    RX_INFO,
+    RX_FCS,
+    RX_END,
+} cmux_rx_state_t;
+
+typedef struct
+{
+    cmux_rx_state_t state;
+    uint8_t addr;
+    uint8_t ctrl;
+    uint16_t len;
+    uint16_t pos;
+    uint8_t fcs;                    // 逐字节累计的校验余数
+    uint8_t info[U4G_CMUX_N1];
+} cmux_rx_t;
+
+static volatile u4g_cmux_state_t cmux_state = U4G_CMUX_OFF;
+static cmux_rx_t cmux_rx;                              // 只在解析任务中访问
+static u4g_uart_line_t cmux_line[U4G_CMUX_DLCI_NUM];   // 各通道的行切分器，下标0用于帧之外的非复用数据
+static uint8_t crc_table[256];
+static SemaphoreHandle_t tx_mutex = NULL;              // 帧整体写入串口，不同通道的帧不交错
+static EventGroupHandle_t cmux_event = NULL;
+static volatile bool flow_off_all = false;             // 模块通过 FCoff 暂停全部通道
+static volatile uint8_t flow_off_mask = 0;             // 模块通过 MSC 暂停的通道
+static u4g_cmux_stat_t cmux_stat;
+static u4g_cmux_raw_cb_t raw_cb[U4G_CMUX_DLCI_NUM];    // 透传数据接收函数，NULL 为按行解析AT
+static void *raw_arg[U4G_CMUX_DLCI_NUM];
+static portMUX_TYPE raw_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 27.010 使用反射多项式 x^8+x^2+x+1 (0xE0)
+static void crc_table_init(void)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        uint8_t crc = i;
+        for (int b = 0; b < 8; b++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xE0 : crc >> 1;
+        }
+        crc_table[i] = crc;
+    }
+}
+
+static uint8_t fcs_calc(const uint8_t *data, size_t len)
+{
+    uint8_t fcs = 0xFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        fcs = crc_table[fcs ^ data[i]];
+    }
+    return 0xFF - fcs;
+}
+
+/**
+ * @brief 发送一帧，信息字段不超过 U4G_CMUX_N1
+ * @param cr 本端作为发起方，命令与UIH置1，对模块命令的响应置0
+ */
+static int32_t frame_send(uint8_t dlci, uint8_t ctrl, bool cr, const uint8_t *info, size_t len)
+{
+    uint8_t frame[U4G_CMUX_N1 + 7];
+    size_t n = 0;
+    frame[n++] = CMUX_FLAG;
+    frame[n++] = (dlci << 2) | (cr ? CMUX_CR : 0) | CMUX_EA;
+    frame[n++] = ctrl;
+    if (len <= 127)
+    {
+        frame[n++] = (len << 1) | CMUX_EA;
+    }
+    else
+    {
+        frame[n++] = (len & 0x7F) << 1;
+        frame[n++] = len >> 7;
+    }
+    size_t head = n - 1;
+    memcpy(&frame[n], info, len);
+    n += len;
+    // UIH 的 FCS 只覆盖地址、控制、长度字段，其他帧覆盖到信息字段
+    frame[n] = fcs_calc(&frame[1], (ctrl & ~CMUX_PF) == CMUX_UIH ? head : n - 1);
+    n++;
+    frame[n++] = CMUX_FLAG;
+
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    int32_t ret = u4g_uart_send((const char *)frame, n);
+    if (ret >= 0)
+    {
+        cmux_stat.tx_frames++;
+    }
+    xSemaphoreGive(tx_mutex);
+    return ret;
+}
+
+// 控制通道消息：类型、长度、值
+static int32_t ctrl_msg_send(uint8_t type, bool cr, const uint8_t *value, size_t len)
+{
+    uint8_t msg[8];
+    if (len > sizeof(msg) - 2)
+    {
+        return U4G_ERR_INVALID_SIZE;
+    }
+    msg[0] = (type << 2) | (cr ? CMUX_CR : 0) | CMUX_EA;
+    msg[1] = (len << 1) | CMUX_EA;
+    memcpy(&msg[2], value, len);
+    return frame_send(0, CMUX_UIH, true, msg, len + 2);
+}
+
+/**
+ * @brief 处理模块在控制通道上发来的消息，命令类消息原样应答
+ */
+static void ctrl_msg_handle(const uint8_t *info, size_t len)
+{
+    while (len >= 2)
+    {
+        uint8_t type = info[0] >> 2;
+        bool cr = info[0] & CMUX_CR;
+        size_t vlen = info[1] >> 1;
+        if (!(info[1] & CMUX_EA) || vlen + 2 > len)
+        {
+            return; // 不支持多字节长度，控制消息都很短
+        }
+        const uint8_t *value = &info[2];
+        if (type == CMUX_MSG_MSC && vlen >= 2)
+        {
+            uint8_t dlci = value[0] >> 2;
+            if (cr && dlci < 8)
+            {
+                // 模块通知其发送侧状态：FC=1 时暂停向该通道发送
+                if (value[1] & CMUX_MSC_FC)
+                {
+                    flow_off_mask |= 1 << dlci;
+                }
+                else
+                {
+                    flow_off_mask &= ~(1 << dlci);
+                }
+            }
+        }
+        else if (type == CMUX_MSG_FCOFF || type == CMUX_MSG_FCON)
+        {
+            flow_off_all = type == CMUX_MSG_FCOFF;
+        }
+        else if (type == CMUX_MSG_CLD && cr)
+        {
+            ESP_LOGW(TAG, "模块关闭复用");
+            cmux_state = U4G_CMUX_OFF;
+        }
+        if (cr)
+        {
+            ctrl_msg_send(type, false, value, vlen);
+        }
+        info += vlen + 2;
+        len -= vlen + 2;
+    }
+}
+
+// 一帧接收完成
+static void frame_handle(cmux_rx_t *rx)
+{
+    uint8_t dlci = rx->addr >> 2;
+    uint8_t type = rx->ctrl & ~CMUX_PF;
+    cmux_stat.rx_frames++;
+    switch (type)
+    {
+    case CMUX_UA:
+        xEventGroupSetBits(cmux_event, CMUX_UA_BIT(dlci & 7));
+        break;
+    case CMUX_DM:
+        xEventGroupSetBits(cmux_event, CMUX_DM_BIT(dlci & 7));
+        break;
+    case CMUX_DISC:
+        frame_send(dlci, CMUX_UA | CMUX_PF, false, NULL, 0);
+        if (dlci == 0)
+        {
+            ESP_LOGW(TAG, "模块断开复用控制通道");
+            cmux_state = U4G_CMUX_OFF;
+        }
+        break;
+    case CMUX_UIH:
+    case CMUX_UI:
+        if (dlci == 0)
+        {
+            ctrl_msg_handle(rx->info, rx->len);
+        }
+        else if (dlci < U4G_CMUX_DLCI_NUM)
+        {
+            portENTER_CRITICAL(&raw_lock);
+            u4g_cmux_raw_cb_t cb = raw_cb[dlci];
+            void *arg = raw_arg[dlci];
+            portEXIT_CRITICAL(&raw_lock);
+            if (cb)
+            {
+                cb(rx->info, rx->len, arg);
+            }
+            else
+            {
+                u4g_uart_line_feed(&cmux_line[dlci], rx->info, rx->len);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief 接收侧输入串口字节，按帧解析后把各通道的数据交给对应的行切分器
+ * 帧之外的数据（模块异常重启后输出的 +MATREADY 等）按非复用数据切行，作为URC处理。
+ * 只在解析任务中调用
+ */
+void u4g_cmux_feed(const uint8_t *data, size_t len)
+{
+    cmux_rx_t *rx = &cmux_rx;
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t b = data[i];
+        switch (rx->state)
+        {
+        case RX_HUNT:
+            if (b == CMUX_FLAG)
+            {
+                rx->state = RX_ADDR;
+            }
+            else
+            {
+                u4g_uart_line_feed(&cmux_line[0], &b, 1);
+            }
+            break;
+        case RX_ADDR:
+            if (b == CMUX_FLAG)
+            {
+                break; // 连续的标志：上一帧的结束标志兼作本帧起始
+            }
+            if (!(b & CMUX_EA))
+            {
+                rx->state = RX_HUNT;
+                cmux_stat.rx_drop++;
+                break;
+            }
+            rx->addr = b;
+            rx->fcs = crc_table[0xFF ^ b];
+            rx->state = RX_CTRL;
+            break;
+        case RX_CTRL:
+            rx->ctrl = b;
+            rx->fcs = crc_table[rx->fcs ^ b];
+            rx->state = RX_LEN1;
+            break;
+        case RX_LEN1:
+            rx->fcs = crc_table[rx->fcs ^ b];
+            rx->len = b >> 1;
+            rx->pos = 0;
+            if (!(b & CMUX_EA))
+            {
+                rx->state = RX_LEN2;
+            }
+            else
+            {
+                rx->state = rx->len ? RX_INFO : RX_FCS;
+            }
+            break;
+        case RX_LEN2:
+            rx->fcs = crc_table[rx->fcs ^ b];
+            rx->len |= (uint16_t)b << 7;
+            if (rx->len > U4G_CMUX_N1)
+            {
+                rx->state = RX_HUNT;
+                cmux_stat.rx_drop++;
+                break;
+            }
+            rx->state = rx->len ? RX_INFO : RX_FCS;
+            break;
+        case RX_INFO:
+            rx->info[rx->pos++] = b;
+            if ((rx->ctrl & ~CMUX_PF) != CMUX_UIH)
+            {
+                rx->fcs = crc_table[rx->fcs ^ b];
+            }
+            if (rx->pos >= rx->len)
+            {
+                rx->state = RX_FCS;
+            }
+            break;
+        case RX_FCS:
+            if (crc_table[rx->fcs ^ b] != CMUX_FCS_GOOD)
+            {
+                cmux_stat.rx_fcs++;
+                rx->state = RX_HUNT;
+                break;
+            }
+            rx->state = RX_END;
+            break;
+        case RX_END:
+            if (b == CMUX_FLAG)
+            {
+                frame_handle(rx);
+                rx->state = RX_ADDR;
+            }
+            else
+            {
+                cmux_stat.rx_drop++;
+                rx->state = RX_HUNT;
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 丢弃未完成的帧与各通道未完成的行（复用状态切换、串口溢出后由解析任务调用）
+ */
+void u4g_cmux_rx_reset(void)
+{
+    cmux_rx.state = RX_HUNT;
+    for (int i = 0; i < U4G_CMUX_DLCI_NUM; i++)
+    {
+        u4g_uart_line_reset(&cmux_line[i]);
+    }
+}
+
+// 各通道的完整行交给AT应答处理，arg 为对应的指令通道
+static size_t cmux_line_handler(char *line, size_t len, bool raw, void *arg)
+{
+    if (raw)
+    {
+        u4g_uart_recv_content(line, len);
+    }
+    else
+    {
+        u4g_uart_recv_process((uint8_t)(uintptr_t)arg, line, len);
+    }
+    return u4g_uart_recv_raw_take();
+}
+
+static bool cmux_line_prompt(void *arg)
+{
+    return u4g_uart_recv_prompt_wait((uint8_t)(uintptr_t)arg);
+}
+
+/**
+ * @brief 向虚拟通道写入数据，超过 N1 时拆成多帧
+ * @param dlci 通道
+ * @param data 数据
+ * @param len 数据长度
+ * @return 成功返回写入的字节数，否则返回错误码
+ */
+int32_t u4g_cmux_write(uint8_t dlci, const uint8_t *data, size_t len)
+{
+    if (dlci == 0 || dlci >= U4G_CMUX_DLCI_NUM || cmux_state == U4G_CMUX_OFF)
+    {
+        return U4G_ERR_INVALID_STATE;
+    }
+    size_t sent = 0;
+    while (sent < len)
+    {
+        TickType_t start = xTaskGetTickCount();
+        while ((flow_off_all || (flow_off_mask & (1 << dlci))) && xTaskGetTickCount() - start < pdMS_TO_TICKS(U4G_CMUX_FLOW_WAIT_MS))
+        {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        size_t n = len - sent < U4G_CMUX_N1 ? len - sent : U4G_CMUX_N1;
+        int32_t ret = frame_send(dlci, CMUX_UIH, true, data + sent, n);
+        if (ret < 0)
+        {
+            return ret;
+        }
+        sent += n;
+    }
+    return sent;
+}
+
+/**
+ * @brief 设置通道的透传数据接收函数（拨号进入数据模式后由PPP接管），NULL 恢复为按行解析AT
+ * 从下一帧开始生效；切换时丢弃该通道未完成的行
+ * @param dlci 通道
+ * @param cb 接收函数，在解析任务中调用，不要阻塞
+ * @param arg 接收函数参数
+ */
+void u4g_cmux_raw_set(uint8_t dlci, u4g_cmux_raw_cb_t cb, void *arg)
+{
+    if (dlci == 0 || dlci >= U4G_CMUX_DLCI_NUM)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&raw_lock);
+    raw_cb[dlci] = cb;
+    raw_arg[dlci] = arg;
+    portEXIT_CRITICAL(&raw_lock);
+    u4g_uart_line_reset(&cmux_line[dlci]);
+}
+
+/**
+ * @brief 通道是否处于透传模式
+ */
+bool u4g_cmux_raw_active(uint8_t dlci)
+{
+    return dlci < U4G_CMUX_DLCI_NUM && raw_cb[dlci] != NULL;
+}
+
+// 发送本端 V.24 信号状态（RTC/RTR 有效，FC=0）
+static int32_t msc_send(uint8_t dlci)
+{
+    uint8_t msc[2] = {(dlci << 2) | CMUX_CR | CMUX_EA, CMUX_MSC_V24};
+    return ctrl_msg_send(CMUX_MSG_MSC, true, msc, sizeof(msc));
+}
+
+// 建立一条通道：发送 SABM，等待 UA，超时重发
+static emU4GResult dlci_open(uint8_t dlci)
+{
+    for (int i = 0; i < U4G_CMUX_N2; i++)
+    {
+        xEventGroupClearBits(cmux_event, CMUX_UA_BIT(dlci) | CMUX_DM_BIT(dlci));
+        frame_send(dlci, CMUX_SABM | CMUX_PF, true, NULL, 0);
+        EventBits_t bits = xEventGroupWaitBits(cmux_event, CMUX_UA_BIT(dlci) | CMUX_DM_BIT(dlci), pdTRUE, pdFALSE, pdMS_TO_TICKS(U4G_CMUX_T1_MS));
+        if (bits & CMUX_UA_BIT(dlci))
+        {
+            return U4G_OK;
+        }
+        if (bits & CMUX_DM_BIT(dlci))
+        {
+            ESP_LOGE(TAG, "模块拒绝建立通道%d", dlci);
+            return U4G_FAIL;
+        }
+    }
+    ESP_LOGE(TAG, "建立通道%d超时", dlci);
+    return U4G_ERR_TIMEOUT;
+}
+
+/**
+ * @brief 模块应答 AT+CMUX 后建立全部通道并交换 V.24 信号状态；失败时让模块退出复用
+ */
+static emU4GResult cmux_open(void)
+{
+    flow_off_all = false;
+    flow_off_mask = 0;
+    cmux_state = U4G_CMUX_OPENING; // 解析任务从此按帧解析
+    emU4GResult ret = U4G_OK;
+    for (uint8_t dlci = 0; dlci < U4G_CMUX_DLCI_NUM && ret == U4G_OK; dlci++)
+    {
+        ret = dlci_open(dlci);
+    }
+    if (ret != U4G_OK)
+    {
+        ctrl_msg_send(CMUX_MSG_CLD, true, NULL, 0);
+        vTaskDelay(pdMS_TO_TICKS(U4G_CMUX_T1_MS));
+        cmux_state = U4G_CMUX_OFF;
+        return ret;
+    }
+    for (uint8_t dlci = 1; dlci < U4G_CMUX_DLCI_NUM; dlci++)
+    {
+        msc_send(dlci);
+    }
+    cmux_state = U4G_CMUX_ON;
+    return U4G_OK;
+}
+
+/**
+ * @brief 进入复用模式并建立控制、数据、URC三个虚拟通道
+ * 模块每次启动都处于非复用模式，复位后需重新调用（由监管任务在模块响应AT后调用）
+ * @return emU4GResult 成功返回U4G_OK，失败时保持非复用模式
+ */
+emU4GResult u4g_cmux_start(void)
+{
+    if (cmux_state != U4G_CMUX_OFF)
+    {
+        return U4G_OK;
+    }
+    if (tx_mutex == NULL)
+    {
+        crc_table_init();
+        tx_mutex = xSemaphoreCreateMutex();
+        cmux_event = xEventGroupCreate();
+        if (tx_mutex == NULL || cmux_event == NULL)
+        {
+            ESP_LOGE(TAG, "复用资源创建失败");
+            return U4G_FAIL;
+        }
+        u4g_uart_line_init(&cmux_line[0], cmux_line_handler, cmux_line_prompt, (void *)(uintptr_t)U4G_AT_CHAN_ANY);
+        u4g_uart_line_init(&cmux_line[U4G_CMUX_DLCI_AT(U4G_AT_CHAN_CTRL)], cmux_line_handler, cmux_line_prompt, (void *)(uintptr_t)U4G_AT_CHAN_CTRL);
+        u4g_uart_line_init(&cmux_line[U4G_CMUX_DLCI_AT(U4G_AT_CHAN_DATA)], cmux_line_handler, cmux_line_prompt, (void *)(uintptr_t)U4G_AT_CHAN_DATA);
+        u4g_uart_line_init(&cmux_line[U4G_CMUX_DLCI_URC], cmux_line_handler, cmux_line_prompt, (void *)(uintptr_t)U4G_AT_CHAN_ANY);
+    }
+    emU4GResult ret = u4g_at_cmux(U4G_CMUX_N1, cmux_open);
+    if (ret == U4G_OK)
+    {
+        ESP_LOGI(TAG, "CMUX已建立：控制、数据、URC通道");
+    }
+    return ret;
+}
+
+/**
+ * @brief 断开并重新建立一条通道，模块挂断该通道上的数据呼叫并回到AT命令模式
+ * @param dlci 通道
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_cmux_dlci_reopen(uint8_t dlci)
+{
+    if (dlci == 0 || dlci >= U4G_CMUX_DLCI_NUM || cmux_state != U4G_CMUX_ON)
+    {
+        return U4G_ERR_INVALID_STATE;
+    }
+    xEventGroupClearBits(cmux_event, CMUX_UA_BIT(dlci) | CMUX_DM_BIT(dlci));
+    frame_send(dlci, CMUX_DISC | CMUX_PF, true, NULL, 0);
+    // 通道已关闭时模块以 DM 应答，同样可以重新建立
+    xEventGroupWaitBits(cmux_event, CMUX_UA_BIT(dlci) | CMUX_DM_BIT(dlci), pdTRUE, pdFALSE, pdMS_TO_TICKS(U4G_CMUX_T1_MS));
+    u4g_uart_line_reset(&cmux_line[dlci]);
+    emU4GResult ret = dlci_open(dlci);
+    if (ret != U4G_OK)
+    {
+        return ret;
+    }
+    msc_send(dlci);
+    ESP_LOGI(TAG, "通道%d已重新建立", dlci);
+    return U4G_OK;
+}
+
+/**
+ * @brief 模块已复位（复用随之结束），本端回到非复用模式，不向模块发送任何数据
+ */
+void u4g_cmux_reset(void)
+{
+    if (cmux_state != U4G_CMUX_OFF)
+    {
+        ESP_LOGW(TAG, "回到非复用模式");
+        cmux_state = U4G_CMUX_OFF;
+    }
+    portENTER_CRITICAL(&raw_lock);
+    memset(raw_cb, 0, sizeof(raw_cb)); // 透传随复用一同结束
+    portEXIT_CRITICAL(&raw_lock);
+}
+
+u4g_cmux_state_t u4g_cmux_state_get(void)
+{
+    return cmux_state;
+}
+
+void u4g_cmux_stat_get(u4g_cmux_stat_t *out)
+{
+    *out = cmux_stat;
+}
+
+#endif
@@ -1,117 +1,71 @@
 #include "u4g_data.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "esp_log.h"
+#include <stdatomic.h>
 #include <string.h> // 增加字符串操作支持
 
 #define TAG "U4G-DATA"
 
-// 新增保护机制
-static SemaphoreHandle_t data_mutex = NULL;
+#define U4G_DATA_SPIN_MAX 64 // 读取冲突时自旋重试次数，超过后让出CPU
 
-u4g_data_t u4g_data = {0};
+/**
+ * 顺序锁：写入方开始时序号加一（奇数），结束时再加一（偶数）；
+ * 读取方复制前后序号一致且为偶数才算完整快照，否则重试，读写双方都不阻塞接收任务
+ * 写入方只有解析任务中的应答处理函数，无需写锁
+ */
+static u4g_data_t u4g_data = {0};
+static atomic_uint data_seq = 0;
 
 emU4GResult u4g_data_init(void)
 {
-    data_mutex = xSemaphoreCreateMutex();
-    if (data_mutex == NULL)
-    {
-        // 互斥锁创建失败
-        ESP_LOGE(TAG, "发送命令互斥锁创建失败");
-        return U4G_FAIL;
-    }
-    ESP_LOGI(TAG, "AT 命令模块初始化完成");
+    ESP_LOGI(TAG, "模块数据初始化完成");
     return U4G_OK;
 }
 
-// 获取4G模组信息
-u4g_data_t* u4g_data_get(void) {
-    if (xSemaphoreTake(data_mutex, pdMS_TO_TICKS(500)) != pdTRUE) {
-        ESP_LOGW(TAG, "模块数据获取超时");
-        return NULL;
-    }
-    xSemaphoreGive(data_mutex); // 快速释放锁（假设后续只读操作）
+/**
+ * @brief 开始修改模块数据，返回的指针只能在 u4g_data_write_end 之前使用
+ * @return 模块数据
+ */
+u4g_data_t *u4g_data_write_begin(void)
+{
+    atomic_fetch_add_explicit(&data_seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
     return &u4g_data;
 }
 
-// 安全获取模块信息（返回数据副本）-- 占用空间极大
-// u4g_data_t u4g_data_get(void)
-// {
-//     u4g_data_t module_copy = {0};
-//     // 获取数据锁
-//     if (xSemaphoreTake(data_mutex, pdMS_TO_TICKS(500)) == pdTRUE)
-//     {
-//         memcpy(&module_copy, &u4g_data, sizeof(u4g_data_t));
-//         xSemaphoreGive(data_mutex);
-//     }
-//     else
-//     {
-//         ESP_LOGW(TAG, "模块数据获取超时，返回空数据");
-//     }
-//     return module_copy;
-// }
-
-// 应用层代码示例
-// void app_task(void *arg) {
-//     u4g_at_imei_refresh();
-//     u4g_module_safe_t mod = u4g_at_module_get_safe();
-//     ESP_LOGI("APP", "IMEI: %s (v%d)", mod.data.imei, mod.data_version);
-//     // 检测数据更新
-//     while(1) {
-//         u4g_module_safe_t new_mod = u4g_at_module_get_safe();
-//         if(new_mod.data_version != mod.data_version) {
-//             ESP_LOGI("APP", "检测到IMEI更新: %s", new_mod.data.imei);
-//             mod = new_mod;
-//         }
-//         vTaskDelay(1000);
-//     }
-// }
-
-// // 线程安全存储
-// static u4g_module_safe_t u4g_module_safe = {0};
-// static SemaphoreHandle_t u4g_module_mutex = NULL;
-
-// // 数据更新接口（AT响应解析器调用）
-// void u4g_module_update(const u4g_module_t *new_data)
-// {
-//     if (u4g_module_mutex == NULL)
-//         u4g_module_mutex = xSemaphoreCreateMutex();
-
-//     xSemaphoreTake(u4g_module_mutex, portMAX_DELAY);
-//     u4g_module_safe.data_version++;
-//     memcpy(&u4g_module_safe.data, new_data, sizeof(u4g_module_t));
-//     xSemaphoreGive(u4g_module_mutex);
-// }
-
-// // 数据获取接口
-// u4g_module_safe_t u4g_at_module_safe_get(void)
-// {
-//     u4g_module_safe_t ret;
-//     if (u4g_module_mutex == NULL)
-//         u4g_module_mutex = xSemaphoreCreateMutex();
-
-//     xSemaphoreTake(u4g_module_mutex, portMAX_DELAY);
-//     memcpy(&ret, &u4g_module_safe, sizeof(u4g_module_safe_t));
-//     xSemaphoreGive(u4g_module_mutex);
-//     return ret;
-// }
-
-// 新增保护机制
-// static SemaphoreHandle_t data_mutex = NULL;
-
-// // 增强版获取接口
-// u4g_module_t *u4g_at_module_get_safe(void)
-// {
-//     if (!data_mutex)
-//         data_mutex = xSemaphoreCreateMutex();
-
-//     xSemaphoreTake(data_mutex, portMAX_DELAY);
-//     static u4g_module_t safe_copy;
-//     memcpy(&safe_copy, &u4g_module, sizeof(u4g_module_t));
-//     xSemaphoreGive(data_mutex);
-
-//     return &safe_copy;
-// }
+/**
+ * @brief 结束修改，发布完整记录
+ */
+void u4g_data_write_end(void)
+{
+    atomic_fetch_add_explicit(&data_seq, 1, memory_order_release);
+}
 
-// // 废弃原全局变量访问
-// #define u4g_at_module_get() u4g_at_module_get_safe()
+/**
+ * @brief 获取模块数据的一致快照
+ * @param out 快照输出
+ * @return 快照版本号（每次修改加2），可用于判断数据是否更新过
+ */
+uint32_t u4g_data_snapshot(u4g_data_t *out)
+{
+    uint32_t spin = 0;
+    while (1)
+    {
+        unsigned int begin = atomic_load_explicit(&data_seq, memory_order_acquire);
+        if ((begin & 1) == 0)
+        {
+            memcpy(out, (const void *)&u4g_data, sizeof(u4g_data_t));
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&data_seq, memory_order_relaxed) == begin)
+            {
+                return begin;
+            }
+        }
+        if (++spin >= U4G_DATA_SPIN_MAX)
+        {
+            spin = 0;
+            taskYIELD(); // 写入方可能被抢占在写入中途
+        }
+    }
+}
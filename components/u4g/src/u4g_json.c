@@ -0,0 +1,549 @@
+#include "u4g_json.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TAG "U4G-JSON"
+
+// 解析状态
+enum
+{
+    JSON_VALUE,           // 等待值
+    JSON_VALUE_OR_END,    // 数组首个元素或 ]
+    JSON_KEY_OR_END,      // 对象的键或 }
+    JSON_KEY,             // 键字符串中
+    JSON_COLON,           // 等待 :
+    JSON_STRING,          // 值字符串中
+    JSON_LITERAL,         // 数字/true/false/null
+    JSON_AFTER_VALUE,     // 等待 , 或 } ]
+    JSON_DONE,            // 根值结束
+    JSON_ERROR,           // 出错，后续输入全部忽略
+};
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool is_literal(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+}
+
+static emU4GResult json_error(u4g_json_t *json, const char *reason, char c)
+{
+    ESP_LOGE(TAG, "JSON解析失败: %s [%c] 路径:%s", reason, c, json->path);
+    json->state = JSON_ERROR;
+    return U4G_FAIL;
+}
+
+/**
+ * @brief 路径（或以其为前缀的路径）是否为关注字段
+ * @param path 键路径，NULL 表示路径无法表示
+ * @param prefix 是否按前缀匹配（容器内有关注字段）
+ */
+static bool field_watched(const u4g_json_t *json, const char *path, bool prefix)
+{
+    if (json->fields == NULL)
+    {
+        return true; // 未登记关注字段：全部关注
+    }
+    if (path == NULL)
+    {
+        return false; // 关注字段的路径都能表示
+    }
+    size_t n = strlen(path);
+    for (int i = 0; i < json->field_num; i++)
+    {
+        const char *f = json->fields[i].path;
+        if (strncmp(f, path, n) == 0 && (f[n] == '\0' || (prefix && f[n] == '.')))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 超长部分丢弃，只记下已截断
+static void token_put(u4g_json_t *json, char c)
+{
+    if (json->token_len >= U4G_JSON_TOKEN_MAX)
+    {
+        json->truncated = true;
+        return;
+    }
+    json->token[json->token_len++] = c;
+}
+
+static void token_reset(u4g_json_t *json)
+{
+    json->token_len = 0;
+    json->escape = 0;
+    json->truncated = false;
+}
+
+// 路径截回 len 后追加一段，过长时路径停在 len
+static bool path_set(u4g_json_t *json, uint8_t len, const char *seg)
+{
+    int n = snprintf(json->path + len, sizeof(json->path) - len, "%s%s", len ? "." : "", seg);
+    if (n < 0 || len + n > U4G_JSON_PATH_MAX)
+    {
+        json->path_len = len;
+        json->path[len] = '\0';
+        return false;
+    }
+    json->path_len = len + n;
+    return true;
+}
+
+static bool path_index(u4g_json_t *json)
+{
+    char seg[8];
+    snprintf(seg, sizeof(seg), "%u", json->stack[json->depth - 1].index);
+    return path_set(json, json->stack[json->depth - 1].base_len, seg);
+}
+
+static bool skipping(const u4g_json_t *json)
+{
+    return json->skip || json->skip_value;
+}
+
+static void emit(u4g_json_t *json, u4g_json_type_t type, const char *value)
+{
+    if (json->cb && !skipping(json))
+    {
+        json->cb(json->path, type, value, json->arg);
+    }
+}
+
+// 数组元素的路径过长：元素不可能是关注字段，跳过
+static emU4GResult element_path(u4g_json_t *json, char c)
+{
+    if (!path_index(json))
+    {
+        if (field_watched(json, NULL, false))
+        {
+            return json_error(json, "路径过长", c);
+        }
+        json->skip_value = true;
+    }
+    return U4G_OK;
+}
+
+static bool level_array(const u4g_json_t *json)
+{
+    return json->skip ? (json->skip_array >> (json->skip - 1)) & 1 : json->stack[json->depth - 1].array;
+}
+
+static emU4GResult open_container(u4g_json_t *json, bool array, char c)
+{
+    emit(json, array ? U4G_JSON_ARRAY : U4G_JSON_OBJECT, NULL);
+    json->state = array ? JSON_VALUE_OR_END : JSON_KEY_OR_END;
+    if (skipping(json) || json->depth >= U4G_JSON_DEPTH_MAX)
+    {
+        // 跳过的容器只计层数，括号仍需匹配
+        if (!skipping(json) && field_watched(json, json->path, true))
+        {
+            return json_error(json, "嵌套过深", c);
+        }
+        if (json->skip >= 32)
+        {
+            return json_error(json, "嵌套过深", c);
+        }
+        json->skip_array = (json->skip_array & ~(1UL << json->skip)) | ((uint32_t)array << json->skip);
+        json->skip++;
+        json->skip_value = false;
+        return U4G_OK;
+    }
+    json->stack[json->depth].array = array;
+    json->stack[json->depth].index = 0;
+    json->stack[json->depth].base_len = json->path_len;
+    json->depth++;
+    return array ? element_path(json, c) : U4G_OK;
+}
+
+static emU4GResult close_container(u4g_json_t *json, char c)
+{
+    if ((json->skip == 0 && json->depth == 0) || level_array(json) != (c == ']'))
+    {
+        return json_error(json, "括号不匹配", c);
+    }
+    if (json->skip)
+    {
+        json->skip--;
+        json->state = JSON_AFTER_VALUE;
+        return U4G_OK;
+    }
+    json->depth--;
+    json->skip_value = false; // 空数组的元素路径
+    json->path_len = json->stack[json->depth].base_len;
+    json->path[json->path_len] = '\0';
+    json->state = json->depth ? JSON_AFTER_VALUE : JSON_DONE;
+    return U4G_OK;
+}
+
+// 值结束：回到所在容器的路径
+static void value_end(u4g_json_t *json)
+{
+    if (json->skip)
+    {
+        json->state = JSON_AFTER_VALUE;
+        return;
+    }
+    json->skip_value = false;
+    json->state = json->depth ? JSON_AFTER_VALUE : JSON_DONE;
+}
+
+// 截断的值：关注字段报错，其余不回调
+static bool value_truncated(u4g_json_t *json)
+{
+    if (!json->truncated || skipping(json))
+    {
+        return false;
+    }
+    if (field_watched(json, json->path, false))
+    {
+        return true;
+    }
+    ESP_LOGD(TAG, "跳过超长的值: %s", json->path);
+    json->skip_value = true;
+    return false;
+}
+
+static emU4GResult literal_end(u4g_json_t *json)
+{
+    if (value_truncated(json))
+    {
+        return json_error(json, "数值过长", ' ');
+    }
+    json->token[json->token_len] = '\0';
+    u4g_json_type_t type = U4G_JSON_NUMBER;
+    if (strcmp(json->token, "true") == 0 || strcmp(json->token, "false") == 0)
+    {
+        type = U4G_JSON_BOOL;
+    }
+    else if (strcmp(json->token, "null") == 0)
+    {
+        type = U4G_JSON_NULL;
+    }
+    emit(json, type, json->token);
+    value_end(json);
+    return U4G_OK;
+}
+
+/**
+ * @brief 字符串字符（含转义）写入 token，超长部分截断
+ * @return 字符串结束返回1，继续返回0，转义错误返回-1
+ */
+static int string_char(u4g_json_t *json, char c)
+{
+    if (json->escape == 1)
+    {
+        json->escape = 0;
+        switch (c)
+        {
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'n': c = '\n'; break;
+        case 'r': c = '\r'; break;
+        case 't': c = '\t'; break;
+        case 'u':
+            json->escape = 2;
+            json->ucode = 0;
+            return 0;
+        default: // " \ / 原样保留
+            break;
+        }
+        token_put(json, c);
+        return 0;
+    }
+    if (json->escape >= 2)
+    {
+        uint8_t v;
+        if (c >= '0' && c <= '9')
+            v = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            v = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            v = c - 'A' + 10;
+        else
+            return -1;
+        json->ucode = (json->ucode << 4) | v;
+        if (++json->escape < 6)
+        {
+            return 0;
+        }
+        json->escape = 0;
+        token_put(json, json->ucode < 0x80 ? (char)json->ucode : '?'); // 非ASCII字符以'?'代替
+        return 0;
+    }
+    if (c == '\\')
+    {
+        json->escape = 1;
+        return 0;
+    }
+    if (c == '"')
+    {
+        json->token[json->token_len] = '\0';
+        return 1;
+    }
+    token_put(json, c);
+    return 0;
+}
+
+/**
+ * @brief 初始化解析器
+ * @param json 解析器
+ * @param cb 值回调
+ * @param arg 用户参数
+ */
+void u4g_json_init(u4g_json_t *json, u4g_json_cb_t cb, void *arg)
+{
+    memset(json, 0, sizeof(*json));
+    json->cb = cb;
+    json->arg = arg;
+    json->state = JSON_VALUE;
+}
+
+/**
+ * @brief 登记关注的字段：其余字段超出解析器容量时跳过而不报错
+ * @param json 解析器（u4g_json_init 之后调用）
+ * @param fields 字段表，需在解析期间保持有效
+ * @param num 字段数
+ */
+void u4g_json_watch(u4g_json_t *json, const u4g_json_field_t *fields, int num)
+{
+    json->fields = fields;
+    json->field_num = num;
+}
+
+/**
+ * @brief 输入一段JSON文本
+ * @return emU4GResult 成功返回U4G_OK，语法错误返回U4G_FAIL
+ */
+emU4GResult u4g_json_feed(u4g_json_t *json, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        char c = data[i];
+        switch (json->state)
+        {
+        case JSON_ERROR:
+            return U4G_FAIL;
+        case JSON_KEY:
+        case JSON_STRING:
+        {
+            int r = string_char(json, c);
+            if (r < 0)
+            {
+                return json_error(json, "转义错误", c);
+            }
+            if (r == 0)
+            {
+                break;
+            }
+            if (json->state == JSON_STRING)
+            {
+                if (value_truncated(json))
+                {
+                    return json_error(json, "字符串过长", c);
+                }
+                emit(json, U4G_JSON_STRING, json->token);
+                value_end(json);
+                break;
+            }
+            json->state = JSON_COLON;
+            if (json->skip)
+            {
+                break; // 跳过的容器内不维护路径
+            }
+            // 键被截断或路径过长：不可能是关注字段，跳过它的值
+            if (json->truncated || !path_set(json, json->stack[json->depth - 1].base_len, json->token))
+            {
+                if (field_watched(json, NULL, false))
+                {
+                    return json_error(json, "路径过长", c);
+                }
+                json->path_len = json->stack[json->depth - 1].base_len;
+                json->path[json->path_len] = '\0';
+                json->skip_value = true;
+            }
+            break;
+        }
+        case JSON_LITERAL:
+            if (is_literal(c))
+            {
+                token_put(json, c);
+                break;
+            }
+            if (literal_end(json) != U4G_OK)
+            {
+                return U4G_FAIL;
+            }
+            i--; // 当前字符属于后续状态
+            break;
+        default:
+            if (is_space(c))
+            {
+                break;
+            }
+            switch (json->state)
+            {
+            case JSON_VALUE_OR_END:
+                if (c == ']')
+                {
+                    if (close_container(json, c) != U4G_OK)
+                    {
+                        return U4G_FAIL;
+                    }
+                    break;
+                }
+                /* fall through */
+            case JSON_VALUE:
+                token_reset(json);
+                if (c == '{' || c == '[')
+                {
+                    if (open_container(json, c == '[', c) != U4G_OK)
+                    {
+                        return U4G_FAIL;
+                    }
+                }
+                else if (c == '"')
+                {
+                    json->state = JSON_STRING;
+                }
+                else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n')
+                {
+                    token_put(json, c);
+                    json->state = JSON_LITERAL;
+                }
+                else
+                {
+                    return json_error(json, "非法的值", c);
+                }
+                break;
+            case JSON_KEY_OR_END:
+                if (c == '}')
+                {
+                    if (close_container(json, c) != U4G_OK)
+                    {
+                        return U4G_FAIL;
+                    }
+                }
+                else if (c == '"')
+                {
+                    token_reset(json);
+                    json->state = JSON_KEY;
+                }
+                else
+                {
+                    return json_error(json, "缺少键", c);
+                }
+                break;
+            case JSON_COLON:
+                if (c != ':')
+                {
+                    return json_error(json, "缺少冒号", c);
+                }
+                json->state = JSON_VALUE;
+                break;
+            case JSON_AFTER_VALUE:
+                if (c == '}' || c == ']')
+                {
+                    if (close_container(json, c) != U4G_OK)
+                    {
+                        return U4G_FAIL;
+                    }
+                }
+                else if (c == ',')
+                {
+                    if (level_array(json))
+                    {
+                        json->state = JSON_VALUE;
+                        if (json->skip)
+                        {
+                            break;
+                        }
+                        json->stack[json->depth - 1].index++;
+                        if (element_path(json, c) != U4G_OK)
+                        {
+                            return U4G_FAIL;
+                        }
+                    }
+                    else
+                    {
+                        json->state = JSON_KEY_OR_END;
+                    }
+                }
+                else
+                {
+                    return json_error(json, "缺少逗号", c);
+                }
+                break;
+            case JSON_DONE:
+                return json_error(json, "根值之后有多余内容", c);
+            default:
+                break;
+            }
+            break;
+        }
+    }
+    return json->state == JSON_ERROR ? U4G_FAIL : U4G_OK;
+}
+
+/**
+ * @brief 输入结束，检查JSON是否完整
+ * @return emU4GResult 完整返回U4G_OK
+ */
+emU4GResult u4g_json_finish(u4g_json_t *json)
+{
+    if (json->state == JSON_LITERAL && json->depth == 0 && literal_end(json) != U4G_OK)
+    {
+        return U4G_FAIL;
+    }
+    if (json->state != JSON_DONE)
+    {
+        ESP_LOGE(TAG, "JSON不完整: 状态%d 层数%d", json->state, json->depth);
+        return U4G_FAIL;
+    }
+    return U4G_OK;
+}
+
+/**
+ * @brief 在字段表中查找路径和类型都匹配的字段
+ * @return 字段下标，未找到返回 -1
+ */
+int u4g_json_field_find(const u4g_json_field_t *fields, int num, const char *path, u4g_json_type_t type)
+{
+    for (int i = 0; i < num; i++)
+    {
+        if (fields[i].type == type && strcmp(fields[i].path, path) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief HTTP响应接收器的开始回调，arg 为 u4g_json_t*：保留回调与关注字段，重置解析状态
+ */
+emU4GResult u4g_json_sink_begin(void *arg)
+{
+    u4g_json_t *json = arg;
+    u4g_json_cb_t cb = json->cb;
+    void *cb_arg = json->arg;
+    const u4g_json_field_t *fields = json->fields;
+    uint8_t field_num = json->field_num;
+    u4g_json_init(json, cb, cb_arg);
+    u4g_json_watch(json, fields, field_num);
+    return U4G_OK;
+}
+
+/**
+ * @brief HTTP响应接收器的写入回调，arg 为 u4g_json_t*
+ */
+emU4GResult u4g_json_sink_write(const char *data, size_t len, void *arg)
+{
+    return u4g_json_feed(arg, data, len);
+}
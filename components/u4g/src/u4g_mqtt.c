@@ -0,0 +1,550 @@
+#include "u4g_mqtt.h"
+#include "u4g_at_cmd.h"
+#include "u4g_at_sched.h"
+#include "u4g_supervisor.h"
+#include "u4g_urc.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if U4G_MQTT_ENABLE
+
+#define TAG "U4G-MQTT"
+
+#define MQTT_CFG_CMD_LEN 256 // 配置、连接、订阅类指令缓冲区长度
+
+#define MQTT_CONN_OK_BIT (1 << 0)   // 连接成功
+#define MQTT_CONN_FAIL_BIT (1 << 1) // 连接被拒绝或失败
+#define MQTT_SUBACK_BIT (1 << 2)    // 订阅应答
+#define MQTT_PUBACK_BIT (1 << 3)    // 发布应答
+#define MQTT_ACK_FAIL_BIT (1 << 4)  // 订阅/发布被拒绝
+#define MQTT_DOWN_BIT (1 << 5)      // 连接断开或模块重启
+#define MQTT_LEAVE_BIT (1 << 6)     // 模块离开数据就绪
+
+typedef struct
+{
+    char topic[U4G_MQTT_TOPIC_MAX + 1];
+    uint8_t qos;
+} mqtt_sub_t;
+
+static u4g_mqtt_config_t mqtt_cfg; // 字符串为启动时复制的副本
+static mqtt_sub_t mqtt_sub[U4G_MQTT_SUB_MAX];
+static volatile uint8_t mqtt_sub_count = 0;
+static EventGroupHandle_t mqtt_event = NULL;
+static SemaphoreHandle_t ack_mutex = NULL; // 同一时间只有一条订阅/发布等待应答
+static volatile bool mqtt_connected = false;
+static portMUX_TYPE mqtt_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * 应答匹配：模块为每个订阅/QoS 1 发布按顺序分配递增的 msg_id，应答也按发送顺序到达。
+ * 等待超时放弃的请求，其应答可能在下一条请求等待期间才到达，不能算作下一条的应答：
+ * 记下最近匹配的 msg_id 及其后发出的请求数，应答的 msg_id 小于当前请求应有的编号时是迟到的应答，丢弃
+ */
+static int32_t ack_last_id = -1; // 最近匹配的应答 msg_id，-1 表示连接后尚未收到
+static uint16_t ack_sent = 0;    // 此后发出、尚未匹配的请求数（含正在等待的一条）
+
+static void mqtt_task(void *pvParameters);
+
+/**
+ * @brief 格式化并执行一条MQTT指令
+ */
+static emU4GResult mqtt_cmd(emATCmd name, const char *fmt, ...)
+{
+    char cmd[MQTT_CFG_CMD_LEN];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(cmd, sizeof(cmd), fmt, args);
+    va_end(args);
+    if (len < 0 || len >= sizeof(cmd))
+    {
+        ESP_LOGE(TAG, "AT指令超出缓冲区: %d", len);
+        return U4G_ERR_INVALID_SIZE;
+    }
+    u4g_at_cmd_t config = {
+        .name = name,
+        .cmd = cmd,
+        .cmd_len = len,
+        .timeout = U4G_MQTT_CMD_TIMEOUT,
+    };
+    return u4g_at_cmd_sync(&config);
+}
+
+/**
+ * @brief 收到的消息：+MQTTURC: "publish",<id>,<msg_id>,"<topic>",<total_len>,<len>,<payload>
+ * @param p "publish", 之后的内容
+ */
+static void mqtt_msg_handle(const char *p)
+{
+    int id = -1, msg_id = 0, total = 0, len = 0, n = 0;
+    char topic[U4G_MQTT_TOPIC_MAX + 1];
+    // %64 与 U4G_MQTT_TOPIC_MAX 一致
+    if (sscanf(p, "%d,%d,\"%64[^\"]\",%d,%d,%n", &id, &msg_id, topic, &total, &len, &n) != 5 || n == 0)
+    {
+        ESP_LOGW(TAG, "无法解析的消息: %.48s", p);
+        return;
+    }
+    if (id != U4G_MQTT_CONN_ID)
+    {
+        return;
+    }
+    p += n;
+    size_t avail = strlen(p);
+    while (avail && (p[avail - 1] == '\r' || p[avail - 1] == '\n'))
+    {
+        avail--;
+    }
+    if (len < 0 || len != total || len > avail)
+    {
+        ESP_LOGW(TAG, "消息不完整(%d/%d/%d)，丢弃: %s", len, total, avail, topic);
+        return;
+    }
+    char *payload = malloc(len + 1);
+    if (payload == NULL)
+    {
+        ESP_LOGE(TAG, "消息内存分配失败");
+        return;
+    }
+    memcpy(payload, p, len);
+    payload[len] = '\0';
+    ESP_LOGI(TAG, "收到消息 %s (%d字节)", topic, len);
+    if (mqtt_cfg.cb)
+    {
+        mqtt_cfg.cb(topic, payload, len, mqtt_cfg.arg);
+    }
+    free(payload);
+}
+
+// 新连接的 msg_id 重新编号
+static void mqtt_ack_reset(void)
+{
+    portENTER_CRITICAL(&mqtt_lock);
+    ack_last_id = -1;
+    ack_sent = 0;
+    portEXIT_CRITICAL(&mqtt_lock);
+}
+
+/**
+ * @brief 订阅/发布应答：msg_id 不早于当前请求应有的编号时交给等待者，否则是已放弃请求的迟到应答
+ * @param msg_id 应答的 msg_id
+ * @param bit 交给等待者的事件位
+ */
+static void mqtt_ack(int msg_id, EventBits_t bit)
+{
+    bool match;
+    portENTER_CRITICAL(&mqtt_lock);
+    if (ack_last_id < 0)
+    {
+        // 连接后尚无基准：只有一条未应答的请求时就是它；否则按顺序归于最早放弃的那条
+        match = ack_sent <= 1;
+        if (!match)
+        {
+            ack_sent--;
+        }
+    }
+    else
+    {
+        match = (int16_t)(uint16_t)(msg_id - (ack_last_id + ack_sent)) >= 0; // msg_id 为16位，按回绕比较
+    }
+    if (match || ack_last_id < 0)
+    {
+        ack_last_id = msg_id & 0xFFFF;
+        ack_sent = match ? 0 : ack_sent;
+    }
+    portEXIT_CRITICAL(&mqtt_lock);
+    if (!match)
+    {
+        ESP_LOGW(TAG, "丢弃已放弃请求的迟到应答 msg_id=%d", msg_id);
+        return;
+    }
+    xEventGroupSetBits(mqtt_event, bit);
+}
+
+// 发出一条需要应答的请求前计数；指令被模块拒绝时撤销
+static void mqtt_ack_expect(bool sent)
+{
+    portENTER_CRITICAL(&mqtt_lock);
+    if (sent)
+    {
+        ack_sent++;
+    }
+    else if (ack_sent)
+    {
+        ack_sent--;
+    }
+    portEXIT_CRITICAL(&mqtt_lock);
+}
+
+// 连接断开：等待中的请求与连接任务都会被唤醒
+static void mqtt_down(void)
+{
+    if (mqtt_connected)
+    {
+        ESP_LOGW(TAG, "MQTT连接断开");
+    }
+    mqtt_connected = false;
+    xEventGroupSetBits(mqtt_event, MQTT_DOWN_BIT);
+}
+
+/**
+ * @brief +MQTTURC: "<type>",<id>,... 连接状态、订阅/发布应答与收到的消息
+ */
+static void urc_mqtt(const char *line, void *arg)
+{
+    const char *p = line + strlen(U4G_URC_MQTTURC);
+    char type[12];
+    int n = 0;
+    if (sscanf(p, "\"%11[^\"]\",%n", type, &n) != 1 || n == 0)
+    {
+        return;
+    }
+    p += n;
+    if (strcmp(type, "publish") == 0)
+    {
+        mqtt_msg_handle(p);
+        return;
+    }
+    int id = -1, a = 0, b = 0;
+    int cnt = sscanf(p, "%d,%d,%d", &id, &a, &b);
+    if (cnt < 1 || id != U4G_MQTT_CONN_ID)
+    {
+        return;
+    }
+    if (strcmp(type, "conn") == 0)
+    {
+        if (cnt >= 2 && a == 0)
+        {
+            xEventGroupSetBits(mqtt_event, MQTT_CONN_OK_BIT);
+        }
+        else if (mqtt_connected)
+        {
+            mqtt_down();
+        }
+        else
+        {
+            ESP_LOGE(TAG, "连接失败: %d", a);
+            xEventGroupSetBits(mqtt_event, MQTT_CONN_FAIL_BIT);
+        }
+    }
+    else if (strcmp(type, "disc") == 0)
+    {
+        mqtt_down();
+    }
+    else if (strcmp(type, "suback") == 0 && cnt >= 2)
+    {
+        // <msg_id>,<result>：result 为授予的QoS，128 表示拒绝
+        mqtt_ack(a, (cnt >= 3 && b >= 128) ? MQTT_ACK_FAIL_BIT : MQTT_SUBACK_BIT);
+    }
+    else if (strcmp(type, "puback") == 0 && cnt >= 2)
+    {
+        mqtt_ack(a, (cnt >= 3 && b != 0) ? MQTT_ACK_FAIL_BIT : MQTT_PUBACK_BIT);
+    }
+}
+
+// 模块重启后连接已不存在
+static void urc_mqtt_matready(const char *line, void *arg)
+{
+    mqtt_down();
+}
+
+// 模块离开数据就绪时断开，回到数据就绪后重连
+static void mqtt_sup_changed(u4g_sup_state_t from, u4g_sup_state_t to, void *arg)
+{
+    if (from == U4G_SUP_DATA_READY && to != U4G_SUP_DATA_READY)
+    {
+        xEventGroupSetBits(mqtt_event, MQTT_LEAVE_BIT);
+    }
+}
+
+// 复制字符串参数，NULL 保持为NULL
+static const char *mqtt_strdup(const char *s)
+{
+    return s ? strdup(s) : NULL;
+}
+
+/**
+ * @brief 启动MQTT客户端，数据就绪后自动连接；订阅可在启动前后任意时间添加
+ * @param config 连接参数
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_mqtt_start(const u4g_mqtt_config_t *config)
+{
+    if (mqtt_event)
+    {
+        return U4G_OK;
+    }
+    if (config == NULL || config->host == NULL || config->client_id == NULL)
+    {
+        return U4G_ERR_INVALID_ARG;
+    }
+    mqtt_cfg = *config;
+    mqtt_cfg.host = mqtt_strdup(config->host);
+    mqtt_cfg.client_id = mqtt_strdup(config->client_id);
+    mqtt_cfg.username = mqtt_strdup(config->username);
+    mqtt_cfg.password = mqtt_strdup(config->password);
+    mqtt_event = xEventGroupCreate();
+    ack_mutex = xSemaphoreCreateMutex();
+    if (mqtt_event == NULL || ack_mutex == NULL || mqtt_cfg.host == NULL || mqtt_cfg.client_id == NULL)
+    {
+        ESP_LOGE(TAG, "MQTT资源创建失败");
+        return U4G_FAIL;
+    }
+    u4g_urc_subscribe(U4G_URC_MQTTURC, urc_mqtt, NULL);
+    u4g_urc_subscribe(U4G_URC_MATREADY, urc_mqtt_matready, NULL);
+    if (u4g_sup_subscribe(mqtt_sup_changed, NULL) != U4G_OK)
+    {
+        ESP_LOGE(TAG, "订阅模块状态失败");
+        return U4G_FAIL;
+    }
+    if (xTaskCreate(mqtt_task, "u4g_mqtt_task", U4G_MQTT_TASK_STACK, NULL, U4G_MQTT_TASK_PRIO, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "创建 u4g_mqtt_task 失败");
+        return U4G_FAIL;
+    }
+    return U4G_OK;
+}
+
+/**
+ * @brief 等待订阅/发布应答（持有 ack_mutex 时调用）
+ */
+static emU4GResult mqtt_ack_wait(EventBits_t ok_bit)
+{
+    EventBits_t bits = xEventGroupWaitBits(mqtt_event, ok_bit | MQTT_ACK_FAIL_BIT | MQTT_DOWN_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(U4G_MQTT_ACK_TIMEOUT));
+    if (bits & ok_bit)
+    {
+        return U4G_OK;
+    }
+    return (bits & (MQTT_ACK_FAIL_BIT | MQTT_DOWN_BIT)) ? U4G_FAIL : U4G_ERR_TIMEOUT;
+}
+
+// 发送一条订阅并等待应答
+static emU4GResult mqtt_sub_send(const mqtt_sub_t *sub)
+{
+    if (xSemaphoreTake(ack_mutex, pdMS_TO_TICKS(U4G_MQTT_ACK_TIMEOUT)) != pdTRUE)
+    {
+        return U4G_ERR_TIMEOUT;
+    }
+    xEventGroupClearBits(mqtt_event, MQTT_SUBACK_BIT | MQTT_ACK_FAIL_BIT);
+    mqtt_ack_expect(true);
+    emU4GResult ret = mqtt_cmd(U4G_AT_CMD_MQTT_SUB, "AT+MQTTSUB=%d,\"%s\",%u\r\n", U4G_MQTT_CONN_ID, sub->topic, sub->qos);
+    if (ret == U4G_OK)
+    {
+        ret = mqtt_ack_wait(MQTT_SUBACK_BIT);
+    }
+    else
+    {
+        mqtt_ack_expect(false);
+    }
+    xSemaphoreGive(ack_mutex);
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "订阅 %s 失败:%d", sub->topic, ret);
+    }
+    return ret;
+}
+
+/**
+ * @brief 添加订阅主题，已连接时立即订阅，之后每次重连自动重新订阅
+ * @param topic 主题
+ * @param qos 服务质量 0/1
+ * @return emU4GResult 成功返回U4G_OK；未连接时只登记，返回U4G_OK
+ */
+emU4GResult u4g_mqtt_subscribe(const char *topic, uint8_t qos)
+{
+    if (topic == NULL || strlen(topic) > U4G_MQTT_TOPIC_MAX || qos > 1)
+    {
+        return U4G_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&mqtt_lock);
+    if (mqtt_sub_count >= U4G_MQTT_SUB_MAX)
+    {
+        portEXIT_CRITICAL(&mqtt_lock);
+        ESP_LOGE(TAG, "订阅数量超过上限: %s", topic);
+        return U4G_FAIL;
+    }
+    mqtt_sub_t *sub = &mqtt_sub[mqtt_sub_count];
+    strcpy(sub->topic, topic);
+    sub->qos = qos;
+    mqtt_sub_count++;
+    portEXIT_CRITICAL(&mqtt_lock);
+    return mqtt_connected ? mqtt_sub_send(sub) : U4G_OK;
+}
+
+/**
+ * @brief 发布一条消息；QoS 1 时等待服务器 PUBACK
+ * @param topic 主题
+ * @param payload 内容
+ * @param len 内容长度，不超过 U4G_MQTT_PAYLOAD_MAX
+ * @param qos 服务质量 0/1
+ * @return emU4GResult 成功返回U4G_OK，未连接返回U4G_ERR_INVALID_STATE
+ */
+emU4GResult u4g_mqtt_publish(const char *topic, const char *payload, size_t len, uint8_t qos)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    if (!mqtt_connected)
+    {
+        return U4G_ERR_INVALID_STATE;
+    }
+    if (topic == NULL || payload == NULL || strlen(topic) > U4G_MQTT_TOPIC_MAX || qos > 1)
+    {
+        return U4G_ERR_INVALID_ARG;
+    }
+    if (len > U4G_MQTT_PAYLOAD_MAX)
+    {
+        ESP_LOGE(TAG, "发布内容超过%d字节: %d", U4G_MQTT_PAYLOAD_MAX, len);
+        return U4G_ERR_INVALID_SIZE;
+    }
+    // AT+MQTTPUB=<id>,<topic>,<qos>,<retain>,<dup>,<len>,"<十六进制内容>"，<len> 为原始内容长度
+    size_t cmd_size = strlen(topic) + len * 2 + 48;
+    char *cmd = malloc(cmd_size);
+    if (cmd == NULL)
+    {
+        ESP_LOGE(TAG, "Memory allocation failed");
+        return U4G_FAIL;
+    }
+    int n = snprintf(cmd, cmd_size, "AT+MQTTPUB=%d,\"%s\",%u,0,0,%u,\"", U4G_MQTT_CONN_ID, topic, qos, (unsigned)len);
+    for (size_t i = 0; i < len; i++)
+    {
+        cmd[n++] = hex[(uint8_t)payload[i] >> 4];
+        cmd[n++] = hex[(uint8_t)payload[i] & 0x0F];
+    }
+    n += snprintf(cmd + n, cmd_size - n, "\"\r\n");
+    u4g_at_cmd_t config = {
+        .name = U4G_AT_CMD_MQTT_PUB,
+        .cmd = cmd,
+        .cmd_len = n,
+        .timeout = U4G_MQTT_CMD_TIMEOUT,
+    };
+
+    emU4GResult ret = U4G_ERR_TIMEOUT;
+    if (xSemaphoreTake(ack_mutex, pdMS_TO_TICKS(U4G_MQTT_ACK_TIMEOUT)) == pdTRUE)
+    {
+        xEventGroupClearBits(mqtt_event, MQTT_PUBACK_BIT | MQTT_ACK_FAIL_BIT);
+        if (qos > 0)
+        {
+            mqtt_ack_expect(true); // 先计数：应答可能在指令的 OK 之前由URC任务处理
+        }
+        ret = u4g_at_cmd_sync(&config);
+        if (ret == U4G_OK && qos > 0)
+        {
+            ret = mqtt_ack_wait(MQTT_PUBACK_BIT);
+        }
+        else if (qos > 0)
+        {
+            mqtt_ack_expect(false);
+        }
+        xSemaphoreGive(ack_mutex);
+    }
+    free(cmd);
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "发布 %s 失败:%d", topic, ret);
+    }
+    return ret;
+}
+
+/**
+ * @brief 已连接且订阅完成
+ */
+bool u4g_mqtt_is_connected(void)
+{
+    return mqtt_connected;
+}
+
+/**
+ * @brief 配置持久会话并连接，连接成功后重新订阅全部主题
+ */
+static emU4GResult mqtt_connect(void)
+{
+    xEventGroupClearBits(mqtt_event, MQTT_CONN_OK_BIT | MQTT_CONN_FAIL_BIT | MQTT_DOWN_BIT);
+    mqtt_ack_reset();
+    emU4GResult ret = mqtt_cmd(U4G_AT_CMD_MQTT_CFG, "AT+MQTTCFG=\"clean\",%d,0\r\n", U4G_MQTT_CONN_ID);
+    if (ret == U4G_OK)
+    {
+        ret = mqtt_cmd(U4G_AT_CMD_MQTT_CFG, "AT+MQTTCFG=\"keepalive\",%d,%d\r\n", U4G_MQTT_CONN_ID, U4G_MQTT_KEEPALIVE_S);
+    }
+    if (ret == U4G_OK)
+    {
+        // 发布内容以十六进制输入，收到的消息以ASCII输出
+        ret = mqtt_cmd(U4G_AT_CMD_MQTT_CFG, "AT+MQTTCFG=\"encoding\",%d,1,0\r\n", U4G_MQTT_CONN_ID);
+    }
+    if (ret == U4G_OK && mqtt_cfg.tls)
+    {
+        ret = mqtt_cmd(U4G_AT_CMD_MQTT_CFG, "AT+MQTTCFG=\"ssl\",%d,1\r\n", U4G_MQTT_CONN_ID);
+    }
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "MQTT配置失败:%d", ret);
+        return ret;
+    }
+
+    if (mqtt_cfg.username)
+    {
+        ret = mqtt_cmd(U4G_AT_CMD_MQTT_CONN, "AT+MQTTCONN=%d,\"%s\",%u,\"%s\",\"%s\",\"%s\"\r\n", U4G_MQTT_CONN_ID,
+                       mqtt_cfg.host, mqtt_cfg.port, mqtt_cfg.client_id, mqtt_cfg.username, mqtt_cfg.password ? mqtt_cfg.password : "");
+    }
+    else
+    {
+        ret = mqtt_cmd(U4G_AT_CMD_MQTT_CONN, "AT+MQTTCONN=%d,\"%s\",%u,\"%s\"\r\n", U4G_MQTT_CONN_ID,
+                       mqtt_cfg.host, mqtt_cfg.port, mqtt_cfg.client_id);
+    }
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "MQTT连接指令失败:%d", ret);
+        return ret;
+    }
+    EventBits_t bits = xEventGroupWaitBits(mqtt_event, MQTT_CONN_OK_BIT | MQTT_CONN_FAIL_BIT | MQTT_DOWN_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(U4G_MQTT_CONN_TIMEOUT));
+    if (!(bits & MQTT_CONN_OK_BIT))
+    {
+        ESP_LOGE(TAG, "MQTT连接%s", (bits & MQTT_CONN_FAIL_BIT) ? "被拒绝" : "超时");
+        return (bits & MQTT_CONN_FAIL_BIT) ? U4G_FAIL : U4G_ERR_TIMEOUT;
+    }
+    mqtt_connected = true;
+    for (uint8_t i = 0; i < mqtt_sub_count; i++)
+    {
+        ret = mqtt_sub_send(&mqtt_sub[i]);
+        if (ret != U4G_OK)
+        {
+            mqtt_connected = false;
+            return ret;
+        }
+    }
+    ESP_LOGI(TAG, "MQTT已连接 %s:%u，订阅%d个主题", mqtt_cfg.host, mqtt_cfg.port, mqtt_sub_count);
+    return U4G_OK;
+}
+
+// 连接任务：数据就绪后连接，断开后按退避间隔重连
+static void mqtt_task(void *pvParameters)
+{
+    u4g_at_sched_class_set(U4G_AT_CLASS_CONTROL); // 连接维护与配置下发同等级
+    uint32_t retry_ms = U4G_MQTT_RETRY_MIN_MS;
+    while (1)
+    {
+        xEventGroupClearBits(mqtt_event, MQTT_LEAVE_BIT);
+        if (!u4g_sup_wait(U4G_SUP_DATA_READY, U4G_MQTT_RETRY_MIN_MS))
+        {
+            continue;
+        }
+        if (mqtt_connect() == U4G_OK)
+        {
+            retry_ms = U4G_MQTT_RETRY_MIN_MS;
+            xEventGroupWaitBits(mqtt_event, MQTT_DOWN_BIT | MQTT_LEAVE_BIT, pdFALSE, pdFALSE, portMAX_DELAY);
+        }
+        else
+        {
+            retry_ms = retry_ms * 2 > U4G_MQTT_RETRY_MAX_MS ? U4G_MQTT_RETRY_MAX_MS : retry_ms * 2;
+        }
+        mqtt_connected = false;
+        // 释放模块侧的连接实例；模块已重启时指令失败，忽略
+        mqtt_cmd(U4G_AT_CMD_MQTT_DISC, "AT+MQTTDISC=%d\r\n", U4G_MQTT_CONN_ID);
+        ESP_LOGW(TAG, "%lu秒后重新连接MQTT", retry_ms / 1000);
+        vTaskDelay(pdMS_TO_TICKS(retry_ms));
+    }
+}
+
+#endif
@@ -0,0 +1,460 @@
+#include "u4g_ppp.h"
+#include "u4g_cmux.h"
+#include "u4g_at_cmd.h"
+#include "u4g_at_sched.h"
+#include "u4g_supervisor.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if U4G_PPP_ENABLE
+
+#include "sdkconfig.h"
+#include "esp_netif.h"
+#include "esp_netif_ppp.h"
+#include "esp_event.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+
+#if !CONFIG_LWIP_PPP_SUPPORT
+#error "PPP模式需要在 sdkconfig 中启用 CONFIG_LWIP_PPP_SUPPORT"
+#endif
+
+#define TAG "U4G-PPP"
+
+#define PPP_DLCI U4G_CMUX_DLCI_AT(U4G_AT_CHAN_DATA) // PPP 占用的数据通道
+#define PPP_URL_MAX 128                              // 服务器地址长度上限（与模块HTTP一致）
+
+#define PPP_UP_BIT (1 << 0)    // 已获得IP
+#define PPP_DOWN_BIT (1 << 1)  // 链路结束（失去IP、协商失败或本端停止）
+#define PPP_LEAVE_BIT (1 << 2) // 模块离开数据就绪
+
+/**
+ * esp_netif 驱动：PPP 帧经 CMUX 数据通道收发
+ */
+typedef struct
+{
+    esp_netif_driver_base_t base;
+} ppp_driver_t;
+
+/**
+ * HTTP会话：一个服务器地址对应一个客户端，TCP连接与TLS会话随客户端保留
+ */
+typedef struct
+{
+    char url[PPP_URL_MAX + 1];       // 服务器地址
+    esp_http_client_handle_t client; // NULL 表示会话无效
+    TickType_t last_used;            // 最近使用时间，会话满时淘汰最久未用的
+} ppp_http_session_t;
+
+static esp_netif_t *ppp_netif = NULL;
+static ppp_driver_t ppp_driver;
+static EventGroupHandle_t ppp_event = NULL;
+static volatile bool ppp_up = false;
+static SemaphoreHandle_t http_mutex = NULL; // 会话与当前请求的接收器
+static ppp_http_session_t http_session[U4G_PPP_HTTP_SESSION_MAX];
+static u4g_ppp_http_write_t http_write = NULL; // 当前请求的响应写入函数
+static emU4GResult http_write_ret = U4G_OK;    // 写入失败后丢弃后续数据
+
+static void ppp_task(void *pvParameters);
+
+// lwIP 发出的 PPP 数据写入数据通道
+static esp_err_t ppp_transmit(void *h, void *buffer, size_t len)
+{
+    int32_t ret = u4g_cmux_write(PPP_DLCI, buffer, len);
+    return ret == (int32_t)len ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t ppp_post_attach(esp_netif_t *netif, void *args)
+{
+    ppp_driver_t *driver = args;
+    driver->base.netif = netif;
+    esp_netif_driver_ifconfig_t ifconfig = {
+        .handle = driver,
+        .transmit = ppp_transmit,
+    };
+    return esp_netif_set_driver_config(netif, &ifconfig);
+}
+
+// 数据通道收到的数据交给 lwIP（在解析任务中调用，数据被复制到 pbuf）
+static void ppp_rx(const uint8_t *data, size_t len, void *arg)
+{
+    esp_netif_receive(ppp_netif, (void *)data, len, NULL);
+}
+
+// 收到 CONNECT：数据通道转为透传，之后的数据不再按行解析
+static emU4GResult ppp_on_connect(char *rsp)
+{
+    if (u4g_cmux_state_get() != U4G_CMUX_ON)
+    {
+        return U4G_FAIL; // 复用已结束，拨号实际发生在串口本身
+    }
+    u4g_cmux_raw_set(PPP_DLCI, ppp_rx, NULL);
+    return U4G_OK;
+}
+
+static void ppp_ip_event(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (id == IP_EVENT_PPP_GOT_IP)
+    {
+        const ip_event_got_ip_t *event = data;
+        if (event->esp_netif != ppp_netif)
+        {
+            return;
+        }
+        ESP_LOGI(TAG, "PPP已获得IP: " IPSTR, IP2STR(&event->ip_info.ip));
+        xEventGroupSetBits(ppp_event, PPP_UP_BIT);
+    }
+    else if (id == IP_EVENT_PPP_LOST_IP)
+    {
+        ESP_LOGW(TAG, "PPP失去IP");
+        ppp_up = false;
+        xEventGroupSetBits(ppp_event, PPP_DOWN_BIT);
+    }
+}
+
+// PPP 错误事件（含本端停止），阶段事件不订阅
+static void ppp_status_event(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (id > NETIF_PPP_ERRORNONE && id < NETIF_PP_PHASE_OFFSET)
+    {
+        ESP_LOGW(TAG, "PPP链路结束: %ld", id);
+        ppp_up = false;
+        xEventGroupSetBits(ppp_event, PPP_DOWN_BIT);
+    }
+}
+
+// 模块离开数据就绪（注册丢失、复位等）时挂断
+static void ppp_sup_changed(u4g_sup_state_t from, u4g_sup_state_t to, void *arg)
+{
+    if (from == U4G_SUP_DATA_READY && to != U4G_SUP_DATA_READY)
+    {
+        xEventGroupSetBits(ppp_event, PPP_LEAVE_BIT);
+    }
+}
+
+/**
+ * @brief 初始化PPP接口并启动拨号任务，数据就绪后自动拨号
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_ppp_init(void)
+{
+    if (ppp_netif)
+    {
+        return U4G_OK;
+    }
+    // 其他模块（如WiFi）可能已初始化
+    esp_err_t err = esp_netif_init();
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+    {
+        ESP_LOGE(TAG, "esp_netif 初始化失败:%d", err);
+        return U4G_FAIL;
+    }
+    err = esp_event_loop_create_default();
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+    {
+        ESP_LOGE(TAG, "默认事件循环创建失败:%d", err);
+        return U4G_FAIL;
+    }
+    ppp_event = xEventGroupCreate();
+    http_mutex = xSemaphoreCreateMutex();
+    if (ppp_event == NULL || http_mutex == NULL)
+    {
+        ESP_LOGE(TAG, "PPP资源创建失败");
+        return U4G_FAIL;
+    }
+
+    esp_netif_config_t cfg = ESP_NETIF_DEFAULT_PPP();
+    ppp_netif = esp_netif_new(&cfg);
+    if (ppp_netif == NULL)
+    {
+        ESP_LOGE(TAG, "PPP接口创建失败");
+        return U4G_FAIL;
+    }
+    esp_netif_ppp_config_t ppp_cfg = {
+        .ppp_phase_event_enabled = false,
+        .ppp_error_event_enabled = true,
+    };
+    esp_netif_ppp_set_params(ppp_netif, &ppp_cfg);
+    ppp_driver.base.post_attach = ppp_post_attach;
+    if (esp_netif_attach(ppp_netif, &ppp_driver) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "PPP接口绑定失败");
+        return U4G_FAIL;
+    }
+    esp_event_handler_register(IP_EVENT, ESP_EVENT_ANY_ID, ppp_ip_event, NULL);
+    esp_event_handler_register(NETIF_PPP_STATUS, ESP_EVENT_ANY_ID, ppp_status_event, NULL);
+
+    if (u4g_sup_subscribe(ppp_sup_changed, NULL) != U4G_OK)
+    {
+        ESP_LOGE(TAG, "订阅模块状态失败");
+        return U4G_FAIL;
+    }
+    if (xTaskCreate(ppp_task, "u4g_ppp_task", U4G_PPP_TASK_STACK, NULL, U4G_PPP_TASK_PRIO, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "创建 u4g_ppp_task 失败");
+        return U4G_FAIL;
+    }
+    return U4G_OK;
+}
+
+/**
+ * @brief PPP链路已建立（已获得IP）
+ */
+bool u4g_ppp_is_up(void)
+{
+    return ppp_up;
+}
+
+// 释放会话，连接随之关闭
+static void http_session_drop(ppp_http_session_t *session)
+{
+    if (session->client)
+    {
+        esp_http_client_cleanup(session->client);
+        session->client = NULL;
+    }
+}
+
+static void http_session_drop_all(void)
+{
+    xSemaphoreTake(http_mutex, portMAX_DELAY);
+    for (int i = 0; i < U4G_PPP_HTTP_SESSION_MAX; i++)
+    {
+        http_session_drop(&http_session[i]);
+    }
+    xSemaphoreGive(http_mutex);
+}
+
+/**
+ * @brief 断开PPP：终止LCP、挂断数据通道上的呼叫，通道回到AT命令模式
+ */
+static void ppp_disconnect(void)
+{
+    ppp_up = false; // 新请求改用模块HTTP
+    esp_netif_action_stop(ppp_netif, 0, 0, NULL);
+    xEventGroupWaitBits(ppp_event, PPP_DOWN_BIT, pdTRUE, pdFALSE, pdMS_TO_TICKS(U4G_PPP_STOP_WAIT_MS));
+    http_session_drop_all(); // 连接已随链路失效
+    u4g_cmux_raw_set(PPP_DLCI, NULL, NULL);
+    if (u4g_cmux_state_get() == U4G_CMUX_ON && u4g_cmux_dlci_reopen(PPP_DLCI) != U4G_OK)
+    {
+        ESP_LOGW(TAG, "数据通道重新建立失败");
+    }
+}
+
+/**
+ * @brief 在数据通道上拨号并等待获得IP
+ */
+static emU4GResult ppp_connect(void)
+{
+    if (u4g_cmux_state_get() != U4G_CMUX_ON)
+    {
+        ESP_LOGW(TAG, "CMUX未建立，暂不拨号");
+        return U4G_ERR_INVALID_STATE;
+    }
+    xEventGroupClearBits(ppp_event, PPP_UP_BIT | PPP_DOWN_BIT);
+    if (U4G_PPP_APN[0] != '\0' && u4g_at_pdp_set(U4G_PPP_CID, U4G_PPP_APN) != U4G_OK)
+    {
+        return U4G_FAIL;
+    }
+    if (u4g_at_dial(U4G_PPP_CID, U4G_PPP_DIAL_TIMEOUT, ppp_on_connect) != U4G_OK)
+    {
+        return U4G_FAIL;
+    }
+    int64_t start = esp_timer_get_time();
+    esp_netif_action_start(ppp_netif, 0, 0, NULL);
+    EventBits_t bits = xEventGroupWaitBits(ppp_event, PPP_UP_BIT | PPP_DOWN_BIT | PPP_LEAVE_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(U4G_PPP_UP_TIMEOUT));
+    if (!(bits & PPP_UP_BIT) || (bits & (PPP_DOWN_BIT | PPP_LEAVE_BIT)))
+    {
+        ESP_LOGE(TAG, "PPP协商失败");
+        ppp_disconnect();
+        return U4G_ERR_TIMEOUT;
+    }
+    ppp_up = true;
+    ESP_LOGI(TAG, "PPP已建立，耗时%lldms", (esp_timer_get_time() - start) / 1000);
+    return U4G_OK;
+}
+
+// 拨号任务：数据就绪后拨号，链路断开或模块离开数据就绪后挂断，间隔后重新拨号
+static void ppp_task(void *pvParameters)
+{
+    u4g_at_sched_class_set(U4G_AT_CLASS_TELEMETRY); // 上报等级的指令在数据通道上执行
+    while (1)
+    {
+        xEventGroupClearBits(ppp_event, PPP_LEAVE_BIT);
+        if (!u4g_sup_wait(U4G_SUP_DATA_READY, U4G_PPP_RETRY_MS))
+        {
+            continue;
+        }
+        if (ppp_connect() != U4G_OK)
+        {
+            vTaskDelay(pdMS_TO_TICKS(U4G_PPP_RETRY_MS));
+            continue;
+        }
+        EventBits_t bits = xEventGroupWaitBits(ppp_event, PPP_DOWN_BIT | PPP_LEAVE_BIT, pdFALSE, pdFALSE, portMAX_DELAY);
+        ppp_disconnect();
+        if (!(bits & PPP_LEAVE_BIT))
+        {
+            ESP_LOGW(TAG, "PPP链路断开，%d秒后重新拨号", U4G_PPP_RETRY_MS / 1000);
+            u4g_sup_data_report(false);
+        }
+        vTaskDelay(pdMS_TO_TICKS(U4G_PPP_RETRY_MS));
+    }
+}
+
+// 响应内容逐段交给接收器
+static esp_err_t http_event(esp_http_client_event_t *evt)
+{
+    if (evt->event_id == HTTP_EVENT_ON_DATA && http_write_ret == U4G_OK)
+    {
+        http_write_ret = http_write(evt->data, evt->data_len);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 取得服务器地址对应的会话，不存在时创建；会话满时淘汰最久未用的
+ */
+static ppp_http_session_t *http_session_get(const char *url)
+{
+    ppp_http_session_t *victim = &http_session[0];
+    for (int i = 0; i < U4G_PPP_HTTP_SESSION_MAX; i++)
+    {
+        ppp_http_session_t *s = &http_session[i];
+        if (s->client && strcmp(s->url, url) == 0)
+        {
+            s->last_used = xTaskGetTickCount();
+            return s;
+        }
+        if (victim->client && (s->client == NULL || s->last_used < victim->last_used))
+        {
+            victim = s;
+        }
+    }
+    http_session_drop(victim);
+
+    esp_http_client_config_t cfg = {
+        .url = url,
+        .timeout_ms = U4G_PPP_HTTP_TIMEOUT,
+        .buffer_size = U4G_PPP_HTTP_BUF_SIZE,
+        .buffer_size_tx = U4G_PPP_HTTP_BUF_SIZE,
+        .event_handler = http_event,
+        .keep_alive_enable = true,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        .save_client_session = true, // 重连时用会话票据恢复TLS，省去完整握手
+#endif
+    };
+    victim->client = esp_http_client_init(&cfg);
+    if (victim->client == NULL)
+    {
+        ESP_LOGE(TAG, "HTTP客户端创建失败");
+        return NULL;
+    }
+    strncpy(victim->url, url, PPP_URL_MAX);
+    victim->url[PPP_URL_MAX] = '\0';
+    victim->last_used = xTaskGetTickCount();
+    return victim;
+}
+
+/**
+ * @brief 经PPP链路发送HTTP请求，同一服务器的连接在请求之间保持
+ * @param url 服务器地址
+ * @param path 请求路径
+ * @param body POST内容，NULL 为GET
+ * @param body_len POST内容长度（可含'\0'）
+ * @param content_type POST内容类型
+ * @param accept Accept 头部，NULL 不发送
+ * @param begin 发送前重置接收器
+ * @param write 写入一段响应内容
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_ppp_http_request(const char *url, const char *path, const char *body, size_t body_len,
+                                 const char *content_type, const char *accept,
+                                 u4g_ppp_http_begin_t begin, u4g_ppp_http_write_t write)
+{
+    if (!ppp_up)
+    {
+        return U4G_ERR_INVALID_STATE;
+    }
+    if (strlen(url) > PPP_URL_MAX)
+    {
+        return U4G_ERR_INVALID_SIZE;
+    }
+    if (xSemaphoreTake(http_mutex, pdMS_TO_TICKS(U4G_PPP_HTTP_TIMEOUT)) != pdTRUE)
+    {
+        return U4G_ERR_TIMEOUT;
+    }
+    emU4GResult ret = U4G_FAIL;
+    size_t full_size = strlen(url) + strlen(path) + 1;
+    char *full = malloc(full_size);
+    ppp_http_session_t *session = full ? http_session_get(url) : NULL;
+    if (session)
+    {
+        esp_http_client_handle_t client = session->client;
+        snprintf(full, full_size, "%s%s", url, path);
+        esp_http_client_set_url(client, full);
+        if (body)
+        {
+            esp_http_client_set_method(client, HTTP_METHOD_POST);
+            esp_http_client_set_header(client, "Content-Type", content_type);
+            esp_http_client_set_post_field(client, body, body_len);
+        }
+        else
+        {
+            esp_http_client_set_method(client, HTTP_METHOD_GET);
+            esp_http_client_delete_header(client, "Content-Type");
+            esp_http_client_set_post_field(client, NULL, 0);
+        }
+        if (accept)
+        {
+            esp_http_client_set_header(client, "Accept", accept);
+        }
+        else
+        {
+            esp_http_client_delete_header(client, "Accept");
+        }
+        ret = begin();
+        http_write = write;
+        http_write_ret = ret;
+        if (ret == U4G_OK)
+        {
+            int64_t start = esp_timer_get_time();
+            esp_err_t err = esp_http_client_perform(client);
+            if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "HTTP请求失败:%s", esp_err_to_name(err));
+                http_session_drop(session);
+                ret = U4G_FAIL;
+            }
+            else if (http_write_ret != U4G_OK)
+            {
+                ESP_LOGE(TAG, "HTTP响应接收器处理失败:%d", http_write_ret);
+                http_session_drop(session); // 响应未读完，连接不能复用
+                ret = http_write_ret;
+            }
+            else
+            {
+                int status = esp_http_client_get_status_code(client);
+                ESP_LOGI(TAG, "HTTP %s %s -> %d, %lld字节, 耗时%lldms", body ? "POST" : "GET", path, status,
+                         esp_http_client_get_content_length(client), (esp_timer_get_time() - start) / 1000);
+                if (status >= 400)
+                {
+                    ESP_LOGW(TAG, "服务器返回错误状态:%d", status);
+                }
+            }
+        }
+        http_write = NULL;
+    }
+    free(full);
+    xSemaphoreGive(http_mutex);
+    return ret;
+}
+
+#endif
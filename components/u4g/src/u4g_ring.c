@@ -0,0 +1,134 @@
+#include "u4g_ring.h"
+#include "esp_log.h"
+#include <string.h>
+
+#define TAG "U4G-RING"
+
+/**
+ * @brief 初始化环形缓冲区
+ * @param ring 环形缓冲区
+ * @param buf 数据区
+ * @param size 数据区大小，必须是2的幂
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_ring_init(u4g_ring_t *ring, uint8_t *buf, size_t size)
+{
+    if (ring == NULL || buf == NULL || size == 0 || (size & (size - 1)) != 0)
+    {
+        ESP_LOGE(TAG, "环形缓冲区参数无效: %d", size);
+        return U4G_ERR_INVALID_ARG;
+    }
+    ring->buf = buf;
+    ring->size = size;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->high_water = 0;
+    ring->overrun = 0;
+    return U4G_OK;
+}
+
+/**
+ * @brief 丢弃全部未读数据，只能由消费者调用
+ */
+void u4g_ring_reset(u4g_ring_t *ring)
+{
+    atomic_store_explicit(&ring->tail, atomic_load_explicit(&ring->head, memory_order_acquire), memory_order_release);
+}
+
+/**
+ * @brief 生产者：取当前可连续写入的区域，写完后调用 u4g_ring_commit
+ * @param[out] len 可写字节数，空间不足时为0
+ * @return 写入位置
+ */
+uint8_t *u4g_ring_write_span(u4g_ring_t *ring, size_t *len)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t free_len = ring->size - (head - tail);
+    size_t pos = head & (ring->size - 1);
+    size_t contiguous = ring->size - pos;
+    *len = free_len < contiguous ? free_len : contiguous;
+    if (free_len == 0)
+    {
+        ring->overrun++;
+    }
+    return ring->buf + pos;
+}
+
+/**
+ * @brief 生产者：提交已写入的字节，消费者随即可见
+ */
+void u4g_ring_commit(u4g_ring_t *ring, size_t len)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed) + len;
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+    size_t used = head - atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (used > ring->high_water)
+    {
+        ring->high_water = used;
+    }
+}
+
+/**
+ * @brief 生产者：复制写入，空间不足时只写入能放下的部分
+ * @return 实际写入字节数
+ */
+size_t u4g_ring_write(u4g_ring_t *ring, const uint8_t *data, size_t len)
+{
+    size_t written = 0;
+    while (written < len)
+    {
+        size_t span = 0;
+        uint8_t *dst = u4g_ring_write_span(ring, &span);
+        if (span == 0)
+        {
+            break;
+        }
+        if (span > len - written)
+        {
+            span = len - written;
+        }
+        memcpy(dst, data + written, span);
+        u4g_ring_commit(ring, span);
+        written += span;
+    }
+    return written;
+}
+
+/**
+ * @brief 消费者：取当前可连续读取的区域（数据绕回时分两次取），读完后调用 u4g_ring_consume
+ * @param[out] len 可读字节数，无数据时为0
+ * @return 读取位置
+ */
+const uint8_t *u4g_ring_read_span(u4g_ring_t *ring, size_t *len)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t used = head - tail;
+    size_t pos = tail & (ring->size - 1);
+    size_t contiguous = ring->size - pos;
+    *len = used < contiguous ? used : contiguous;
+    return ring->buf + pos;
+}
+
+/**
+ * @brief 消费者：释放已读取的字节，不清零数据区
+ */
+void u4g_ring_consume(u4g_ring_t *ring, size_t len)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + len, memory_order_release);
+}
+
+/**
+ * @brief 获取统计信息
+ */
+void u4g_ring_stat_get(u4g_ring_t *ring, u4g_ring_stat_t *out)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    out->size = ring->size;
+    out->used = head - tail;
+    out->high_water = ring->high_water;
+    out->overrun = ring->overrun;
+}
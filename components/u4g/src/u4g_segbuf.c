@@ -0,0 +1,188 @@
+#include "u4g_segbuf.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+
+#define TAG "U4G-SEGBUF"
+
+/**
+ * @brief 申请PSRAM，PSRAM不可用时退回内部RAM（单次申请不超过一个分段）
+ */
+static void *segbuf_malloc(size_t size)
+{
+    void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p == NULL && size <= sizeof(u4g_segbuf_seg_t) + U4G_SEGBUF_SEG_SIZE + 1)
+    {
+        p = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    return p;
+}
+
+/**
+ * @brief 初始化分段缓冲区，此时不申请内存
+ * @param sb 分段缓冲区
+ * @param cap 总字节数上限
+ */
+void u4g_segbuf_init(u4g_segbuf_t *sb, size_t cap)
+{
+    memset(sb, 0, sizeof(*sb));
+    sb->cap = cap;
+}
+
+/**
+ * @brief 清空内容，保留首分段供下次复用
+ */
+void u4g_segbuf_reset(u4g_segbuf_t *sb)
+{
+    heap_caps_free(sb->flat);
+    sb->flat = NULL;
+    if (sb->head)
+    {
+        u4g_segbuf_seg_t *seg = sb->head->next;
+        while (seg)
+        {
+            u4g_segbuf_seg_t *next = seg->next;
+            heap_caps_free(seg);
+            seg = next;
+        }
+        sb->head->next = NULL;
+        sb->head->len = 0;
+        sb->head->data[0] = '\0';
+    }
+    sb->tail = sb->head;
+    sb->len = 0;
+}
+
+/**
+ * @brief 释放全部内存，上限保持不变
+ */
+void u4g_segbuf_free(u4g_segbuf_t *sb)
+{
+    u4g_segbuf_reset(sb);
+    heap_caps_free(sb->head);
+    sb->head = NULL;
+    sb->tail = NULL;
+}
+
+/**
+ * @brief 追加数据，末分段写满时申请新分段
+ * @return emU4GResult 成功返回U4G_OK，超过上限返回U4G_ERR_INVALID_SIZE
+ */
+emU4GResult u4g_segbuf_append(u4g_segbuf_t *sb, const char *data, size_t len)
+{
+    if (sb->len + len > sb->cap)
+    {
+        ESP_LOGE(TAG, "超过上限，无法追加数据 已有:%d | 追加:%d | 上限:%d", sb->len, len, sb->cap);
+        return U4G_ERR_INVALID_SIZE;
+    }
+    while (len)
+    {
+        u4g_segbuf_seg_t *seg = sb->tail;
+        if (seg == NULL || seg->len >= U4G_SEGBUF_SEG_SIZE)
+        {
+            seg = segbuf_malloc(sizeof(u4g_segbuf_seg_t) + U4G_SEGBUF_SEG_SIZE + 1);
+            if (seg == NULL)
+            {
+                ESP_LOGE(TAG, "分段内存分配失败 已有:%d", sb->len);
+                return U4G_FAIL;
+            }
+            seg->next = NULL;
+            seg->len = 0;
+            if (sb->tail)
+            {
+                sb->tail->next = seg;
+            }
+            else
+            {
+                sb->head = seg;
+            }
+            sb->tail = seg;
+        }
+        size_t n = U4G_SEGBUF_SEG_SIZE - seg->len;
+        if (n > len)
+        {
+            n = len;
+        }
+        memcpy(seg->data + seg->len, data, n);
+        seg->len += n;
+        seg->data[seg->len] = '\0';
+        sb->len += n;
+        data += n;
+        len -= n;
+    }
+    return U4G_OK;
+}
+
+/**
+ * @brief 从指定位置复制数据
+ * @param offset 起始位置
+ * @param out 输出缓冲区
+ * @param len 最多复制的字节数
+ * @return 实际复制的字节数
+ */
+size_t u4g_segbuf_copy(const u4g_segbuf_t *sb, size_t offset, char *out, size_t len)
+{
+    size_t copied = 0;
+    for (const u4g_segbuf_seg_t *seg = sb->head; seg && copied < len; seg = seg->next)
+    {
+        if (offset >= seg->len)
+        {
+            offset -= seg->len;
+            continue;
+        }
+        size_t n = seg->len - offset;
+        if (n > len - copied)
+        {
+            n = len - copied;
+        }
+        memcpy(out + copied, seg->data + offset, n);
+        copied += n;
+        offset = 0;
+    }
+    return copied;
+}
+
+/**
+ * @brief 取连续的'\0'结尾内容：只有一个分段时直接返回分段数据，否则在PSRAM中拼接一份
+ * @return 内容，失败返回NULL；下次 reset/free 前有效
+ */
+const char *u4g_segbuf_flatten(u4g_segbuf_t *sb)
+{
+    if (sb->head == NULL)
+    {
+        return "";
+    }
+    if (sb->head->next == NULL)
+    {
+        return sb->head->data;
+    }
+    if (sb->flat == NULL)
+    {
+        sb->flat = heap_caps_malloc(sb->len + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (sb->flat == NULL)
+        {
+            ESP_LOGE(TAG, "拼接内存分配失败: %d字节", sb->len);
+            return NULL;
+        }
+        u4g_segbuf_copy(sb, 0, sb->flat, sb->len);
+        sb->flat[sb->len] = '\0';
+    }
+    return sb->flat;
+}
+
+/**
+ * @brief HTTP响应接收器的开始回调，arg 为 u4g_segbuf_t*
+ */
+emU4GResult u4g_segbuf_sink_begin(void *arg)
+{
+    u4g_segbuf_reset(arg);
+    return U4G_OK;
+}
+
+/**
+ * @brief HTTP响应接收器的写入回调，arg 为 u4g_segbuf_t*
+ */
+emU4GResult u4g_segbuf_sink_write(const char *data, size_t len, void *arg)
+{
+    return u4g_segbuf_append(arg, data, len);
+}
@@ -0,0 +1,362 @@
+#include "u4g_sock.h"
+#include "u4g_at_cmd.h"
+#include "u4g_at_sched.h"
+#include "u4g_supervisor.h"
+#include "u4g_urc.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if U4G_SOCK_ENABLE
+
+#define TAG "U4G-SOCK"
+
+#define SOCK_CFG_CMD_LEN 160 // 配置、连接类指令缓冲区长度
+
+#define SOCK_CONN_OK_BIT (1 << 0)   // 连接成功
+#define SOCK_CONN_FAIL_BIT (1 << 1) // 连接失败
+#define SOCK_DOWN_BIT (1 << 2)      // 连接断开或模块重启
+#define SOCK_LEAVE_BIT (1 << 3)     // 模块离开数据就绪
+
+static u4g_sock_config_t sock_cfg; // host 为启动时复制的副本
+static EventGroupHandle_t sock_event = NULL;
+static SemaphoreHandle_t send_mutex = NULL; // 发送缓冲区互斥
+static char *send_cmd = NULL;               // 发送指令缓冲区（十六进制编码后的内容）
+static volatile bool sock_connected = false;
+
+static void sock_task(void *pvParameters);
+
+/**
+ * @brief 格式化并执行一条套接字指令
+ */
+static emU4GResult sock_cmd(emATCmd name, const char *fmt, ...)
+{
+    char cmd[SOCK_CFG_CMD_LEN];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(cmd, sizeof(cmd), fmt, args);
+    va_end(args);
+    if (len < 0 || len >= sizeof(cmd))
+    {
+        ESP_LOGE(TAG, "AT指令超出缓冲区: %d", len);
+        return U4G_ERR_INVALID_SIZE;
+    }
+    u4g_at_cmd_t config = {
+        .name = name,
+        .cmd = cmd,
+        .cmd_len = len,
+        .timeout = U4G_SOCK_CMD_TIMEOUT,
+    };
+    return u4g_at_cmd_sync(&config);
+}
+
+// 十六进制字符转数值，非法字符返回-1
+static int sock_hex_val(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief 收到的数据：+MIPURC: "rtcp"|"rudp",<id>,<len>,<十六进制内容>
+ * @param p "rtcp", 之后的内容
+ */
+static void sock_rx_handle(const char *p)
+{
+    int id = -1, len = 0, n = 0;
+    if (sscanf(p, "%d,%d,%n", &id, &len, &n) != 2 || n == 0 || id != U4G_SOCK_CONN_ID)
+    {
+        return;
+    }
+    p += n;
+    if (*p == '"')
+    {
+        p++;
+    }
+    if (len <= 0 || len > U4G_SOCK_PAYLOAD_MAX)
+    {
+        ESP_LOGW(TAG, "接收长度无效: %d", len);
+        return;
+    }
+    uint8_t data[U4G_SOCK_PAYLOAD_MAX];
+    for (int i = 0; i < len; i++)
+    {
+        int hi = sock_hex_val(p[2 * i]);
+        int lo = hi < 0 ? -1 : sock_hex_val(p[2 * i + 1]);
+        if (lo < 0)
+        {
+            ESP_LOGW(TAG, "数据不完整(%d/%d)，丢弃", i, len);
+            return;
+        }
+        data[i] = (hi << 4) | lo;
+    }
+    ESP_LOGD(TAG, "收到%d字节", len);
+    if (sock_cfg.rx)
+    {
+        sock_cfg.rx(data, len, sock_cfg.arg);
+    }
+}
+
+// 连接断开：连接任务会被唤醒
+static void sock_down(void)
+{
+    if (sock_connected)
+    {
+        ESP_LOGW(TAG, "套接字连接断开");
+    }
+    sock_connected = false;
+    xEventGroupSetBits(sock_event, SOCK_DOWN_BIT);
+}
+
+/**
+ * @brief +MIPOPEN: <id>,<result> 连接结果，0 为成功
+ */
+static void urc_sock_open(const char *line, void *arg)
+{
+    int id = -1, result = -1;
+    if (sscanf(line + strlen(U4G_URC_MIPOPEN), "%d,%d", &id, &result) != 2 || id != U4G_SOCK_CONN_ID)
+    {
+        return;
+    }
+    if (result != 0)
+    {
+        ESP_LOGE(TAG, "连接失败: %d", result);
+    }
+    xEventGroupSetBits(sock_event, result == 0 ? SOCK_CONN_OK_BIT : SOCK_CONN_FAIL_BIT);
+}
+
+/**
+ * @brief +MIPURC: "<type>",<id>,... 收到的数据与对端断开
+ */
+static void urc_sock(const char *line, void *arg)
+{
+    const char *p = line + strlen(U4G_URC_MIPURC);
+    char type[12];
+    int n = 0;
+    if (sscanf(p, "\"%11[^\"]\",%n", type, &n) != 1 || n == 0)
+    {
+        return;
+    }
+    p += n;
+    if (strcmp(type, "rtcp") == 0 || strcmp(type, "rudp") == 0)
+    {
+        sock_rx_handle(p);
+    }
+    else if (strcmp(type, "disconn") == 0 && atoi(p) == U4G_SOCK_CONN_ID)
+    {
+        sock_down();
+    }
+}
+
+// 模块重启后连接已不存在
+static void urc_sock_matready(const char *line, void *arg)
+{
+    sock_down();
+}
+
+// 模块离开数据就绪时断开，回到数据就绪后重连
+static void sock_sup_changed(u4g_sup_state_t from, u4g_sup_state_t to, void *arg)
+{
+    if (from == U4G_SUP_DATA_READY && to != U4G_SUP_DATA_READY)
+    {
+        xEventGroupSetBits(sock_event, SOCK_LEAVE_BIT);
+    }
+}
+
+/**
+ * @brief 启动套接字连接，数据就绪后自动连接
+ * @param config 连接参数
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_sock_start(const u4g_sock_config_t *config)
+{
+    if (sock_event)
+    {
+        return U4G_OK;
+    }
+    if (config == NULL || config->host == NULL || config->rx == NULL)
+    {
+        return U4G_ERR_INVALID_ARG;
+    }
+    sock_cfg = *config;
+    sock_cfg.host = strdup(config->host);
+    sock_event = xEventGroupCreate();
+    send_mutex = xSemaphoreCreateMutex();
+    send_cmd = malloc(U4G_SOCK_PAYLOAD_MAX * 2 + 40);
+    if (sock_event == NULL || send_mutex == NULL || send_cmd == NULL || sock_cfg.host == NULL)
+    {
+        ESP_LOGE(TAG, "套接字资源创建失败");
+        return U4G_FAIL;
+    }
+    u4g_urc_subscribe(U4G_URC_MIPOPEN, urc_sock_open, NULL);
+    u4g_urc_subscribe(U4G_URC_MIPURC, urc_sock, NULL);
+    u4g_urc_subscribe(U4G_URC_MATREADY, urc_sock_matready, NULL);
+    if (u4g_sup_subscribe(sock_sup_changed, NULL) != U4G_OK)
+    {
+        ESP_LOGE(TAG, "订阅模块状态失败");
+        return U4G_FAIL;
+    }
+    if (xTaskCreate(sock_task, "u4g_sock_task", U4G_SOCK_TASK_STACK, NULL, U4G_SOCK_TASK_PRIO, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "创建 u4g_sock_task 失败");
+        return U4G_FAIL;
+    }
+    return U4G_OK;
+}
+
+/**
+ * @brief 发送数据，模块受理（OK）即返回；是否送达由上层协议确认
+ * @param data 数据
+ * @param len 数据长度，不超过 U4G_SOCK_PAYLOAD_MAX
+ * @return emU4GResult 成功返回U4G_OK，未连接返回U4G_ERR_INVALID_STATE
+ */
+emU4GResult u4g_sock_send(const uint8_t *data, size_t len)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    if (!sock_connected)
+    {
+        return U4G_ERR_INVALID_STATE;
+    }
+    if (data == NULL || len == 0)
+    {
+        return U4G_ERR_INVALID_ARG;
+    }
+    if (len > U4G_SOCK_PAYLOAD_MAX)
+    {
+        ESP_LOGE(TAG, "发送内容超过%d字节: %d", U4G_SOCK_PAYLOAD_MAX, len);
+        return U4G_ERR_INVALID_SIZE;
+    }
+    if (xSemaphoreTake(send_mutex, pdMS_TO_TICKS(U4G_SOCK_CMD_TIMEOUT)) != pdTRUE)
+    {
+        return U4G_ERR_TIMEOUT;
+    }
+    // AT+MIPSEND=<id>,<len>,"<十六进制内容>"，<len> 为原始内容长度
+    int n = sprintf(send_cmd, "AT+MIPSEND=%d,%u,\"", U4G_SOCK_CONN_ID, (unsigned)len);
+    for (size_t i = 0; i < len; i++)
+    {
+        send_cmd[n++] = hex[data[i] >> 4];
+        send_cmd[n++] = hex[data[i] & 0x0F];
+    }
+    n += sprintf(send_cmd + n, "\"\r\n");
+    u4g_at_cmd_t config = {
+        .name = U4G_AT_CMD_SOCK_SEND,
+        .cmd = send_cmd,
+        .cmd_len = n,
+        .timeout = U4G_SOCK_CMD_TIMEOUT,
+    };
+    emU4GResult ret = u4g_at_cmd_sync(&config);
+    xSemaphoreGive(send_mutex);
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "发送%d字节失败:%d", len, ret);
+    }
+    return ret;
+}
+
+/**
+ * @brief 主动断开并重连，用于上层判断连接已失效（如连续收不到应答）
+ */
+void u4g_sock_reset(void)
+{
+    if (sock_event && sock_connected)
+    {
+        ESP_LOGW(TAG, "上层请求重建连接");
+        sock_down();
+    }
+}
+
+/**
+ * @brief 连接已建立
+ */
+bool u4g_sock_is_connected(void)
+{
+    return sock_connected;
+}
+
+/**
+ * @brief 配置收发编码并连接
+ */
+static emU4GResult sock_connect(void)
+{
+    xEventGroupClearBits(sock_event, SOCK_CONN_OK_BIT | SOCK_CONN_FAIL_BIT | SOCK_DOWN_BIT);
+    // 发送与接收均为十六进制
+    emU4GResult ret = sock_cmd(U4G_AT_CMD_SOCK_CFG, "AT+MIPCFG=\"encoding\",%d,1,1\r\n", U4G_SOCK_CONN_ID);
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "套接字配置失败:%d", ret);
+        return ret;
+    }
+    ret = sock_cmd(U4G_AT_CMD_SOCK_OPEN, "AT+MIPOPEN=%d,\"%s\",\"%s\",%u\r\n", U4G_SOCK_CONN_ID,
+                   sock_cfg.udp ? "UDP" : "TCP", sock_cfg.host, sock_cfg.port);
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "套接字连接指令失败:%d", ret);
+        return ret;
+    }
+    EventBits_t bits = xEventGroupWaitBits(sock_event, SOCK_CONN_OK_BIT | SOCK_CONN_FAIL_BIT | SOCK_DOWN_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(U4G_SOCK_CONN_TIMEOUT));
+    if (!(bits & SOCK_CONN_OK_BIT))
+    {
+        ESP_LOGE(TAG, "套接字连接%s", (bits & SOCK_CONN_FAIL_BIT) ? "失败" : "超时");
+        return (bits & SOCK_CONN_FAIL_BIT) ? U4G_FAIL : U4G_ERR_TIMEOUT;
+    }
+    sock_connected = true;
+    ESP_LOGI(TAG, "已连接 %s %s:%u", sock_cfg.udp ? "UDP" : "TCP", sock_cfg.host, sock_cfg.port);
+    return U4G_OK;
+}
+
+// 连接任务：数据就绪后连接，断开后按退避间隔重连
+static void sock_task(void *pvParameters)
+{
+    u4g_at_sched_class_set(U4G_AT_CLASS_CONTROL); // 连接维护与配置下发同等级
+    uint32_t retry_ms = U4G_SOCK_RETRY_MIN_MS;
+    while (1)
+    {
+        xEventGroupClearBits(sock_event, SOCK_LEAVE_BIT);
+        if (!u4g_sup_wait(U4G_SUP_DATA_READY, U4G_SOCK_RETRY_MIN_MS))
+        {
+            continue;
+        }
+        if (sock_connect() == U4G_OK)
+        {
+            retry_ms = U4G_SOCK_RETRY_MIN_MS;
+            if (sock_cfg.state)
+            {
+                sock_cfg.state(true, sock_cfg.arg);
+            }
+            xEventGroupWaitBits(sock_event, SOCK_DOWN_BIT | SOCK_LEAVE_BIT, pdFALSE, pdFALSE, portMAX_DELAY);
+            sock_connected = false;
+            if (sock_cfg.state)
+            {
+                sock_cfg.state(false, sock_cfg.arg);
+            }
+        }
+        else
+        {
+            retry_ms = retry_ms * 2 > U4G_SOCK_RETRY_MAX_MS ? U4G_SOCK_RETRY_MAX_MS : retry_ms * 2;
+        }
+        sock_connected = false;
+        // 释放模块侧的连接实例；对端已断开或模块已重启时指令失败，忽略
+        sock_cmd(U4G_AT_CMD_SOCK_CLOSE, "AT+MIPCLOSE=%d\r\n", U4G_SOCK_CONN_ID);
+        ESP_LOGW(TAG, "%lu秒后重新连接", retry_ms / 1000);
+        vTaskDelay(pdMS_TO_TICKS(retry_ms));
+    }
+}
+
+#endif
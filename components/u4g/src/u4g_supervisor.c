@@ -0,0 +1,535 @@
+#include "u4g_supervisor.h"
+#include "u4g_at_cmd.h"
+#include "u4g_at_sched.h"
+#include "u4g_baud.h"
+#include "u4g_cmux.h"
+#include "u4g_urc.h"
+#include "esp_attr.h"   // RTC_NOINIT_ATTR
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TAG "U4G-SUP"
+
+// 监管任务的通知位
+#define SUP_NOTIFY_MATREADY (1 << 0)  // 模块已重启
+#define SUP_NOTIFY_REG (1 << 1)       // 注册状态上报
+#define SUP_NOTIFY_DATA_FAIL (1 << 2) // 上层数据业务连续失败
+
+// 状态事件位：链上状态 s 对应 1<<s，当前状态不低于 s 时置位；降级单独一位
+#define SUP_BIT(s) (1 << (s))
+#define SUP_CHAIN_BITS (SUP_BIT(U4G_SUP_AT_ALIVE) | SUP_BIT(U4G_SUP_SIM_READY) | SUP_BIT(U4G_SUP_REGISTERED) | SUP_BIT(U4G_SUP_DATA_READY))
+
+typedef struct
+{
+    u4g_sup_cb_t cb;
+    void *arg;
+} u4g_sup_sub_t;
+
+static TaskHandle_t sup_task_handle = NULL;
+static EventGroupHandle_t sup_event = NULL;
+static volatile u4g_sup_state_t sup_state = U4G_SUP_OFFLINE;
+static u4g_sup_sub_t sup_sub[U4G_SUP_SUB_MAX];
+static uint8_t sup_sub_count = 0;
+static portMUX_TYPE sup_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool reg_lost = false;         // 最近一次注册上报为未注册
+static volatile uint8_t data_fail = 0;         // 上层连续报告的数据业务失败次数
+
+// 监管任务内部状态，只在监管任务中访问
+static uint32_t sup_pending = 0;               // 已收到尚未处理的通知位
+static uint8_t fail_count = 0;                 // 当前状态连续失败次数
+static uint8_t wait_count = 0;                 // 等待注册/附着的次数，用于退避
+static int64_t unreg_since_us = 0;             // 开始等待注册/附着的时间，0 表示未在等待
+static bool net_degraded = false;              // 本次降级由无SIM卡/长时间未注册引起
+static u4g_sup_action_t next_action = U4G_SUP_ACTION_SOFT_RESET; // 下一次降级时的恢复手段
+
+/**
+ * 跨系统重启保留的恢复状态（RTC内存，软件复位不清除，掉电后魔数不符重新开始）
+ */
+#define SUP_RTC_MAGIC 0x55345350
+typedef struct
+{
+    uint32_t magic;
+    uint8_t level;     // 下一次降级时的恢复手段
+    uint8_t restarted; // 曾因模块故障重启系统
+    uint16_t count;    // 因模块故障重启系统的次数
+} sup_rtc_t;
+static RTC_NOINIT_ATTR sup_rtc_t sup_rtc;
+
+static const char *state_name[U4G_SUP_STATE_MAX] = {"offline", "at_alive", "sim_ready", "registered", "data_ready", "degraded"};
+
+static void sup_task(void *pvParameters);
+
+/**
+ * @brief 获取状态名称
+ */
+const char *u4g_sup_state_name(u4g_sup_state_t state)
+{
+    return state < U4G_SUP_STATE_MAX ? state_name[state] : "unknown";
+}
+
+/**
+ * @brief +CEREG 注册状态上报 +CEREG: <stat>；查询应答 +CEREG: <n>,<stat> 超时后才到达时也会走到这里，
+ * 它反映的是查询当时的状态且可能早于最近的上报，忽略
+ */
+static void urc_cereg(const char *line, void *arg)
+{
+    int stat = 0;
+    bool query = false;
+    if (u4g_at_cereg_parse(line, &stat, &query) != U4G_OK)
+    {
+        ESP_LOGW(TAG, "无法解析注册状态上报: %s", line);
+        return;
+    }
+    if (query)
+    {
+        ESP_LOGD(TAG, "迟到的注册状态查询应答，忽略: %s", line);
+        return;
+    }
+    ESP_LOGI(TAG, "网络注册状态变化: stat=%d", stat);
+    reg_lost = !(stat == 1 || stat == 5); // 1: 已注册，本地网络; 5: 已注册，漫游
+    xTaskNotify(sup_task_handle, SUP_NOTIFY_REG, eSetBits);
+}
+
+// 模块启动完成（上电、软重启、硬复位或异常重启）
+static void urc_matready(const char *line, void *arg)
+{
+    xTaskNotify(sup_task_handle, SUP_NOTIFY_MATREADY, eSetBits);
+}
+
+// 恢复等级变化时写入RTC内存
+static void sup_level_set(u4g_sup_action_t level)
+{
+    next_action = level;
+    sup_rtc.level = level;
+}
+
+// 上电时初始化RTC内存中的恢复状态，系统重启后沿用上次的恢复等级
+static void sup_rtc_load(void)
+{
+    if (sup_rtc.magic != SUP_RTC_MAGIC || sup_rtc.level > U4G_SUP_ACTION_RESTART)
+    {
+        memset(&sup_rtc, 0, sizeof(sup_rtc));
+        sup_rtc.magic = SUP_RTC_MAGIC;
+    }
+    next_action = sup_rtc.level;
+    if (sup_rtc.restarted)
+    {
+        ESP_LOGW(TAG, "上次因4G模块故障重启系统(累计%u次)，恢复等级%d", sup_rtc.count, next_action);
+    }
+}
+
+/**
+ * @brief 启动模块监管任务，需在 u4g_init 完成AT初始化后调用
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_sup_start(void)
+{
+    if (sup_task_handle)
+    {
+        return U4G_OK;
+    }
+    sup_rtc_load();
+    sup_event = xEventGroupCreate();
+    if (sup_event == NULL)
+    {
+        ESP_LOGE(TAG, "监管事件组创建失败");
+        return U4G_FAIL;
+    }
+    if (xTaskCreate(sup_task, "u4g_sup_task", U4G_SUP_TASK_STACK, NULL, U4G_SUP_TASK_PRIO, &sup_task_handle) != pdPASS)
+    {
+        ESP_LOGE(TAG, "创建 u4g_sup_task 失败");
+        vEventGroupDelete(sup_event);
+        sup_event = NULL;
+        return U4G_FAIL;
+    }
+    u4g_urc_subscribe(U4G_URC_CEREG, urc_cereg, NULL);
+    u4g_urc_subscribe(U4G_URC_MATREADY, urc_matready, NULL);
+    return U4G_OK;
+}
+
+/**
+ * @brief 订阅状态变化，每次状态切换都会按订阅顺序回调
+ * @param cb 回调
+ * @param arg 用户参数
+ * @return emU4GResult 订阅数量已满返回U4G_ERR_INVALID_SIZE
+ */
+emU4GResult u4g_sup_subscribe(u4g_sup_cb_t cb, void *arg)
+{
+    if (cb == NULL)
+    {
+        return U4G_ERR_INVALID_ARG;
+    }
+    emU4GResult ret = U4G_OK;
+    portENTER_CRITICAL(&sup_lock);
+    if (sup_sub_count >= U4G_SUP_SUB_MAX)
+    {
+        ret = U4G_ERR_INVALID_SIZE;
+    }
+    else
+    {
+        sup_sub[sup_sub_count].cb = cb;
+        sup_sub[sup_sub_count].arg = arg;
+        sup_sub_count++;
+    }
+    portEXIT_CRITICAL(&sup_lock);
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "状态订阅数量已满");
+    }
+    return ret;
+}
+
+u4g_sup_state_t u4g_sup_state_get(void)
+{
+    return sup_state;
+}
+
+/**
+ * @brief 等待进入指定状态（链上状态：不低于该状态即可）
+ * @param state 目标状态
+ * @param timeout_ms 最长等待时间
+ * @return 已达到返回true
+ */
+bool u4g_sup_wait(u4g_sup_state_t state, uint32_t timeout_ms)
+{
+    if (state == U4G_SUP_OFFLINE)
+    {
+        return true;
+    }
+    if (sup_event == NULL || state >= U4G_SUP_STATE_MAX)
+    {
+        return false;
+    }
+    return xEventGroupWaitBits(sup_event, SUP_BIT(state), pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms)) & SUP_BIT(state);
+}
+
+/**
+ * @brief 上层报告一次数据业务（HTTP等）结果；连续失败达到 U4G_SUP_DATA_FAIL_MAX 次时重新检查链路
+ * @param ok 成功为true
+ */
+void u4g_sup_data_report(bool ok)
+{
+    if (ok)
+    {
+        data_fail = 0;
+        return;
+    }
+    if (++data_fail >= U4G_SUP_DATA_FAIL_MAX && sup_task_handle)
+    {
+        data_fail = 0;
+        xTaskNotify(sup_task_handle, SUP_NOTIFY_DATA_FAIL, eSetBits);
+    }
+}
+
+// 切换状态：更新事件位并通知订阅者
+static void sup_state_set(u4g_sup_state_t to)
+{
+    u4g_sup_state_t from = sup_state;
+    if (from == to)
+    {
+        return;
+    }
+    sup_state = to;
+    EventBits_t bits = 0;
+    if (to == U4G_SUP_DEGRADED)
+    {
+        bits = SUP_BIT(U4G_SUP_DEGRADED);
+    }
+    else
+    {
+        for (u4g_sup_state_t s = U4G_SUP_AT_ALIVE; s <= to; s++)
+        {
+            bits |= SUP_BIT(s);
+        }
+    }
+    xEventGroupClearBits(sup_event, (SUP_CHAIN_BITS | SUP_BIT(U4G_SUP_DEGRADED)) & ~bits);
+    xEventGroupSetBits(sup_event, bits);
+    fail_count = 0;
+    ESP_LOGI(TAG, "状态: %s -> %s", state_name[from], state_name[to]);
+    for (uint8_t i = 0; i < sup_sub_count; i++)
+    {
+        sup_sub[i].cb(from, to, sup_sub[i].arg);
+    }
+}
+
+/**
+ * @brief 退避等待，期间收到通知立即返回
+ * 等待时间为 base*2^n 的 [1/2, 1] 之间随机值，多台设备同时掉线后不会同时重试
+ * @param n 已失败次数
+ */
+static void sup_backoff(uint8_t n)
+{
+    uint32_t delay = U4G_SUP_BACKOFF_BASE_MS << (n < 10 ? n : 10);
+    if (delay > U4G_SUP_BACKOFF_MAX_MS)
+    {
+        delay = U4G_SUP_BACKOFF_MAX_MS;
+    }
+    delay = delay / 2 + esp_random() % (delay / 2 + 1);
+    uint32_t bits = 0;
+    if (xTaskNotifyWait(0, UINT32_MAX, &bits, pdMS_TO_TICKS(delay)) == pdTRUE)
+    {
+        sup_pending |= bits;
+    }
+}
+
+// 当前状态的检查失败：退避后重试，连续失败过多则降级
+static void sup_fail(emU4GResult ret)
+{
+    fail_count++;
+    ESP_LOGW(TAG, "[%s] 检查失败(%d) %d/%d", state_name[sup_state], ret, fail_count, U4G_SUP_FAIL_MAX);
+    if (fail_count >= U4G_SUP_FAIL_MAX)
+    {
+        net_degraded = false;
+        sup_state_set(U4G_SUP_DEGRADED);
+        return;
+    }
+    sup_backoff(fail_count);
+}
+
+/**
+ * @brief 等待SIM卡/注册/附着：属于外部状态而非模块故障，按退避等待并由 +CEREG 上报提前唤醒；
+ * 持续超过 U4G_SUP_REG_TIMEOUT_MS（随恢复等级加倍）才降级，且只复位模块，不重启系统
+ */
+static void sup_wait_network(void)
+{
+    int64_t now = esp_timer_get_time();
+    if (unreg_since_us == 0)
+    {
+        unreg_since_us = now;
+        wait_count = 0;
+    }
+    if ((now - unreg_since_us) / 1000 > ((int64_t)U4G_SUP_REG_TIMEOUT_MS << next_action))
+    {
+        ESP_LOGW(TAG, "长时间未注册网络");
+        net_degraded = true;
+        sup_state_set(U4G_SUP_DEGRADED);
+        return;
+    }
+    if (wait_count < UINT8_MAX)
+    {
+        wait_count++;
+    }
+    sup_backoff(wait_count);
+}
+
+/**
+ * @brief 是否允许因模块故障重启系统：上电后第一次允许，之后两次之间至少运行 U4G_SUP_RESTART_INTERVAL_S。
+ * 无SIM卡、无信号时重启系统无济于事，不允许；其他原因的复位（看门狗等）后重新计时
+ */
+static bool sup_restart_allowed(void)
+{
+    if (net_degraded)
+    {
+        return false;
+    }
+    return !sup_rtc.restarted || esp_timer_get_time() / 1000000 >= U4G_SUP_RESTART_INTERVAL_S;
+}
+
+/**
+ * @brief 执行当前等级的恢复手段并升级，复位后等待模块启动完成
+ */
+static void sup_recover(void)
+{
+    u4g_sup_action_t action = next_action;
+    if (next_action < U4G_SUP_ACTION_RESTART)
+    {
+        sup_level_set(next_action + 1);
+    }
+    if (action == U4G_SUP_ACTION_SOFT_RESET)
+    {
+        ESP_LOGW(TAG, "恢复: 软重启4G模块");
+        if (u4g_at_reboot_soft() != U4G_OK)
+        {
+            action = U4G_SUP_ACTION_HARD_RESET; // 模块不响应AT，软重启无效
+            sup_level_set(U4G_SUP_ACTION_RESTART);
+        }
+    }
+    if (action == U4G_SUP_ACTION_RESTART && !sup_restart_allowed())
+    {
+        ESP_LOGW(TAG, "恢复: %s，不重启系统", net_degraded ? "无SIM卡或无信号" : "距上次重启系统不足间隔");
+        action = U4G_SUP_ACTION_HARD_RESET;
+    }
+    if (action == U4G_SUP_ACTION_HARD_RESET)
+    {
+        ESP_LOGW(TAG, "恢复: 硬复位4G模块");
+        u4g_at_reboot_hard();
+    }
+    if (action == U4G_SUP_ACTION_RESTART)
+    {
+        ESP_LOGE(TAG, "恢复: 模块复位无效，重启系统");
+        sup_rtc.restarted = 1;
+        if (sup_rtc.count < UINT16_MAX)
+        {
+            sup_rtc.count++;
+        }
+        esp_restart();
+    }
+#if U4G_CMUX_ENABLE
+    u4g_cmux_reset(); // 模块重启后处于非复用模式
+#endif
+    // 等待 +MATREADY，超时也回到检测，由检测结果决定下一步
+    sup_pending &= ~SUP_NOTIFY_MATREADY;
+    TickType_t start = xTaskGetTickCount();
+    while (!(sup_pending & SUP_NOTIFY_MATREADY) && xTaskGetTickCount() - start < pdMS_TO_TICKS(U4G_SUP_BOOT_WAIT_MS))
+    {
+        uint32_t bits = 0;
+        if (xTaskNotifyWait(0, UINT32_MAX, &bits, pdMS_TO_TICKS(U4G_SUP_BOOT_WAIT_MS)) == pdTRUE)
+        {
+            sup_pending |= bits;
+        }
+    }
+    sup_pending = 0;
+    unreg_since_us = 0;
+    sup_state_set(U4G_SUP_OFFLINE);
+}
+
+// 数据就绪：等待异常通知，定时复查注册状态
+static void sup_monitor(void)
+{
+    uint32_t bits = 0;
+    if (!sup_pending && xTaskNotifyWait(0, UINT32_MAX, &bits, pdMS_TO_TICKS(U4G_SUP_CHECK_MS)) == pdTRUE)
+    {
+        sup_pending |= bits;
+    }
+    if (sup_pending & SUP_NOTIFY_REG)
+    {
+        sup_pending &= ~SUP_NOTIFY_REG;
+        if (reg_lost)
+        {
+            sup_state_set(U4G_SUP_SIM_READY); // 从注册开始重新检查
+        }
+        return;
+    }
+    if (sup_pending & SUP_NOTIFY_DATA_FAIL)
+    {
+        sup_pending &= ~SUP_NOTIFY_DATA_FAIL;
+        ESP_LOGW(TAG, "数据业务连续失败，重新检查链路");
+        sup_state_set(U4G_SUP_REGISTERED); // 复查附着，失败再逐级回退
+        return;
+    }
+    emU4GResult ret = u4g_at_netstatus();
+    if (ret == U4G_STATE_AT_NET_NOT)
+    {
+        sup_state_set(U4G_SUP_SIM_READY);
+    }
+    else if (ret != U4G_OK)
+    {
+        sup_state_set(U4G_SUP_OFFLINE);
+        sup_fail(ret);
+    }
+}
+
+// 监管任务：逐级检查并在失败时退避、降级恢复
+static void sup_task(void *pvParameters)
+{
+    u4g_at_sched_class_set(U4G_AT_CLASS_CONTROL);
+    emU4GResult ret;
+    while (1)
+    {
+        // 模块意外重启（非本任务复位）：从头检查
+        if (sup_pending & SUP_NOTIFY_MATREADY)
+        {
+            sup_pending &= ~SUP_NOTIFY_MATREADY;
+#if U4G_CMUX_ENABLE
+            u4g_cmux_reset(); // 重启后 +MATREADY 以非复用方式输出，复用已结束
+#endif
+            if (sup_state != U4G_SUP_OFFLINE && sup_state != U4G_SUP_DEGRADED)
+            {
+                ESP_LOGW(TAG, "4G模块已重启");
+                sup_state_set(U4G_SUP_OFFLINE);
+            }
+        }
+        switch (sup_state)
+        {
+        case U4G_SUP_OFFLINE:
+            ret = u4g_at();
+            if (ret == U4G_OK)
+            {
+#if U4G_CMUX_ENABLE
+                if (u4g_cmux_state_get() == U4G_CMUX_OFF && u4g_cmux_start() != U4G_OK)
+                {
+                    ESP_LOGW(TAG, "CMUX建立失败，继续使用单通道");
+                }
+#endif
+                if (u4g_at_netstatus_report(1) != U4G_OK) // 注册状态变化由 +CEREG 上报
+                {
+                    ESP_LOGW(TAG, "开启注册状态上报失败，仅依赖定时查询");
+                }
+                sup_state_set(U4G_SUP_AT_ALIVE);
+            }
+            else
+            {
+                if (fail_count == 1)
+                {
+#if U4G_CMUX_ENABLE
+                    u4g_cmux_reset(); // 模块可能已在未上报的情况下重启，退出复用后重新探测
+#endif
+                    u4g_baud_negotiate(); // 复位后模块可能回到出厂波特率
+                }
+                sup_fail(ret);
+            }
+            break;
+        case U4G_SUP_AT_ALIVE:
+            ret = u4g_at_sim_status();
+            if (ret == U4G_OK)
+            {
+                sup_state_set(U4G_SUP_SIM_READY);
+            }
+            else if (ret == U4G_STATE_AT_SIM_NOT)
+            {
+                sup_wait_network(); // 未插卡与无信号一样只退避，不计入模块故障
+            }
+            else
+            {
+                sup_fail(ret);
+            }
+            break;
+        case U4G_SUP_SIM_READY:
+            ret = u4g_at_netstatus();
+            if (ret == U4G_OK)
+            {
+                sup_state_set(U4G_SUP_REGISTERED);
+            }
+            else if (ret == U4G_STATE_AT_NET_NOT)
+            {
+                sup_wait_network();
+            }
+            else
+            {
+                sup_fail(ret);
+            }
+            break;
+        case U4G_SUP_REGISTERED:
+            ret = u4g_at_attach_status();
+            if (ret == U4G_OK)
+            {
+                unreg_since_us = 0;
+                sup_level_set(U4G_SUP_ACTION_SOFT_RESET); // 恢复成功，下次从最轻的手段开始
+                sup_state_set(U4G_SUP_DATA_READY);
+            }
+            else if (ret == U4G_STATE_AT_NET_NOT)
+            {
+                sup_wait_network();
+            }
+            else
+            {
+                sup_fail(ret);
+            }
+            break;
+        case U4G_SUP_DATA_READY:
+            sup_monitor();
+            break;
+        case U4G_SUP_DEGRADED:
+        default:
+            sup_recover();
+            break;
+        }
+    }
+}
@@ -0,0 +1,158 @@
+#include "u4g_trace.h"
+#include "u4g_at_cmd.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "mbedtls/base64.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TAG "U4G-TRACE"
+
+static u4g_trace_rec_t *trace_buf = NULL; // 记录环，PSRAM
+static uint32_t trace_total = 0;          // 累计写入条数，取模得到写入位置
+static volatile bool trace_on = false;
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief 申请PSRAM中的记录环并开始记录，PSRAM不可用时不记录（不占用内部RAM）
+ */
+emU4GResult u4g_trace_init(void)
+{
+#if U4G_TRACE_ENABLE
+    if (trace_buf == NULL)
+    {
+        trace_buf = heap_caps_calloc(U4G_TRACE_REC_MAX, sizeof(u4g_trace_rec_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (trace_buf == NULL)
+        {
+            ESP_LOGW(TAG, "PSRAM不足，AT轨迹不记录");
+            return U4G_FAIL;
+        }
+    }
+    trace_on = true;
+    ESP_LOGI(TAG, "AT轨迹记录已启用: %d条 x %d字节", U4G_TRACE_REC_MAX, sizeof(u4g_trace_rec_t));
+#endif
+    return U4G_OK;
+}
+
+/**
+ * @brief 记录一个数据块并指定所属指令
+ * @param dir 记录类型
+ * @param cmd 所属 emATCmd，无则为 U4G_TRACE_CMD_NONE
+ * @param data 数据，只保存前 U4G_TRACE_DATA_MAX 字节
+ * @param len 数据长度
+ */
+void u4g_trace_record_cmd(u4g_trace_dir_t dir, uint8_t cmd, const void *data, size_t len)
+{
+#if U4G_TRACE_ENABLE
+    if (!trace_on || trace_buf == NULL)
+    {
+        return;
+    }
+    size_t copy = len < U4G_TRACE_DATA_MAX ? len : U4G_TRACE_DATA_MAX;
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    portENTER_CRITICAL(&trace_lock);
+    u4g_trace_rec_t *rec = &trace_buf[trace_total % U4G_TRACE_REC_MAX];
+    rec->t_us = now;
+    rec->len = len > UINT16_MAX ? UINT16_MAX : len;
+    rec->dir = dir;
+    rec->cmd = cmd;
+    memcpy(rec->data, data, copy);
+    trace_total++;
+    portEXIT_CRITICAL(&trace_lock);
+#endif
+}
+
+/**
+ * @brief 记录一个收发数据块，所属指令取正在执行的指令（多个通道同时执行时取编号最小的通道）
+ * @param dir 记录类型
+ * @param data 数据，只保存前 U4G_TRACE_DATA_MAX 字节
+ * @param len 数据长度
+ */
+void u4g_trace_record(u4g_trace_dir_t dir, const void *data, size_t len)
+{
+#if U4G_TRACE_ENABLE
+    if (!trace_on)
+    {
+        return;
+    }
+    uint8_t cmd = U4G_TRACE_CMD_NONE;
+    for (int i = 0; i < U4G_AT_CHAN_NUM && cmd == U4G_TRACE_CMD_NONE; i++)
+    {
+        const u4g_at_cmd_t *content = u4g_at_cmd_handle[i].cmd_content;
+        if (content)
+        {
+            cmd = content->name;
+        }
+    }
+    u4g_trace_record_cmd(dir, cmd, data, len);
+#endif
+}
+
+/**
+ * @brief 暂停或恢复记录，已有记录保留
+ */
+void u4g_trace_enable(bool enable)
+{
+    trace_on = enable && trace_buf != NULL;
+}
+
+/**
+ * @brief 清空全部记录
+ */
+void u4g_trace_clear(void)
+{
+    portENTER_CRITICAL(&trace_lock);
+    trace_total = 0;
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+/**
+ * @brief 按从旧到新的顺序以base64文本导出全部记录到控制台，导出期间暂停记录
+ * 输出格式（由 tools/u4g_trace_decode.py 解析）：
+ *   U4G-TRACE BEGIN ver=<版本> rec=<单条字节数> count=<条数> total=<累计条数>
+ *   U4G-TRACE <每行 U4G_TRACE_DUMP_PER_LINE 条记录的base64>
+ *   U4G-TRACE END
+ * @return 导出的记录条数
+ */
+uint32_t u4g_trace_dump(void)
+{
+#if U4G_TRACE_ENABLE
+    if (trace_buf == NULL)
+    {
+        printf("U4G-TRACE 未启用\n");
+        return 0;
+    }
+    bool was_on = trace_on;
+    trace_on = false;
+    portENTER_CRITICAL(&trace_lock); // 等待进行中的写入完成
+    uint32_t total = trace_total;
+    portEXIT_CRITICAL(&trace_lock);
+    uint32_t count = total < U4G_TRACE_REC_MAX ? total : U4G_TRACE_REC_MAX;
+    uint32_t first = total - count;
+
+    printf("U4G-TRACE BEGIN ver=%d rec=%d count=%lu total=%lu\n", U4G_TRACE_VERSION, sizeof(u4g_trace_rec_t), count, total);
+    uint8_t line[((sizeof(u4g_trace_rec_t) * U4G_TRACE_DUMP_PER_LINE + 2) / 3) * 4 + 1];
+    for (uint32_t i = 0; i < count; i += U4G_TRACE_DUMP_PER_LINE)
+    {
+        uint32_t n = count - i < U4G_TRACE_DUMP_PER_LINE ? count - i : U4G_TRACE_DUMP_PER_LINE;
+        u4g_trace_rec_t recs[U4G_TRACE_DUMP_PER_LINE];
+        for (uint32_t k = 0; k < n; k++)
+        {
+            recs[k] = trace_buf[(first + i + k) % U4G_TRACE_REC_MAX];
+        }
+        size_t olen = 0;
+        if (mbedtls_base64_encode(line, sizeof(line), &olen, (const uint8_t *)recs, n * sizeof(u4g_trace_rec_t)) != 0)
+        {
+            break;
+        }
+        printf("U4G-TRACE %.*s\n", (int)olen, line);
+    }
+    printf("U4G-TRACE END\n");
+    trace_on = was_on;
+    return count;
+#else
+    return 0;
+#endif
+}
@@ -1,8 +1,11 @@
 #include "u4g_uart.h"
 #include "u4g_state.h" // 状态码
 #include "u4g_uart_recv.h"
+#include "u4g_uart_line.h"
 #include "u4g_at_cmd.h"
-#include "u4g_at_buffer.h"
+#include "u4g_ring.h"
+#include "u4g_trace.h"
+#include "u4g_cmux.h"
 #include "driver/uart.h"       // 引入 ESP-IDF 中 UART 驱动库，用于配置和操作 UART 接口
 #include "freertos/FreeRTOS.h" // 引入 FreeRTOS 操作系统的核心库，FreeRTOS 是一个开源的实时操作系统内核，用于任务管理、调度等
 #include "freertos/task.h"     // 引入 FreeRTOS 的任务相关库，提供任务创建、删除、挂起等功能
@@ -15,14 +18,24 @@
 
 // 内部 UART 参数配置
 #define U4G_UART_NUM UART_NUM_1
-#define U4G_UART_BAUD_RATE 9600 // 波特率
-// #define U4G_UART_BAUD_RATE 115200           // 波特率
+#define U4G_UART_BAUD_RATE U4G_UART_BAUD_DEFAULT // 初始波特率，u4g_baud_negotiate 协商后调整
 #define U4G_UART_TX_PIN GPIO_NUM_17         // TX 发送引脚
 #define U4G_UART_RX_PIN GPIO_NUM_18         // RX 接收引脚
+#define U4G_UART_TX_BUF_SIZE (1024)         // TX 发送缓冲区大小
+#define U4G_UART_RX_RING_SIZE (8 * 1024)    // 驱动接收环形缓冲区大小（921600下约90ms的数据量）
+#define U4G_UART_QUEUE_SIZE (20)            // 事件队列数量
+#define U4G_UART_PATTERN_QUEUE (32)         // 未读取的换行位置记录数量
+#define U4G_UART_RING_SIZE (4096)           // 接收环形缓冲区大小（2的幂）
+#define U4G_UART_PARSE_PRIO (9)             // 解析任务优先级，低于接收任务
+#define U4G_UART_PARSE_STACK (4096)         // 解析任务栈（应答处理函数及HTTP接收器在此运行）
+#if U4G_UART_HW_FLOWCTRL
+#define U4G_UART_RTS_PIN GPIO_NUM_15        // RTS 引脚（接模块CTS）
+#define U4G_UART_CTS_PIN GPIO_NUM_16        // CTS 引脚（接模块RTS）
+#define U4G_UART_RX_FLOW_THRESH (100)       // 硬件FIFO达到该字节数时拉高RTS
+#else
 #define U4G_UART_RTS_PIN UART_PIN_NO_CHANGE // RTS 引脚
 #define U4G_UART_CTS_PIN UART_PIN_NO_CHANGE // CTS 引脚
-#define U4G_UART_TX_BUF_SIZE (1024)         // TX 发送缓冲区大小
-#define U4G_UART_QUEUE_SIZE (10)            // 事件队列数量
+#endif
 #define U4G_UART_RESET_PIN GPIO_NUM_3       // 4G模块硬复位，拉低300ms以上释放则复位重启
 
 static const char *TAG = "4G-UART"; // 定义日志标签，用于在日志输出中标识该模块的信息
@@ -36,6 +49,9 @@ static const char *TAG = "4G-UART"; // 定义日志标签，用于在日志输
 static QueueHandle_t u4g_uart_event_queue = NULL;
 // static TaskHandle_t uart_recv_task_handle = NULL; // 接收数据的任务句柄
 TaskHandle_t uart_recv_task_handle = NULL;
+static uint32_t uart_baud = U4G_UART_BAUD_RATE; // 当前波特率
+static volatile bool line_reset_req = false;    // 切换波特率后由接收任务丢弃未完成的行
+static uint32_t uart_overflow = 0;              // 硬件FIFO溢出次数（数据已丢失）
 
 /**
  * @brief 接收数据处理任务
@@ -116,13 +132,138 @@ TaskHandle_t uart_recv_task_handle = NULL;
 //     // 理论上这里不会执行到，但为了代码完整性保留
 //     vTaskDelete(NULL);
 // }
+
+// 行切分器输出的完整行交给 AT 应答处理（非复用模式只有控制通道）
+static size_t uart_line_handler(char *line, size_t len, bool raw, void *arg)
+{
+    emU4GResult ret = raw ? u4g_uart_recv_content(line, len) : u4g_uart_recv_process(U4G_AT_CHAN_CTRL, line, len);
+    if (ret == U4G_STATE_AT_RSP_WAITING)
+    {
+        ESP_LOGD(TAG, "收到响应，执行继续等待");
+    }
+    return u4g_uart_recv_raw_take();
+}
+
+static bool uart_line_prompt(void *arg)
+{
+    return u4g_uart_recv_prompt_wait(U4G_AT_CHAN_CTRL);
+}
+
+static uint8_t uart_ring_buf[U4G_UART_RING_SIZE]; // 接收任务与解析任务之间的字节环形缓冲区
+static u4g_ring_t uart_ring;
+static TaskHandle_t uart_parse_task_handle = NULL;
+static volatile bool ring_full_wait = false; // 接收任务在等待环形缓冲区空间
+static u4g_uart_line_t uart_line;            // 非复用模式的行切分器
+
+/**
+ * @brief 从驱动缓冲区直接读入环形缓冲区，随后唤醒解析任务
+ * 环形缓冲区满时等待解析任务腾出空间，数据留在驱动缓冲区中（流控下模块暂停发送），不丢弃
+ */
+static void uart_read_feed(size_t want)
+{
+    while (want > 0)
+    {
+        size_t span = 0;
+        uint8_t *dst = u4g_ring_write_span(&uart_ring, &span);
+        if (span == 0)
+        {
+            ring_full_wait = true;
+            xTaskNotifyGive(uart_parse_task_handle);
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+            ring_full_wait = false;
+            continue;
+        }
+        int len = uart_read_bytes(U4G_UART_NUM, dst, want < span ? want : span, 0);
+        if (len <= 0)
+        {
+            break;
+        }
+        ESP_LOGD(TAG, "<<<UART%d | size:%d | %.*s", U4G_UART_NUM, len, len, dst);
+        u4g_trace_record(U4G_TRACE_RX, dst, len);
+        u4g_ring_commit(&uart_ring, len);
+        want -= len;
+    }
+    xTaskNotifyGive(uart_parse_task_handle);
+}
+
+// 读取驱动缓冲区中的全部数据
+static void uart_read_all(void)
+{
+    size_t buffered = 0;
+    uart_get_buffered_data_len(U4G_UART_NUM, &buffered);
+    uart_read_feed(buffered);
+}
+
+// 解析任务：从环形缓冲区按连续区域取数据交给行切分器，行回调中完成AT应答处理
+static void uart_parse_task(void *arg)
+{
+    u4g_uart_line_init(&uart_line, uart_line_handler, uart_line_prompt, NULL);
+#if U4G_CMUX_ENABLE
+    bool framed = false; // 当前按复用帧解析
+#endif
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (line_reset_req)
+        {
+            u4g_ring_reset(&uart_ring); // 旧波特率下或溢出前的残缺数据不能拼到新行前面
+            u4g_uart_line_reset(&uart_line);
+#if U4G_CMUX_ENABLE
+            u4g_cmux_rx_reset();
+#endif
+            line_reset_req = false;
+        }
+        size_t len = 0;
+        const uint8_t *data = u4g_ring_read_span(&uart_ring, &len);
+        while (len > 0)
+        {
+#if U4G_CMUX_ENABLE
+            // 进入或退出复用时丢弃另一种解析方式下未完成的数据
+            if (framed != (u4g_cmux_state_get() != U4G_CMUX_OFF))
+            {
+                framed = !framed;
+                u4g_uart_line_reset(&uart_line);
+                u4g_cmux_rx_reset();
+            }
+            if (framed)
+            {
+                u4g_cmux_feed(data, len);
+            }
+            else
+#endif
+            {
+                u4g_uart_line_feed(&uart_line, data, len);
+            }
+            u4g_ring_consume(&uart_ring, len);
+            if (ring_full_wait)
+            {
+                xTaskNotifyGive(uart_recv_task_handle);
+            }
+            data = u4g_ring_read_span(&uart_ring, &len);
+        }
+    }
+}
+
+#if U4G_UART_PATTERN_MODE
+/**
+ * @brief 按记录的换行位置逐行读取；位置记录溢出时读出全部数据，由行切分器重新切分
+ */
+static void uart_read_lines(void)
+{
+    int pos;
+    while ((pos = uart_pattern_pop_pos(U4G_UART_NUM)) >= 0)
+    {
+        uart_read_feed(pos + 1); // 读取后驱动会同步调整其余位置
+    }
+    uart_read_all();
+}
+#endif
+
 static void uart_recv_task(void *arg)
 {
     // esp_task_wdt_add(NULL); // 增加任务看门狗保护
     // esp_task_wdt_delete(NULL); // 看门狗-卸载此任务
     uart_event_t event;
-    static uint8_t cache_data[U4G_UART_RX_BUF_SIZE]; // 接收缓冲区
-    memset(cache_data, 0, U4G_UART_RX_BUF_SIZE);
 
     while (1)
     {
@@ -132,42 +273,38 @@ static void uart_recv_task(void *arg)
             switch (event.type)
             {
             case UART_DATA:
-                vTaskDelay(pdMS_TO_TICKS(300));
-                // vTaskDelay(pdMS_TO_TICKS(300));
-                // uart_get_buffered_data_len(U4G_UART_NUM, &buffered_size); // 获取UART接收数据的长度
-                int len = uart_read_bytes(U4G_UART_NUM, cache_data, (U4G_UART_RX_BUF_SIZE - 1), 20 / portTICK_PERIOD_MS);
-                /***** 接收到数据 *****/
-                if (len > 0)
+#if U4G_UART_PATTERN_MODE
+                // 完整行由 UART_PATTERN_DET 处理；没有待处理的换行时，说明是空闲超时触发的无换行数据（如">"提示符）
+                if (uart_pattern_get_pos(U4G_UART_NUM) < 0)
                 {
-                    cache_data[len] = '\0';
-                    ESP_LOGD(TAG, "<<<UART%d | size:%d | %.*s", U4G_UART_NUM, len, len, cache_data); // 为调试方便，在接收中打印数据，正式生产需删除
-
-                    // if (u4g_at_cmd_handle.cmd_content->name == U4G_AT_CMD_HTTP_REQUEST)
-                    // {
-                    //     ESP_LOGI(TAG, "Recv DATA %s", (char *)UART_RXbuff.Recv);
-                    // }
-                    // else
-                    // {
-                    emU4GResult ret = u4g_uart_recv_process((char *)cache_data, len);
-                    if (ret == U4G_STATE_AT_RSP_WAITING)
-                    {
-                        ESP_LOGW(TAG, "收到响应，执行继续等待");
-                    }
-                    memset(cache_data, 0, U4G_UART_RX_BUF_SIZE);
-                    // }
+                    uart_read_all();
                 }
+#else
+                // 有多少读多少，不足一行的部分由行切分器缓存到下次读取
+                uart_read_all();
+#endif
                 break;
-            case UART_FIFO_OVF:
-                ESP_LOGE(TAG, "UART缓冲区溢出或已满，清空输入");
-                uart_flush_input(U4G_UART_NUM); // 清空UART输入缓冲区
-                xQueueReset(u4g_uart_event_queue);
-                vTaskDelay(pdMS_TO_TICKS(100)); // 等待一段时间，防止频繁重置
+#if U4G_UART_PATTERN_MODE
+            case UART_PATTERN_DET:
+                uart_read_lines();
                 break;
+#endif
             case UART_BUFFER_FULL:
-                ESP_LOGE(TAG, "UART ring buffer full");
-                uart_flush_input(U4G_UART_NUM); // 清空UART输入缓冲区
+                // 驱动缓冲区满时新数据留在硬件FIFO（流控下模块暂停发送），及时读出即可，不丢弃已收数据
+                ESP_LOGW(TAG, "UART接收缓冲区满，立即读取");
+                uart_read_all();
+                break;
+            case UART_FIFO_OVF:
+                // 硬件FIFO已溢出，部分字节已丢失：丢弃残缺数据重新同步
+                uart_overflow++;
+                ESP_LOGE(TAG, "UART硬件FIFO溢出(第%lu次)，丢弃残缺数据", uart_overflow);
+                uart_flush_input(U4G_UART_NUM);
+#if U4G_UART_PATTERN_MODE
+                uart_pattern_queue_reset(U4G_UART_NUM, U4G_UART_PATTERN_QUEUE);
+#endif
                 xQueueReset(u4g_uart_event_queue);
-                vTaskDelay(pdMS_TO_TICKS(100)); // 等待一段时间，防止频繁重置
+                line_reset_req = true;
+                xTaskNotifyGive(uart_parse_task_handle);
                 break;
             case UART_BREAK:
                 ESP_LOGE(TAG, "接收到UART事件-通信中断");
@@ -181,9 +318,6 @@ static void uart_recv_task(void *arg)
             case UART_FRAME_ERR:
                 ESP_LOGE(TAG, "接收到UART事件-UART_FRAME_ERR");
                 break;
-            case UART_PATTERN_DET:
-                ESP_LOGE(TAG, "接收到UART事件-UART_PATTERN_DET");
-                break;
             default:
                 ESP_LOGW(TAG, "未知的UART事件类型: %d", event.type);
                 break;
@@ -217,7 +351,12 @@ esp_err_t u4g_uart_init(void)
         .data_bits = UART_DATA_8_BITS,         // 数据位
         .parity = UART_PARITY_DISABLE,         // 校验位
         .stop_bits = UART_STOP_BITS_1,         // 停止位
+#if U4G_UART_HW_FLOWCTRL
+        .flow_ctrl = UART_HW_FLOWCTRL_CTS_RTS, // RTS/CTS硬件流控
+        .rx_flow_ctrl_thresh = U4G_UART_RX_FLOW_THRESH,
+#else
         .flow_ctrl = UART_HW_FLOWCTRL_DISABLE, // 禁用硬件流控制
+#endif
         .source_clk = UART_SCLK_DEFAULT,       // 明确时钟源
     };
     int intr_alloc_flags = 0; // 定义中断分配标志，初始化为 0
@@ -242,7 +381,7 @@ esp_err_t u4g_uart_init(void)
         return err;
     }
     // 安装 UART 驱动并创建事件队列
-    err = uart_driver_install(U4G_UART_NUM, U4G_UART_RX_BUF_SIZE * 2, U4G_UART_TX_BUF_SIZE, U4G_UART_QUEUE_SIZE, &u4g_uart_event_queue, intr_alloc_flags);
+    err = uart_driver_install(U4G_UART_NUM, U4G_UART_RX_RING_SIZE, U4G_UART_TX_BUF_SIZE, U4G_UART_QUEUE_SIZE, &u4g_uart_event_queue, intr_alloc_flags);
     // err = uart_driver_install(U4G_UART_NUM, U4G_UART_RX_BUF_SIZE, U4G_UART_TX_BUF_SIZE, U4G_UART_QUEUE_SIZE, &u4g_uart_event_queue, intr_alloc_flags);
     if (err != ESP_OK)
     {
@@ -255,13 +394,23 @@ esp_err_t u4g_uart_init(void)
         return ESP_FAIL;
     }
 
+#if U4G_UART_PATTERN_MODE
+    // 收到'\n'即产生 UART_PATTERN_DET 事件，参数单位为波特周期，与波特率无关
+    uart_enable_pattern_det_baud_intr(U4G_UART_NUM, '\n', 1, 9, 0, 0);
+    uart_pattern_queue_reset(U4G_UART_NUM, U4G_UART_PATTERN_QUEUE);
+#endif
+
     // 配置 DMA 缓冲区（必须 4 字节对齐）
     // uart_set_rx_full_threshold(U4G_UART_NUM, 128);
     // uart_set_tx_empty_threshold(U4G_UART_NUM, 16);
     // uart_set_rx_timeout(U4G_UART_NUM, 10); // 缩短超时时间
 
-    // 初始化缓冲区管理
-    u4g_at_buffer_init();
+    u4g_ring_init(&uart_ring, uart_ring_buf, sizeof(uart_ring_buf));
+    if (xTaskCreate(uart_parse_task, "uart_parse_task", U4G_UART_PARSE_STACK, NULL, U4G_UART_PARSE_PRIO, &uart_parse_task_handle) != pdPASS)
+    {
+        ESP_LOGE(TAG, "创建 uart_parse_task 失败");
+        return ESP_FAIL;
+    }
     if (xTaskCreatePinnedToCore(
             uart_recv_task,         // 任务函数
             "uart_recv_task",       // 任务名称
@@ -275,11 +424,65 @@ esp_err_t u4g_uart_init(void)
         ESP_LOGE(TAG, "创建 uart_recv_task 失败");
         return ESP_FAIL;
     }
-    ESP_LOGI(TAG, "UART%d 初始化成功丨波特率: %d | TX引脚%d | RX引脚%d | TX缓冲区:%d | RX(接收)缓冲区:%d | 队列数量%d",
-             U4G_UART_NUM, U4G_UART_BAUD_RATE, U4G_UART_TX_PIN, U4G_UART_RX_PIN, U4G_UART_TX_BUF_SIZE, U4G_UART_RX_BUF_SIZE, U4G_UART_QUEUE_SIZE);
+    ESP_LOGI(TAG, "UART%d 初始化成功丨波特率: %lu | TX引脚%d | RX引脚%d | TX缓冲区:%d | RX(接收)缓冲区:%d | 队列数量%d | 行模式%d | 硬件流控%d",
+             U4G_UART_NUM, uart_baud, U4G_UART_TX_PIN, U4G_UART_RX_PIN, U4G_UART_TX_BUF_SIZE, U4G_UART_RX_RING_SIZE, U4G_UART_QUEUE_SIZE,
+             U4G_UART_PATTERN_MODE, U4G_UART_HW_FLOWCTRL);
     return ESP_OK;
 }
 
+/**
+ * @brief 切换本端波特率：等待发送完成后切换，并丢弃切换前收到的残留数据
+ * @param baud 波特率
+ * @return esp_err_t
+ */
+esp_err_t u4g_uart_baud_set(uint32_t baud)
+{
+    uart_wait_tx_done(U4G_UART_NUM, pdMS_TO_TICKS(100));
+    esp_err_t err = uart_set_baudrate(U4G_UART_NUM, baud);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "UART%d 设置波特率%lu失败: %s", U4G_UART_NUM, baud, esp_err_to_name(err));
+        return err;
+    }
+    uart_flush_input(U4G_UART_NUM);
+#if U4G_UART_PATTERN_MODE
+    uart_pattern_queue_reset(U4G_UART_NUM, U4G_UART_PATTERN_QUEUE);
+#endif
+    line_reset_req = true;
+    xTaskNotifyGive(uart_parse_task_handle);
+    for (int i = 0; i < 10 && line_reset_req; i++)
+    {
+        vTaskDelay(pdMS_TO_TICKS(5)); // 等解析任务丢弃残留数据，再发送新波特率下的指令
+    }
+    uart_baud = baud;
+    ESP_LOGI(TAG, "UART%d 波特率切换为 %lu", U4G_UART_NUM, baud);
+    return ESP_OK;
+}
+
+/**
+ * @brief 获取硬件FIFO溢出次数（流控关闭时高波特率下可能发生）
+ */
+uint32_t u4g_uart_overflow_get(void)
+{
+    return uart_overflow;
+}
+
+/**
+ * @brief 获取接收环形缓冲区统计（最高占用、空间不足次数）
+ */
+void u4g_uart_ring_stat_get(u4g_ring_stat_t *out)
+{
+    u4g_ring_stat_get(&uart_ring, out);
+}
+
+/**
+ * @brief 获取本端当前波特率
+ */
+uint32_t u4g_uart_baud_get(void)
+{
+    return uart_baud;
+}
+
 // 重启4G模块
 void u4g_uart_reset(void)
 {
@@ -308,7 +511,8 @@ int32_t u4g_uart_send(const char *p_data, uint16_t len)
         ESP_LOGE(TAG, "数据长度超过UART%d TX缓冲区大小: %d > %d", U4G_UART_NUM, len, U4G_UART_TX_BUF_SIZE);
         return U4G_ERR_INVALID_ARG; // 返回错误码
     }
-    ESP_LOGI(TAG, ">>> 发送数据长度: %d | 数据: %.*s", len, len, p_data);
+    ESP_LOGD(TAG, ">>> 发送数据长度: %d | 数据: %.*s", len, len, p_data);
+    u4g_trace_record(U4G_TRACE_TX, p_data, len);
     // esp_task_wdt_reset(); // 喂狗
     int bytes_written = uart_write_bytes(U4G_UART_NUM, p_data, len);
     // int bytes_written = uart_write_bytes(U4G_UART_NUM, (const char *)p_data, len);
@@ -322,7 +526,7 @@ int32_t u4g_uart_send(const char *p_data, uint16_t len)
     esp_err_t ret = uart_wait_tx_done(U4G_UART_NUM, portMAX_DELAY);
     if (ret == ESP_OK)
     {
-        ESP_LOGI(TAG, "数据发送成功，发送字节数: %d", bytes_written);
+        ESP_LOGD(TAG, "数据发送成功，发送字节数: %d", bytes_written);
         return len; // 成功返回发送的字节数
     }
     else if (ret == ESP_ERR_TIMEOUT)
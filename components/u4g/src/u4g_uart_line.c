@@ -0,0 +1,114 @@
+#include "u4g_uart_line.h"
+#include "esp_log.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define TAG "U4G-UART-LINE"
+
+static void line_emit(u4g_uart_line_t *ctx, bool raw)
+{
+    ctx->buf[ctx->len] = '\0';
+    size_t follow = 0;
+    if (ctx->cb)
+    {
+        follow = ctx->cb(ctx->buf, ctx->len, raw, ctx->arg);
+    }
+    ctx->len = 0;
+    if (!raw)
+    {
+        ctx->raw = follow;
+    }
+}
+
+/**
+ * @brief 初始化行切分器
+ * @param ctx 行切分器
+ * @param cb 完整行回调
+ * @param prompt_cb 提示符询问回调，为NULL时不识别提示符
+ * @param arg 回调参数
+ */
+void u4g_uart_line_init(u4g_uart_line_t *ctx, u4g_uart_line_cb_t cb, u4g_uart_line_prompt_cb_t prompt_cb, void *arg)
+{
+    ctx->cb = cb;
+    ctx->prompt_cb = prompt_cb;
+    ctx->arg = arg;
+    u4g_uart_line_reset(ctx);
+}
+
+/**
+ * @brief 丢弃未完成的行（UART溢出清空、模块重启后调用）
+ */
+void u4g_uart_line_reset(u4g_uart_line_t *ctx)
+{
+    ctx->len = 0;
+    ctx->raw = 0;
+    ctx->prompt = false;
+}
+
+/**
+ * @brief 输入新收到的字节
+ * @param ctx 行切分器
+ * @param data 数据
+ * @param len  数据长度
+ */
+void u4g_uart_line_feed(u4g_uart_line_t *ctx, const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+    while (i < len)
+    {
+        if (ctx->raw)
+        {
+            // 透传：按声明的字节数整段截取，内容中的换行不切分
+            size_t n = len - i;
+            if (n > ctx->raw)
+            {
+                n = ctx->raw;
+            }
+            if (n > U4G_UART_LINE_MAX - ctx->len)
+            {
+                n = U4G_UART_LINE_MAX - ctx->len;
+            }
+            memcpy(ctx->buf + ctx->len, data + i, n);
+            ctx->len += n;
+            ctx->raw -= n;
+            i += n;
+            if (ctx->raw == 0 || ctx->len >= U4G_UART_LINE_MAX)
+            {
+                line_emit(ctx, true);
+            }
+            continue;
+        }
+        char c = (char)data[i++];
+        if (ctx->prompt)
+        {
+            ctx->prompt = false;
+            if (c == ' ')
+            {
+                continue;
+            }
+        }
+        if (ctx->len == 0 && c == '>' && ctx->prompt_cb && ctx->prompt_cb(ctx->arg))
+        {
+            // 数据输入提示符没有换行结尾
+            ctx->buf[ctx->len++] = c;
+            line_emit(ctx, false);
+            ctx->prompt = true;
+            continue;
+        }
+        ctx->buf[ctx->len++] = c;
+        if (c == '\n' && ctx->len >= 2 && ctx->buf[ctx->len - 2] == '\r')
+        {
+            if (ctx->len == 2)
+            {
+                ctx->len = 0; // 空行
+                continue;
+            }
+            line_emit(ctx, false);
+        }
+        else if (ctx->len >= U4G_UART_LINE_MAX)
+        {
+            ESP_LOGW(TAG, "行超过%d字节，分段输出", U4G_UART_LINE_MAX);
+            line_emit(ctx, false);
+        }
+    }
+}
@@ -1,1070 +1,443 @@
 #include "u4g_uart_recv.h"
 #include "u4g_at_cmd.h"
+#include "u4g_urc.h"
 #include "esp_log.h"
 #include <stdio.h>  //默认
 #include <stddef.h> // 引入size_t、NULL类型
+#include <stdlib.h>
 #include <string.h>
 
 #define TAG "U4G-UART_RECV"
 
-emU4GResult u4g_uart_recv_process(char *data, uint32_t size)
-{
-    if (data == NULL || size == 0)
-    {
-        ESP_LOGE(TAG, "接收数据为空或长度为0");
-        return 0;
-    }
-    // int32_t res = (int32_t)size; // 初始化消费长度为接收长度
-    ESP_LOGI(TAG, "接收到数据(%ld字节): %.*s", size, (int)size, data);
+#define U4G_RECV_TRIE_NODES 256 // 前缀树节点上限
+#define U4G_RECV_PREFIX_MAX 32  // 信息行前缀数量上限
 
-    if (u4g_at_cmd_handle.cmd_content == NULL)
+// 行分类结果
+enum
+{
+    LINE_NONE = 0,    // 未匹配任何前缀（续行/未知行）
+    LINE_OK,          // OK
+    LINE_ERROR,       // ERROR
+    LINE_CME_ERROR,   // +CME ERROR: <err>
+    LINE_PROMPT,      // > 数据输入提示符
+    LINE_ECHO,        // 指令回显
+    LINE_PREFIX_BASE, // 描述表中的信息行前缀从此开始编号
+};
+
+/**
+ * 前缀树节点：子节点以“首子节点+兄弟链”保存，下标 0 为根节点
+ */
+typedef struct
+{
+    char c;           // 节点字符
+    uint8_t token;    // 以该节点结尾的前缀编号，LINE_NONE 表示不是前缀结尾
+    uint16_t child;   // 首个子节点，0 表示无
+    uint16_t sibling; // 下一个兄弟节点，0 表示无
+} recv_trie_node_t;
+
+static recv_trie_node_t trie[U4G_RECV_TRIE_NODES];
+static uint16_t trie_count = 1;                      // 已用节点数（含根）
+static const char *prefix_list[U4G_RECV_PREFIX_MAX]; // 前缀编号对应的字符串
+static uint8_t prefix_count = 0;
+static uint8_t cmd_token[U4G_AT_CMD_MAX]; // 各指令期望的信息行前缀编号
+static uint8_t recv_chan = U4G_AT_CHAN_ANY;   // 正在处理的行所属的指令通道
+static size_t recv_raw = 0;                    // 处理函数声明紧随当前行之后的内容字节数
+static uint8_t raw_chan = U4G_AT_CHAN_ANY;     // 透传内容所属的指令通道
+static const u4g_at_cmd_t *raw_cmd = NULL;     // 透传内容所属的指令，超时换成下一条指令后不再交付
+
+/**
+ * @brief 向前缀树插入一个前缀
+ * @return 插入成功返回 true
+ */
+static bool trie_insert(const char *prefix, uint8_t token)
+{
+    uint16_t node = 0;
+    for (const char *p = prefix; *p; p++)
     {
-        ESP_LOGE(TAG, "无活动指令");
-        return 0;
+        uint16_t child = trie[node].child;
+        while (child && trie[child].c != *p)
+        {
+            child = trie[child].sibling;
+        }
+        if (!child)
+        {
+            if (trie_count >= U4G_RECV_TRIE_NODES)
+            {
+                ESP_LOGE(TAG, "前缀树节点不足，无法插入: %s", prefix);
+                return false;
+            }
+            child = trie_count++;
+            trie[child].c = *p;
+            trie[child].token = LINE_NONE;
+            trie[child].child = 0;
+            trie[child].sibling = trie[node].child;
+            trie[node].child = child;
+        }
+        node = child;
     }
-    const u4g_at_cmd_t *cmd_content = u4g_at_cmd_handle.cmd_content;
+    trie[node].token = token;
+    return true;
+}
 
-    emU4GResult result = U4G_STATE_AT_RSP_WAITING;
-    // 根据当前AT命令类型进行不同的处理
-    switch (cmd_content->name)
-    {
-    case U4G_AT_CMD:
+/**
+ * @brief 对一行数据做最长前缀匹配，耗时只与行长度有关，与指令数量无关
+ * @return 行分类
+ */
+static uint8_t trie_match(const char *line, size_t len)
+{
+    uint8_t token = LINE_NONE;
+    uint16_t node = 0;
+    for (size_t i = 0; i < len; i++)
     {
-        if (strstr(data, "OK\r\n"))
+        uint16_t child = trie[node].child;
+        while (child && trie[child].c != line[i])
         {
-            ESP_LOGI(TAG, "AT 指令处理完成");
-            result = U4G_OK;
+            child = trie[child].sibling;
         }
-        else if (strstr(data, "ERROR\r\n"))
+        if (!child)
         {
-            ESP_LOGE(TAG, "AT 指令 错误需重启");
-            result = U4G_OK;
+            break;
         }
-        else
+        node = child;
+        if (trie[node].token != LINE_NONE)
         {
-            ESP_LOGI(TAG, "AT 指令处理失败");
-            result = U4G_FAIL;
+            token = trie[node].token;
         }
-        break;
     }
-    case U4G_AT_CMD_IMEI:
+    return token;
+}
+
+/**
+ * @brief 登记一个信息行前缀，相同前缀共用编号
+ * @return 前缀编号，失败返回 LINE_NONE
+ */
+static uint8_t prefix_register(const char *prefix)
+{
+    for (uint8_t i = 0; i < prefix_count; i++)
     {
-        char *pt = strstr(data, "+CGSN: ");
-        if (pt)
-        {
-            emU4GResult handler_res = cmd_content->handler(data);
-            if (handler_res == U4G_OK)
-            {
-                ESP_LOGI(TAG, "U4G_AT_CMD_IMEI-指令回调成功");
-                result = U4G_OK;
-            }
-            else
-            {
-                ESP_LOGI(TAG, "U4G_AT_CMD_IMEI-指令回调失败");
-                result = U4G_FAIL;
-            }
-        }
-        else
+        if (strcmp(prefix_list[i], prefix) == 0)
         {
-            ESP_LOGE(TAG, "未找到 CGSN 字符串");
-            result = U4G_FAIL;
+            return LINE_PREFIX_BASE + i;
         }
-        break;
     }
-    case U4G_AT_CMD_CEREG:
+    if (prefix_count >= U4G_RECV_PREFIX_MAX)
     {
-        char *pt = strstr(data, "+CEREG: ");
-        if (pt)
-        {
-            emU4GResult handler_res = cmd_content->handler(data); // ✅
-            if (handler_res == U4G_OK)
-            {
-                ESP_LOGI(TAG, "U4G_AT_CMD_CEREG-联网成功");
-                result = U4G_OK;
-            }
-            else if (handler_res == U4G_STATE_AT_NET_NOT)
-            {
-                ESP_LOGI(TAG, "U4G_AT_CMD_CEREG-未联网");
-                result = U4G_STATE_AT_NET_NOT;
-            }
-            else
-            {
-                ESP_LOGI(TAG, "U4G_AT_CMD_CEREG-指令回调失败");
-                result = U4G_FAIL;
-            }
-        }
-        else
-        {
-            ESP_LOGE(TAG, "未找到 CEREG 字符串");
-            result = U4G_FAIL;
-        }
-        break;
+        ESP_LOGE(TAG, "前缀数量超过上限: %s", prefix);
+        return LINE_NONE;
     }
-    case U4G_AT_CMD_MCCID:
+    uint8_t token = LINE_PREFIX_BASE + prefix_count;
+    if (!trie_insert(prefix, token))
     {
-        char *pt = strstr(data, "+MCCID: ");
-        if (pt)
-        {
-            emU4GResult handler_res = cmd_content->handler(data); // ✅
-            if (handler_res == U4G_OK)
-            {
-                ESP_LOGI(TAG, "U4G_AT_CMD_MCCID-指令回调成功");
-                result = U4G_OK;
-            }
-            else
-            {
-                ESP_LOGI(TAG, "U4G_AT_CMD_MCCID-指令回调失败");
-                result = U4G_FAIL;
-            }
-        }
-        else
-        {
-            ESP_LOGE(TAG, "未找到 MCCID 字符串");
-            result = U4G_FAIL;
-        }
-        break;
+        return LINE_NONE;
     }
-    case U4G_AT_CMD_REBOOT:
+    prefix_list[prefix_count++] = prefix;
+    return token;
+}
+
+/**
+ * @brief 根据应答描述表构建前缀树，需在串口接收任务启动前调用
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_uart_recv_init(void)
+{
+    memset(trie, 0, sizeof(trie));
+    trie_count = 1;
+    prefix_count = 0;
+    bool ok = trie_insert("OK\r\n", LINE_OK) &&
+              trie_insert("ERROR", LINE_ERROR) &&
+              trie_insert("+CME ERROR:", LINE_CME_ERROR) &&
+              trie_insert(">", LINE_PROMPT) &&
+              trie_insert("AT", LINE_ECHO);
+    if (!ok)
     {
-        result = U4G_OK;
-        break;
+        return U4G_FAIL;
     }
-    case U4G_AT_CMD_TIME:
+    for (int i = 0; i < U4G_AT_CMD_MAX; i++)
     {
-        char *pt = strstr(data, "+CCLK: ");
-        if (pt)
+        const u4g_at_desc_t *desc = u4g_at_desc_get(i);
+        cmd_token[i] = LINE_NONE;
+        if (desc && desc->prefix)
         {
-            emU4GResult handler_res = cmd_content->handler(data); // ✅
-            if (handler_res == U4G_OK)
-            {
-                ESP_LOGI(TAG, "U4G_AT_CMD_TIME-指令回调成功");
-                result = U4G_OK;
-            }
-            else
+            cmd_token[i] = prefix_register(desc->prefix);
+            if (cmd_token[i] == LINE_NONE)
             {
-                ESP_LOGI(TAG, "U4G_AT_CMD_TIME-指令回调失败");
-                result = U4G_FAIL;
+                return U4G_FAIL;
             }
         }
-        else
-        {
-            ESP_LOGE(TAG, "未找到 CCLK 字符串");
-            result = U4G_FAIL;
-        }
-        break;
     }
-    case U4G_AT_CMD_CSQ:
+    ESP_LOGI(TAG, "应答前缀树构建完成：前缀%d个，节点%d个", prefix_count, trie_count);
+    return U4G_OK;
+}
+
+/**
+ * @brief 解析 +CME ERROR 错误码
+ */
+static emU4GResult cme_error_result(const char *line)
+{
+    int err = atoi(line + strlen("+CME ERROR:"));
+    if (err == 651)
     {
-        char *pt = strstr(data, "+CSQ: ");
-        if (pt)
-        {
-            emU4GResult handler_res = cmd_content->handler(data); // ✅
-            if (handler_res == U4G_OK)
-            {
-                ESP_LOGI(TAG, "U4G_AT_CMD_CSQ-指令回调成功");
-                result = U4G_OK;
-            }
-            else
-            {
-                ESP_LOGI(TAG, "U4G_AT_CMD_CSQ-指令回调失败");
-                result = U4G_FAIL;
-            }
-        }
-        else
-        {
-            ESP_LOGE(TAG, "未找到 CSQ 字符串");
-            result = U4G_FAIL;
-        }
-        break;
+        ESP_LOGE(TAG, "HTTP 客户端实例无空闲客户端");
+        return U4G_STATE_AT_NO_CLIENT_IDLE;
     }
-    case U4G_AT_CMD_ATE:
+    if (err >= 10 && err <= 15) // 未插卡、需要PIN/PUK、卡故障、卡忙、卡错误
     {
-        if (strstr(data, "OK\r\n"))
-        {
-            ESP_LOGI(TAG, "ATE 指令处理完成");
-            result = U4G_OK;
-        }
-        else if (strstr(data, "ERROR\r\n"))
-        {
-            ESP_LOGE(TAG, "ATE 指令 已执行");
-            result = U4G_OK;
-        }
-        else
-        {
-            ESP_LOGE(TAG, "ATE 指令 未找到");
-            result = U4G_FAIL;
-        }
-        break;
+        ESP_LOGW(TAG, "SIM卡未就绪: +CME ERROR: %d", err);
+        return U4G_STATE_AT_SIM_NOT;
+    }
+    ESP_LOGE(TAG, "+CME ERROR: %d", err);
+    return U4G_FAIL;
+}
+
+/**
+ * @brief 信息行交给处理函数，URC 类指令由处理函数结果直接结束，其余指令暂存结果等待 OK
+ */
+static emU4GResult rsp_dispatch(u4g_at_cmd_handle_t *h, const u4g_at_desc_t *desc, u4g_at_rsp_handler_t handler, char *data)
+{
+    emU4GResult rsp = handler ? handler(data) : U4G_OK;
+    h->progress++;
+    if (desc->final == U4G_AT_FINAL_URC)
+    {
+        return rsp;
     }
-    case U4G_AT_CMD_SSL_AUTH:
+    if (rsp != U4G_STATE_AT_RSP_WAITING)
     {
-        if (strstr(data, "OK\r\n"))
-        {
-            ESP_LOGI(TAG, "U4G_AT_CMD_SSL_AUTH 指令处理完成");
-            result = U4G_OK;
-        }
-        else
-        {
-            ESP_LOGE(TAG, "U4G_AT_CMD_SSL_AUTH 指令 未找到");
-            result = U4G_FAIL;
-        }
-        break;
+        h->rsp = rsp;
     }
-    case U4G_AT_CMD_HTTP_CREATE:
+    return U4G_STATE_AT_RSP_WAITING;
+}
+
+// 该通道当前指令正在等待此前缀的信息行
+static bool recv_expects(uint8_t chan, uint8_t token)
+{
+    const u4g_at_cmd_t *cmd = u4g_at_cmd_handle[chan].cmd_content;
+    return cmd && token != LINE_NONE && token == cmd_token[cmd->name];
+}
+
+/**
+ * @brief 是否为该通道指令的最终结果码：URC 携带的数据续行读取中，内容行即使恰好是 OK/ERROR 也不算
+ * @param chan 指令通道
+ * @param token 行分类
+ */
+static bool recv_is_final(uint8_t chan, uint8_t token)
+{
+    if (token != LINE_OK && token != LINE_ERROR && token != LINE_CME_ERROR)
     {
-        char *pt = strstr(data, "+MHTTPCREATE:");
-        if (pt)
-        {
-            emU4GResult handler_res = cmd_content->handler(data); // ✅
-            if (handler_res == U4G_OK)
-            {
-                result = U4G_OK;
-            }
-            else
-            {
-                ESP_LOGI(TAG, "U4G_AT_CMD_HTTP_CREATE-无法解析HTTP实例ID");
-                result = U4G_FAIL;
-            }
-        }
-        else
+        return false;
+    }
+    const u4g_at_cmd_handle_t *h = &u4g_at_cmd_handle[chan];
+    const u4g_at_desc_t *desc = h->cmd_content ? u4g_at_desc_get(h->cmd_content->name) : NULL;
+    return !(desc && h->matched && desc->lines == U4G_AT_LINES_CONT && desc->final == U4G_AT_FINAL_URC &&
+             token != LINE_CME_ERROR);
+}
+
+/**
+ * @brief 确定一行应答属于哪个通道的指令
+ * 启用CMUX后模块可能在发起通道以外（如URC通道）上报指令的结果，按前缀找到正在等待它的通道；
+ * 非指令通道上转交过的指令，其后的数据续行跟随转交
+ * @param chan 行来源通道
+ * @param token 行分类
+ * @return 所属通道，不属于任何指令时为 chan 本身
+ */
+static uint8_t recv_route(uint8_t chan, uint8_t token)
+{
+    static uint8_t any_follow = U4G_AT_CHAN_ANY; // 非指令通道上最近一次转交到的通道
+    if (chan < U4G_AT_CHAN_NUM && recv_expects(chan, token))
+    {
+        return chan;
+    }
+    for (uint8_t i = 0; i < U4G_AT_CHAN_NUM; i++)
+    {
+        if (i != chan && recv_expects(i, token))
         {
-            pt = strstr(data, "+CME ERROR: ");
-            if (pt)
-            {
-                pt += strlen("+CME ERROR: ");
-                int err = 0;
-                sscanf(pt, "%d", &err);
-                if (err == 651)
-                {
-                    ESP_LOGE(TAG, "HTTP 客户端实例无空闲客户端");
-                    result = U4G_STATE_AT_NO_CLIENT_IDLE;
-                }
-                else
-                {
-                    ESP_LOGI(TAG, "U4G_AT_CMD_HTTP_CREATE-无法解析HTTP实例ID +CME ERROR");
-                    result = U4G_FAIL;
-                }
-            }
-            else
+            if (chan == U4G_AT_CHAN_ANY)
             {
-                ESP_LOGI(TAG, "HTTP 客户端实例创建失败");
-                result = U4G_FAIL;
+                any_follow = i;
             }
+            return i;
         }
-        break;
     }
-    case U4G_AT_CMD_HTTP_SSL:
+    if (chan == U4G_AT_CHAN_ANY && any_follow != U4G_AT_CHAN_ANY)
     {
-        if (strstr(data, "OK\r\n"))
-        {
-            ESP_LOGI(TAG, "U4G_AT_CMD_HTTP_SSL 指令处理完成");
-            result = U4G_OK;
-        }
-        else
+        const u4g_at_cmd_handle_t *h = &u4g_at_cmd_handle[any_follow];
+        const u4g_at_desc_t *desc = h->cmd_content ? u4g_at_desc_get(h->cmd_content->name) : NULL;
+        if (desc && h->matched && desc->lines == U4G_AT_LINES_CONT && token != LINE_CME_ERROR)
         {
-            ESP_LOGE(TAG, "U4G_AT_CMD_HTTP_SSL 指令 未找到");
-            result = U4G_FAIL;
+            return any_follow;
         }
-        break;
+        any_follow = U4G_AT_CHAN_ANY;
     }
-    case U4G_AT_CMD_HTTP_ENCODING:
+    return chan;
+}
+
+/**
+ * @brief 处理一行AT应答
+ * @param chan 行来源的指令通道，U4G_AT_CHAN_ANY 表示不属于任何指令通道
+ * @param data 由行切分器输出的完整行（含"\r\n"）
+ * @param size 行长度
+ */
+emU4GResult u4g_uart_recv_process(uint8_t chan, char *data, uint32_t size)
+{
+    if (data == NULL || size == 0)
     {
-        if (strstr(data, "OK\r\n"))
-        {
-            ESP_LOGI(TAG, "U4G_AT_CMD_HTTP_ENCODING 指令处理完成");
-            result = U4G_OK;
-        }
-        else
-        {
-            ESP_LOGE(TAG, "U4G_AT_CMD_HTTP_ENCODING 指令 未找到");
-            result = U4G_FAIL;
-        }
-        break;
+        ESP_LOGE(TAG, "接收数据为空或长度为0");
+        return 0;
     }
-    case U4G_AT_CMD_HTTP_FRAGMENT:
+    ESP_LOGD(TAG, "接收到数据[通道%d](%ld字节): %.*s", chan, size, (int)size, data); // 逐行内容由 trace 记录
+
+    uint8_t token = trie_match(data, size);
+    if (token == LINE_ERROR && !(size == strlen("ERROR\r\n") && memcmp(data, "ERROR\r\n", size) == 0))
     {
-        if (strstr(data, "OK\r\n"))
-        {
-            ESP_LOGI(TAG, "U4G_AT_CMD_HTTP_FRAGMENT 指令处理完成");
-            result = U4G_OK;
-        }
-        else
-        {
-            ESP_LOGE(TAG, "U4G_AT_CMD_HTTP_FRAGMENT 指令 未找到");
-            result = U4G_FAIL;
-        }
-        break;
+        token = LINE_NONE; // 只是以 ERROR 开头的内容行（"OK\r\n" 按整行匹配）
     }
-    case U4G_AT_CMD_HTTP_HEADER:
+    // 最终结果码表示模块已处理完该通道的上一条指令，可立即发送下一条
+    if (chan < U4G_AT_CHAN_NUM && recv_is_final(chan, token))
     {
-        if (strstr(data, "OK\r\n"))
-        {
-            ESP_LOGI(TAG, "U4G_AT_CMD_HTTP_HEADER 指令处理完成");
-            result = U4G_OK;
-        }
-        else
-        {
-            ESP_LOGE(TAG, "U4G_AT_CMD_HTTP_HEADER 指令 未找到");
-            result = U4G_FAIL;
-        }
-        break;
+        u4g_at_cmd_idle_notify(chan);
     }
-    case U4G_AT_CMD_HTTP_BODY:
+
+    chan = recv_route(chan, token);
+    u4g_at_cmd_handle_t *h = chan < U4G_AT_CHAN_NUM ? &u4g_at_cmd_handle[chan] : NULL;
+    recv_chan = chan;
+    const u4g_at_cmd_t *cmd_content = h ? h->cmd_content : NULL;
+    // 不是当前指令期望的信息行时，先交给URC订阅者
+    bool solicited = h && recv_expects(chan, token);
+    if (!solicited && u4g_urc_dispatch(data, size))
     {
-        if (strstr(data, "OK\r\n"))
-        {
-            ESP_LOGI(TAG, "U4G_AT_CMD_HTTP_BODY 指令处理完成");
-            result = U4G_OK;
-        }
-        else
-        {
-            ESP_LOGE(TAG, "U4G_AT_CMD_HTTP_BODY 指令 未找到");
-            result = U4G_FAIL;
-        }
-        break;
+        return U4G_STATE_AT_RSP_WAITING;
     }
-    case U4G_AT_CMD_HTTP_REQUEST:
+    if (cmd_content == NULL)
     {
-        static bool data_state = false;
-        char *pt = strstr(data, "+MHTTPURC: \"content\"");
-        if (pt)
-        {
-            data_state = true; // 检测到内容-首次处理
-        }
-        else if (strstr(data, "+MHTTPURC: \"err\"") || strstr(data, "+CME ERROR:"))
-        {
-            ESP_LOGE(TAG, "HTTP请求处理错误响应: %s", data);
-            result = U4G_FAIL;
-        }
-        else if (strstr(data, "OK\r\n"))
-        {
-            ESP_LOGE(TAG, "继续接收指令");
-            result = U4G_STATE_AT_RSP_WAITING;
-        }
-        else
-        {
-            // result = U4G_FAIL;
-            if(data_state == false){
-                ESP_LOGI(TAG, "HTTP请求未知数据");
-            }
-        }
-        if (data_state)
+        ESP_LOGD(TAG, "无活动指令");
+        return 0;
+    }
+    const u4g_at_desc_t *desc = u4g_at_desc_get(cmd_content->name);
+    if (desc == NULL)
+    {
+        ESP_LOGW(TAG, "未登记的命令类型: %d", cmd_content->name);
+        return 0;
+    }
+    u4g_at_rsp_handler_t handler = cmd_content->handler ? cmd_content->handler : desc->handler;
+    bool cont = h->matched && desc->lines == U4G_AT_LINES_CONT;
+
+    emU4GResult result = U4G_STATE_AT_RSP_WAITING;
+    if (solicited)
+    {
+        // 期望的信息行
+        h->matched = true;
+        result = rsp_dispatch(h, desc, handler, data);
+    }
+    else if (cont && desc->final == U4G_AT_FINAL_URC && token != LINE_CME_ERROR)
+    {
+        // URC 携带的数据续行，内容任意（可能恰好以 OK/AT 开头），整行交给处理函数
+        result = rsp_dispatch(h, desc, handler, data);
+    }
+    else if (token == LINE_OK)
+    {
+        if (desc->final != U4G_AT_FINAL_URC)
         {
-            emU4GResult handler_res = cmd_content->handler(data); // ✅
-            if (handler_res == U4G_OK)
-            {
-                data_state = false; // 接收完毕，关闭数据处理
-                result = U4G_OK;
-            }
-            else if (handler_res == U4G_STATE_AT_RSP_WAITING)
-            {
-                result = U4G_STATE_AT_RSP_WAITING;
-            }
-            else if (handler_res == U4G_STATE_AT_RINGBUF_OVERFLOW)
+            if (desc->prefix && !h->matched)
             {
-                data_state = false; // 接收完毕，关闭数据处理
-                result = U4G_STATE_AT_RINGBUF_OVERFLOW;
+                ESP_LOGE(TAG, "指令[%d]未收到 %s 信息行", cmd_content->name, desc->prefix);
+                result = U4G_FAIL;
             }
             else
             {
-                ESP_LOGI(TAG, "U4G_AT_CMD_HTTP_REQUEST-无法解析HTTP内容");
-                data_state = false; // 接收完毕，关闭数据处理
-                result = U4G_FAIL;
+                result = h->rsp;
             }
         }
-        break;
     }
-    case U4G_AT_CMD_HTTP_DELETE:
+    else if (token == LINE_ERROR || token == LINE_CME_ERROR)
     {
-        if (strstr(data, "OK\r\n"))
+        if (desc->final == U4G_AT_FINAL_ANY)
         {
-            ESP_LOGI(TAG, "U4G_AT_CMD_HTTP_DELETE 指令处理完成");
-            result = U4G_OK;
+            result = U4G_OK; // 探测类指令收到 ERROR 也说明模块在线
         }
         else
         {
-            ESP_LOGE(TAG, "U4G_AT_CMD_HTTP_DELETE 指令 未找到");
-            result = U4G_FAIL;
+            result = (token == LINE_CME_ERROR) ? cme_error_result(data) : U4G_FAIL;
         }
-        break;
     }
-    default:
-        ESP_LOGW(TAG, "默认的命令类型: %d", cmd_content->name);
-        break;
+    else if (cont && token == LINE_NONE)
+    {
+        result = rsp_dispatch(h, desc, handler, data);
     }
+    // 回显、提示符及无关行继续等待
+
     if (result == U4G_STATE_AT_RSP_WAITING)
     { // 继续等待命令回执
         return U4G_STATE_AT_RSP_WAITING;
     }
-    u4g_at_cmd_handle.result = result;
-    xSemaphoreGive(u4g_at_cmd_semaphore_sync); // 释放信号量，通知消费者
-
-    // if (result == U4G_OK)
-    // {
-    //     u4g_at_cmd_handle.state = AT_MSG;
-    //     xEventGroupSetBits(at_event_group, AT_RESPONSE_BIT);
-    // }
-    // u4g_at_cmd_handle.state = AT_MSG;
-    // xEventGroupSetBits(at_event_group, AT_RESPONSE_BIT);
-
+    u4g_at_cmd_finish(chan, result); // 通知等待中的 u4g_at_cmd_sync
     return result;
 }
 
-// 在 u4g_uart_recv_process 中触发缓冲区切换
-// int32_t u4g_uart_recv_process(uint8_t *pdata, uint32_t size) {
-//     // ...原有解析逻辑...
-
-//     // 示例：HTTP请求数据完整接收后切换缓冲区
-//     if (cmd_content->name == U4G_AT_CMD_HTTP_REQUEST) {
-//         int buf_idx;
-//         size_t len;
-//         // 获取当前写入的缓冲区
-//         if (u4g_at_buffer_write(&buf_idx, &len, 0)) {
-//             memcpy(AT_Cache.data[buf_idx], data, size);
-//             AT_Cache.len[buf_idx] = size;
-//             u4g_at_buffer_switch(buf_idx); // 触发队列发送
-//         }
-//     }
-
-//     return res;
-// }
-
-// int32_t u4g_uart_recv_process2(uint8_t *pdata, uint32_t size)
-// {
-//     if (pdata == NULL || size == 0)
-//     {
-//         ESP_LOGE(TAG, "接收数据为空或长度为0");
-//         return 0;
-//     }
-
-//     int32_t res = (int32_t)size; // 初始化消费长度为接收长度
-
-//     char *data = (char *)pdata;
-
-//     // 先打印接收到的数据（调试用）
-//     ESP_LOGI(TAG, "接收到数据(%ld字节): %.*s", size, (int)size, data);
-
-//     bool data_res = false;
-//     if (u4g_at_cmd_handle.cmd_content)
-//     {
-//         // // 特殊处理HTTP请求
-//         if (u4g_at_cmd_handle.cmd_content->name == U4G_AT_CMD_HTTP_REQUEST)
-//         {
-//             ESP_LOGI(TAG, "检测到HTTP请求相关数据: %.*s", (int)size, data);
-//             // ESP_LOGI(TAG, "检测到HTTP请求相关数据");
-//             // 只有当收到内容或错误时才设置处理标志
-//             if (strstr(data, "+MHTTPURC: \"content\""))
-//             {
-//                 ESP_LOGI(TAG, "检测到HTTP内容响应");
-//                 data_res = true;
-//             }
-//             else if (strstr(data, "+MHTTPURC: \"err\"") || strstr(data, "+CME ERROR:"))
-//             {
-//                 ESP_LOGI(TAG, "检测到HTTP错误响应");
-//                 data_res = true;
-//             }
-//             else if (strstr(data, "OK\r\n"))
-//             {
-//                 // OK只是命令接受确认，不是最终响应
-//                 ESP_LOGI(TAG, "检测到HTTP请求命令确认(OK)，继续等待实际响应");
-//                 // 不要直接清空原始数据，而是复制一份再处理
-//                 // char local_buffer[128]; // 足够存储"OK"响应的小缓冲区
-//                 // strncpy(local_buffer, data, sizeof(local_buffer) - 1);
-//                 // local_buffer[sizeof(local_buffer) - 1] = '\0';
-//                 // // 只设置状态，不清空数据
-//                 // at_result_data.state = AT_MSG_PARTIAL; // 添加一个新状态表示部分响应
-//                 // memset(data, 0, U4G_UART_RX_BUF_SIZE);
-//             }
-//             // else if (strstr(data, "OK\r\n") && !strstr(data, "+MHTTPURC:"))
-//             // {
-//             //     // 如果只收到OK且没有其他HTTP相关内容，仅记录日志但不触发完成                ESP_LOGI(TAG, "HTTP请求已被接受，等待数据返回");
-//             //     // 不要清空，保留响应
-//             // }
-//             else if (strstr(data, "+MHTTPURC: \"header\""))
-//             {
-//                 // 收到HTTP头部，可以考虑设置超时时间
-//                 ESP_LOGI(TAG, "检测到HTTP头部信息，继续等待实际响应");
-//                 memset(data, 0, U4G_UART_RX_BUF_SIZE);
-//             }
-//             else if (strstr(data, "+MHTTPURC:"))
-//             {
-//                 // 任何其他MHTTPURC响应可能也包含有效数据
-//                 ESP_LOGI(TAG, "检测到其他HTTP相关响应");
-//                 data_res = true;
-//             }
-//             else if (size > 20 && strstr(data, "{") && strstr(data, "}"))
-//             {
-//                 // 可能是JSON数据
-//                 ESP_LOGI(TAG, "可能收到直接的JSON数据");
-//                 data_res = true;
-//             }
-//             else
-//             {
-//                 // ESP_LOGW(TAG, "未识别的HTTP响应内容: %.*s", (int)size, data);
-//                 ESP_LOGW(TAG, "未识别的HTTP响应内容，继续等待");
-//                 memset(data, 0, U4G_UART_RX_BUF_SIZE);
-//             }
-//         }
-//         else
-//         {
-//             // 普通AT命令处理
-//             if (strstr(data, "OK\r\n") || strstr(data, "ERROR\r\n") ||
-//                 strstr(data, "+CEREG: ") || strstr(data, "+CCLK: ") ||
-//                 strstr(data, "+MQTTSTATE:") || strstr(data, "+MCCID:") || strstr(data, "+CME ERROR:"))
-//             {
-//                 ESP_LOGI(TAG, "检测到普通指令[%s]响应：%.*s", at_cmd_current->cmd, (int)size, data);
-//                 data_res = true;
-//             }
-//             else
-//             {
-//                 ESP_LOGI(TAG, "未知响应内容，继续接收，缓冲区内容(%ld字节): %.*s", size, (int)size, data);
-//                 memset(data, 0, U4G_UART_RX_BUF_SIZE);
-//             }
-//         }
-
-//         // 处理有效响应
-//         if (data_res)
-//         {
-//             ESP_LOGI(TAG, "处理有效AT响应");
-//             receive_process_data(data, res);
-
-//             at_result_data.state = AT_MSG; // 有数据
-
-//             //     // 设置事件通知
-//             //     // if (at_event_group != NULL)
-//             //     // {
-//             //     //     xEventGroupSetBits(at_event_group, AT_RESPONSE_BIT);
-//             //     //     ESP_LOGI(TAG, "已设置AT响应事件位");
-//             //     // }
-//             //     // else
-//             //     // {
-//             //     //     ESP_LOGE(TAG, "事件组句柄为NULL，无法设置事件位");
-//             //     // }
-
-//             //     // xSemaphoreGive(AT_CALLBACK_SIGNAL); // 同步响应
-//             //     // 修改：使用任务通知代替信号量
-
-//             memset(data, 0, U4G_UART_RX_BUF_SIZE);
-//         }
-//     }
-//     else
-//     {
-//         ESP_LOGW(TAG, "收到数据但当前无活动AT命令");
-//     }
-
-//     ESP_LOGD(TAG, "u4g_uart_recv_process-返回处理后的数据长度: %ld", res);
-//     return 1; // 返回处理后的数据长度
-// }
-
-// static emATResult receive_process_data(void *pdata, size_t plen)
-// {
-//     if (pdata == NULL)
-//     {
-//         ESP_LOGE(TAG, "接收到的数据指针为NULL");
-//         return AT_ERR_UNKNOWN;
-//     }
-
-//     // 处理数据的实现
-//     char *data = (char *)pdata;
-//     ESP_LOGI(TAG, "receive_process_data接收到数据：%s", data);
-
-//     emATResult result = AT_OK;
-
-//     if (at_cmd_current == NULL)
-//     {
-//         ESP_LOGW(TAG, "receive_process_data当前AT命令为空");
-//         return AT_ERR_UNKNOWN;
-//     }
-
-//     // 根据当前AT命令类型进行不同的处理
-//     switch (at_cmd_current->cmdName)
-//     {
-//     case CMD_AT:
-//     {
-//         if (strstr(data, "OK\r\n"))
-//         {
-//             ESP_LOGI(TAG, "AT 指令处理完成");
-//             at_result_data.result = AT_OK;
-//         }
-//         else
-//         {
-//             ESP_LOGI(TAG, "AT 指令处理失败");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_REBOOT:
-//     {
-//         at_result_data.result = AT_OK;
-//         break;
-//     }
-//     case CMD_CSQ:
-//     {
-//         char *pt = strstr(data, "+CSQ: "); // 移动指针到数据部分
-//         if (pt)
-//         {
-//             pt += strlen("+CSQ: ");
-
-//             // 使用 sscanf 提取第一个数字（rssi）
-//             int rssi = 0;
-//             if (sscanf(pt, "%d,", &rssi) == 1)
-//             {
-//                 // 安全地存储结果
-//                 if (at_result_data.data != NULL && at_result_data.data_len >= sizeof(int))
-//                 {
-//                     *((int *)at_result_data.data) = rssi;
-//                     ESP_LOGI(TAG, "解析到CSQ值: %d", rssi);
-//                     at_result_data.result = AT_OK;
-//                 }
-//                 else
-//                 {
-//                     ESP_LOGE(TAG, "CSQ结果缓冲区无效");
-//                     at_result_data.result = AT_FAIL;
-//                 }
-//             }
-//             else
-//             {
-//                 ESP_LOGE(TAG, "字符串格式不正确，无法解析 CSQ 数据");
-//                 at_result_data.result = AT_FAIL;
-//             }
-
-//             // int pt_len = strlen(pt); // 计算数据长度
-//             // if (at_result_data.data_len > 0 && pt_len > at_result_data.data_len)
-//             // {
-//             //     ESP_LOGD(TAG, "CSQ 超出传递size");
-//             //     at_result_data.result = AT_FAIL;
-//             //     break;
-//             // }
-//             // // 使用 sscanf 提取第一个数字（rssi）
-//             // if (sscanf(pt, "%d,%*d", (int *)at_result_data.data) == 1)
-//             // {
-//             //     at_result_data.result = AT_OK;
-//             //     break;
-//             // }
-//             // ESP_LOGE(TAG, "字符串格式不正确，无法解析 CSQ 数据");
-//         }
-//         else
-//         {
-//             ESP_LOGE(TAG, "未找到 +CSQ: 字符串");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_CEREG:
-//     {
-//         char *pt = strstr(data, "+CEREG: ");
-//         if (pt)
-//         {
-//             pt += strlen("+CEREG: "); // 添加这行，跳过前缀
-//             int n = 0, stat = 0;
-//             // 修正：匹配格式为"数字,数字"
-//             if (sscanf(pt, "%d,%d", &n, &stat) == 2)
-//             {
-//                 ESP_LOGI(TAG, "CEREG: n=%d, stat=%d", n, stat);
-//                 if (stat == 1 || stat == 5) // 1: 已注册，本地网络; 5: 已注册，漫游
-//                 {
-//                     at_result_data.result = AT_OK;
-//                 }
-//                 else if (stat == 0)
-//                 { // 未联网
-//                     at_result_data.result = AT_NET_NOT;
-//                 }
-//                 else
-//                 {
-//                     at_result_data.result = AT_FAIL;
-//                 }
-//             }
-//             else
-//             {
-//                 ESP_LOGE(TAG, "字符串格式不正确，无法解析 CEREG 数据: [%s]", pt);
-//                 at_result_data.result = AT_FAIL;
-//             }
-//         }
-//         else
-//         {
-//             ESP_LOGE(TAG, "未找到 CEREG 字符串");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_TIME:
-//     {
-//         char *pt = strstr(data, "+CCLK: ");
-//         if (pt)
-//         {
-//             pt += strlen("+CCLK: ");
-//             // 示例响应: +CCLK: "24/12/23,03:18:05+32"
-//             const char *start = strchr(pt, '\"');
-//             if (!start)
-//             {
-//                 ESP_LOGE(TAG, "无法找到引号，解析失败");
-//                 at_result_data.result = AT_FAIL;
-//                 break;
-//             }
-//             start++; // 移动到引号后的第一个字符
-
-//             // 查找第二个引号
-//             const char *end = strchr(start, '\"');
-//             if (!end)
-//             {
-//                 ESP_LOGE(TAG, "无法找到结束引号，解析失败");
-//                 at_result_data.result = AT_FAIL;
-//                 break;
-//             }
-
-//             // 提取时间字符串
-//             size_t len = end - start;
-//             if (at_result_data.data == NULL || len >= at_result_data.data_len)
-//             {
-//                 ESP_LOGE(TAG, "时间字符串过长或缓冲区无效");
-//                 at_result_data.result = AT_FAIL;
-//                 break;
-//             }
-
-//             strncpy((char *)at_result_data.data, start, len);
-//             ((char *)at_result_data.data)[len] = '\0';
-//             at_result_data.result = AT_OK;
-//             ESP_LOGI(TAG, "解析后的时间字符串: %s", (char *)at_result_data.data);
-//         }
-//         else
-//         {
-//             ESP_LOGE(TAG, "未找到 解析后的时间字符串");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_ATE:
-//     {
-//         if (strstr(data, "OK\r\n"))
-//         {
-//             ESP_LOGI(TAG, "ATE 指令处理完成");
-//             at_result_data.result = AT_OK;
-//         }
-//         else
-//         {
-//             ESP_LOGE(TAG, "ATE 指令 未找到");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_IMEI:
-//     {
-//         // +CGSN: 869951040379202\r\nOK\r\n
-//         char *pt = strstr(data, "+CGSN:");
-//         if (pt)
-//         {
-//             pt += strlen("+CGSN:");
-//             int pt_len = strlen(pt); // 计算数据长度
-//             if (at_result_data.data_len > 0 && pt_len > at_result_data.data_len)
-//             {
-//                 ESP_LOGD(TAG, "CGSN 超出传递size");
-//                 at_result_data.result = AT_FAIL;
-//                 break;
-//             }
-//             sscanf(pt, "%17s", (char *)at_result_data.data);
-//             ESP_LOGI(TAG, "IMEI接收数据 %s | 接收字节数 %d | 传递包大小 %d", (char *)at_result_data.data, plen, at_result_data.data_len);
-//             at_result_data.result = AT_OK;
-//         }
-//         else
-//         {
-//             ESP_LOGE(TAG, "未找到 CGSN 字符串");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_MCCID: // 读取ICCID(AT+MCCID)SIM
-//     {
-//         char *pt = strstr(data, "+MCCID: ");
-//         if (pt)
-//         {
-//             pt += strlen("+MCCID: ");
-//             int pt_len = strlen(pt); // 计算数据长度
-
-//             if (at_result_data.data_len > 0 && pt_len > at_result_data.data_len)
-//             {
-//                 ESP_LOGD(TAG, "MCCID 超出传递size");
-//                 at_result_data.result = AT_FAIL;
-//                 break;
-//             }
-//             // 使用 sscanf 读取数据
-//             sscanf(pt, "%s", (char *)at_result_data.data);
-//             ESP_LOGI(TAG, "MCCID = %s", (char *)at_result_data.data);
-//             at_result_data.result = AT_OK;
-//             break;
-//         }
-//         pt = strstr(data, "+CME ERROR: ");
-//         if (pt)
-//         {
-//             pt += strlen("+CME ERROR: ");
-//             sscanf(pt, "%s", (char *)at_result_data.data);
-//             ESP_LOGI(TAG, "MCCID-ERROR: %s", (char *)at_result_data.data);
-//             if (strcmp((char *)at_result_data.data, "10") == 0)
-//             {
-//                 // 如果 out_data 指向的字符串是 "10"
-//                 ESP_LOGE(TAG, "读取MCCID(SIM)不存在未插卡");
-//                 at_result_data.result = AT_ERR_MCCID_NOT; // 读取SIM不存在
-//             }
-//             else
-//             {
-//                 ESP_LOGE(TAG, "读取MCCID(SIM)失败 错误码: %s", (char *)at_result_data.data);
-//                 at_result_data.result = AT_ERR_MCCID;
-//             }
-//             break;
-//         }
-
-//         ESP_LOGE(TAG, "未找到 MCCID 字符串或错误信息");
-//         at_result_data.result = AT_FAIL;
-//         break;
-//     }
-//     case CMD_SSL_AUTH:
-//     {
-//         if (strstr(data, "OK\r\n"))
-//         {
-//             ESP_LOGI(TAG, "CMD_SSL_AUTH 指令处理完成");
-//             at_result_data.result = AT_OK;
-//         }
-//         else
-//         {
-//             ESP_LOGI(TAG, "CMD_SSL_AUTH 指令处理失败");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_HTTP_CREATE:
-//     {
-//         char *pt = strstr(data, "+MHTTPCREATE:");
-//         if (pt)
-//         {
-//             pt += strlen("+MHTTPCREATE: ");
-//             int pt_len = strlen(pt); // 计算数据长度
-//             if (at_result_data.data_len > 0 && pt_len > at_result_data.data_len)
-//             {
-//                 ESP_LOGD(TAG, "MHTTPCREATE 超出传递size");
-//                 at_result_data.result = AT_FAIL;
-//                 break;
-//             }
-
-//             // sscanf(pt, "+MHTTPCREATE: %hhu", &AT_Info.httpid);
-//             // 修正格式，移除了重复的"+MHTTPCREATE: "
-//             if (sscanf(pt, "%hhu", &AT_Info.httpid) == 1)
-//             {
-//                 ESP_LOGI(TAG, "HTTP 客户端实例 ID = %hhu", AT_Info.httpid);
-//                 at_result_data.result = AT_OK;
-//             }
-//             else
-//             {
-//                 ESP_LOGE(TAG, "无法解析HTTP实例ID");
-//                 at_result_data.result = AT_FAIL;
-//             }
-//         }
-//         else
-//         {
-//             pt = strstr(data, "+CME ERROR: ");
-//             if (pt)
-//             {
-//                 pt += strlen("+CME ERROR: ");
-//                 int err = 0;
-//                 sscanf(pt, "%d", &err);
-//                 if (err == 651)
-//                 {
-//                     at_result_data.result = AT_NO_CLIENT_IDLE;
-//                     ESP_LOGE(TAG, "HTTP 客户端实例无空闲客户端");
-//                 }
-//                 else
-//                 {
-//                     at_result_data.result = AT_FAIL;
-//                 }
-//             }
-//             else
-//             {
-//                 ESP_LOGI(TAG, "HTTP 客户端实例创建失败");
-//                 at_result_data.result = AT_FAIL;
-//             }
-//         }
-//         break;
-//     }
-//     case CMD_HTTP_HEADER:
-//     {
-//         if (strstr(data, "OK\r\n"))
-//         {
-//             ESP_LOGI(TAG, "CMD_HTTP_HEADER 配置完成");
-//             at_result_data.result = AT_OK;
-//         }
-//         else
-//         {
-//             ESP_LOGI(TAG, "CMD_HTTP_HEADER 配置失败");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_HTTP_SSL:
-//     {
-//         if (strstr(data, "OK\r\n"))
-//         {
-//             ESP_LOGI(TAG, "HTTP SSL配置完成");
-//             at_result_data.result = AT_OK;
-//         }
-//         else
-//         {
-//             ESP_LOGI(TAG, "HTTP SSL配置失败");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_HTTP_ENCODING:
-//     {
-//         if (strstr(data, "OK\r\n"))
-//         {
-//             ESP_LOGI(TAG, "CMD_HTTP_ENCODING 配置完成");
-//             at_result_data.result = AT_OK;
-//         }
-//         else
-//         {
-//             ESP_LOGI(TAG, "CMD_HTTP_ENCODING 配置失败");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_HTTP_TIMEOUT:
-//     {
-//         if (strstr(data, "OK\r\n"))
-//         {
-//             ESP_LOGI(TAG, "CMD_HTTP_TIMEOUT 配置完成");
-//             at_result_data.result = AT_OK;
-//         }
-//         else
-//         {
-//             ESP_LOGI(TAG, "CMD_HTTP_TIMEOUT 配置失败");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_HTTP_FRAGMENT:
-//     {
-//         if (strstr(data, "OK\r\n"))
-//         {
-//             ESP_LOGI(TAG, "CMD_HTTP_FRAGMENT 配置完成");
-//             at_result_data.result = AT_OK;
-//         }
-//         else
-//         {
-//             ESP_LOGI(TAG, "CMD_HTTP_FRAGMENT 配置失败");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_HTTP_BODY:
-//     {
-//         if (strstr(data, "OK\r\n"))
-//         {
-//             ESP_LOGI(TAG, "CMD_HTTP_BODY 配置完成");
-//             at_result_data.result = AT_OK;
-//         }
-//         else
-//         {
-//             ESP_LOGI(TAG, "CMD_HTTP_BODY 配置失败");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_HTTP_REQUEST:
-//     {
-//         char *pt = strstr(data, "+MHTTPURC: \"content\"");
-//         if (pt)
-//         {
-//             pt += strlen("+MHTTPURC: \"content\"");
-//             // int pt_len = strlen(pt); // 计算数据长度
-//             ESP_LOGI(TAG, "CMD_HTTP_REQUEST 指令 HTTP请求成功");
-
-//             // 格式: +MHTTPURC: "content",<httpid>,<content_len>,<sum_len>,<cur_len>,<data>
-//             int httpid = 0, content_len = 0, sum_len = 0, cur_len = 0;
-//             int offset = 0;
-//             // 修正: 解析格式，跳过前缀后应该匹配逗号和四个数字
-//             if (sscanf(pt, ",%d,%d,%d,%d,%n", &httpid, &content_len, &sum_len, &cur_len, &offset) == 4)
-//             {
-//                 if (offset > 0 && offset < strlen(pt))
-//                 {
-//                     // 计算数据起始位置并安全地复制数据
-//                     const char *data_ptr = pt + offset;
-//                     size_t data_len = strlen(data_ptr);
-
-//                     if (at_result_data.data != NULL && at_result_data.data_len > 0)
-//                     {
-//                         size_t copy_len = (data_len < at_result_data.data_len - 1) ? data_len : (at_result_data.data_len - 1);
-
-//                         strncpy((char *)at_result_data.data, data_ptr, copy_len);
-//                         ((char *)at_result_data.data)[copy_len] = '\0'; // 添加字符串终止符
-
-//                         ESP_LOGI(TAG, "提取的HTTP数据: %s", (char *)at_result_data.data);
-//                         at_result_data.result = AT_OK;
-//                     }
-//                     else
-//                     {
-//                         ESP_LOGE(TAG, "HTTP数据缓冲区无效");
-//                         at_result_data.result = AT_FAIL;
-//                     }
-//                 }
-//                 else
-//                 {
-//                     ESP_LOGE(TAG, "HTTP数据偏移量无效: %d", offset);
-//                     at_result_data.result = AT_FAIL;
-//                 }
-//             }
-//             else
-//             {
-//                 ESP_LOGE(TAG, "字符串格式不正确，无法解析HTTP数据: [%s]", pt);
-//                 at_result_data.result = AT_FAIL;
-//             }
+/**
+ * @brief 处理函数在解析一行时调用：声明紧随该行之后有 n 字节内容（如 +MHTTPURC 分包的剩余数据），
+ * 行切分器随后按字节数原样透传，内容中的空行、">"、"OK" 等都不会被当作应答
+ * @param n 字节数
+ */
+void u4g_uart_recv_raw(size_t n)
+{
+    recv_raw = n;
+    raw_chan = recv_chan;
+    raw_cmd = recv_chan < U4G_AT_CHAN_NUM ? u4g_at_cmd_handle[recv_chan].cmd_content : NULL;
+}
 
-//             // // 使用 sscanf 解析固定格式的字符串，%n 用于获取剩余字符串的位置
-//             // int offset = 0;
-//             // // 修正sscanf格式，因为已经跳过了前缀
-//             // if (sscanf(pt, ",%d,%d,%d,%d,%n", &httpid, &content_len, &sum_len, &cur_len, &offset) != 4)
-//             // {
-//             //     ESP_LOGE(TAG, "字符串格式不正确，无法解析 HTTP data");
-//             //     at_result_data.result = AT_FAIL;
-//             //     break;
-//             // }
+/**
+ * @brief 行回调在交付一行后调用，取出处理函数声明的透传字节数（只在接收解析任务中使用）
+ * @return 透传字节数，0 表示继续按行切分
+ */
+size_t u4g_uart_recv_raw_take(void)
+{
+    size_t n = recv_raw;
+    recv_raw = 0;
+    return n;
+}
 
-//             // // 计算数据起始位置并复制数据
-//             // const char *data_ptr = pt + offset;
-//             // size_t data_len = strlen(data_ptr);
-//             // size_t copy_len = (data_len < at_result_data.data_len - 1) ? data_len : (at_result_data.data_len - 1);
-//             // strncpy((char *)at_result_data.data, data_ptr, copy_len);
-//             // ((char *)at_result_data.data)[copy_len] = '\0'; // 手动添加字符串终止符
+/**
+ * @brief 处理透传的内容数据：不做前缀匹配与URC分发，直接交给声明它的指令的处理函数
+ * @param data 内容数据（以'\0'结尾）
+ * @param size 数据长度
+ */
+emU4GResult u4g_uart_recv_content(char *data, uint32_t size)
+{
+    u4g_at_cmd_handle_t *h = raw_chan < U4G_AT_CHAN_NUM ? &u4g_at_cmd_handle[raw_chan] : NULL;
+    if (h == NULL || h->cmd_content == NULL || h->cmd_content != raw_cmd)
+    {
+        ESP_LOGW(TAG, "内容数据所属指令已结束，丢弃%ld字节", size);
+        return 0;
+    }
+    const u4g_at_desc_t *desc = u4g_at_desc_get(raw_cmd->name);
+    if (desc == NULL)
+    {
+        return 0;
+    }
+    recv_chan = raw_chan;
+    u4g_at_rsp_handler_t handler = raw_cmd->handler ? raw_cmd->handler : desc->handler;
+    emU4GResult result = rsp_dispatch(h, desc, handler, data);
+    if (result == U4G_STATE_AT_RSP_WAITING)
+    {
+        return U4G_STATE_AT_RSP_WAITING;
+    }
+    u4g_at_cmd_finish(raw_chan, result);
+    return result;
+}
 
-//             // ESP_LOGI(TAG, "提取的data: %s", (char *)at_result_data.data);
-//             // at_result_data.result = AT_OK;
-//         }
-//         else if (strstr(data, "+MHTTPURC: \"err\"") || strstr(data, "+CME ERROR:"))
-//         {
-//             ESP_LOGE(TAG, "HTTP请求处理错误响应: %s", data);
-//             at_result_data.result = AT_FAIL;
-//         }
-//         else
-//         {
-//             ESP_LOGI(TAG, "HTTP请求未知数据，内容: %s", data);
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     case CMD_HTTP_DELETE:
-//     {
-//         if (strstr(data, "OK\r\n"))
-//         {
-//             ESP_LOGI(TAG, "CMD_HTTP_DELETE 配置完成");
-//             at_result_data.result = AT_OK;
-//         }
-//         else
-//         {
-//             ESP_LOGI(TAG, "CMD_HTTP_DELETE 配置失败");
-//             at_result_data.result = AT_FAIL;
-//         }
-//         break;
-//     }
-//     default:
-//         ESP_LOGW(TAG, "默认的命令类型: %d", at_cmd_current->cmdName);
-//         break;
-//     }
-//     return result;
-// }
\ No newline at end of file
+/**
+ * @brief 是否有指令正在等待">"数据输入提示符，供行切分器判断行首的">"
+ * @param chan 行来源通道，U4G_AT_CHAN_ANY 时检查全部通道
+ */
+bool u4g_uart_recv_prompt_wait(uint8_t chan)
+{
+    for (uint8_t i = 0; i < U4G_AT_CHAN_NUM; i++)
+    {
+        const u4g_at_cmd_t *cmd = u4g_at_cmd_handle[i].cmd_content;
+        const u4g_at_desc_t *desc = cmd ? u4g_at_desc_get(cmd->name) : NULL;
+        if ((chan == U4G_AT_CHAN_ANY || chan == i) && desc && desc->prompt)
+        {
+            return true;
+        }
+    }
+    return false;
+}
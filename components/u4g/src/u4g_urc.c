@@ -0,0 +1,154 @@
+#include "u4g_urc.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TAG "U4G-URC"
+
+/**
+ * URC订阅项
+ */
+typedef struct
+{
+    const char *prefix; // 行前缀
+    size_t prefix_len;  // 前缀长度
+    u4g_urc_cb_t cb;    // 回调
+    void *arg;          // 用户参数
+} u4g_urc_sub_t;
+
+static u4g_urc_sub_t urc_sub[U4G_URC_SUB_MAX];
+static uint8_t urc_sub_count = 0;
+static portMUX_TYPE urc_lock = portMUX_INITIALIZER_UNLOCKED;
+static QueueHandle_t urc_queue = NULL; // 元素为 char*，由分发任务释放
+static TaskHandle_t urc_task_handle = NULL;
+
+/**
+ * @brief 查找与行匹配的订阅
+ * @param start 起始下标
+ * @return 订阅下标，未找到返回 -1
+ */
+static int urc_find(const char *line, size_t len, int start)
+{
+    for (int i = start; i < urc_sub_count; i++)
+    {
+        if (len >= urc_sub[i].prefix_len && strncmp(line, urc_sub[i].prefix, urc_sub[i].prefix_len) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// URC分发任务：依次调用所有匹配的订阅回调
+static void urc_task(void *pvParameters)
+{
+    char *line = NULL;
+    while (1)
+    {
+        if (xQueueReceive(urc_queue, &line, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+        size_t len = strlen(line);
+        for (int i = urc_find(line, len, 0); i >= 0; i = urc_find(line, len, i + 1))
+        {
+            urc_sub[i].cb(line, urc_sub[i].arg);
+        }
+        free(line);
+    }
+}
+
+/**
+ * @brief 初始化URC分发，需在串口接收任务启动前调用
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_urc_init(void)
+{
+    if (urc_queue)
+    {
+        return U4G_OK;
+    }
+    urc_queue = xQueueCreate(U4G_URC_QUEUE_LEN, sizeof(char *));
+    if (urc_queue == NULL)
+    {
+        ESP_LOGE(TAG, "URC队列创建失败");
+        return U4G_FAIL;
+    }
+    if (xTaskCreate(urc_task, "u4g_urc_task", U4G_URC_TASK_STACK, NULL, U4G_URC_TASK_PRIO, &urc_task_handle) != pdPASS)
+    {
+        ESP_LOGE(TAG, "创建 u4g_urc_task 失败");
+        vQueueDelete(urc_queue);
+        urc_queue = NULL;
+        return U4G_FAIL;
+    }
+    return U4G_OK;
+}
+
+/**
+ * @brief 按前缀订阅URC，同一前缀可以有多个订阅者
+ * @param prefix 行前缀，需为静态字符串
+ * @param cb 回调
+ * @param arg 用户参数
+ * @return emU4GResult 成功返回U4G_OK
+ */
+emU4GResult u4g_urc_subscribe(const char *prefix, u4g_urc_cb_t cb, void *arg)
+{
+    if (prefix == NULL || prefix[0] == '\0' || cb == NULL)
+    {
+        return U4G_ERR_INVALID_ARG;
+    }
+    emU4GResult ret = U4G_OK;
+    portENTER_CRITICAL(&urc_lock);
+    if (urc_sub_count >= U4G_URC_SUB_MAX)
+    {
+        ret = U4G_FAIL;
+    }
+    else
+    {
+        u4g_urc_sub_t *sub = &urc_sub[urc_sub_count];
+        sub->prefix = prefix;
+        sub->prefix_len = strlen(prefix);
+        sub->cb = cb;
+        sub->arg = arg;
+        urc_sub_count++; // 填好后再计数，接收侧不会看到半成品
+    }
+    portEXIT_CRITICAL(&urc_lock);
+    if (ret != U4G_OK)
+    {
+        ESP_LOGE(TAG, "URC订阅数量超过上限: %s", prefix);
+        return ret;
+    }
+    ESP_LOGI(TAG, "订阅URC: %s", prefix);
+    return U4G_OK;
+}
+
+/**
+ * @brief 接收侧提交一行数据，有订阅者时复制入队并返回true
+ * @param line 行数据
+ * @param len 行长度
+ * @return 已作为URC处理返回true
+ */
+bool u4g_urc_dispatch(const char *line, size_t len)
+{
+    if (urc_queue == NULL || urc_find(line, len, 0) < 0)
+    {
+        return false;
+    }
+    char *copy = malloc(len + 1);
+    if (copy == NULL)
+    {
+        ESP_LOGE(TAG, "URC内存分配失败，丢弃: %.*s", (int)len, line);
+        return true;
+    }
+    memcpy(copy, line, len);
+    copy[len] = '\0';
+    if (xQueueSend(urc_queue, &copy, 0) != pdTRUE)
+    {
+        ESP_LOGW(TAG, "URC队列已满，丢弃: %.*s", (int)len, line);
+        free(copy);
+    }
+    return true;
+}
@@ -0,0 +1,178 @@
+#include "a_boot.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TAG "A_BOOT" // 日志标签
+
+typedef struct
+{
+    int64_t ready_us; // 依赖完成、开始执行的时间
+    int64_t done_us;  // 执行结束时间
+    esp_err_t ret;    // 执行结果
+} boot_record_t;
+
+typedef struct
+{
+    const char *name;
+    int64_t us;
+} boot_mark_t;
+
+static const a_boot_step_t *boot_steps = NULL;
+static boot_record_t boot_record[A_BOOT_STEP_MAX];
+static EventGroupHandle_t boot_event = NULL; // 第 i 位：第 i 个步骤成功完成
+static TaskHandle_t boot_waiter = NULL;      // 等待全部步骤的任务
+static boot_mark_t boot_mark[A_BOOT_MARK_MAX];
+static uint8_t boot_mark_count = 0;
+static portMUX_TYPE boot_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 步骤执行任务：等待依赖全部成功后执行；有依赖失败时 a_boot_run 已返回错误，本任务一直等待不会执行
+static void boot_step_task(void *arg)
+{
+    size_t i = (size_t)arg;
+    const a_boot_step_t *step = &boot_steps[i];
+    if (step->deps)
+    {
+        xEventGroupWaitBits(boot_event, step->deps, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+    boot_record[i].ready_us = esp_timer_get_time();
+    boot_record[i].ret = step->fn();
+    boot_record[i].done_us = esp_timer_get_time();
+    if (boot_record[i].ret == ESP_OK)
+    {
+        xEventGroupSetBits(boot_event, A_BOOT_DEP(i));
+    }
+    else
+    {
+        ESP_LOGE(TAG, "启动步骤[%s]失败: %s", step->name, esp_err_to_name(boot_record[i].ret));
+    }
+    xTaskNotifyGive(boot_waiter);
+    vTaskDelete(NULL);
+}
+
+// 输出启动时间线：各步骤的就绪、结束时间（从系统启动起算）及耗时
+static void boot_timeline_log(size_t count, int64_t begin_us)
+{
+    ESP_LOGI(TAG, "┌───────────── 启动时间线(ms) ─────────────┐");
+    for (size_t i = 0; i < count; i++)
+    {
+        const boot_record_t *rec = &boot_record[i];
+        if (rec->done_us == 0)
+        {
+            ESP_LOGI(TAG, "│ %-10s 未执行", boot_steps[i].name);
+            continue;
+        }
+        ESP_LOGI(TAG, "│ %-10s %6lld -> %6lld  耗时%6lld  等待依赖%6lld %s",
+                 boot_steps[i].name, rec->ready_us / 1000, rec->done_us / 1000,
+                 (rec->done_us - rec->ready_us) / 1000, (rec->ready_us - begin_us) / 1000,
+                 rec->ret == ESP_OK ? "" : "失败");
+    }
+    ESP_LOGI(TAG, "└─ 编排开始 %lld ms，全部完成 %lld ms ─┘", begin_us / 1000, esp_timer_get_time() / 1000);
+}
+
+/**
+ * @brief 按依赖关系并行执行启动步骤，全部完成或出错后输出时间线
+ * 步骤只能依赖排在它前面的步骤，保证不会出现循环依赖
+ * @param steps 步骤表，需在启动期间保持有效
+ * @param count 步骤数量
+ * @param timeout_ms 全部完成的最长等待时间
+ * @return ESP_OK 全部成功；任一步骤失败或超时返回错误（未执行的步骤不会再执行）
+ */
+esp_err_t a_boot_run(const a_boot_step_t *steps, size_t count, uint32_t timeout_ms)
+{
+    if (steps == NULL || count == 0 || count > A_BOOT_STEP_MAX || boot_steps != NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (steps[i].fn == NULL || (steps[i].deps & ~(A_BOOT_DEP(i) - 1)))
+        {
+            ESP_LOGE(TAG, "启动步骤[%s]无效：只能依赖前面的步骤", steps[i].name);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    boot_event = xEventGroupCreate();
+    if (boot_event == NULL)
+    {
+        ESP_LOGE(TAG, "启动事件组创建失败");
+        return ESP_ERR_NO_MEM;
+    }
+    boot_steps = steps;
+    boot_waiter = xTaskGetCurrentTaskHandle();
+    memset(boot_record, 0, sizeof(boot_record));
+    int64_t begin_us = esp_timer_get_time();
+
+    esp_err_t ret = ESP_OK;
+    size_t started = 0;
+    for (; started < count; started++)
+    {
+        char name[configMAX_TASK_NAME_LEN];
+        snprintf(name, sizeof(name), "boot_%s", steps[started].name);
+        if (xTaskCreate(boot_step_task, name, steps[started].stack ? steps[started].stack : A_BOOT_TASK_STACK,
+                        (void *)started, A_BOOT_TASK_PRIO, NULL) != pdPASS)
+        {
+            ESP_LOGE(TAG, "创建启动步骤[%s]任务失败", steps[started].name);
+            ret = ESP_ERR_NO_MEM;
+            break;
+        }
+    }
+
+    // 每个步骤结束通知一次，出现失败即停止等待
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
+    for (size_t done = 0; ret == ESP_OK && done < started; done++)
+    {
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(deadline - now) <= 0 || ulTaskNotifyTake(pdFALSE, deadline - now) == 0)
+        {
+            ESP_LOGE(TAG, "启动超时(%lums)", timeout_ms);
+            ret = ESP_ERR_TIMEOUT;
+            break;
+        }
+        for (size_t i = 0; i < started; i++)
+        {
+            if (boot_record[i].done_us && boot_record[i].ret != ESP_OK)
+            {
+                ret = boot_record[i].ret;
+                break;
+            }
+        }
+    }
+    boot_timeline_log(count, begin_us);
+    return ret;
+}
+
+/**
+ * @brief 记录启动里程碑（如首次制水、首次上报），同名只记录第一次
+ * @param name 里程碑名称，需为常量字符串
+ */
+void a_boot_mark(const char *name)
+{
+    int64_t now = esp_timer_get_time();
+    bool added = false;
+    portENTER_CRITICAL(&boot_lock);
+    uint8_t i = 0;
+    for (; i < boot_mark_count; i++)
+    {
+        if (strcmp(boot_mark[i].name, name) == 0)
+        {
+            break;
+        }
+    }
+    if (i == boot_mark_count && i < A_BOOT_MARK_MAX)
+    {
+        boot_mark[i].name = name;
+        boot_mark[i].us = now;
+        boot_mark_count++;
+        added = true;
+    }
+    portEXIT_CRITICAL(&boot_lock);
+    if (added)
+    {
+        ESP_LOGI(TAG, "启动里程碑[%s]: %lld ms", name, now / 1000);
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef _A_BOOT_H_
+#define _A_BOOT_H_
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define A_BOOT_STEP_MAX 16     // 启动步骤数量上限
+#define A_BOOT_MARK_MAX 8      // 启动里程碑数量上限
+#define A_BOOT_TASK_PRIO 5     // 步骤执行任务优先级
+#define A_BOOT_TASK_STACK 4096 // 步骤执行任务默认栈大小
+
+#define A_BOOT_DEP(i) (1UL << (i)) // 依赖第 i 个步骤
+
+/**
+ * @brief 启动步骤：依赖全部完成后在独立任务中执行，互不依赖的步骤并行
+ */
+typedef struct
+{
+    const char *name;          // 步骤名称（时间线日志）
+    esp_err_t (*fn)(void);     // 初始化函数
+    uint32_t deps;             // 依赖的步骤，A_BOOT_DEP(下标) 按位或
+    uint32_t stack;            // 执行任务栈大小，0 使用 A_BOOT_TASK_STACK
+} a_boot_step_t;
+
+esp_err_t a_boot_run(const a_boot_step_t *steps, size_t count, uint32_t timeout_ms);
+void a_boot_mark(const char *name);
+
+#endif
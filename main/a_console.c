@@ -0,0 +1,241 @@
+#include "a_console.h"
+#include "u4g_trace.h"
+#include "u4g_json.h"   // 解析器自检
+#include "u4g_at_http.h" // 响应体长度上限
+#include "u4g_segbuf.h"  // 大响应体分段缓冲区自检
+#include "a_feedback.h" // 上报编码基准测试、离线记录上传自检
+#include "esp_console.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TAG "A_CONSOLE" // 日志标签
+
+// trace dump|clear|on|off：导出/清空/启停AT收发轨迹
+static int cmd_trace(int argc, char **argv)
+{
+    if (argc < 2 || strcmp(argv[1], "dump") == 0)
+    {
+        u4g_trace_dump();
+    }
+    else if (strcmp(argv[1], "clear") == 0)
+    {
+        u4g_trace_clear();
+    }
+    else if (strcmp(argv[1], "on") == 0 || strcmp(argv[1], "off") == 0)
+    {
+        u4g_trace_enable(strcmp(argv[1], "on") == 0);
+    }
+    else
+    {
+        printf("用法: trace [dump|clear|on|off]\n");
+        return 1;
+    }
+    return 0;
+}
+
+// bench [次数]：对比上报内容的 JSON 与 CBOR 编码
+static int cmd_bench(int argc, char **argv)
+{
+    uint32_t rounds = argc < 2 ? 1000 : strtoul(argv[1], NULL, 10);
+    a_feedback_bench(rounds);
+    return 0;
+}
+
+// JSON 自检的关注字段
+static const u4g_json_field_t selftest_fields[] = {
+    {"code", U4G_JSON_NUMBER},
+    {"data.flush.power_on", U4G_JSON_NUMBER},
+    {"data.name", U4G_JSON_STRING},
+};
+
+typedef struct
+{
+    uint32_t found; // 解析到的字段位
+    int32_t power_on;
+} selftest_json_t;
+
+static void selftest_field(const char *path, u4g_json_type_t type, const char *value, void *arg)
+{
+    selftest_json_t *r = arg;
+    int f = u4g_json_field_find(selftest_fields, sizeof(selftest_fields) / sizeof(selftest_fields[0]), path, type);
+    if (f >= 0)
+    {
+        r->found |= 1UL << f;
+        if (f == 1)
+        {
+            r->power_on = atoi(value);
+        }
+    }
+}
+
+/**
+ * @brief 按小段输入解析一段JSON
+ * @return 解析成功返回 true
+ */
+static bool selftest_json_parse(const char *text, selftest_json_t *r)
+{
+    u4g_json_t json;
+    memset(r, 0, sizeof(*r));
+    u4g_json_init(&json, selftest_field, r);
+    u4g_json_watch(&json, selftest_fields, sizeof(selftest_fields) / sizeof(selftest_fields[0]));
+    size_t len = strlen(text);
+    for (size_t i = 0; i < len; i += 7)
+    {
+        if (u4g_json_feed(&json, text + i, len - i < 7 ? len - i : 7) != U4G_OK)
+        {
+            return false;
+        }
+    }
+    return u4g_json_finish(&json) == U4G_OK;
+}
+
+/**
+ * @brief JSON 解析器自检：未关注的超长字符串/数值、超长路径、过深嵌套应跳过，关注字段照常解析；
+ *        关注字段超长应报错
+ * @return 通过返回 true
+ */
+static bool selftest_json(void)
+{
+    char *text = malloc(1024);
+    if (!text)
+    {
+        return false;
+    }
+    char big[U4G_JSON_TOKEN_MAX * 2];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    char num[U4G_JSON_TOKEN_MAX + 16];
+    memset(num, '9', sizeof(num) - 1);
+    num[sizeof(num) - 1] = '\0';
+    const char *deep = "{\"a\":{\"b\":{\"c\":{\"d\":{\"e\":{\"f\":{\"g\":{\"h\":{\"i\":[1,[2,{\"j\":3}]]}}}}}}}}}";
+    const char *long_key = "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz";
+    selftest_json_t r;
+    bool ok = true;
+
+    // 未关注的超长内容与关注字段混在一起
+    snprintf(text, 1024, "{\"note\":\"%s\",\"big\":%s,\"data\":{\"%s\":{\"x\":[1,2]},\"%s\":\"v\",\"deep\":%s,"
+                         "\"flush\":{\"power_on\":15}},\"code\":200}",
+             big, num, long_key, big, deep);
+    bool pass = selftest_json_parse(text, &r) && r.found == 0x3 && r.power_on == 15;
+    printf("json 跳过未关注的超长字段: %s\n", pass ? "通过" : "失败");
+    ok &= pass;
+
+    // 关注字段超长：报错
+    snprintf(text, 1024, "{\"code\":200,\"data\":{\"name\":\"%s\"}}", big);
+    pass = !selftest_json_parse(text, &r);
+    printf("json 关注字段超长报错: %s\n", pass ? "通过" : "失败");
+    ok &= pass;
+
+    free(text);
+    return ok;
+}
+
+// 响应体自检的内容：可打印字符，周期与分段大小互质，错位能被发现
+static char selftest_body_byte(size_t i)
+{
+    return (char)('a' + (i + i / 4093) % 26);
+}
+
+/**
+ * @brief 大响应体自检：经HTTP默认接收器的回调把 U4G_HTTP_BODY_MAX 字节按不等长的分包写入分段缓冲区，
+ *        核对总长度、跨分段读取与拼接后的内容，超出上限的追加应失败
+ * @return 通过返回 true
+ */
+static bool selftest_segbuf(void)
+{
+    u4g_segbuf_t sb;
+    char chunk[512];
+    u4g_segbuf_init(&sb, U4G_HTTP_BODY_MAX);
+    bool ok = u4g_segbuf_sink_begin(&sb) == U4G_OK;
+    size_t pos = 0;
+    while (ok && pos < U4G_HTTP_BODY_MAX)
+    {
+        // 分包长度不等，分包边界落在分段内的不同位置
+        size_t n = sizeof(chunk) - pos % 61;
+        if (n > U4G_HTTP_BODY_MAX - pos)
+        {
+            n = U4G_HTTP_BODY_MAX - pos;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            chunk[i] = selftest_body_byte(pos + i);
+        }
+        ok = u4g_segbuf_sink_write(chunk, n, &sb) == U4G_OK;
+        pos += n;
+    }
+    ok = ok && sb.len == U4G_HTTP_BODY_MAX;
+    // 跨分段边界读取
+    for (size_t off = U4G_SEGBUF_SEG_SIZE - 8; ok && off + 16 <= sb.len; off += U4G_SEGBUF_SEG_SIZE * 5 + 3)
+    {
+        char out[16];
+        ok = u4g_segbuf_copy(&sb, off, out, sizeof(out)) == sizeof(out);
+        for (size_t i = 0; ok && i < sizeof(out); i++)
+        {
+            ok = out[i] == selftest_body_byte(off + i);
+        }
+    }
+    // 已达上限，再追加应失败且不改变内容
+    ok = ok && u4g_segbuf_append(&sb, "x", 1) == U4G_ERR_INVALID_SIZE && sb.len == U4G_HTTP_BODY_MAX;
+    const char *flat = ok ? u4g_segbuf_flatten(&sb) : NULL;
+    ok = flat != NULL && flat[U4G_HTTP_BODY_MAX] == '\0';
+    for (size_t i = 0; ok && i < U4G_HTTP_BODY_MAX; i++)
+    {
+        ok = flat[i] == selftest_body_byte(i);
+    }
+    printf("segbuf %d字节响应体: %s\n", U4G_HTTP_BODY_MAX, ok ? "通过" : "失败");
+    u4g_segbuf_free(&sb);
+    return ok;
+}
+
+// selftest：解析/编码路径自检
+static int cmd_selftest(int argc, char **argv)
+{
+    bool ok = selftest_json();
+    ok &= selftest_segbuf();
+    bool pass = a_feedback_journal_check();
+    printf("离线记录分批上传: %s\n", pass ? "通过" : "失败");
+    ok &= pass;
+    printf("自检%s\n", ok ? "通过" : "失败");
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief 在调试串口(UART0)上启动命令行，注册调试命令
+ * @return ESP_OK 成功；失败不影响设备运行
+ */
+esp_err_t a_console_init(void)
+{
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = A_CONSOLE_PROMPT;
+    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    esp_err_t ret = esp_console_new_repl_uart(&uart_config, &repl_config, &repl);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "创建控制台失败: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    const esp_console_cmd_t trace = {
+        .command = "trace",
+        .help = "AT收发轨迹: dump 以base64导出(用 tools/u4g_trace_decode.py 解析) | clear 清空 | on/off 启停记录",
+        .hint = "[dump|clear|on|off]",
+        .func = cmd_trace,
+    };
+    esp_console_cmd_register(&trace);
+    const esp_console_cmd_t bench = {
+        .command = "bench",
+        .help = "上报内容编码基准: JSON 与 CBOR 的平均耗时、编码长度与堆分配，默认1000次",
+        .hint = "[次数]",
+        .func = cmd_bench,
+    };
+    esp_console_cmd_register(&bench);
+    const esp_console_cmd_t selftest = {
+        .command = "selftest",
+        .help = "解析/编码路径自检: JSON 解析器跳过未关注的超长字段；256KB 响应体经分段缓冲区接收；离线记录整批按实际格式编码不超过模块长度限制",
+        .func = cmd_selftest,
+    };
+    esp_console_cmd_register(&selftest);
+    esp_console_register_help_command();
+    return esp_console_start_repl(repl);
+}
@@ -0,0 +1,10 @@
+#ifndef _A_CONSOLE_H_
+#define _A_CONSOLE_H_
+
+#include "esp_err.h"
+
+#define A_CONSOLE_PROMPT "water> " // 控制台提示符
+
+esp_err_t a_console_init(void);
+
+#endif
@@ -2,34 +2,137 @@
 #include "a_network.h"  // 网络工作类
 #include "head.h"
 #include "u4g_at_http.h"
+#include "u4g_at_sched.h"
+#include "u4g_supervisor.h"
 #include "u4g_data.h"
 #include "u4g_at_cmd.h"
+#include "u4g_json.h"
+#include "u4g_cbor.h"
+#include "u4g_mqtt.h"
+#include "a_feedback_bin.h" // 二进制上报
+#include "a_journal.h"      // 离线上报日志
 #include "a_nvs_flash.h" // nvs_flash应用类
 #include "a_service.h"   // 应用服务类
 #include "a_led_event.h"
+#include "a_boot.h" // 启动里程碑
 #include "gpio_water.h"
 #include "gpio_flush.h"
+#include "gpio_flowmeter.h"
+#include "gpio_water_timer.h"
 #include "freertos/timers.h"
+#include "freertos/semphr.h"
 #include "cJSON.h"
 #include "esp_log.h"
 #include "esp_task_wdt.h" // 包含看门狗相关库
+#include <math.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #define TAG "A_FEEDBACK" // 日志标签
 
 #define DEBUG 0
 
+// 合并上报：POST 路径带上该参数，支持的服务器在 POST 响应的 data 中返回设备配置（与 GET 响应相同），
+// 一次请求完成上报与配置同步；响应不含 data 时补发 GET，并在之后若干轮内直接使用 POST+GET
+#define FEEDBACK_COMBINED_QUERY "?config=1"
+#define FEEDBACK_COMBINED_RETRY 24 // 服务器不支持合并上报时，间隔多少轮重新尝试
+
 TaskHandle_t xTaskHandle_feedback = NULL; // 通知执行get和post
 // xTaskNotifyGive(xTaskHandle_net); // 触发通知设备反馈
 static TimerHandle_t timer_feedback = NULL;
+static uint8_t combined_skip = 0; // 剩余多少轮不尝试合并上报（上报任务递减，HTTP执行任务回调中重置）
+static portMUX_TYPE combined_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t config_lock = NULL; // 应用配置互斥（HTTP执行任务与推送回调）
+static volatile bool reporting = false; // 联网初始化已完成，之前只记录离线日志
+static bool journal_draining = false; // 离线日志正在分批上传（上报任务与HTTP执行任务都会发起，journal_lock 保护）
+static portMUX_TYPE journal_lock = portMUX_INITIALIZER_UNLOCKED;
+#if U4G_MQTT_ENABLE
+static bool mqtt_started = false;
+#endif
+#if A_FEEDBACK_BIN_ENABLE
+static bool bin_started = false;
+#endif
+
+// 上报字段，枚举值即 report_t.fields 中的位
+enum
+{
+    REPORT_TOTAL_WATER_TIME,
+    REPORT_WATER_LEAK,
+    REPORT_TDS_RAW,
+    REPORT_TDS_PURE,
+    REPORT_TEMP_RAW,
+    REPORT_TEMP_PURE,
+    REPORT_FLOWMETER,
+    REPORT_EXPIRE_TIME,
+    REPORT_SIGNAL,
+    REPORT_FIELD_NUM,
+};
+#define REPORT_BIT(f) (1UL << (f))
+#define REPORT_ALL (REPORT_BIT(REPORT_FIELD_NUM) - 1)
+
+// 上报是否携带序号 seq：增量上报需要；MQTT发布等不到确认时本轮改用HTTP重发同一上报，服务器按 seq 去重
+#define REPORT_SEQ (FEEDBACK_DELTA || U4G_MQTT_ENABLE)
+
+// 一次上报：生成时的设备数据快照，fields 为实际发送的字段
+typedef struct
+{
+    uint32_t seq;              // 上报序号（REPORT_SEQ 时发送）
+    bool key;                  // 全量上报（关键帧）
+    uint32_t fields;           // 发送的字段位
+    uint64_t total_water_time; // 累计制水时间
+    bool water_leak;           // 漏水
+    uint8_t tds_raw;           // 原水TDS
+    uint8_t tds_pure;          // 纯水TDS
+    float temp_raw;            // 原水温度
+    float temp_pure;           // 纯水温度
+    uint32_t flowmeter;        // 流量计
+    int32_t expire_time;       // 到期时间
+    int8_t signal;             // 信号值
+    uint64_t water_mark;       // 快照的累计制水在开机以来总量中的位置（已扣除 + 快照值），确认时据此扣除
+    uint64_t flow_mark;        // 快照的流量计在开机以来总量中的位置
+} report_t;
 
 static void a_feedback_task(void *pvParameters);
 static bool submit_httpget();
-static bool submit_httppost(char *key);
+static bool report_csq_read(u4g_at_class_t cls, int8_t *csq);
+static void report_snapshot(int8_t csq, report_t *r);
+static void report_delta(report_t *r);
+static void report_base_update(uint32_t seq);
+static char *report_json_encode(const report_t *r);
+static emU4GResult report_cbor_encode(const report_t *r, uint8_t *buf, size_t size, size_t *len);
+static void report_acked(const report_t *r);
+static bool submit_report(const report_t *r, u4g_at_class_t cls, bool combined);
+static bool submit_httppost(const char *body, const u4g_http_fmt_t *fmt, u4g_at_class_t cls, bool combined, uint32_t seq);
+static void httpget_done(u4g_http_handle_t handle, emU4GResult result, const char *data, void *arg);
+static void httppost_done(u4g_http_handle_t handle, emU4GResult result, const char *data, void *arg);
 static void timer_feedback_callback(TimerHandle_t xTimer);
+static void feedback_journal_record(void);
+static void feedback_journal_drain(void);
+static bool submit_journal(void);
+static void journal_done(u4g_http_handle_t handle, emU4GResult result, const char *data, void *arg);
+#if U4G_MQTT_ENABLE
+static bool feedback_mqtt_start(const char *key);
+static bool feedback_mqtt_report(const char *body, const report_t *r);
+#endif
+#if A_FEEDBACK_BIN_ENABLE
+static a_feedback_bin_status_t feedback_bin_config(const int32_t value[A_FEEDBACK_BIN_CFG_MAX], uint32_t found);
+static void feedback_bin_report(u4g_at_class_t cls);
+#endif
 
-esp_err_t a_feedback_init(void)
+// 创建反馈任务与上报定时器（只创建一次）
+static esp_err_t feedback_start(void)
 {
+    if (xTaskHandle_feedback != NULL)
+    {
+        return ESP_OK;
+    }
+    config_lock = xSemaphoreCreateMutex();
+    if (config_lock == NULL)
+    {
+        ESP_LOGE(TAG, "创建配置互斥锁失败");
+        return ESP_FAIL;
+    }
     // 创建事件处理任务
     if (xTaskCreate(a_feedback_task, "a_feedback_task", 6144, NULL, 6, &xTaskHandle_feedback) != pdPASS)
     {
@@ -56,6 +159,30 @@ esp_err_t a_feedback_init(void)
         ESP_LOGE(TAG, "启动定时器失败");
         return ESP_FAIL;
     }
+    return ESP_OK;
+}
+
+/**
+ * @brief 开机未联网时先启动反馈任务，按上报周期记录离线日志，联网初始化完成后由 a_feedback_init 开始上报
+ * @return ESP_OK 成功
+ */
+esp_err_t a_feedback_offline_start(void)
+{
+    return feedback_start();
+}
+
+/**
+ * @brief 联网初始化完成，开始上报（反馈任务未启动时一并启动）
+ * @return ESP_OK 成功
+ */
+esp_err_t a_feedback_init(void)
+{
+    esp_err_t ret = feedback_start();
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    reporting = true;
     DEVICE_STATUS.feedback_init = true;
     return ESP_OK;
 }
@@ -76,6 +203,11 @@ static void a_feedback_task(void *pvParameters)
         if (xTaskNotifyWait(0x00, 0xFFFFFFFF, NULL, portMAX_DELAY) == pdTRUE) // 等待通知
         {
             ESP_LOGI(TAG, "收到反馈通知");
+            if (!reporting || DEVICE.NETSTATE != DEVICE_NETON)
+            {
+                feedback_journal_record(); // 未联网：本周期记入离线日志
+                continue;
+            }
             char *key = a_nvs_flash_get("key"); // 读取设备ID的key秘钥
             if (key == NULL || strlen(key) < 10)
             {
@@ -87,17 +219,76 @@ static void a_feedback_task(void *pvParameters)
 #ifndef DEBUG
             int64_t start_time = esp_timer_get_time(); // 记录开始时间-微秒
 #endif
-            submit_httppost(key);
-#ifndef DEBUG
-            ESP_LOGI(TAG, "handle_at_init-耗时 %.3f 秒", (esp_timer_get_time() - start_time) / 1000000.0); // 计算耗时（秒）
+            // 优先合并上报：POST 响应同时带回设备配置，不支持时在完成回调中补发 GET
+            // 否则 POST 与 GET 依次入队，由HTTP执行任务背靠背发送，结果在完成回调中处理
+            // 漏水时上报按告警等级排队，越过其他任务的AT指令与已排队的普通请求，且不先查询信号值；
+            // 正在执行的HTTP请求不被打断，最坏时延见 u4g_http_submit
+            u4g_at_class_t cls = DEVICE.WATER_LEAK ? U4G_AT_CLASS_ALARM : U4G_AT_CLASS_TELEMETRY;
+            if (cls != U4G_AT_CLASS_ALARM)
+            {
+                feedback_journal_drain(); // 先补传离线期间的记录，排在本轮上报之前
+            }
+#if A_FEEDBACK_BIN_ENABLE
+            // 二进制上报：配置在认证后及变化时由服务器下发，不再轮询
+            if (!bin_started)
+            {
+                bin_started = a_feedback_bin_start(BIN_HOST, BIN_PORT, BIN_UDP, DEVICE.IMEI, key, feedback_bin_config) == ESP_OK;
+            }
+            free(key);
+            feedback_bin_report(cls);
+            if (cls == U4G_AT_CLASS_ALARM)
+            {
+                feedback_journal_drain(); // 告警上报已完成，补传本轮推迟的离线记录
+            }
+#else
+#if U4G_MQTT_ENABLE
+            if (!mqtt_started)
+            {
+                mqtt_started = feedback_mqtt_start(key);
+            }
 #endif
-            // esp_task_wdt_reset();
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            // esp_task_wdt_reset();
-#ifndef DEBUG
-            int64_t start_time = esp_timer_get_time(); // 记录开始时间-微秒
+            free(key);
+            int8_t csq;
+            bool measured = report_csq_read(cls, &csq);
+            report_t report;
+            if (measured)
+            {
+                report_snapshot(csq, &report);
+                report_delta(&report);
+            }
+#if U4G_MQTT_ENABLE
+            // MQTT已连接：上报以 QoS 1 发布，配置由服务器推送，不再轮询；发布失败时本轮改用HTTP
+            if (measured)
+            {
+                char *body = report_json_encode(&report);
+                bool sent = body && feedback_mqtt_report(body, &report);
+                free(body);
+                if (sent)
+                {
+                    if (cls == U4G_AT_CLASS_ALARM)
+                    {
+                        feedback_journal_drain(); // 告警上报已完成，补传本轮推迟的离线记录
+                    }
+                    continue;
+                }
+            }
+#endif
+            portENTER_CRITICAL(&combined_lock);
+            bool combined = combined_skip == 0;
+            if (!combined)
+            {
+                combined_skip--;
+            }
+            portEXIT_CRITICAL(&combined_lock);
+            if (measured)
+            {
+                submit_report(&report, cls, combined);
+            }
+            if (!combined)
+            {
+                submit_httpget();
+            }
 #endif
-            submit_httpget();
 #ifndef DEBUG
             ESP_LOGI(TAG, "handle_at_init-耗时 %.3f 秒", (esp_timer_get_time() - start_time) / 1000000.0); // 计算耗时（秒）
 #endif
@@ -108,81 +299,214 @@ static void a_feedback_task(void *pvParameters)
     }
 }
 
+// 设备信息（GET 响应）中关注的字段
+enum
+{
+    GET_CODE,
+    GET_DATA,
+    GET_CHARGING,
+    GET_EXPIRE_TIME,
+    GET_FILTER_LEVEL,
+    GET_DURATION_S,
+    GET_FLUSH,
+    GET_FLUSH_POWER_ON, // 反冲洗字段按 flush_nvs_key 顺序排列
+    GET_FLUSH_LOW_END,
+    GET_FLUSH_HIGH_START,
+    GET_FLUSH_HIGH_END,
+    GET_FLUSH_WATER_TOTAL,
+    GET_FLUSH_WATER_PROUCTION_TIME,
+    GET_FIELD_NUM,
+};
+static const u4g_json_field_t get_fields[GET_FIELD_NUM] = {
+    [GET_CODE] = {"code", U4G_JSON_NUMBER},
+    [GET_DATA] = {"data", U4G_JSON_OBJECT},
+    [GET_CHARGING] = {"data.charging", U4G_JSON_NUMBER},
+    [GET_EXPIRE_TIME] = {"data.expire_time", U4G_JSON_NUMBER},
+    [GET_FILTER_LEVEL] = {"data.filter_level", U4G_JSON_NUMBER},
+    [GET_DURATION_S] = {"data.duration_s", U4G_JSON_NUMBER},
+    [GET_FLUSH] = {"data.flush", U4G_JSON_OBJECT},
+    [GET_FLUSH_POWER_ON] = {"data.flush.power_on", U4G_JSON_NUMBER},                         // 开机冲洗
+    [GET_FLUSH_LOW_END] = {"data.flush.low_end", U4G_JSON_NUMBER},                           // 低压结束
+    [GET_FLUSH_HIGH_START] = {"data.flush.high_start", U4G_JSON_NUMBER},                     // 高压进入
+    [GET_FLUSH_HIGH_END] = {"data.flush.high_end", U4G_JSON_NUMBER},                         // 高压结束
+    [GET_FLUSH_WATER_TOTAL] = {"data.flush.water_total", U4G_JSON_NUMBER},                   // 累计制水
+    [GET_FLUSH_WATER_PROUCTION_TIME] = {"data.flush.water_prouction_time", U4G_JSON_NUMBER}, // 累计制水冲洗
+};
+static const char *flush_nvs_key[] = {"flush_power_on", "flush_low_end", "flush_hs", "flush_high_end", "flush_wt", "flush_wp"};
+
+/**
+ * 设备配置解析结果：HTTP 响应与推送的配置各用一份，互不干扰
+ */
+typedef struct
+{
+    u4g_json_t json;              // 流式解析器
+    int32_t value[GET_FIELD_NUM]; // 已解析的字段值
+    uint32_t found;               // 已解析到的字段位
+#if HTTP_CBOR
+    u4g_cbor_t cbor; // 服务器以CBOR响应时的解码器，与 json 共用字段回调
+    bool is_cbor;    // 响应格式由首字节判定
+    bool started;    // 已收到首字节
+#endif
+} config_rsp_t;
+#define GET_HAS(r, f) ((r)->found & (1UL << (f)))
+
+#define REPORT_CBOR_MAX 192 // 上报内容CBOR编码缓冲区（栈上）
+#define REPORT_TEMP_X10(t) ((int32_t)lroundf((t) * 10.0f)) // 温度按 0.1℃ 取整（增量比较与离线日志）
+
+static config_rsp_t http_rsp; // GET 响应（及合并上报的 POST 响应），在HTTP执行任务中解析
+#if HTTP_CBOR
+/**
+ * 内容协商：请求声明可接受CBOR，服务器以CBOR响应即表示支持，之后上报改用CBOR；
+ * 以JSON响应（或无法解析）时回到JSON。模块不输出响应头部，按响应内容的首字节判定格式
+ */
+#define HTTP_ACCEPT "application/cbor, application/json"
+static const u4g_http_fmt_t fmt_json = {.accept = HTTP_ACCEPT, .binary = true};
+static const u4g_http_fmt_t fmt_cbor = {.content_type = "application/cbor", .accept = HTTP_ACCEPT, .binary = true};
+static bool cbor_accepted = false; // 服务器支持CBOR
+#endif
+
+// 配置字段回调：边接收边解析，只保留关注的字段
+static void httpget_field(const char *path, u4g_json_type_t type, const char *value, void *arg)
+{
+    config_rsp_t *rsp = arg;
+    int f = u4g_json_field_find(get_fields, GET_FIELD_NUM, path, type);
+    if (f >= 0)
+    {
+        rsp->found |= 1UL << f;
+        rsp->value[f] = value ? atoi(value) : 0;
+    }
+}
+
+static emU4GResult httpget_begin(void *arg)
+{
+    config_rsp_t *rsp = arg;
+    rsp->found = 0;
+    u4g_json_init(&rsp->json, httpget_field, rsp);
+    u4g_json_watch(&rsp->json, get_fields, GET_FIELD_NUM);
+#if HTTP_CBOR
+    u4g_cbor_init(&rsp->cbor, httpget_field, rsp);
+    rsp->started = false;
+#endif
+    return U4G_OK;
+}
+
+// 响应内容写入解析器：JSON 以'{'或空白开始，CBOR 映射的首字节为 0xA0-0xBF
+static emU4GResult httpget_write(const char *data, size_t len, void *arg)
+{
+    config_rsp_t *rsp = arg;
+#if HTTP_CBOR
+    if (!rsp->started && len)
+    {
+        rsp->started = true;
+        rsp->is_cbor = (uint8_t)data[0] >= 0xA0 && (uint8_t)data[0] <= 0xBF;
+    }
+    if (rsp->started && rsp->is_cbor)
+    {
+        return u4g_cbor_feed(&rsp->cbor, (const uint8_t *)data, len);
+    }
+#endif
+    return u4g_json_feed(&rsp->json, data, len);
+}
+
+/**
+ * @brief HTTP响应接收完毕，结束解析；启用CBOR时按响应格式更新协商结果
+ * @return 解析成功返回U4G_OK
+ */
+static emU4GResult http_rsp_finish(void)
+{
+#if HTTP_CBOR
+    if (http_rsp.started && http_rsp.is_cbor)
+    {
+        emU4GResult ret = u4g_cbor_finish(&http_rsp.cbor);
+        if (ret == U4G_OK && !cbor_accepted)
+        {
+            ESP_LOGI(TAG, "服务器支持CBOR，上报改用CBOR");
+        }
+        cbor_accepted = ret == U4G_OK;
+        return ret;
+    }
+    if (cbor_accepted)
+    {
+        ESP_LOGW(TAG, "服务器以JSON响应，上报改回JSON");
+        cbor_accepted = false;
+    }
+#endif
+    return u4g_json_finish(&http_rsp.json);
+}
+
+static u4g_http_sink_t get_sink = {
+    .begin = httpget_begin,
+    .write = httpget_write,
+    .arg = &http_rsp,
+};
+
 // 获取设备信息
 static bool submit_httpget()
 {
     char path[200];
     snprintf(path, sizeof(path), "/api/v1/device/%s/%s", CONFIG_PROJECT_NAME, DEVICE.IMEI);
-    // 发送 HTTP GET 请求
-    emU4GResult ret = u4g_at_http_request(HTTP_URL, path, NULL);
-    // esp_task_wdt_reset();
-    if (ret != U4G_OK)
-    {
-        ESP_LOGE(TAG, "HTTP GET请求失败 错误码: %d", ret);
-        return false;
-    }
-    char *u4g_data = (char *)u4g_data_get()->data;
-    if (u4g_data == NULL)
+    // 提交 HTTP GET 请求，响应直接流入解析器
+    u4g_http_req_t req = {
+        .url = HTTP_URL,
+        .path = path,
+        .sink = &get_sink,
+        .cb = httpget_done,
+        .cls = U4G_AT_CLASS_TELEMETRY,
+#if HTTP_CBOR
+        .fmt = &fmt_json,
+#endif
+    };
+    if (u4g_http_submit(&req) == NULL)
     {
-        ESP_LOGE(TAG, "u4g_data 无数据");
+        ESP_LOGE(TAG, "HTTP GET请求提交失败");
         return false;
     }
+    return true;
+}
 
-    // 解析JSON数据
-    cJSON *root = cJSON_Parse(u4g_data);
-    if (root == NULL)
-    {
-        ESP_LOGE(TAG, "解析JSON数据失败");
-        cJSON_Delete(root);
-        return false; // 直接返回，避免调用 cJSON_Delete
-    }
+// 应用设备信息
+static bool httpget_apply_locked(const config_rsp_t *rsp)
+{
     // 获取"code"字段
-    cJSON *code_item = cJSON_GetObjectItem(root, "code");
-    if (!cJSON_IsNumber(code_item))
+    if (!GET_HAS(rsp, GET_CODE))
     {
         ESP_LOGE(TAG, "code 字段无效");
-        cJSON_Delete(root);
         return false;
     }
-    if (code_item->valueint == 200)
+    if (rsp->value[GET_CODE] == 200)
     {
         ESP_LOGI(TAG, "接收成功数据执行逐步操作");
         // 获取"data"对象
-        cJSON *data_item = cJSON_GetObjectItem(root, "data");
-        if (!cJSON_IsObject(data_item))
+        if (!GET_HAS(rsp, GET_DATA))
         {
             ESP_LOGE(TAG, "data 字段无效");
-            cJSON_Delete(root);
             return false;
         }
 
         // 获取计费模式
-        cJSON *charging_item = cJSON_GetObjectItem(data_item, "charging");
-        if (!cJSON_IsNumber(charging_item))
+        if (!GET_HAS(rsp, GET_CHARGING))
         {
             ESP_LOGE(TAG, "charging 字段无效");
-            cJSON_Delete(root);
             return false;
         }
-        if (charging_item->valueint == 0)
+        if (rsp->value[GET_CHARGING] == 0)
         {
             ESP_LOGI(TAG, "下发 计费模式：永久");
             a_service_expiry_set(0, 0);
         }
-        else if (charging_item->valueint == 1)
+        else if (rsp->value[GET_CHARGING] == 1)
         {
             ESP_LOGI(TAG, "下发 计费模式：计时");
-            cJSON *expire_time_item = cJSON_GetObjectItem(data_item, "expire_time");
-            if (cJSON_IsNumber(expire_time_item))
+            if (GET_HAS(rsp, GET_EXPIRE_TIME))
             {
                 int32_t charging = 0;
                 a_nvs_flash_get_int("charging", &charging);
                 int32_t expire_time = 0;
                 a_nvs_flash_get_int("expire_time", &expire_time); // 到期时间
-                if (charging != charging_item->valueint || expire_time != expire_time_item->valueint)
+                if (charging != rsp->value[GET_CHARGING] || expire_time != rsp->value[GET_EXPIRE_TIME])
                 {
-                    ESP_LOGI(TAG, "[到期时间]从flash获取: %d", expire_time_item->valueint);
-                    a_service_expiry_set(1, expire_time_item->valueint);
+                    ESP_LOGI(TAG, "[到期时间]从flash获取: %ld", rsp->value[GET_EXPIRE_TIME]);
+                    a_service_expiry_set(1, rsp->value[GET_EXPIRE_TIME]);
                 }
                 else
                 {
@@ -197,201 +521,884 @@ static bool submit_httpget()
         }
 
         // 获取滤芯值
-        cJSON *filter_level_item = cJSON_GetObjectItem(data_item, "filter_level");
-        if (cJSON_IsNumber(filter_level_item))
+        if (GET_HAS(rsp, GET_FILTER_LEVEL))
         {
-            ESP_LOGI(TAG, "下发滤芯值：%d", filter_level_item->valueint);
+            ESP_LOGI(TAG, "下发滤芯值：%ld", rsp->value[GET_FILTER_LEVEL]);
             a_led_event_t event;
             event.type = LED_WATER_FILTER_ELEMENT;
-            event.data.led_water_filter_element = filter_level_item->valueint;
+            event.data.led_water_filter_element = rsp->value[GET_FILTER_LEVEL];
             xQueueSend(a_led_event_queue, &event, pdMS_TO_TICKS(100));
         }
         else
         {
             ESP_LOGE(TAG, "filter_level 字段无效");
-            cJSON_Delete(root);
             return false;
         }
 
         // 步长(秒)
-        cJSON *duration_s_item = cJSON_GetObjectItem(data_item, "duration_s");
-        if (cJSON_IsNumber(duration_s_item))
+        if (GET_HAS(rsp, GET_DURATION_S))
         {
-            ESP_LOGI(TAG, "下发步长：%d", duration_s_item->valueint);
-            DEVICE.duration_s = duration_s_item->valueint;
+            ESP_LOGI(TAG, "下发步长：%ld", rsp->value[GET_DURATION_S]);
+            DEVICE.duration_s = rsp->value[GET_DURATION_S];
         }
 
         // 累计制水故障(秒)always_water_time
 
         // 反冲洗flush
-        cJSON *flush_item = cJSON_GetObjectItem(data_item, "flush");
-        if (cJSON_IsObject(flush_item))
+        if (!GET_HAS(rsp, GET_FLUSH))
         {
-            // 开机冲洗
-            cJSON *item_flush_power_on = cJSON_GetObjectItem(flush_item, "power_on");
-            if (cJSON_IsNumber(item_flush_power_on))
-            {
-                a_nvs_flash_insert_int("flush_power_on", item_flush_power_on->valueint);
-            }
-            else
-            {
-                ESP_LOGE(TAG, "power_on 字段无效");
-                cJSON_Delete(root);
-                return false;
-            }
-            // 低压结束
-            cJSON *item_flush_low_end = cJSON_GetObjectItem(flush_item, "low_end");
-            if (cJSON_IsNumber(item_flush_low_end))
-            {
-                a_nvs_flash_insert_int("flush_low_end", item_flush_low_end->valueint);
-            }
-            else
-            {
-                ESP_LOGE(TAG, "low_end 字段无效");
-                cJSON_Delete(root);
-                return false;
-            }
-            // 高压进入
-            cJSON *item_flush_high_start = cJSON_GetObjectItem(flush_item, "high_start");
-            if (cJSON_IsNumber(item_flush_high_start))
-            {
-                a_nvs_flash_insert_int("flush_hs", item_flush_high_start->valueint);
-            }
-            else
-            {
-                ESP_LOGE(TAG, "high_start 字段无效");
-                cJSON_Delete(root);
-                return false;
-            }
-            // 高压结束
-            cJSON *item_flush_high_end = cJSON_GetObjectItem(flush_item, "high_end");
-            if (cJSON_IsNumber(item_flush_high_end))
-            {
-                a_nvs_flash_insert_int("flush_high_end", item_flush_high_end->valueint);
-            }
-            else
-            {
-                ESP_LOGE(TAG, "high_end 字段无效");
-                cJSON_Delete(root);
-                return false;
-            }
-            // 累计制水
-            cJSON *item_flush_water_total = cJSON_GetObjectItem(flush_item, "water_total");
-            if (cJSON_IsNumber(item_flush_water_total))
-            {
-                a_nvs_flash_insert_int("flush_wt", item_flush_water_total->valueint);
-            }
-            else
-            {
-                ESP_LOGE(TAG, "water_total 字段无效");
-                cJSON_Delete(root);
-                return false;
-            }
-            // 累计制水冲洗
-            cJSON *item_flush_water_prouction_time = cJSON_GetObjectItem(flush_item, "water_prouction_time");
-            if (cJSON_IsNumber(item_flush_water_prouction_time))
-            {
-                a_nvs_flash_insert_int("flush_wp", item_flush_water_prouction_time->valueint);
-            }
-            else
+            ESP_LOGE(TAG, "flush 字段无效");
+            return false;
+        }
+        for (int f = GET_FLUSH_POWER_ON; f <= GET_FLUSH_WATER_PROUCTION_TIME; f++)
+        {
+            if (!GET_HAS(rsp, f))
             {
-                ESP_LOGE(TAG, "water_prouction_time 字段无效");
-                cJSON_Delete(root);
+                ESP_LOGE(TAG, "%s 字段无效", get_fields[f].path);
                 return false;
             }
-            gpio_flush_data_update();
+            a_nvs_flash_insert_int(flush_nvs_key[f - GET_FLUSH_POWER_ON], rsp->value[f]);
         }
-        else
+        gpio_flush_data_update();
+    }
+    return true;
+}
+
+static bool httpget_apply(const config_rsp_t *rsp)
+{
+    xSemaphoreTake(config_lock, portMAX_DELAY);
+    bool ok = httpget_apply_locked(rsp);
+    xSemaphoreGive(config_lock);
+    return ok;
+}
+
+// GET 完成回调（HTTP执行任务中运行）
+static void httpget_done(u4g_http_handle_t handle, emU4GResult result, const char *data, void *arg)
+{
+    u4g_sup_data_report(result == U4G_OK); // 连续失败时由监管任务复查链路
+    if (result != U4G_OK)
+    {
+        ESP_LOGE(TAG, "HTTP GET请求失败 错误码: %d", result);
+        return;
+    }
+    if (http_rsp_finish() != U4G_OK)
+    {
+        ESP_LOGE(TAG, "解析响应数据失败");
+        return;
+    }
+    httpget_apply(&http_rsp);
+}
+
+// POST 响应与 GET 响应共用解析器：code 之外，合并上报时还带有设备配置（data）
+// 两者在HTTP执行任务中依次执行，解析状态不会交叉
+static u4g_http_sink_t post_sink = {
+    .begin = httpget_begin,
+    .write = httpget_write,
+    .arg = &http_rsp,
+};
+
+/**
+ * @brief 读取信号值；告警不为此多等一条 AT+CSQ，直接使用上次查询的值
+ * @param cls 执行时AT指令的等级
+ * @param csq 输出信号值
+ * @return 成功返回true
+ */
+static bool report_csq_read(u4g_at_class_t cls, int8_t *csq)
+{
+    if (cls != U4G_AT_CLASS_ALARM)
+    {
+        u4g_at_class_t prev = u4g_at_sched_class_set(cls);
+        emU4GResult ret = u4g_at_csq();
+        u4g_at_sched_class_set(prev);
+        if (ret != U4G_OK)
         {
-            ESP_LOGE(TAG, "flush 字段无效");
-            cJSON_Delete(root);
+            ESP_LOGE(TAG, "4G模块信号值 请求失败 错误码: %d", ret);
             return false;
         }
     }
-    cJSON_Delete(root); // 解析完成后释放 JSON 对象
+    u4g_data_t u4g_snap;
+    u4g_data_snapshot(&u4g_snap);
+    *csq = u4g_snap.csq;
     return true;
 }
 
-// 提交设备信息
-static bool submit_httppost(char *key)
+/**
+ * 累计量（累计制水、流量计）只在上报被确认或记入离线日志后扣除，扣除的是当时快照中的部分，
+ * 快照之后新增的留给下次上报。几次上报可能同时在途且包含同一段累计量，按开机以来已扣除的总量换算，
+ * 同一段只扣除一次
+ */
+#define REPORT_INFLIGHT_MAX 4 // 等待确认的 HTTP 上报，按序号取余存放
+static portMUX_TYPE report_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t report_seq = 0;        // 最近使用的序号
+static uint64_t taken_water_time = 0;  // 开机以来已扣除的累计制水时间
+static uint64_t taken_flowmeter = 0;   // 开机以来已扣除的流量计
+static report_t report_inflight[REPORT_INFLIGHT_MAX];
+
+#if FEEDBACK_DELTA
+/**
+ * 增量上报：只发送与服务器最近确认的上报相比有变化的字段，另附递增的序号 seq；
+ * 每 FEEDBACK_KEYFRAME 次（及开机后首次、尚无已确认的上报时）发送全部字段并附 "key": true，
+ * 服务器据此重新同步。累计量在确认后扣除已上报的部分，非零即视为有变化。
+ * 序号每次开机从1开始，服务器以关键帧为准
+ */
+static report_t report_base;         // 服务器最近确认的上报
+static bool report_base_valid = false;
+static report_t report_pending;      // 最近提交、等待确认的上报
+static uint8_t report_since_key = 0; // 距上次关键帧的上报次数（含关键帧本身）
+
+// 与已确认的上报相比有变化的字段
+static uint32_t report_changed(const report_t *base, const report_t *r)
+{
+    uint32_t fields = 0;
+    if (r->total_water_time != 0)
+    {
+        fields |= REPORT_BIT(REPORT_TOTAL_WATER_TIME);
+    }
+    if (r->flowmeter != 0)
+    {
+        fields |= REPORT_BIT(REPORT_FLOWMETER);
+    }
+    if (r->water_leak != base->water_leak)
+    {
+        fields |= REPORT_BIT(REPORT_WATER_LEAK);
+    }
+    if (r->tds_raw != base->tds_raw)
+    {
+        fields |= REPORT_BIT(REPORT_TDS_RAW);
+    }
+    if (r->tds_pure != base->tds_pure)
+    {
+        fields |= REPORT_BIT(REPORT_TDS_PURE);
+    }
+    // 温度按 0.1℃ 比较，避免传感器噪声使每次上报都带温度
+    if (REPORT_TEMP_X10(r->temp_raw) != REPORT_TEMP_X10(base->temp_raw))
+    {
+        fields |= REPORT_BIT(REPORT_TEMP_RAW);
+    }
+    if (REPORT_TEMP_X10(r->temp_pure) != REPORT_TEMP_X10(base->temp_pure))
+    {
+        fields |= REPORT_BIT(REPORT_TEMP_PURE);
+    }
+    if (r->expire_time != base->expire_time)
+    {
+        fields |= REPORT_BIT(REPORT_EXPIRE_TIME);
+    }
+    if (r->signal != base->signal)
+    {
+        fields |= REPORT_BIT(REPORT_SIGNAL);
+    }
+    return fields;
+}
+#endif
+
+/**
+ * @brief 记录设备数据快照，默认发送全部字段
+ * @param csq 信号值
+ * @param r 输出上报
+ */
+static void report_snapshot(int8_t csq, report_t *r)
 {
-    emU4GResult ret = u4g_at_csq();
-    if (ret != U4G_OK)
+    r->seq = 0;
+    r->key = true;
+    r->fields = REPORT_ALL;
+    r->water_leak = DEVICE.WATER_LEAK;
+    r->tds_raw = DEVICE_TDSWD.raw_tds;
+    r->tds_pure = DEVICE_TDSWD.pure_tds;
+    r->temp_raw = DEVICE_TDSWD.raw_temperature;
+    r->temp_pure = DEVICE_TDSWD.pure_temperature;
+    r->expire_time = DEVICE.expire_time;
+    r->signal = csq;
+    portENTER_CRITICAL(&report_lock); // 读取与扣除都在 report_lock 内，累计量与已扣除量一致
+    r->total_water_time = gpio_water_total_time_get();
+    r->flowmeter = gpio_flowmeter_get_pulse_count();
+    r->water_mark = taken_water_time + r->total_water_time;
+    r->flow_mark = taken_flowmeter + r->flowmeter;
+    portEXIT_CRITICAL(&report_lock);
+}
+
+// 从累计量中扣除已上报/已记录的部分（持有 report_lock），计数本身由计数模块在各自的锁内扣除
+static void report_take_locked(uint64_t water_time, uint32_t flowmeter)
+{
+    gpio_water_total_time_take(water_time);
+    gpio_flowmeter_take(flowmeter);
+    taken_water_time += water_time;
+    taken_flowmeter += flowmeter;
+}
+
+/**
+ * @brief 扣除快照中尚未被扣除的累计量：已被更晚的确认或离线日志扣除的部分不再扣除
+ * @param r 快照
+ * @param water_time 输出实际扣除的制水时间
+ * @param flowmeter 输出实际扣除的流量计
+ */
+static void report_take(const report_t *r, uint64_t *water_time, uint32_t *flowmeter)
+{
+    portENTER_CRITICAL(&report_lock);
+    *water_time = r->water_mark > taken_water_time ? r->water_mark - taken_water_time : 0;
+    *flowmeter = r->flow_mark > taken_flowmeter ? (uint32_t)(r->flow_mark - taken_flowmeter) : 0;
+    report_take_locked(*water_time, *flowmeter);
+    portEXIT_CRITICAL(&report_lock);
+}
+
+/**
+ * @brief 分配序号并按已确认的上报裁剪字段（FEEDBACK_DELTA 为0时保持全量），记为等待确认的上报
+ * @param r 上报
+ */
+static void report_delta(report_t *r)
+{
+    portENTER_CRITICAL(&report_lock);
+    r->seq = ++report_seq;
+#if FEEDBACK_DELTA
+    r->key = !report_base_valid || report_since_key >= FEEDBACK_KEYFRAME;
+    if (r->key)
     {
-        ESP_LOGE(TAG, "4G模块信号值 请求失败 错误码: %d", ret);
-        return false;
+        r->fields = REPORT_ALL;
+        report_since_key = 1;
+    }
+    else
+    {
+        r->fields = report_changed(&report_base, r);
+        report_since_key++;
+    }
+    report_pending = *r;
+#endif
+    portEXIT_CRITICAL(&report_lock);
+#if FEEDBACK_DELTA
+    ESP_LOGI(TAG, "上报 %lu%s 字段 0x%03lx", r->seq, r->key ? "（关键帧）" : "", r->fields);
+#endif
+}
+
+/**
+ * @brief 上报已被服务器确认，作为之后增量上报的基准；确认的不是最近一次提交的上报时忽略
+ * @param seq 被确认的上报序号
+ */
+static void report_base_update(uint32_t seq)
+{
+#if FEEDBACK_DELTA
+    portENTER_CRITICAL(&report_lock);
+    if (seq == report_pending.seq)
+    {
+        report_base = report_pending;
+        report_base_valid = true;
     }
-    int8_t csq = u4g_data_get()->csq;
+    portEXIT_CRITICAL(&report_lock);
+#endif
+}
+
+/**
+ * @brief 生成上报内容（JSON）
+ * @param r 上报
+ * @return 上报内容，调用方负责 free；失败返回NULL
+ */
+static char *report_json_encode(const report_t *r)
+{
     // 创建一个 cJSON 对象
     cJSON *json = cJSON_CreateObject();
     if (json == NULL)
     {
         ESP_LOGE(TAG, "创建 JSON 对象失败");
-        return false;
+        return NULL;
     }
     // 添加数据到 JSON 对象
-    cJSON_AddNumberToObject(json, "total_water_time", DEVICE.total_water_time);
-    cJSON_AddBoolToObject(json, "water_leak", DEVICE.WATER_LEAK);
-    cJSON_AddNumberToObject(json, "tds_raw", DEVICE_TDSWD.raw_tds);
-    cJSON_AddNumberToObject(json, "tds_pure", DEVICE_TDSWD.pure_tds);
-    cJSON_AddNumberToObject(json, "temp_raw", DEVICE_TDSWD.raw_temperature);
-    cJSON_AddNumberToObject(json, "temp_pure", DEVICE_TDSWD.pure_temperature);
-    cJSON_AddNumberToObject(json, "flowmeter", DEVICE.flowmeter);
-    cJSON_AddNumberToObject(json, "expire_time", DEVICE.expire_time);
-    cJSON_AddNumberToObject(json, "signal", csq);
+#if REPORT_SEQ
+    cJSON_AddNumberToObject(json, "seq", r->seq);
+#endif
+#if FEEDBACK_DELTA
+    if (r->key)
+    {
+        cJSON_AddBoolToObject(json, "key", true);
+    }
+#endif
+    if (r->fields & REPORT_BIT(REPORT_TOTAL_WATER_TIME))
+    {
+        cJSON_AddNumberToObject(json, "total_water_time", r->total_water_time);
+    }
+    if (r->fields & REPORT_BIT(REPORT_WATER_LEAK))
+    {
+        cJSON_AddBoolToObject(json, "water_leak", r->water_leak);
+    }
+    if (r->fields & REPORT_BIT(REPORT_TDS_RAW))
+    {
+        cJSON_AddNumberToObject(json, "tds_raw", r->tds_raw);
+    }
+    if (r->fields & REPORT_BIT(REPORT_TDS_PURE))
+    {
+        cJSON_AddNumberToObject(json, "tds_pure", r->tds_pure);
+    }
+    if (r->fields & REPORT_BIT(REPORT_TEMP_RAW))
+    {
+        cJSON_AddNumberToObject(json, "temp_raw", r->temp_raw);
+    }
+    if (r->fields & REPORT_BIT(REPORT_TEMP_PURE))
+    {
+        cJSON_AddNumberToObject(json, "temp_pure", r->temp_pure);
+    }
+    if (r->fields & REPORT_BIT(REPORT_FLOWMETER))
+    {
+        cJSON_AddNumberToObject(json, "flowmeter", r->flowmeter);
+    }
+    if (r->fields & REPORT_BIT(REPORT_EXPIRE_TIME))
+    {
+        cJSON_AddNumberToObject(json, "expire_time", r->expire_time);
+    }
+    if (r->fields & REPORT_BIT(REPORT_SIGNAL))
+    {
+        cJSON_AddNumberToObject(json, "signal", r->signal);
+    }
     // 将 JSON 对象转换为字符串
     char *body = cJSON_PrintUnformatted(json);
     if (body == NULL)
     {
         ESP_LOGE(TAG, "JSON 转换为字符串失败");
-        cJSON_Delete(json); // 释放 JSON 对象
+    }
+    cJSON_Delete(json); // 释放 JSON 对象
+    return body;
+}
+
+/**
+ * @brief 生成上报内容（CBOR），字段与JSON相同，直接写入调用方的缓冲区
+ * @param r 上报
+ * @param buf 输出缓冲区
+ * @param size 缓冲区大小
+ * @param len 输出编码长度
+ * @return emU4GResult 缓冲区不足返回 U4G_ERR_INVALID_SIZE
+ */
+static emU4GResult report_cbor_encode(const report_t *r, uint8_t *buf, size_t size, size_t *len)
+{
+    u4g_cbor_enc_t enc;
+    u4g_cbor_enc_init(&enc, buf, size);
+    uint32_t pairs = __builtin_popcount(r->fields);
+#if REPORT_SEQ
+    pairs += 1;
+#endif
+#if FEEDBACK_DELTA
+    pairs += r->key ? 1 : 0;
+#endif
+    u4g_cbor_enc_map(&enc, pairs);
+#if REPORT_SEQ
+    u4g_cbor_enc_text(&enc, "seq");
+    u4g_cbor_enc_int(&enc, r->seq);
+#endif
+#if FEEDBACK_DELTA
+    if (r->key)
+    {
+        u4g_cbor_enc_text(&enc, "key");
+        u4g_cbor_enc_bool(&enc, true);
+    }
+#endif
+    if (r->fields & REPORT_BIT(REPORT_TOTAL_WATER_TIME))
+    {
+        u4g_cbor_enc_text(&enc, "total_water_time");
+        u4g_cbor_enc_int(&enc, r->total_water_time);
+    }
+    if (r->fields & REPORT_BIT(REPORT_WATER_LEAK))
+    {
+        u4g_cbor_enc_text(&enc, "water_leak");
+        u4g_cbor_enc_bool(&enc, r->water_leak);
+    }
+    if (r->fields & REPORT_BIT(REPORT_TDS_RAW))
+    {
+        u4g_cbor_enc_text(&enc, "tds_raw");
+        u4g_cbor_enc_int(&enc, r->tds_raw);
+    }
+    if (r->fields & REPORT_BIT(REPORT_TDS_PURE))
+    {
+        u4g_cbor_enc_text(&enc, "tds_pure");
+        u4g_cbor_enc_int(&enc, r->tds_pure);
+    }
+    if (r->fields & REPORT_BIT(REPORT_TEMP_RAW))
+    {
+        u4g_cbor_enc_text(&enc, "temp_raw");
+        u4g_cbor_enc_float(&enc, r->temp_raw);
+    }
+    if (r->fields & REPORT_BIT(REPORT_TEMP_PURE))
+    {
+        u4g_cbor_enc_text(&enc, "temp_pure");
+        u4g_cbor_enc_float(&enc, r->temp_pure);
+    }
+    if (r->fields & REPORT_BIT(REPORT_FLOWMETER))
+    {
+        u4g_cbor_enc_text(&enc, "flowmeter");
+        u4g_cbor_enc_int(&enc, r->flowmeter);
+    }
+    if (r->fields & REPORT_BIT(REPORT_EXPIRE_TIME))
+    {
+        u4g_cbor_enc_text(&enc, "expire_time");
+        u4g_cbor_enc_int(&enc, r->expire_time);
+    }
+    if (r->fields & REPORT_BIT(REPORT_SIGNAL))
+    {
+        u4g_cbor_enc_text(&enc, "signal");
+        u4g_cbor_enc_int(&enc, r->signal);
+    }
+    return u4g_cbor_enc_finish(&enc, len);
+}
+
+/**
+ * @brief 提交上报：服务器支持CBOR时在栈上编码，不分配堆内存；否则为JSON
+ * @param r 上报
+ * @param cls 执行时AT指令的等级
+ * @param combined 请求服务器在响应中带回设备配置
+ */
+static bool submit_report(const report_t *r, u4g_at_class_t cls, bool combined)
+{
+    portENTER_CRITICAL(&report_lock);
+    report_inflight[r->seq % REPORT_INFLIGHT_MAX] = *r; // 确认时按序号取回快照
+    portEXIT_CRITICAL(&report_lock);
+#if HTTP_CBOR
+    if (cbor_accepted)
+    {
+        uint8_t buf[REPORT_CBOR_MAX];
+        u4g_http_fmt_t fmt = fmt_cbor;
+        if (report_cbor_encode(r, buf, sizeof(buf), &fmt.body_len) == U4G_OK)
+        {
+            return submit_httppost((const char *)buf, &fmt, cls, combined, r->seq);
+        }
+    }
+#endif
+    char *body = report_json_encode(r);
+    if (body == NULL)
+    {
         return false;
     }
+#if HTTP_CBOR
+    u4g_http_fmt_t fmt = fmt_json;
+    fmt.body_len = strlen(body);
+    bool ok = submit_httppost(body, &fmt, cls, combined, r->seq);
+#else
+    bool ok = submit_httppost(body, NULL, cls, combined, r->seq);
+#endif
+    free(body);
+    return ok;
+}
+
+/**
+ * @brief 上报已被服务器确认：扣除快照中的累计量，快照之后新增的留到下次；
+ * 已被更晚的确认或离线日志扣除的部分不再扣除
+ * @param r 被确认的上报
+ */
+static void report_acked(const report_t *r)
+{
+    a_boot_mark("first_report"); // 上电到首次上报成功的耗时
+    uint64_t water_time;
+    uint32_t flowmeter;
+    report_take(r, &water_time, &flowmeter);
+    ESP_LOGI(TAG, "上报 %lu 已确认，扣除制水时间%llu 流量计%lu", r->seq, water_time, flowmeter);
+}
+
+// 按序号取回等待确认的 HTTP 上报，已被后来的上报覆盖时返回false（累计量保留到下次上报）
+static bool report_inflight_take(uint32_t seq, report_t *r)
+{
+    portENTER_CRITICAL(&report_lock);
+    *r = report_inflight[seq % REPORT_INFLIGHT_MAX];
+    portEXIT_CRITICAL(&report_lock);
+    return r->seq == seq && seq != 0;
+}
 
+// POST 完成回调参数：上报序号左移一位，最低位为合并上报
+#define POST_ARG(seq, combined) ((void *)(((uintptr_t)(seq) << 1) | (combined)))
+#define POST_ARG_SEQ(arg) ((uint32_t)((uintptr_t)(arg) >> 1))
+#define POST_ARG_COMBINED(arg) ((bool)((uintptr_t)(arg) & 1))
+
+/**
+ * @brief 提交设备信息
+ * @param body 上报内容
+ * @param fmt 内容格式，NULL 为JSON文本
+ * @param cls 执行时AT指令的等级
+ * @param combined 请求服务器在响应中带回设备配置
+ * @param seq 上报序号，确认后作为增量上报的基准
+ */
+static bool submit_httppost(const char *body, const u4g_http_fmt_t *fmt, u4g_at_class_t cls, bool combined, uint32_t seq)
+{
     char path[200];
-    snprintf(path, sizeof(path), "/api/v1/device/%s/%s", CONFIG_PROJECT_NAME, DEVICE.IMEI);
+    snprintf(path, sizeof(path), "/api/v1/device/%s/%s%s", CONFIG_PROJECT_NAME, DEVICE.IMEI, combined ? FEEDBACK_COMBINED_QUERY : "");
 
-    // 发送 HTTP POST 请求
-    ret = u4g_at_http_request(HTTP_URL, path, body);
-    // 释放内存
-    free(body);         // 释放 JSON 字符串内存
-    cJSON_Delete(json); // 释放 JSON 对象
-    if (ret != U4G_OK)
+    // 提交 HTTP POST 请求，body 在提交时已被复制
+    u4g_http_req_t req = {
+        .url = HTTP_URL,
+        .path = path,
+        .body = body,
+        .sink = &post_sink,
+        .cb = httppost_done,
+        .arg = POST_ARG(seq, combined),
+        .cls = cls,
+        .fmt = fmt,
+    };
+    u4g_http_handle_t handle = u4g_http_submit(&req);
+    if (handle == NULL)
     {
-        ESP_LOGE(TAG, "HTTP POST请求失败 错误码: %d", ret);
+        ESP_LOGE(TAG, "HTTP POST请求提交失败");
         return false;
     }
-    char *u4g_data = (char *)u4g_data_get()->data;
-    if (u4g_data == NULL)
+    return true;
+}
+
+// POST 完成回调（HTTP执行任务中运行）
+static void httppost_done(u4g_http_handle_t handle, emU4GResult result, const char *data, void *arg)
+{
+    u4g_sup_data_report(result == U4G_OK); // 连续失败时由监管任务复查链路
+    if (result != U4G_OK)
     {
-        ESP_LOGE(TAG, "u4g_data 无数据");
-        return false;
+        ESP_LOGE(TAG, "HTTP POST请求失败 错误码: %d", result);
+        return;
     }
-    ESP_LOGD(TAG, "HTTP POST请求成功 提取JSON数据: %s", u4g_data);
-    // 解析JSON数据
-    cJSON *root = cJSON_Parse(u4g_data);
-    if (root == NULL)
+    // 告警上报不排在离线记录补传之后，补传推迟到此时；HTTP执行任务在回调返回后才开始下一个请求，
+    // 提交不影响本次响应的解析。已在补传时不重复提交
+    feedback_journal_drain();
+    bool combined = POST_ARG_COMBINED(arg);
+    if (http_rsp_finish() != U4G_OK)
     {
-        ESP_LOGE(TAG, "解析JSON数据失败");
-        return false;
+        ESP_LOGE(TAG, "解析响应数据失败");
+        return;
     }
     // 获取"code"字段
-    cJSON *code_item = cJSON_GetObjectItem(root, "code");
-    if (!cJSON_IsNumber(code_item))
+    if (!GET_HAS(&http_rsp, GET_CODE))
     {
         ESP_LOGE(TAG, "code 字段无效");
-        cJSON_Delete(root);
+        return;
+    }
+    report_t acked;
+    if (http_rsp.value[GET_CODE] == 200 && report_inflight_take(POST_ARG_SEQ(arg), &acked))
+    {
+        report_acked(&acked);
+        report_base_update(acked.seq);
+    }
+    if (!combined)
+    {
+        return;
+    }
+    if (GET_HAS(&http_rsp, GET_DATA))
+    {
+        ESP_LOGI(TAG, "合并上报：应用响应中的设备配置");
+        httpget_apply(&http_rsp);
+        return;
+    }
+    // 服务器未带回配置：本轮补发 GET，之后一段时间直接使用 POST+GET
+    ESP_LOGW(TAG, "服务器不支持合并上报，改用 POST+GET");
+    portENTER_CRITICAL(&combined_lock);
+    combined_skip = FEEDBACK_COMBINED_RETRY;
+    portEXIT_CRITICAL(&combined_lock);
+    submit_httpget();
+}
+
+#if U4G_MQTT_ENABLE
+/**
+ * MQTT 推送通道：订阅 device/<型号>/<IMEI>/config，服务器在配置变化时发布（建议保留消息，连接后立即同步），
+ * 内容与 GET 响应相同；上报发布到 device/<型号>/<IMEI>/telemetry，内容与 POST 相同。
+ * PUBACK 超时后本轮改用HTTP发送同一上报（同一 seq），服务器可能两条都收到，按 seq 去重
+ */
+static config_rsp_t mqtt_rsp; // 推送的配置，在URC分发任务中解析
+
+// 推送的配置（URC分发任务中运行）
+static void feedback_mqtt_msg(const char *topic, const char *payload, size_t len, void *arg)
+{
+    httpget_begin(&mqtt_rsp);
+    if (u4g_json_feed(&mqtt_rsp.json, payload, len) != U4G_OK || u4g_json_finish(&mqtt_rsp.json) != U4G_OK)
+    {
+        ESP_LOGE(TAG, "推送的配置解析失败");
+        return;
+    }
+    ESP_LOGI(TAG, "收到推送的设备配置");
+    httpget_apply(&mqtt_rsp);
+}
+
+/**
+ * @brief 启动MQTT客户端：IMEI 作为客户端标识与用户名，设备秘钥作为密码
+ * @return 启动成功返回true
+ */
+static bool feedback_mqtt_start(const char *key)
+{
+    char topic[U4G_MQTT_TOPIC_MAX + 1];
+    snprintf(topic, sizeof(topic), "device/%s/%s/config", CONFIG_PROJECT_NAME, DEVICE.IMEI);
+    u4g_mqtt_subscribe(topic, 1);
+    u4g_mqtt_config_t config = {
+        .host = MQTT_HOST,
+        .port = MQTT_PORT,
+        .tls = MQTT_TLS,
+        .client_id = DEVICE.IMEI,
+        .username = DEVICE.IMEI,
+        .password = key,
+        .cb = feedback_mqtt_msg,
+    };
+    if (u4g_mqtt_start(&config) != U4G_OK)
+    {
+        ESP_LOGE(TAG, "MQTT启动失败");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 通过MQTT上报，收到 PUBACK 视为服务器已确认
+ * @param body 上报内容
+ * @param r 上报
+ * @return 上报成功返回true；未连接或失败返回false，由调用方改用HTTP
+ */
+static bool feedback_mqtt_report(const char *body, const report_t *r)
+{
+    if (!u4g_mqtt_is_connected())
+    {
         return false;
     }
-    if (code_item->valueint == 200)
+    char topic[U4G_MQTT_TOPIC_MAX + 1];
+    snprintf(topic, sizeof(topic), "device/%s/%s/telemetry", CONFIG_PROJECT_NAME, DEVICE.IMEI);
+    emU4GResult ret = u4g_mqtt_publish(topic, body, strlen(body), 1);
+    u4g_sup_data_report(ret == U4G_OK);
+    if (ret != U4G_OK)
     {
-        ESP_LOGI(TAG, "接收成功数据执行清零操作");
-        DEVICE.flowmeter = 0;        // 流量计清零
-        DEVICE.total_water_time = 0; // 累计制水清零
+        ESP_LOGW(TAG, "MQTT上报失败:%d，本轮改用HTTP", ret);
+        return false;
     }
-    cJSON_Delete(root); // 解析完成后释放 JSON 对象
+    report_acked(r);
+    report_base_update(r->seq);
     return true;
 }
+#endif
+
+#if A_FEEDBACK_BIN_ENABLE
+// 二进制配置编号对应的配置字段
+static const uint8_t bin_cfg_field[A_FEEDBACK_BIN_CFG_MAX] = {
+    [A_FEEDBACK_BIN_CFG_CHARGING] = GET_CHARGING,
+    [A_FEEDBACK_BIN_CFG_EXPIRE_TIME] = GET_EXPIRE_TIME,
+    [A_FEEDBACK_BIN_CFG_FILTER_LEVEL] = GET_FILTER_LEVEL,
+    [A_FEEDBACK_BIN_CFG_DURATION_S] = GET_DURATION_S,
+    [A_FEEDBACK_BIN_CFG_FLUSH_POWER_ON] = GET_FLUSH_POWER_ON,
+    [A_FEEDBACK_BIN_CFG_FLUSH_LOW_END] = GET_FLUSH_LOW_END,
+    [A_FEEDBACK_BIN_CFG_FLUSH_HIGH_START] = GET_FLUSH_HIGH_START,
+    [A_FEEDBACK_BIN_CFG_FLUSH_HIGH_END] = GET_FLUSH_HIGH_END,
+    [A_FEEDBACK_BIN_CFG_FLUSH_WATER_TOTAL] = GET_FLUSH_WATER_TOTAL,
+    [A_FEEDBACK_BIN_CFG_FLUSH_WATER_TIME] = GET_FLUSH_WATER_PROUCTION_TIME,
+};
+static config_rsp_t bin_rsp; // 下发的配置，在URC分发任务中转换
+
+// 下发的配置（URC分发任务中运行）：转换为与 GET 响应相同的字段后应用
+static a_feedback_bin_status_t feedback_bin_config(const int32_t value[A_FEEDBACK_BIN_CFG_MAX], uint32_t found)
+{
+    bin_rsp.found = (1UL << GET_CODE) | (1UL << GET_DATA);
+    bin_rsp.value[GET_CODE] = 200;
+    for (int id = 1; id < A_FEEDBACK_BIN_CFG_MAX; id++)
+    {
+        if (found & (1UL << id))
+        {
+            int f = bin_cfg_field[id];
+            bin_rsp.found |= 1UL << f;
+            bin_rsp.value[f] = value[id];
+            if (f >= GET_FLUSH_POWER_ON)
+            {
+                bin_rsp.found |= 1UL << GET_FLUSH;
+            }
+        }
+    }
+    return httpget_apply(&bin_rsp) ? A_FEEDBACK_BIN_OK : A_FEEDBACK_BIN_ERR_INVALID;
+}
+
+// 二进制上报，服务器确认后扣除快照中的累计量
+static void feedback_bin_report(u4g_at_class_t cls)
+{
+    int8_t csq;
+    if (!report_csq_read(cls, &csq))
+    {
+        return;
+    }
+    report_t r;
+    report_snapshot(csq, &r);
+    if (r.total_water_time > UINT32_MAX) // 编码只有4字节，超出部分留到下次
+    {
+        r.water_mark -= r.total_water_time - UINT32_MAX;
+        r.total_water_time = UINT32_MAX;
+    }
+    a_feedback_bin_report_t report = {
+        .total_water_time = (uint32_t)r.total_water_time,
+        .flowmeter = r.flowmeter,
+        .expire_time = r.expire_time,
+        .temp_raw = r.temp_raw,
+        .temp_pure = r.temp_pure,
+        .tds_raw = r.tds_raw,
+        .tds_pure = r.tds_pure,
+        .water_leak = r.water_leak,
+        .signal = csq,
+    };
+    esp_err_t ret = a_feedback_bin_report(&report);
+    if (ret == ESP_ERR_INVALID_STATE)
+    {
+        ESP_LOGW(TAG, "二进制上报未连接，本轮跳过");
+        return;
+    }
+    u4g_sup_data_report(ret == ESP_OK); // 连续失败时由监管任务复查链路
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "二进制上报失败: %s", esp_err_to_name(ret));
+        return;
+    }
+    report_acked(&r);
+}
+#endif
+
+/**
+ * 离线上报日志：未联网时每个上报周期记录一条（本周期的累计量与周期结束时的状态），
+ * 联网后 POST 到 /api/v1/device/<型号>/<IMEI>/journal 分批补传，每批受模块单次请求内容长度限制：
+ *   {"records":[[seq,time,water_time,flowmeter,tds_raw,tds_pure,temp_raw,temp_pure,water_leak],...]}
+ * 响应 code 为200后确认这批记录并继续下一批；失败时在下一个上报周期重试。掉电重传的记录按 seq 去重
+ */
+#define JOURNAL_BATCH_MAX 16 // 每批最多读取的记录数
+
+static void feedback_journal_record(void)
+{
+    report_t r;
+    report_snapshot(0, &r); // 日志不记录信号值
+    if (r.total_water_time > UINT32_MAX) // 记录只有4字节，超出部分留到下次
+    {
+        r.water_mark -= r.total_water_time - UINT32_MAX;
+        r.total_water_time = UINT32_MAX;
+    }
+    a_journal_rec_t rec = {
+        .time = (uint32_t)time(NULL),
+        .water_time = (uint32_t)r.total_water_time,
+        .flowmeter = r.flowmeter,
+        .temp_raw = REPORT_TEMP_X10(r.temp_raw),
+        .temp_pure = REPORT_TEMP_X10(r.temp_pure),
+        .tds_raw = r.tds_raw,
+        .tds_pure = r.tds_pure,
+        .water_leak = r.water_leak,
+    };
+    esp_err_t ret = a_journal_append(&rec);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "离线记录写入失败: %s", esp_err_to_name(ret)); // 累计量保留，联网后随上报发送
+        return;
+    }
+    // 本周期的累计量已记入日志，只扣除记录的部分（按快照位置，已被确认扣除的不再扣除），记录期间新增的计入下个周期
+    uint64_t water_time;
+    uint32_t flowmeter;
+    report_take(&r, &water_time, &flowmeter);
+    ESP_LOGI(TAG, "离线记录 %lu 已写入，待上传 %d 条", rec.seq, a_journal_pending());
+}
+
+// 有未上传的离线记录时开始分批上传，同一时间只有一批在途
+static void feedback_journal_drain(void)
+{
+    if (a_journal_pending() == 0)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&journal_lock);
+    bool busy = journal_draining;
+    journal_draining = true;
+    portEXIT_CRITICAL(&journal_lock);
+    if (!busy && !submit_journal())
+    {
+        journal_draining = false;
+    }
+}
+
+/**
+ * @brief 按上传格式把一批离线记录编码为 JSON，条数以编码后不超过 limit 为限
+ * @param body 输出缓冲区，至少 limit+1 字节
+ * @param limit 内容长度上限
+ * @param count 输出编入的记录数
+ * @return 内容长度
+ */
+static size_t journal_encode(const a_journal_rec_t *recs, size_t n, char *body, size_t limit, size_t *count)
+{
+    size_t len = snprintf(body, limit + 1, "{\"records\":[");
+    *count = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        char item[112];
+        int m = snprintf(item, sizeof(item), "%s[%lu,%lu,%lu,%lu,%u,%u,%.1f,%.1f,%d]", *count ? "," : "",
+                         recs[i].seq, recs[i].time, recs[i].water_time, recs[i].flowmeter, recs[i].tds_raw, recs[i].tds_pure,
+                         recs[i].temp_raw / 10.0, recs[i].temp_pure / 10.0, recs[i].water_leak);
+        if (len + m + 2 > limit) // 留出结尾的"]}"
+        {
+            break;
+        }
+        memcpy(body + len, item, m);
+        len += m;
+        (*count)++;
+    }
+    memcpy(body + len, "]}", 3);
+    return len + 2;
+}
+
+// 离线记录的内容长度上限：HTTP_CBOR 时以 binary 方式发送（十六进制），上限减半
+#if HTTP_CBOR
+#define JOURNAL_BODY_MAX U4G_HTTP_POST_MAX(fmt_json.binary)
+#else
+#define JOURNAL_BODY_MAX U4G_HTTP_POST_MAX(false)
+#endif
+
+/**
+ * @brief 提交一批离线记录，条数以编码后不超过 JOURNAL_BODY_MAX 为限
+ * @return 提交成功返回true
+ */
+static bool submit_journal(void)
+{
+    a_journal_rec_t recs[JOURNAL_BATCH_MAX];
+    size_t n = a_journal_peek(recs, JOURNAL_BATCH_MAX);
+    if (n == 0)
+    {
+        return false;
+    }
+    char body[U4G_HTTP_CONTENT_MAX + 1];
+    size_t count;
+    size_t len = journal_encode(recs, n, body, JOURNAL_BODY_MAX, &count);
+    if (count == 0)
+    {
+        return false;
+    }
+
+    char path[200];
+    snprintf(path, sizeof(path), "/api/v1/device/%s/%s/journal", CONFIG_PROJECT_NAME, DEVICE.IMEI);
+#if HTTP_CBOR
+    u4g_http_fmt_t fmt = fmt_json;
+    fmt.body_len = len;
+#else
+    (void)len; // 以字符串发送，长度由结尾的 '\0' 确定
+#endif
+    u4g_http_req_t req = {
+        .url = HTTP_URL,
+        .path = path,
+        .body = body,
+        .sink = &post_sink,
+        .cb = journal_done,
+        .arg = (void *)(uintptr_t)recs[count - 1].seq,
+        .cls = U4G_AT_CLASS_TELEMETRY,
+#if HTTP_CBOR
+        .fmt = &fmt,
+#endif
+    };
+    if (u4g_http_submit(&req) == NULL)
+    {
+        ESP_LOGE(TAG, "离线记录上传提交失败");
+        return false;
+    }
+    ESP_LOGI(TAG, "上传离线记录 %lu-%lu，共 %d 条", recs[0].seq, recs[count - 1].seq, count);
+    return true;
+}
+
+// 离线记录上传完成回调（HTTP执行任务中运行）：确认后继续下一批
+static void journal_done(u4g_http_handle_t handle, emU4GResult result, const char *data, void *arg)
+{
+    u4g_sup_data_report(result == U4G_OK);
+    if (result != U4G_OK)
+    {
+        ESP_LOGE(TAG, "离线记录上传失败 错误码: %d", result);
+        journal_draining = false;
+        return;
+    }
+    if (http_rsp_finish() != U4G_OK || !GET_HAS(&http_rsp, GET_CODE) || http_rsp.value[GET_CODE] != 200)
+    {
+        ESP_LOGE(TAG, "离线记录上传未被服务器确认");
+        journal_draining = false;
+        return;
+    }
+    a_journal_commit((uint32_t)(uintptr_t)arg);
+    ESP_LOGI(TAG, "离线记录已确认至 %lu，剩余 %d 条", (uint32_t)(uintptr_t)arg, a_journal_pending());
+    if (a_journal_pending() == 0 || DEVICE.NETSTATE != DEVICE_NETON || !submit_journal())
+    {
+        journal_draining = false;
+    }
+}
 
 // 定时器回调
 static void timer_feedback_callback(TimerHandle_t xTimer)
@@ -413,4 +1420,152 @@ static void timer_feedback_callback(TimerHandle_t xTimer)
             ESP_LOGE(TAG, "更新定时器周期失败");
         }
     }
-}
\ No newline at end of file
+}
+// 基准测试：统计 cJSON 的堆分配
+static uint32_t bench_allocs;
+static size_t bench_bytes;
+
+static void *bench_malloc(size_t size)
+{
+    bench_allocs++;
+    bench_bytes += size;
+    return malloc(size);
+}
+
+/**
+ * @brief 对比上报内容的 JSON 与 CBOR 编码：耗时、编码长度与堆分配，结果输出到日志（控制台 bench 命令）
+ * 统计期间替换了 cJSON 的内存钩子，其他任务同时使用 cJSON 时分配次数会偏大
+ * @param rounds 每种编码的次数
+ */
+void a_feedback_bench(uint32_t rounds)
+{
+    if (rounds == 0)
+    {
+        rounds = 1;
+    }
+    report_t report;
+    report_snapshot(20, &report); // 全量上报，不占用序号
+    size_t json_len = 0;
+    cJSON_Hooks hooks = {.malloc_fn = bench_malloc, .free_fn = free};
+    bench_allocs = 0;
+    bench_bytes = 0;
+    cJSON_InitHooks(&hooks);
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < rounds; i++)
+    {
+        char *body = report_json_encode(&report);
+        if (body == NULL)
+        {
+            break;
+        }
+        json_len = strlen(body);
+        free(body);
+    }
+    int64_t json_us = esp_timer_get_time() - start;
+    cJSON_InitHooks(NULL);
+    uint32_t json_allocs = bench_allocs;
+    size_t json_bytes = bench_bytes;
+
+    uint8_t buf[REPORT_CBOR_MAX];
+    size_t cbor_len = 0;
+    emU4GResult ret = U4G_OK;
+    start = esp_timer_get_time();
+    for (uint32_t i = 0; i < rounds && ret == U4G_OK; i++)
+    {
+        ret = report_cbor_encode(&report, buf, sizeof(buf), &cbor_len);
+    }
+    int64_t cbor_us = esp_timer_get_time() - start;
+
+    ESP_LOGI(TAG, "上报编码 %lu 次: JSON %d 字节 平均 %lld us 堆分配 %lu 次/%d 字节",
+             rounds, json_len, json_us / rounds, json_allocs / rounds, json_bytes / rounds);
+    ESP_LOGI(TAG, "上报编码 %lu 次: CBOR %d 字节 平均 %lld us 堆分配 0 次%s",
+             rounds, cbor_len, cbor_us / rounds, ret == U4G_OK ? "" : "（缓冲区不足）");
+}
+
+// 自检：一批记录解析出的值与编码前逐字段比对
+typedef struct
+{
+    const a_journal_rec_t *recs; // 本批的记录
+    size_t count;                // 本批的记录数
+    size_t values;               // 比对一致的值个数
+    bool ok;
+} journal_check_t;
+
+static void journal_check_cb(const char *path, u4g_json_type_t type, const char *value, void *arg)
+{
+    journal_check_t *c = arg;
+    unsigned i, f;
+    if (type != U4G_JSON_NUMBER)
+    {
+        return;
+    }
+    if (sscanf(path, "records.%u.%u", &i, &f) != 2 || i >= c->count || f >= 9)
+    {
+        c->ok = false; // 多出的记录或字段
+        return;
+    }
+    const a_journal_rec_t *r = &c->recs[i];
+    const int64_t expect[9] = {r->seq, r->time, r->water_time, r->flowmeter, r->tds_raw, r->tds_pure, r->temp_raw, r->temp_pure, r->water_leak};
+    int64_t got = f == 6 || f == 7 ? llround(strtod(value, NULL) * 10) : strtoll(value, NULL, 10); // 温度按0.1度发送
+    if (got != expect[f])
+    {
+        ESP_LOGE(TAG, "离线记录 %lu 第%u个字段: %s，应为 %lld", r->seq, f, value, expect[f]);
+        c->ok = false;
+        return;
+    }
+    c->values++;
+}
+
+/**
+ * @brief 离线记录上传自检（控制台 selftest 命令）：取各字段最长的记录凑满 JOURNAL_BATCH_MAX 条，
+ * 按实际上传格式分批编码，每批须满足模块对该格式的长度限制（HTTP_CBOR 时为十六进制发送），
+ * 解析出的每条记录逐字段与原记录一致，且全部记录恰好各上传一次
+ * @return 全部批次通过返回true
+ */
+bool a_feedback_journal_check(void)
+{
+    a_journal_rec_t recs[JOURNAL_BATCH_MAX];
+    for (size_t i = 0; i < JOURNAL_BATCH_MAX; i++)
+    {
+        recs[i] = (a_journal_rec_t){
+            .seq = UINT32_MAX - JOURNAL_BATCH_MAX + i,
+            .time = UINT32_MAX - i,
+            .water_time = UINT32_MAX - 2 * i,
+            .flowmeter = UINT32_MAX - 3 * i,
+            .temp_raw = INT16_MIN + i,
+            .temp_pure = i % 2 ? INT16_MIN : INT16_MAX - i,
+            .tds_raw = UINT8_MAX - i,
+            .tds_pure = i,
+            .water_leak = i % 2,
+        };
+    }
+#if HTTP_CBOR
+    bool binary = fmt_json.binary;
+#else
+    bool binary = false;
+#endif
+    char body[U4G_HTTP_CONTENT_MAX + 1];
+    size_t done = 0;
+    int batches = 0;
+    while (done < JOURNAL_BATCH_MAX)
+    {
+        size_t count;
+        size_t len = journal_encode(recs + done, JOURNAL_BATCH_MAX - done, body, JOURNAL_BODY_MAX, &count);
+        journal_check_t check = {.recs = recs + done, .count = count, .values = 0, .ok = true};
+        u4g_json_t json;
+        u4g_json_init(&json, journal_check_cb, &check);
+        bool ok = count > 0 && len <= U4G_HTTP_POST_MAX(binary) &&
+                  u4g_json_feed(&json, body, len) == U4G_OK && u4g_json_finish(&json) == U4G_OK &&
+                  check.ok && check.values == count * 9;
+        ESP_LOGI(TAG, "离线记录第%d批: %d 条 %d 字节，%s上限 %d", batches + 1, count, len, binary ? "十六进制发送" : "", U4G_HTTP_POST_MAX(binary));
+        if (!ok)
+        {
+            ESP_LOGE(TAG, "离线记录第%d批无法上传或内容不符", batches + 1);
+            return false;
+        }
+        done += count;
+        batches++;
+    }
+    ESP_LOGI(TAG, "离线记录 %d 条分 %d 批上传", JOURNAL_BATCH_MAX, batches);
+    return true;
+}
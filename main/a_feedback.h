@@ -9,5 +9,8 @@
 extern TaskHandle_t xTaskHandle_feedback;
 
 esp_err_t a_feedback_init(void);
+esp_err_t a_feedback_offline_start(void);
+void a_feedback_bench(uint32_t rounds);
+bool a_feedback_journal_check(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,450 @@
+#include "a_feedback_bin.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "mbedtls/md.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if A_FEEDBACK_BIN_ENABLE
+
+#define TAG "A_FEEDBACK_BIN" // 日志标签
+
+#define BIN_FRAME_MAX (A_FEEDBACK_BIN_HEAD_LEN + A_FEEDBACK_BIN_PAYLOAD_MAX + A_FEEDBACK_BIN_FRAME_MAC_LEN + 2)
+#define BIN_SESSION_LABEL "session" // 会话秘钥派生标签
+
+#define BIN_ACK_BIT (1 << 0)  // 收到等待中的ACK
+#define BIN_DOWN_BIT (1 << 1) // 连接断开
+
+static char *bin_imei = NULL;
+static char *bin_key = NULL;
+static a_feedback_bin_config_cb_t bin_config_cb = NULL;
+static EventGroupHandle_t bin_event = NULL;
+static SemaphoreHandle_t bin_mutex = NULL; // 停等：同一时间只有一帧等待ACK
+static uint16_t tx_seq = 0;                // 最近发送的序号
+static volatile uint8_t tx_type = 0;       // 等待ACK的帧类型
+static volatile uint16_t ack_seq = 0;      // 最近收到的ACK所确认的序号
+static volatile uint8_t ack_status = 0;    // 最近收到的ACK的结果
+static uint8_t ack_data[A_FEEDBACK_BIN_NONCE_LEN]; // 最近收到的ACK的附加内容（HELLO 的挑战随机数）
+static volatile uint8_t ack_data_len = 0;
+static int32_t rx_config_seq = -1;         // 最近处理的CONFIG序号，重发时不再重复应用
+static volatile bool bin_authed = false;
+static uint8_t bin_session_key[32];        // 会话秘钥，由 HELLO 的挑战随机数派生
+static volatile bool bin_session = false;  // 已有会话秘钥：收发的帧都带会话认证码
+
+// 接收帧缓存：TCP 为字节流，按帧头中的长度拼帧
+static uint8_t rx_buf[BIN_FRAME_MAX];
+static size_t rx_len = 0;
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// CRC16-CCITT，初值 0xFFFF，不取反
+static uint16_t bin_crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// 会话认证码：HMAC-SHA256(会话秘钥, 帧头|内容)，调用方取前 A_FEEDBACK_BIN_FRAME_MAC_LEN 字节
+static int bin_frame_mac(const uint8_t *data, size_t len, uint8_t mac[32])
+{
+    return mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), bin_session_key, sizeof(bin_session_key), data, len, mac);
+}
+
+/**
+ * @brief 组帧，已有会话秘钥时附上会话认证码
+ * @param frame 输出缓冲区，至少 BIN_FRAME_MAX 字节
+ * @return 帧长度
+ */
+static size_t bin_frame_build(uint8_t *frame, uint8_t type, uint16_t seq, const uint8_t *payload, size_t len)
+{
+    frame[0] = A_FEEDBACK_BIN_MAGIC;
+    frame[1] = A_FEEDBACK_BIN_VERSION;
+    frame[2] = type;
+    put_u16(frame + 3, seq);
+    put_u16(frame + 5, len);
+    if (len)
+    {
+        memcpy(frame + A_FEEDBACK_BIN_HEAD_LEN, payload, len);
+    }
+    len += A_FEEDBACK_BIN_HEAD_LEN;
+    if (bin_session)
+    {
+        uint8_t mac[32];
+        bin_frame_mac(frame, len, mac);
+        memcpy(frame + len, mac, A_FEEDBACK_BIN_FRAME_MAC_LEN);
+        len += A_FEEDBACK_BIN_FRAME_MAC_LEN;
+    }
+    put_u16(frame + len, bin_crc16(frame, len));
+    return len + 2;
+}
+
+// 回复ACK（不等待确认）
+static void bin_ack_send(uint16_t seq, a_feedback_bin_status_t status)
+{
+    uint8_t payload[3];
+    uint8_t frame[A_FEEDBACK_BIN_HEAD_LEN + sizeof(payload) + A_FEEDBACK_BIN_FRAME_MAC_LEN + 2];
+    put_u16(payload, seq);
+    payload[2] = status;
+    size_t len = bin_frame_build(frame, A_FEEDBACK_BIN_ACK, 0, payload, sizeof(payload));
+    u4g_sock_send(frame, len);
+}
+
+/**
+ * @brief 发送一帧并等待ACK，超时按原序号重发
+ * @param reply 输出ACK的附加内容，NULL 表示不需要
+ * @param reply_len 需要的附加内容长度，ACK 中不足时视为对方拒绝
+ * @return ESP_OK 已确认；ESP_ERR_TIMEOUT 无应答（已请求重建连接）；ESP_FAIL 对方拒绝或连接断开
+ */
+static esp_err_t bin_send_reliable(uint8_t type, const uint8_t *payload, size_t len, uint8_t *reply, size_t reply_len)
+{
+    uint8_t frame[BIN_FRAME_MAX];
+    if (xSemaphoreTake(bin_mutex, pdMS_TO_TICKS(A_FEEDBACK_BIN_ACK_TIMEOUT)) != pdTRUE)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+    uint16_t seq = ++tx_seq;
+    tx_type = type;
+    size_t frame_len = bin_frame_build(frame, type, seq, payload, len);
+    esp_err_t ret = ESP_ERR_TIMEOUT;
+    for (int attempt = 0; attempt <= A_FEEDBACK_BIN_RETRY && ret == ESP_ERR_TIMEOUT; attempt++)
+    {
+        xEventGroupClearBits(bin_event, BIN_ACK_BIT);
+        if (u4g_sock_send(frame, frame_len) != U4G_OK)
+        {
+            ret = ESP_FAIL;
+            break;
+        }
+        TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(A_FEEDBACK_BIN_ACK_TIMEOUT);
+        while (ret == ESP_ERR_TIMEOUT)
+        {
+            TickType_t now = xTaskGetTickCount();
+            if ((int32_t)(deadline - now) <= 0)
+            {
+                ESP_LOGW(TAG, "帧 %u(类型%u) 第%d次发送无应答", seq, type, attempt + 1);
+                break;
+            }
+            EventBits_t bits = xEventGroupWaitBits(bin_event, BIN_ACK_BIT | BIN_DOWN_BIT, pdTRUE, pdFALSE, deadline - now);
+            if (bits & BIN_DOWN_BIT)
+            {
+                ret = ESP_FAIL;
+            }
+            else if ((bits & BIN_ACK_BIT) && ack_seq == seq)
+            {
+                ret = ack_status == A_FEEDBACK_BIN_OK && ack_data_len >= reply_len ? ESP_OK : ESP_FAIL;
+                if (ret != ESP_OK)
+                {
+                    ESP_LOGE(TAG, "帧 %u(类型%u) 被拒绝: %u", seq, type, ack_status);
+                }
+                else if (reply)
+                {
+                    memcpy(reply, ack_data, reply_len);
+                }
+            }
+        }
+    }
+    xSemaphoreGive(bin_mutex);
+    if (ret == ESP_ERR_TIMEOUT)
+    {
+        u4g_sock_reset(); // 连续无应答：连接可能已失效（NAT 超时、半开连接）
+    }
+    return ret;
+}
+
+// 收到配置：解析后交给应用，以处理结果回复ACK
+static void bin_config_handle(uint16_t seq, const uint8_t *p, size_t len)
+{
+    if (!bin_authed)
+    {
+        ESP_LOGW(TAG, "未认证，拒绝配置 %u", seq);
+        bin_ack_send(seq, A_FEEDBACK_BIN_ERR_AUTH);
+        return;
+    }
+    if (len % 5 != 0)
+    {
+        bin_ack_send(seq, A_FEEDBACK_BIN_ERR_FORMAT);
+        return;
+    }
+    if (rx_config_seq == seq)
+    {
+        bin_ack_send(seq, A_FEEDBACK_BIN_OK); // 重发的配置（上次的ACK丢失），不再重复应用
+        return;
+    }
+    int32_t value[A_FEEDBACK_BIN_CFG_MAX] = {0};
+    uint32_t found = 0;
+    for (size_t i = 0; i < len; i += 5)
+    {
+        uint8_t id = p[i];
+        if (id > 0 && id < A_FEEDBACK_BIN_CFG_MAX)
+        {
+            value[id] = (int32_t)get_u32(p + i + 1);
+            found |= 1UL << id;
+        }
+    }
+    ESP_LOGI(TAG, "收到配置 %u，%d项", seq, len / 5);
+    a_feedback_bin_status_t status = bin_config_cb ? bin_config_cb(value, found) : A_FEEDBACK_BIN_ERR_INVALID;
+    if (status == A_FEEDBACK_BIN_OK)
+    {
+        rx_config_seq = seq;
+    }
+    bin_ack_send(seq, status);
+}
+
+// 处理一个完整且校验通过的帧
+static void bin_frame_handle(const uint8_t *frame)
+{
+    uint8_t type = frame[2];
+    uint16_t seq = get_u16(frame + 3);
+    uint16_t len = get_u16(frame + 5);
+    const uint8_t *p = frame + A_FEEDBACK_BIN_HEAD_LEN;
+    switch (type)
+    {
+    case A_FEEDBACK_BIN_ACK:
+        if (len >= 3)
+        {
+            ack_data_len = len - 3 < sizeof(ack_data) ? len - 3 : sizeof(ack_data);
+            memcpy(ack_data, p + 3, ack_data_len);
+            ack_seq = get_u16(p);
+            ack_status = p[2];
+            if (ack_status == A_FEEDBACK_BIN_OK && ack_seq == tx_seq && tx_type == A_FEEDBACK_BIN_AUTH)
+            {
+                bin_authed = true; // 在接收任务中置位：服务器紧随其后下发的 CONFIG 不会因连接任务尚未返回而被拒
+            }
+            xEventGroupSetBits(bin_event, BIN_ACK_BIT);
+        }
+        break;
+    case A_FEEDBACK_BIN_CONFIG:
+        bin_config_handle(seq, p, len);
+        break;
+    default:
+        ESP_LOGW(TAG, "未知帧类型: %u", type);
+        bin_ack_send(seq, A_FEEDBACK_BIN_ERR_FORMAT);
+        break;
+    }
+}
+
+/**
+ * @brief 接收数据（URC分发任务中运行）：按帧头长度拼帧，帧头或校验错误时丢弃一个字节重新同步，
+ * 会话认证码不符的帧整帧丢弃
+ */
+static void bin_rx(const uint8_t *data, size_t len, void *arg)
+{
+    while (len)
+    {
+        size_t n = sizeof(rx_buf) - rx_len;
+        n = n < len ? n : len;
+        memcpy(rx_buf + rx_len, data, n);
+        rx_len += n;
+        data += n;
+        len -= n;
+        while (rx_len)
+        {
+            if (rx_buf[0] != A_FEEDBACK_BIN_MAGIC ||
+                (rx_len > 1 && rx_buf[1] != A_FEEDBACK_BIN_VERSION) ||
+                (rx_len >= A_FEEDBACK_BIN_HEAD_LEN && get_u16(rx_buf + 5) > A_FEEDBACK_BIN_PAYLOAD_MAX))
+            {
+                memmove(rx_buf, rx_buf + 1, --rx_len);
+                continue;
+            }
+            if (rx_len < A_FEEDBACK_BIN_HEAD_LEN)
+            {
+                break;
+            }
+            bool session = bin_session;
+            size_t signed_len = A_FEEDBACK_BIN_HEAD_LEN + get_u16(rx_buf + 5);
+            size_t frame_len = signed_len + (session ? A_FEEDBACK_BIN_FRAME_MAC_LEN : 0) + 2;
+            if (rx_len < frame_len)
+            {
+                break;
+            }
+            if (get_u16(rx_buf + frame_len - 2) != bin_crc16(rx_buf, frame_len - 2))
+            {
+                ESP_LOGW(TAG, "帧校验失败，重新同步");
+                memmove(rx_buf, rx_buf + 1, --rx_len);
+                continue;
+            }
+            uint8_t mac[32];
+            if (session && (bin_frame_mac(rx_buf, signed_len, mac) != 0 ||
+                            memcmp(mac, rx_buf + signed_len, A_FEEDBACK_BIN_FRAME_MAC_LEN) != 0))
+            {
+                ESP_LOGW(TAG, "帧认证码错误，丢弃（类型%u 序号%u）", rx_buf[2], get_u16(rx_buf + 3));
+            }
+            else
+            {
+                bin_frame_handle(rx_buf);
+            }
+            rx_len -= frame_len;
+            memmove(rx_buf, rx_buf + frame_len, rx_len);
+        }
+    }
+}
+
+/**
+ * @brief 认证：HELLO 报上 IMEI，取得服务器的挑战随机数，再以 AUTH 回复
+ * HMAC-SHA256(秘钥, IMEI|挑战随机数) 前16字节。秘钥不在链路上传输，挑战一次有效，截获的 AUTH 无法重放。
+ * 同时派生会话秘钥，AUTH 及之后的帧都带会话认证码
+ */
+static esp_err_t bin_hello(void)
+{
+    uint8_t payload[1 + 32 + A_FEEDBACK_BIN_NONCE_LEN + sizeof(BIN_SESSION_LABEL) - 1];
+    uint8_t mac[32];
+    size_t imei_len = strlen(bin_imei);
+    if (imei_len > 32)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    payload[0] = imei_len;
+    memcpy(payload + 1, bin_imei, imei_len);
+    esp_err_t ret = bin_send_reliable(A_FEEDBACK_BIN_HELLO, payload, 1 + imei_len, payload + 1 + imei_len, A_FEEDBACK_BIN_NONCE_LEN);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    const mbedtls_md_info_t *md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    memcpy(payload + 1 + imei_len + A_FEEDBACK_BIN_NONCE_LEN, BIN_SESSION_LABEL, sizeof(BIN_SESSION_LABEL) - 1);
+    if (mbedtls_md_hmac(md, (const uint8_t *)bin_key, strlen(bin_key), payload + 1,
+                        imei_len + A_FEEDBACK_BIN_NONCE_LEN + sizeof(BIN_SESSION_LABEL) - 1, bin_session_key) != 0 ||
+        mbedtls_md_hmac(md, (const uint8_t *)bin_key, strlen(bin_key), payload + 1, imei_len + A_FEEDBACK_BIN_NONCE_LEN, mac) != 0)
+    {
+        ESP_LOGE(TAG, "计算认证码失败");
+        return ESP_FAIL;
+    }
+    bin_session = true;
+    return bin_send_reliable(A_FEEDBACK_BIN_AUTH, mac, A_FEEDBACK_BIN_MAC_LEN, NULL, 0);
+}
+
+// 连接状态（连接任务中运行）：建立后认证，失败时重建连接
+static void bin_state(bool connected, void *arg)
+{
+    bin_authed = false;
+    bin_session = false;
+    if (!connected)
+    {
+        xEventGroupSetBits(bin_event, BIN_DOWN_BIT);
+        return;
+    }
+    xEventGroupClearBits(bin_event, BIN_DOWN_BIT);
+    rx_len = 0;
+    if (bin_hello() != ESP_OK)
+    {
+        ESP_LOGE(TAG, "认证失败");
+        u4g_sock_reset();
+        return;
+    }
+    ESP_LOGI(TAG, "认证成功"); // bin_authed 已在收到 AUTH 的 ACK 时置位
+}
+
+/**
+ * @brief 启动二进制上报：连接服务器并认证，之后自动重连
+ * @param host 服务器地址
+ * @param port 端口
+ * @param udp 使用UDP，否则TCP
+ * @param imei 设备IMEI
+ * @param key 设备秘钥（只用于计算认证码）
+ * @param cb 收到配置时的回调
+ * @return esp_err_t
+ */
+esp_err_t a_feedback_bin_start(const char *host, uint16_t port, bool udp, const char *imei, const char *key, a_feedback_bin_config_cb_t cb)
+{
+    if (bin_event)
+    {
+        return ESP_OK;
+    }
+    if (host == NULL || imei == NULL || key == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bin_imei = strdup(imei);
+    bin_key = strdup(key);
+    bin_config_cb = cb;
+    bin_event = xEventGroupCreate();
+    bin_mutex = xSemaphoreCreateMutex();
+    if (bin_imei == NULL || bin_key == NULL || bin_event == NULL || bin_mutex == NULL)
+    {
+        ESP_LOGE(TAG, "二进制上报资源创建失败");
+        return ESP_FAIL;
+    }
+    tx_seq = esp_random(); // 重启后序号不与重启前的重复，服务器去重不会误丢
+    u4g_sock_config_t config = {
+        .host = host,
+        .port = port,
+        .udp = udp,
+        .rx = bin_rx,
+        .state = bin_state,
+    };
+    return u4g_sock_start(&config) == U4G_OK ? ESP_OK : ESP_FAIL;
+}
+
+// 温度按 0.1 度编码
+static int16_t bin_temp(float t)
+{
+    float v = roundf(t * 10);
+    return v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : (int16_t)v);
+}
+
+/**
+ * @brief 上报一次并等待服务器确认
+ * @param report 上报内容
+ * @return ESP_OK 已确认；ESP_ERR_INVALID_STATE 未连接或未认证；其他为发送失败
+ */
+esp_err_t a_feedback_bin_report(const a_feedback_bin_report_t *report)
+{
+    if (!bin_authed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t p[20];
+    put_u32(p, report->total_water_time);
+    put_u32(p + 4, report->flowmeter);
+    put_u32(p + 8, (uint32_t)report->expire_time);
+    put_u16(p + 12, (uint16_t)bin_temp(report->temp_raw));
+    put_u16(p + 14, (uint16_t)bin_temp(report->temp_pure));
+    p[16] = report->tds_raw;
+    p[17] = report->tds_pure;
+    p[18] = report->water_leak;
+    p[19] = (uint8_t)report->signal;
+    return bin_send_reliable(A_FEEDBACK_BIN_TELEMETRY, p, sizeof(p), NULL, 0);
+}
+
+/**
+ * @brief 已连接且认证通过
+ */
+bool a_feedback_bin_ready(void)
+{
+    return bin_authed;
+}
+
+#endif
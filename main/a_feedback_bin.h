@@ -0,0 +1,111 @@
+#ifndef _A_FEEDBACK_BIN_H_
+#define _A_FEEDBACK_BIN_H_
+
+#include "esp_err.h"
+#include "u4g_sock.h" // U4G_SOCK_ENABLE
+#include "u4g_mqtt.h" // U4G_MQTT_ENABLE
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef A_FEEDBACK_BIN_ENABLE
+#define A_FEEDBACK_BIN_ENABLE 0 // 1: 上报与配置下发改用套接字上的二进制协议，替代 HTTPS+JSON
+#endif
+
+#if A_FEEDBACK_BIN_ENABLE && !U4G_SOCK_ENABLE
+#error "二进制上报需要启用 U4G_SOCK_ENABLE"
+#endif
+#if A_FEEDBACK_BIN_ENABLE && U4G_MQTT_ENABLE
+#error "二进制上报与MQTT通道只能选择一种"
+#endif
+
+/**
+ * 二进制上报协议（大端序），参考服务器见 tools/feedback_bin_server.py：
+ *   帧头    0xA5 | 版本 | 类型 | 序号(2) | 内容长度(2)
+ *   内容    0~A_FEEDBACK_BIN_PAYLOAD_MAX 字节
+ *   认证码  HMAC-SHA256(会话秘钥, 帧头|内容) 前8字节，HELLO 及其 ACK 没有这一段
+ *   校验    CRC16-CCITT(0xFFFF)，覆盖之前的全部字节
+ * 除 ACK 外每帧都需要对方以 ACK 确认（停等），超时按原序号重发，接收方按序号去重。
+ * 连接建立后先认证（挑战-应答，截获的认证帧无法重放）：
+ *   HELLO 报上 IMEI，服务器在 ACK 中附带一次性的挑战随机数；
+ *   双方各自计算会话秘钥 HMAC-SHA256(秘钥, IMEI|挑战随机数|"session")；
+ *   AUTH 回以 HMAC-SHA256(秘钥, IMEI|挑战随机数)，服务器校验后挑战作废。
+ * 从 AUTH 起双向每帧都带会话认证码（覆盖类型与序号），认证码不符的帧直接丢弃，
+ * 链路上无法伪造或篡改；秘钥错误时设备收不到可校验的 ACK，按无应答处理并重建连接。
+ * 认证成功后服务器下发一次 CONFIG，之后配置变化时主动下发；认证完成前收到的 CONFIG 一律拒绝
+ */
+#define A_FEEDBACK_BIN_MAGIC 0xA5
+#define A_FEEDBACK_BIN_VERSION 3
+#define A_FEEDBACK_BIN_HEAD_LEN 7       // 帧头长度
+#define A_FEEDBACK_BIN_PAYLOAD_MAX 96   // 内容最大长度
+#define A_FEEDBACK_BIN_MAC_LEN 16       // AUTH 认证码长度（HMAC-SHA256 截断）
+#define A_FEEDBACK_BIN_FRAME_MAC_LEN 8  // 每帧会话认证码长度（HMAC-SHA256 截断）
+#define A_FEEDBACK_BIN_NONCE_LEN 8      // 挑战随机数长度
+#define A_FEEDBACK_BIN_ACK_TIMEOUT 5000 // 等待ACK的时间(ms)
+#define A_FEEDBACK_BIN_RETRY 3          // 超时重发次数，仍无应答时重建连接
+
+// 帧类型
+typedef enum
+{
+    A_FEEDBACK_BIN_HELLO = 1,     // 设备->服务器：IMEI长度(1) IMEI；ACK 附带 挑战随机数(8)
+    A_FEEDBACK_BIN_ACK = 2,       // 双向：被确认的序号(2) 结果(1) [附加内容]
+    A_FEEDBACK_BIN_TELEMETRY = 3, // 设备->服务器：a_feedback_bin_report_t 编码，见 a_feedback_bin_report
+    A_FEEDBACK_BIN_CONFIG = 4,    // 服务器->设备：若干个 配置编号(1) 值(4)
+    A_FEEDBACK_BIN_AUTH = 5,      // 设备->服务器：认证码(16)，对最近一次 HELLO 的挑战计算
+} a_feedback_bin_type_t;
+
+// ACK 结果
+typedef enum
+{
+    A_FEEDBACK_BIN_OK = 0,          // 已处理
+    A_FEEDBACK_BIN_ERR_AUTH = 1,    // 未认证或认证失败
+    A_FEEDBACK_BIN_ERR_FORMAT = 2,  // 内容无法解析
+    A_FEEDBACK_BIN_ERR_INVALID = 3, // 内容有效但无法应用
+} a_feedback_bin_status_t;
+
+// CONFIG 中的配置编号，新增时只能追加
+typedef enum
+{
+    A_FEEDBACK_BIN_CFG_CHARGING = 1,           // 计费模式
+    A_FEEDBACK_BIN_CFG_EXPIRE_TIME = 2,        // 到期时间
+    A_FEEDBACK_BIN_CFG_FILTER_LEVEL = 3,       // 滤芯值
+    A_FEEDBACK_BIN_CFG_DURATION_S = 4,         // 步长(秒)
+    A_FEEDBACK_BIN_CFG_FLUSH_POWER_ON = 5,     // 开机冲洗
+    A_FEEDBACK_BIN_CFG_FLUSH_LOW_END = 6,      // 低压结束
+    A_FEEDBACK_BIN_CFG_FLUSH_HIGH_START = 7,   // 高压进入
+    A_FEEDBACK_BIN_CFG_FLUSH_HIGH_END = 8,     // 高压结束
+    A_FEEDBACK_BIN_CFG_FLUSH_WATER_TOTAL = 9,  // 累计制水
+    A_FEEDBACK_BIN_CFG_FLUSH_WATER_TIME = 10,  // 累计制水冲洗
+    A_FEEDBACK_BIN_CFG_MAX,
+} a_feedback_bin_cfg_t;
+
+/**
+ * @brief 上报内容，编码为 20 字节：
+ *   累计制水(4) 流量计(4) 到期时间(4) 原水温度x10(2) 纯水温度x10(2) 原水TDS(1) 纯水TDS(1) 漏水(1) 信号值(1)
+ */
+typedef struct
+{
+    uint32_t total_water_time; // 累计制水时间
+    uint32_t flowmeter;        // 流量计
+    int32_t expire_time;       // 到期时间
+    float temp_raw;            // 原水温度
+    float temp_pure;           // 纯水温度
+    uint8_t tds_raw;           // 原水TDS
+    uint8_t tds_pure;          // 纯水TDS
+    bool water_leak;           // 漏水
+    int8_t signal;             // 信号值
+} a_feedback_bin_report_t;
+
+/**
+ * @brief 收到的配置，运行在URC分发任务中
+ * @param value 按配置编号索引的值
+ * @param found 第 i 位表示收到了编号 i 的配置
+ * @return 应用结果，作为 ACK 的结果返回给服务器
+ */
+typedef a_feedback_bin_status_t (*a_feedback_bin_config_cb_t)(const int32_t value[A_FEEDBACK_BIN_CFG_MAX], uint32_t found);
+
+esp_err_t a_feedback_bin_start(const char *host, uint16_t port, bool udp, const char *imei, const char *key, a_feedback_bin_config_cb_t cb);
+esp_err_t a_feedback_bin_report(const a_feedback_bin_report_t *report);
+bool a_feedback_bin_ready(void);
+
+#endif
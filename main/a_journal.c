@@ -0,0 +1,475 @@
+#include "a_journal.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_partition.h"
+#include "esp_crc.h"
+#include "esp_log.h"
+#include <string.h>
+
+#define TAG "A_JOURNAL" // 日志标签
+
+#define JOURNAL_SLOTS (A_JOURNAL_SECTOR / A_JOURNAL_SLOT) // 每扇区槽数，槽0为扇区头
+#define JOURNAL_SECTOR_MAGIC 0x4C4E524AUL                 // "JRNL"
+#define JOURNAL_REC_MAGIC 0x5A
+#define JOURNAL_SCAN_SLOTS 16 // 开机恢复时每次读取的槽数
+
+// 扇区头，擦除扇区后整条写入；drained 在扇区内记录全部确认后单独写为0
+typedef struct
+{
+    uint32_t magic;   // JOURNAL_SECTOR_MAGIC
+    uint32_t seq;     // 扇区序号，每启用一个扇区加1，最大的为正在写入的扇区
+    uint32_t first;   // 槽1的记录序号，槽 i 的记录序号为 first + i - 1
+    uint32_t crc;     // 前三项的CRC32
+    uint32_t drained; // 0xFFFFFFFF: 可能有未确认的记录；0: 已全部确认
+    uint8_t reserved[12];
+} journal_head_t;
+
+// 记录内容，按槽整条写入
+typedef struct __attribute__((packed))
+{
+    uint32_t seq;
+    uint32_t time;
+    uint32_t water_time;
+    uint32_t flowmeter;
+    int16_t temp_raw;
+    int16_t temp_pure;
+    uint8_t tds_raw;
+    uint8_t tds_pure;
+    uint8_t water_leak;
+    uint8_t reserved;
+} journal_body_t;
+
+// 记录槽：acked 在上传确认后单独写为0，不计入校验
+typedef struct
+{
+    uint8_t magic; // JOURNAL_REC_MAGIC
+    uint8_t acked; // 0xFF 未确认
+    uint16_t reserved;
+    uint32_t crc; // body 的CRC32
+    journal_body_t body;
+} journal_slot_t;
+
+_Static_assert(sizeof(journal_head_t) == A_JOURNAL_SLOT, "journal_head_t");
+_Static_assert(sizeof(journal_slot_t) == A_JOURNAL_SLOT, "journal_slot_t");
+
+// 槽状态
+typedef enum
+{
+    SLOT_EMPTY,  // 未写入
+    SLOT_BAD,    // 写入不完整（掉电）
+    SLOT_VALID,  // 有效记录
+} slot_state_t;
+
+static const esp_partition_t *journal_part = NULL;
+static SemaphoreHandle_t journal_lock = NULL;
+static volatile bool journal_ready = false; // 恢复完成后才接受读写（与联网流程并行初始化）
+static uint32_t sector_num = 0;
+static uint32_t head_sector = 0; // 正在写入的扇区
+static uint32_t head_slot = 1;   // 下一条记录写入的槽，等于 JOURNAL_SLOTS 时扇区已满
+static uint32_t head_seq = 0;    // 正在写入的扇区的扇区序号
+static uint32_t next_seq = 1;    // 下一条记录的记录序号
+static uint32_t tail_sector = 0; // 最早的未确认记录（之前的记录均已确认或无效）
+static uint32_t tail_slot = 1;
+static size_t pending = 0; // 未确认的记录数
+
+static size_t slot_addr(uint32_t sector, uint32_t slot)
+{
+    return (size_t)sector * A_JOURNAL_SECTOR + (size_t)slot * A_JOURNAL_SLOT;
+}
+
+static bool head_valid(const journal_head_t *h)
+{
+    return h->magic == JOURNAL_SECTOR_MAGIC && h->crc == esp_crc32_le(0, (const uint8_t *)h, offsetof(journal_head_t, crc));
+}
+
+static bool head_read(uint32_t sector, journal_head_t *h)
+{
+    return esp_partition_read(journal_part, slot_addr(sector, 0), h, sizeof(*h)) == ESP_OK && head_valid(h);
+}
+
+static slot_state_t slot_check(const journal_slot_t *s)
+{
+    if (s->magic == JOURNAL_REC_MAGIC && s->crc == esp_crc32_le(0, (const uint8_t *)&s->body, sizeof(s->body)))
+    {
+        return SLOT_VALID;
+    }
+    const uint8_t *p = (const uint8_t *)s;
+    for (size_t i = 0; i < sizeof(*s); i++)
+    {
+        if (p[i] != 0xFF)
+        {
+            return SLOT_BAD;
+        }
+    }
+    return SLOT_EMPTY;
+}
+
+static slot_state_t slot_read(uint32_t sector, uint32_t slot, journal_slot_t *s)
+{
+    if (esp_partition_read(journal_part, slot_addr(sector, slot), s, sizeof(*s)) != ESP_OK)
+    {
+        return SLOT_BAD;
+    }
+    return slot_check(s);
+}
+
+// 擦除并启用扇区
+static esp_err_t sector_open(uint32_t sector, uint32_t seq, uint32_t first)
+{
+    esp_err_t ret = esp_partition_erase_range(journal_part, slot_addr(sector, 0), A_JOURNAL_SECTOR);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    journal_head_t h;
+    memset(&h, 0xFF, sizeof(h));
+    h.magic = JOURNAL_SECTOR_MAGIC;
+    h.seq = seq;
+    h.first = first;
+    h.crc = esp_crc32_le(0, (const uint8_t *)&h, offsetof(journal_head_t, crc));
+    return esp_partition_write(journal_part, slot_addr(sector, 0), &h, sizeof(h));
+}
+
+// 扇区内记录已全部确认，之后开机恢复时不再逐条检查
+static void sector_drained(uint32_t sector)
+{
+    uint32_t zero = 0;
+    esp_partition_write(journal_part, slot_addr(sector, 0) + offsetof(journal_head_t, drained), &zero, sizeof(zero));
+}
+
+/**
+ * @brief 统计扇区中未确认的记录，并返回第一条的槽
+ * @param sector 扇区
+ * @param end 只检查 end 之前的槽
+ * @param first 输出第一条未确认记录的槽，没有时为 end
+ * @return 未确认的记录数
+ */
+static size_t sector_pending(uint32_t sector, uint32_t end, uint32_t *first)
+{
+    journal_slot_t buf[JOURNAL_SCAN_SLOTS];
+    size_t count = 0;
+    *first = end;
+    for (uint32_t slot = 1; slot < end; slot += JOURNAL_SCAN_SLOTS)
+    {
+        uint32_t n = end - slot < JOURNAL_SCAN_SLOTS ? end - slot : JOURNAL_SCAN_SLOTS;
+        if (esp_partition_read(journal_part, slot_addr(sector, slot), buf, n * sizeof(buf[0])) != ESP_OK)
+        {
+            continue;
+        }
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if (slot_check(&buf[i]) == SLOT_VALID && buf[i].acked == 0xFF)
+            {
+                if (count++ == 0)
+                {
+                    *first = slot + i;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+// 正在写入的扇区中下一个可写的槽：最后一个非空槽之后（写坏的槽不再使用）
+static uint32_t sector_head_slot(uint32_t sector)
+{
+    journal_slot_t buf[JOURNAL_SCAN_SLOTS];
+    uint32_t next = 1;
+    for (uint32_t slot = 1; slot < JOURNAL_SLOTS; slot += JOURNAL_SCAN_SLOTS)
+    {
+        uint32_t n = JOURNAL_SLOTS - slot < JOURNAL_SCAN_SLOTS ? JOURNAL_SLOTS - slot : JOURNAL_SCAN_SLOTS;
+        if (esp_partition_read(journal_part, slot_addr(sector, slot), buf, n * sizeof(buf[0])) != ESP_OK)
+        {
+            return JOURNAL_SLOTS; // 读取失败时不再写入该扇区
+        }
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if (slot_check(&buf[i]) != SLOT_EMPTY)
+            {
+                next = slot + i + 1;
+            }
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief 由扇区头与记录恢复读写位置：扇区序号最大的为写入扇区，向前连续的扇区为有效数据
+ */
+static esp_err_t journal_recover(void)
+{
+    journal_head_t h;
+    bool found = false;
+    for (uint32_t s = 0; s < sector_num; s++)
+    {
+        if (head_read(s, &h) && (!found || h.seq > head_seq))
+        {
+            found = true;
+            head_sector = s;
+            head_seq = h.seq;
+            next_seq = h.first;
+        }
+    }
+    if (!found)
+    {
+        ESP_LOGI(TAG, "日志分区为空，初始化");
+        head_sector = tail_sector = 0;
+        head_slot = tail_slot = 1;
+        head_seq = 1;
+        next_seq = 1;
+        pending = 0;
+        return sector_open(0, head_seq, next_seq);
+    }
+    head_slot = sector_head_slot(head_sector);
+    next_seq += head_slot - 1;
+
+    // 向前找到最早的有效扇区：扇区序号依次减1
+    uint32_t oldest = head_sector;
+    uint32_t seq = head_seq;
+    for (uint32_t n = 1; n < sector_num; n++)
+    {
+        uint32_t prev = (oldest + sector_num - 1) % sector_num;
+        if (!head_read(prev, &h) || h.seq != seq - 1)
+        {
+            break;
+        }
+        oldest = prev;
+        seq = h.seq;
+    }
+
+    // 从最早的扇区起统计未确认的记录
+    pending = 0;
+    tail_sector = head_sector;
+    tail_slot = head_slot;
+    bool tail_found = false;
+    for (uint32_t s = oldest;; s = (s + 1) % sector_num)
+    {
+        uint32_t end = s == head_sector ? head_slot : JOURNAL_SLOTS;
+        if (s == head_sector || (head_read(s, &h) && h.drained != 0))
+        {
+            uint32_t first;
+            size_t n = sector_pending(s, end, &first);
+            if (n && !tail_found)
+            {
+                tail_found = true;
+                tail_sector = s;
+                tail_slot = first;
+            }
+            pending += n;
+        }
+        if (s == head_sector)
+        {
+            break;
+        }
+    }
+    ESP_LOGI(TAG, "日志恢复: 写入扇区 %lu 槽 %lu, 下一序号 %lu, 未上传 %d 条",
+             head_sector, head_slot, next_seq, pending);
+    return ESP_OK;
+}
+
+/**
+ * @brief 打开日志分区并恢复读写位置
+ * @return ESP_OK 成功；失败时之后的操作均返回失败（不记录离线数据）
+ */
+esp_err_t a_journal_init(void)
+{
+    journal_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, A_JOURNAL_SUBTYPE, A_JOURNAL_PARTITION);
+    if (journal_part == NULL)
+    {
+        ESP_LOGE(TAG, "未找到日志分区 %s", A_JOURNAL_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    sector_num = journal_part->size / A_JOURNAL_SECTOR;
+    if (sector_num < 2)
+    {
+        ESP_LOGE(TAG, "日志分区过小");
+        return ESP_ERR_INVALID_SIZE;
+    }
+    journal_lock = xSemaphoreCreateMutex();
+    if (journal_lock == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = journal_recover();
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "日志恢复失败: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    journal_ready = true;
+    return ESP_OK;
+}
+
+// 写入扇区已满：启用下一个扇区，日志已满时覆盖最早的扇区
+static esp_err_t journal_advance(void)
+{
+    uint32_t next = (head_sector + 1) % sector_num;
+    if (next == tail_sector && pending > 0)
+    {
+        uint32_t first;
+        size_t lost = sector_pending(next, JOURNAL_SLOTS, &first);
+        ESP_LOGW(TAG, "日志已满，覆盖最早的 %d 条未上传记录", lost);
+        pending -= lost;
+        tail_sector = (next + 1) % sector_num;
+        tail_slot = 1;
+    }
+    esp_err_t ret = sector_open(next, head_seq + 1, next_seq);
+    // 扇区头写坏时仍使用该扇区：本次运行不受影响，重启后作为无效扇区跳过
+    head_sector = next;
+    head_seq++;
+    head_slot = 1;
+    if (pending == 0)
+    {
+        tail_sector = head_sector;
+        tail_slot = head_slot;
+    }
+    return ret;
+}
+
+/**
+ * @brief 追加一条记录
+ * @param rec 记录内容，seq 由此分配
+ * @return ESP_OK 成功
+ */
+esp_err_t a_journal_append(a_journal_rec_t *rec)
+{
+    if (!journal_ready)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(journal_lock, portMAX_DELAY);
+    esp_err_t ret = ESP_OK;
+    if (head_slot >= JOURNAL_SLOTS)
+    {
+        ret = journal_advance();
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "启用扇区 %lu 失败: %s", head_sector, esp_err_to_name(ret));
+        }
+    }
+    journal_slot_t s;
+    memset(&s, 0xFF, sizeof(s));
+    s.magic = JOURNAL_REC_MAGIC;
+    s.body.seq = rec->seq = next_seq;
+    s.body.time = rec->time;
+    s.body.water_time = rec->water_time;
+    s.body.flowmeter = rec->flowmeter;
+    s.body.temp_raw = rec->temp_raw;
+    s.body.temp_pure = rec->temp_pure;
+    s.body.tds_raw = rec->tds_raw;
+    s.body.tds_pure = rec->tds_pure;
+    s.body.water_leak = rec->water_leak;
+    s.crc = esp_crc32_le(0, (const uint8_t *)&s.body, sizeof(s.body));
+    if (ret == ESP_OK)
+    {
+        ret = esp_partition_write(journal_part, slot_addr(head_sector, head_slot), &s, sizeof(s));
+    }
+    // 记录序号与槽一一对应，写入失败的槽同样跳过
+    head_slot++;
+    next_seq++;
+    if (ret == ESP_OK)
+    {
+        pending++;
+    }
+    xSemaphoreGive(journal_lock);
+    return ret;
+}
+
+/**
+ * @brief 未上传的记录数
+ */
+size_t a_journal_pending(void)
+{
+    return pending;
+}
+
+/**
+ * @brief 从最早的未上传记录起读取
+ * @param recs 输出记录
+ * @param max 最多读取条数
+ * @return 读取的条数
+ */
+size_t a_journal_peek(a_journal_rec_t *recs, size_t max)
+{
+    if (!journal_ready)
+    {
+        return 0;
+    }
+    xSemaphoreTake(journal_lock, portMAX_DELAY);
+    size_t n = 0;
+    uint32_t sector = tail_sector;
+    uint32_t slot = tail_slot;
+    while (n < max && !(sector == head_sector && slot >= head_slot))
+    {
+        if (slot >= JOURNAL_SLOTS)
+        {
+            sector = (sector + 1) % sector_num;
+            slot = 1;
+            continue;
+        }
+        journal_slot_t s;
+        if (slot_read(sector, slot, &s) == SLOT_VALID && s.acked == 0xFF)
+        {
+            recs[n].seq = s.body.seq;
+            recs[n].time = s.body.time;
+            recs[n].water_time = s.body.water_time;
+            recs[n].flowmeter = s.body.flowmeter;
+            recs[n].temp_raw = s.body.temp_raw;
+            recs[n].temp_pure = s.body.temp_pure;
+            recs[n].tds_raw = s.body.tds_raw;
+            recs[n].tds_pure = s.body.tds_pure;
+            recs[n].water_leak = s.body.water_leak;
+            n++;
+        }
+        slot++;
+    }
+    xSemaphoreGive(journal_lock);
+    return n;
+}
+
+/**
+ * @brief 服务器已确认：标记序号不大于 seq 的记录，读位置移到之后
+ * @param seq 最后一条已上传记录的序号
+ * @return ESP_OK 成功
+ */
+esp_err_t a_journal_commit(uint32_t seq)
+{
+    if (!journal_ready)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(journal_lock, portMAX_DELAY);
+    esp_err_t ret = ESP_OK;
+    const uint8_t acked = 0;
+    while (!(tail_sector == head_sector && tail_slot >= head_slot))
+    {
+        if (tail_slot >= JOURNAL_SLOTS)
+        {
+            sector_drained(tail_sector);
+            tail_sector = (tail_sector + 1) % sector_num;
+            tail_slot = 1;
+            continue;
+        }
+        journal_slot_t s;
+        if (slot_read(tail_sector, tail_slot, &s) == SLOT_VALID)
+        {
+            if (s.body.seq > seq)
+            {
+                break;
+            }
+            if (s.acked == 0xFF)
+            {
+                ret = esp_partition_write(journal_part, slot_addr(tail_sector, tail_slot) + offsetof(journal_slot_t, acked), &acked, 1);
+                if (ret != ESP_OK)
+                {
+                    ESP_LOGE(TAG, "记录 %lu 确认失败: %s", s.body.seq, esp_err_to_name(ret));
+                    break;
+                }
+                pending--;
+            }
+        }
+        tail_slot++;
+    }
+    xSemaphoreGive(journal_lock);
+    return ret;
+}
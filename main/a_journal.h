@@ -0,0 +1,45 @@
+#ifndef _A_JOURNAL_H_
+#define _A_JOURNAL_H_
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 离线上报日志：未联网时按上报周期记录一条带时间戳的记录，联网后分批上传。
+ * 存放在 partitions.csv 中的 journal 分区，按扇区循环追加（各扇区轮流擦除，磨损均衡），
+ * 写满后覆盖最早的扇区。读/确认位置不单独保存，开机时由扇区头与记录状态恢复：
+ *   扇区头  魔数 | 扇区序号 | 首条记录序号 | CRC32 | 已全部确认标志
+ *   记录    魔数 | 确认标志 | CRC32 | 内容（a_journal_rec_t）
+ * 记录与扇区头整条写入，掉电写坏的记录因校验失败被跳过；上传成功后只把确认标志由 0xFF 写为 0x00，
+ * 不需要擦除。上传后、确认前掉电时这批记录会重传，服务器按记录序号去重
+ */
+#define A_JOURNAL_PARTITION "journal" // 分区名称
+#define A_JOURNAL_SUBTYPE 0x40        // 分区子类型（自定义数据分区）
+#define A_JOURNAL_SECTOR 4096         // 擦除扇区大小
+#define A_JOURNAL_SLOT 32             // 记录槽大小，扇区的第一个槽为扇区头
+
+/**
+ * @brief 一条离线记录：一个上报周期内的累计量与周期结束时的状态
+ */
+typedef struct
+{
+    uint32_t seq;        // 记录序号，由 a_journal_append 分配，重启后继续递增
+    uint32_t time;       // 时间戳(秒)
+    uint32_t water_time; // 本周期制水时间
+    uint32_t flowmeter;  // 本周期流量计
+    int16_t temp_raw;    // 原水温度x10
+    int16_t temp_pure;   // 纯水温度x10
+    uint8_t tds_raw;     // 原水TDS
+    uint8_t tds_pure;    // 纯水TDS
+    bool water_leak;     // 漏水
+} a_journal_rec_t;
+
+esp_err_t a_journal_init(void);
+esp_err_t a_journal_append(a_journal_rec_t *rec);
+size_t a_journal_pending(void);
+size_t a_journal_peek(a_journal_rec_t *recs, size_t max);
+esp_err_t a_journal_commit(uint32_t seq);
+
+#endif
@@ -4,13 +4,17 @@
 #include "gpio_buzzer.h" // 蜂鸣器类
 #include "u4g_at_cmd.h"
 #include "u4g_at_http.h"
+#include "u4g_at_sched.h"
 #include "u4g_data.h"
+#include "u4g_supervisor.h"
+#include "u4g_json.h"
 #include "a_nvs_flash.h" // nvs_flash应用类
 #include "a_feedback.h"
 #include "a_service.h" // 应用服务类
 #include "a_time.h"
-#include "cJSON.h"
+#include "a_boot.h" // 启动里程碑
 #include "esp_log.h"
+#include <stdlib.h>
 #include <string.h>
 #include "esp_task_wdt.h" // 包含看门狗相关库
 #include "esp_timer.h"    // 添加此行以包含时间相关函数
@@ -19,33 +23,13 @@
 
 #define DEBUG 0
 
-#define NETWORK_RETRY_THRESHOLD 5 // 重试次数阈值
+#define NET_EVENT_WAIT_MS 5000 // 单次等待时长（小于看门狗超时）
+#define NET_OFFLINE_MS 30000   // 迟迟未联网时执行一次离线流程的等待时间
 
 /******************************/
 /*  1. 通用辅助函数          */
 /******************************/
 
-/**
- * @brief 根据返回码决定是否重启 4G 模块，并更新重试计数
- */
-static void reset_device_if_needed(uint16_t *retry_count, emU4GResult ret)
-{
-    if (ret != U4G_OK)
-    {
-        (*retry_count)++;
-        if (*retry_count > NETWORK_RETRY_THRESHOLD)
-        {
-            ESP_LOGE(TAG, "重试次数超过 %d，硬重启 4G 模块", NETWORK_RETRY_THRESHOLD);
-            u4g_at_reboot_hard();
-            // *retry_count = 0;
-        }
-        else if (*retry_count > 100)
-        {
-            ESP_LOGE(TAG, "重试次数超过 %d，重启ESP系统", 100);
-            esp_restart();
-        }
-    }
-}
 /**
  * @brief 从 NVS 读取 IMEI，长度校验
  * @param[out] imei 输出指针
@@ -62,6 +46,46 @@ static esp_err_t get_imei_from_nvs(char **imei)
     return ESP_OK;
 }
 
+/**
+ * @brief 模块连接状态变化（监管任务中回调）：同步联网状态与指示灯
+ */
+static void sup_state_changed(u4g_sup_state_t from, u4g_sup_state_t to, void *arg)
+{
+    if (to == U4G_SUP_DATA_READY)
+    {
+        ESP_LOGI(TAG, "设备-4G已联网");
+        a_boot_mark("net_ready");
+        DEVICE.NETSTATE = DEVICE_NETON;
+        a_led_timer(0); // 灯常亮
+    }
+    else if (from == U4G_SUP_DATA_READY)
+    {
+        ESP_LOGW(TAG, "设备-4G网络断开(%s)", u4g_sup_state_name(to));
+        DEVICE.NETSTATE = DEVICE_NETOFF;
+        a_led_timer(-1); // 未联网-常灭
+    }
+}
+
+/**
+ * @brief 等待数据业务可用，分段等待以便喂狗
+ * @param timeout_ms 最长等待时间
+ * @return 可用返回true
+ */
+static bool net_ready_wait(uint32_t timeout_ms)
+{
+    while (timeout_ms > 0)
+    {
+        uint32_t wait = timeout_ms > NET_EVENT_WAIT_MS ? NET_EVENT_WAIT_MS : timeout_ms;
+        esp_task_wdt_reset();
+        if (u4g_sup_wait(U4G_SUP_DATA_READY, wait))
+        {
+            return true;
+        }
+        timeout_ms -= wait;
+    }
+    return false;
+}
+
 /******************************/
 /*  2. 网络初始化任务         */
 /******************************/
@@ -72,146 +96,93 @@ void a_network_init(void *pvParameters)
 {
     ESP_LOGI(TAG, "网络初始化任务启动");
     esp_task_wdt_add(NULL); // 注册到 Task WDT
+    u4g_at_sched_class_set(U4G_AT_CLASS_CONTROL); // 驻网、鉴权优先于周期上报
     a_led_timer(1);         // 灯闪烁提示
 
     DEVICE.NETSTATE = DEVICE_NETRUN; // 联网中
-    bool inited = false;
-    bool checked = false;
-    bool check_net_not = false;
     bool authed = false;
     emU4GResult ret;
-    uint16_t retry_count = 0;
+    u4g_sup_subscribe(sup_state_changed, NULL);
 
-    while (1)
+    // 2.1 等待数据业务可用：模块检测、SIM、注册、附着及故障恢复均由 u4g_supervisor 负责
+    if (!net_ready_wait(NET_OFFLINE_MS))
     {
-        esp_task_wdt_reset();
+        ESP_LOGI(TAG, "设备-检测到未联网,执行首次离线流程");
+        a_led_timer(-1); // 未联网-常灭
+        DEVICE.NETSTATE = DEVICE_NETOFF;
+        a_time_sync_offline();    // 执行获取离线时间
+        a_service_expiry_check(); // 判断是否到期
+        if (a_feedback_offline_start() != ESP_OK) // 联网前按上报周期记录离线日志
+        {
+            ESP_LOGE(TAG, "离线日志记录启动失败");
+        }
+    }
 
-        // 2.1 AT 指令初始化
-        if (!inited)
+    while (!authed)
+    {
+        while (!net_ready_wait(NET_EVENT_WAIT_MS))
         {
-            ret = u4g_at();
-            reset_device_if_needed(&retry_count, ret);
-            if (ret == U4G_OK)
-            {
-                inited = true;
-                retry_count = 0; // 重置重试错误
-                ESP_LOGI(TAG, "AT 模块初始化成功");
-            }
-            else
-            {
-                ESP_LOGW(TAG, "AT 初始化失败，重试中...");
-                vTaskDelay(pdMS_TO_TICKS(2000));
-                continue;
-            }
+            ESP_LOGD(TAG, "等待4G数据业务可用: %s", u4g_sup_state_name(u4g_sup_state_get()));
+        }
+        if (DEVICE.NETSTATE != DEVICE_NETON) // 订阅前已联网时不会收到状态变化
+        {
+            DEVICE.NETSTATE = DEVICE_NETON;
+            a_led_timer(0); // 灯常亮
         }
 
-        // 2.2 网络状态检测
-        if (!checked)
+        // 2.2 获取并保存 IMEI
+        char *imei = NULL;
+        u4g_data_t u4g_snap;
+        if (get_imei_from_nvs(&imei) != ESP_OK)
         {
-            ret = u4g_at_netstatus();
-            reset_device_if_needed(&retry_count, ret);
-            if (ret == U4G_OK)
-            {
-                checked = true;
-                DEVICE.NETSTATE = DEVICE_NETON; // 已联网
-                a_led_timer(0);                 // 灯常亮
-                retry_count = 0;                // 重置重试错误
-                ESP_LOGI(TAG, "设备-4G已联网");
-            }
-            else if (ret == U4G_STATE_AT_NET_NOT)
+            // NVS 未配置，执行 AT 获取
+            ret = u4g_at_imei_get();
+            if (ret != U4G_OK)
             {
-                ESP_LOGW(TAG, "设备-未联网,等待重试");
-                if (!check_net_not)
-                {
-                    ESP_LOGI(TAG, "设备-检测到未联网,执行首次离线流程");
-                    a_led_timer(-1); // 未联网-常灭
-                    DEVICE.NETSTATE = DEVICE_NETOFF;
-                    a_time_sync_offline();    // 执行获取离线时间
-                    a_service_expiry_check(); // 判断是否到期
-                    check_net_not = true;     // 已执行离线流程
-                }
-                for (int i = 0; i < 10; i++)
-                {
-                    esp_task_wdt_reset();
-                    vTaskDelay(pdMS_TO_TICKS(1000));
-                }
+                ESP_LOGW(TAG, "IMEI 获取失败");
+                vTaskDelay(pdMS_TO_TICKS(3000));
                 continue;
             }
-            else
+            u4g_data_snapshot(&u4g_snap);
+            imei = u4g_snap.imei;
+            if (a_nvs_flash_insert("deviceid", imei) != ESP_OK) // 保存设备ID
             {
-                ESP_LOGW(TAG, "设备-网络模块异常，准备系统重启进度：%d/5", retry_count);
+                ESP_LOGE(TAG, "[4G] 设备ID保存失败");
+                continue; // 继续循环
             }
-            vTaskDelay(pdMS_TO_TICKS(1000));
         }
+        strncpy(DEVICE.IMEI, imei, sizeof(DEVICE.IMEI));
+        // free(imei); // 释放堆内存
+        ESP_LOGI(TAG, "获取设备IMEI: %s", DEVICE.IMEI);
 
-        // 2.3 获取并保存 IMEI
-        if (checked && !authed)
+        // 2.3 设备认证
+        esp_err_t auth_ret = network_auth_4g();
+        u4g_sup_data_report(auth_ret != ESP_FAIL); // 请求失败累计到一定次数由监管任务复查链路
+        if (auth_ret == 200)
         {
-            char *imei = NULL;
-            if (get_imei_from_nvs(&imei) != ESP_OK)
-            {
-                // NVS 未配置，执行 AT 获取
-                ret = u4g_at_imei_get();
-                reset_device_if_needed(&retry_count, ret);
-                if (ret == U4G_OK)
-                {
-                    imei = u4g_data_get()->imei;
-                    if (a_nvs_flash_insert("deviceid", imei) != ESP_OK) // 保存设备ID
-                    {
-                        ESP_LOGE(TAG, "[4G] 设备ID保存失败");
-                        continue; // 继续循环
-                    }
-                    retry_count = 0; // 重置重试错误
-                }
-                else
-                {
-                    ESP_LOGW(TAG, "IMEI 获取失败");
-                    vTaskDelay(pdMS_TO_TICKS(3000));
-                    continue;
-                }
-            }
-            strncpy(DEVICE.IMEI, imei, sizeof(DEVICE.IMEI));
-            // free(imei); // 释放堆内存
-            ESP_LOGI(TAG, "获取设备IMEI: %s", DEVICE.IMEI);
+            ESP_LOGI(TAG, "设备认证-入库成功");
         }
-
-        // 2.4 设备认证
-        if (checked && !authed)
+        else if (auth_ret == 3001)
         {
-            esp_err_t auth_ret = network_auth_4g();
-            reset_device_if_needed(&retry_count, auth_ret);
-            if (auth_ret == 200)
-            {
-                ESP_LOGI(TAG, "设备认证-入库成功");
-            }
-            else if (auth_ret == 3001)
-            {
-                ESP_LOGI(TAG, "设备认证-未激活，等待后重试");
-                vTaskDelay(pdMS_TO_TICKS(5000));
-                // continue;
-            }
-            else if (auth_ret == 3002)
-            {
-                ESP_LOGI(TAG, "设备认证-已激活");
-                authed = true;
-            }
-            else if (auth_ret == 1001)
-            {
-                ESP_LOGE(TAG, "设备认证-认证秘钥无效-执行清空设备id和秘钥");
-                a_nvs_flash_del("deviceid");
-                a_nvs_flash_del("key");
-            }
-            else
-            {
-                ESP_LOGW(TAG, "设备认证-认证异常，code=%d，重试中", auth_ret);
-                vTaskDelay(pdMS_TO_TICKS(3000));
-                continue;
-            }
+            ESP_LOGI(TAG, "设备认证-未激活，等待后重试");
+            vTaskDelay(pdMS_TO_TICKS(5000));
+        }
+        else if (auth_ret == 3002)
+        {
+            ESP_LOGI(TAG, "设备认证-已激活");
+            authed = true;
+        }
+        else if (auth_ret == 1001)
+        {
+            ESP_LOGE(TAG, "设备认证-认证秘钥无效-执行清空设备id和秘钥");
+            a_nvs_flash_del("deviceid");
+            a_nvs_flash_del("key");
         }
-        // 全部完成则跳出
-        if (inited && checked && authed)
+        else
         {
-            break;
+            ESP_LOGW(TAG, "设备认证-认证异常，code=%d，重试中", auth_ret);
+            vTaskDelay(pdMS_TO_TICKS(3000));
+            continue;
         }
         vTaskDelay(pdMS_TO_TICKS(500));
     }
@@ -237,10 +208,54 @@ void a_network_init(void *pvParameters)
 
     // 退出任务
     ESP_LOGI(TAG, "网络初始化任务结束");
+    u4g_at_sched_class_set(U4G_AT_CLASS_NONE);
     esp_task_wdt_delete(NULL);
     vTaskDelete(NULL);
 }
 
+// 认证响应中关注的字段
+typedef struct
+{
+    int32_t code;
+    bool has_code;
+    bool has_data;
+    bool has_key;
+    char key[64];
+} auth_rsp_t;
+
+enum
+{
+    AUTH_CODE,
+    AUTH_DATA,
+    AUTH_KEY,
+};
+static const u4g_json_field_t auth_fields[] = {
+    [AUTH_CODE] = {"code", U4G_JSON_NUMBER},
+    [AUTH_DATA] = {"data", U4G_JSON_OBJECT},
+    [AUTH_KEY] = {"data.key", U4G_JSON_STRING},
+};
+
+static void auth_field(const char *path, u4g_json_type_t type, const char *value, void *arg)
+{
+    auth_rsp_t *rsp = arg;
+    switch (u4g_json_field_find(auth_fields, sizeof(auth_fields) / sizeof(auth_fields[0]), path, type))
+    {
+    case AUTH_CODE:
+        rsp->code = atoi(value);
+        rsp->has_code = true;
+        break;
+    case AUTH_DATA:
+        rsp->has_data = true;
+        break;
+    case AUTH_KEY:
+        strncpy(rsp->key, value, sizeof(rsp->key) - 1);
+        rsp->has_key = true;
+        break;
+    default:
+        break;
+    }
+}
+
 esp_err_t network_auth_4g(void)
 {
     ESP_LOGI(TAG, "[4G] 正在获取KEY...");
@@ -258,8 +273,9 @@ esp_err_t network_auth_4g(void)
         {
             ESP_LOGW(TAG, "[4G] send CMD-MCCID FAIL");
         }
-        char *mccid = u4g_data_get()->mccid;
-        snprintf(path, 256, "/api/v1/device/auth?deviceid=%s&model=%s&version=%d&mccid=%s", DEVICE.IMEI, CONFIG_PROJECT_NAME, CONFIG_BOOTLOADER_PROJECT_VER, mccid);
+        u4g_data_t u4g_snap;
+        u4g_data_snapshot(&u4g_snap);
+        snprintf(path, 256, "/api/v1/device/auth?deviceid=%s&model=%s&version=%d&mccid=%s", DEVICE.IMEI, CONFIG_PROJECT_NAME, CONFIG_BOOTLOADER_PROJECT_VER, u4g_snap.mccid);
     }
     else
     {
@@ -268,7 +284,16 @@ esp_err_t network_auth_4g(void)
         snprintf(path, 200, "/api/v1/device/auth?deviceid=%s&model=%s&key=%s", DEVICE.IMEI, CONFIG_PROJECT_NAME, key);
         free(key);
     }
-    emU4GResult ret = u4g_at_http_request(HTTP_URL, path, NULL);
+    // 响应直接流入解析器，只保留 code 和 data.key
+    auth_rsp_t rsp = {0};
+    u4g_json_t json;
+    u4g_json_init(&json, auth_field, &rsp);
+    u4g_json_watch(&json, auth_fields, sizeof(auth_fields) / sizeof(auth_fields[0]));
+    u4g_http_sink_t sink = {
+        .write = u4g_json_sink_write,
+        .arg = &json,
+    };
+    emU4GResult ret = u4g_at_http_request_sink(HTTP_URL, path, NULL, &sink);
     free(path);
     esp_task_wdt_reset(); // 喂狗
     if (ret != U4G_OK)
@@ -276,85 +301,62 @@ esp_err_t network_auth_4g(void)
         ESP_LOGE(TAG, "HTTP GET请求失败 错误码: %d", ret);
         return ESP_FAIL;
     }
-    char *u4g_data = (char *)u4g_data_get()->data;
-    if (u4g_data == NULL)
-    {
-        ESP_LOGE(TAG, "u4g_data 无数据");
-        return ESP_FAIL;
-    }
-    ESP_LOGD(TAG, "HTTP GET请求成功 提取JSON数据: %s", u4g_data);
-
-    // 解析JSON数据
-    cJSON *root = cJSON_Parse(u4g_data);
-    if (!root)
+    if (u4g_json_finish(&json) != U4G_OK)
     {
         ESP_LOGE(TAG, "解析JSON数据失败");
         return ESP_FAIL;
     }
 
     // 获取"code"字段
-    cJSON *code_item = cJSON_GetObjectItem(root, "code");
-    if (!cJSON_IsNumber(code_item))
+    if (!rsp.has_code)
     {
         ESP_LOGE(TAG, "code 字段无效");
-        cJSON_Delete(root);
         return ESP_FAIL;
     }
-    if (code_item->valueint == 200)
+    if (rsp.code == 200)
     {
         ESP_LOGI(TAG, "配网入库请求成功");
 
         // 获取"data"对象
-        cJSON *data_item = cJSON_GetObjectItem(root, "data");
-        if (!cJSON_IsObject(data_item))
+        if (!rsp.has_data)
         {
             ESP_LOGE(TAG, "data 字段无效");
-            cJSON_Delete(root);
             return ESP_FAIL;
         }
         // 获取"key"字段
-        cJSON *key_item = cJSON_GetObjectItem(data_item, "key");
-        if (!cJSON_IsString(key_item))
+        if (!rsp.has_key)
         {
             ESP_LOGE(TAG, "key 字段无效");
-            cJSON_Delete(root);
             return ESP_FAIL;
         }
         // 保存 key 到 NVS
-        if (a_nvs_flash_insert("key", key_item->valuestring) == ESP_OK)
+        if (a_nvs_flash_insert("key", rsp.key) == ESP_OK)
         {
-            ESP_LOGI(TAG, "[4G] key值已配置到设备中: %s", key_item->valuestring);
+            ESP_LOGI(TAG, "[4G] key值已配置到设备中: %s", rsp.key);
             ESP_LOGI(TAG, "[4G] 配网入库成功");
-            cJSON_Delete(root);
             return 200;
         }
         else
         {
             ESP_LOGE(TAG, "[4G] 保存设备key键值失败");
-            cJSON_Delete(root);
             return ESP_FAIL;
         }
     }
-    else if (code_item->valueint == 3001)
+    else if (rsp.code == 3001)
     {
-        cJSON_Delete(root);
         return 3001;
     }
-    else if (code_item->valueint == 3002)
+    else if (rsp.code == 3002)
     {
-        cJSON_Delete(root);
         return 3002;
     }
-    else if (code_item->valueint == 1001)
+    else if (rsp.code == 1001)
     {
-        cJSON_Delete(root);
         return 1001;
     }
     else
     {
-        ESP_LOGE(TAG, "未知错误，代码: %d", code_item->valueint);
-        // 清空JSON数据以节省内存
-        cJSON_Delete(root);
+        ESP_LOGE(TAG, "未知错误，代码: %ld", rsp.code);
         return ESP_FAIL;
     }
 }
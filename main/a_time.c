@@ -1,6 +1,7 @@
 #include "a_time.h"
 #include "head.h"
 #include "u4g_at_cmd.h"
+#include "u4g_at_sched.h"
 #include "u4g_data.h"
 #include "lwip/apps/sntp.h"
 #include "a_nvs_flash.h" // nvs_flash应用类
@@ -13,15 +14,19 @@
 // 联网同步时间
 esp_err_t a_time_sync(void)
 {
-    // &raw_time
+    // 对时不紧急，让出给其他AT指令
+    u4g_at_class_t cls = u4g_at_sched_class_set(U4G_AT_CLASS_BACKGROUND);
     emU4GResult ret = u4g_at_time_get();
+    u4g_at_sched_class_set(cls);
     if (ret != U4G_OK)
     {
         ESP_LOGE(TAG, "AT获取时间失败，错误码：%d", ret);
         return ESP_FAIL;
     }
 
-    char *time_input = u4g_data_get()->time;
+    u4g_data_t u4g_snap;
+    u4g_data_snapshot(&u4g_snap);
+    const char *time_input = u4g_snap.time;
     ESP_LOGE(TAG, "4G模块，获取网络时间: %s", time_input);
 
     // 分离日期时间和时区
@@ -114,6 +114,17 @@ uint32_t gpio_flowmeter_get_pulse_count(void)
     return count;
 }
 
+/**
+ * @brief 扣除已上报的脉冲数，与中断中的计数共用同一把锁，扣除期间新增的脉冲不会丢失
+ * @param count 扣除的脉冲数，不超过当前计数
+ */
+void gpio_flowmeter_take(uint32_t count)
+{
+    portENTER_CRITICAL(&mux);
+    DEVICE.flowmeter -= count;
+    portEXIT_CRITICAL(&mux);
+}
+
 // 重置脉冲计数
 void gpio_flowmeter_reset_count(void)
 {
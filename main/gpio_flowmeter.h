@@ -9,6 +9,7 @@
 
 esp_err_t gpio_flowmeter_init(void);
 uint32_t gpio_flowmeter_get_pulse_count(void);
+void gpio_flowmeter_take(uint32_t count);
 void gpio_flowmeter_reset_count(void);
 // float gpio_flowmeter_get_liters(void);
 
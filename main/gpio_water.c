@@ -5,6 +5,7 @@
 #include "gpio_water_timer.h" // 引入制水时间类
 #include "gpio_buzzer.h"      // 蜂鸣器类
 #include "a_feedback.h"       // 设备反馈
+#include "a_boot.h"           // 启动里程碑
 // #include "freertos/FreeRTOS.h"
 #include "esp_attr.h" // 包含 IRAM_ATTR 的定义
 #include "esp_log.h"
@@ -282,6 +283,7 @@ static void handle_state_change(water_state_t state)
         event.data.led_water = true;              // 制水灯点亮
         gpio_set_level(CONFIG_WATER_GPIO_NUM, 1); // 开启水泵
         gpio_water_production_time_set(true);     // 开始制水计时-冲洗定时
+        a_boot_mark("first_water");               // 上电到首次制水的耗时
     }
     else
     {
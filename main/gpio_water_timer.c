@@ -3,9 +3,12 @@
 #include "gpio_flush.h"
 #include "esp_timer.h" // 添加此行以包含时间相关函数
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
 
 #define TAG "GPIO-WATER-TIMER"
 
+static portMUX_TYPE water_lock = portMUX_INITIALIZER_UNLOCKED; // 保护 DEVICE.total_water_time（64位读写不是原子的）
+
 // 累计制水时间参数
 static uint64_t water_production_time_start = 0; // 上一个开始计算的耗时微秒
 static uint64_t water_production_time = 0;       // 制水累计时间-秒
@@ -36,7 +39,9 @@ void gpio_water_production_time_set(bool type)
             uint64_t diff = microseconds - water_production_time_start; // 微秒
             uint64_t seconds = (uint64_t)(diff / 1000000);              // 转换为秒
             water_production_time += seconds;                           // 只存储非负的制水时间
-            DEVICE.total_water_time += seconds;                         // 只存储非负的制水时间
+            portENTER_CRITICAL(&water_lock);
+            DEVICE.total_water_time += seconds; // 只存储非负的制水时间
+            portEXIT_CRITICAL(&water_lock);
             ESP_LOGI(TAG, "累计制水耗时 %lld 秒", water_production_time);
 
             if (water_production_time > FLUSH_TIME.WATER_TOTAL) // 累计制水时间超过
@@ -50,4 +55,27 @@ void gpio_water_production_time_set(bool type)
     {
         ESP_LOGE(TAG, "累计制水时间读取失败: %lld", microseconds);
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 读取累计制水时间
+ * @return 累计制水时间(秒)
+ */
+uint64_t gpio_water_total_time_get(void)
+{
+    portENTER_CRITICAL(&water_lock);
+    uint64_t seconds = DEVICE.total_water_time;
+    portEXIT_CRITICAL(&water_lock);
+    return seconds;
+}
+
+/**
+ * @brief 扣除已上报的累计制水时间，与计时结束时的累加共用同一把锁
+ * @param seconds 扣除的秒数，不超过当前累计值
+ */
+void gpio_water_total_time_take(uint64_t seconds)
+{
+    portENTER_CRITICAL(&water_lock);
+    DEVICE.total_water_time -= seconds;
+    portEXIT_CRITICAL(&water_lock);
+}
@@ -2,7 +2,10 @@
 #define GPIO_WATER_TIMER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 void gpio_water_production_time_set(bool type);
+uint64_t gpio_water_total_time_get(void);
+void gpio_water_total_time_take(uint64_t seconds);
 
 #endif
\ No newline at end of file
@@ -7,6 +7,18 @@
 // ------- 联网相关信息 -------
 // HTTP相关配置
 #define HTTP_URL "https://api.iot.zsyxlife.cn"
+#define HTTP_CBOR 0 // 1: 请求声明可接受CBOR，服务器以CBOR响应后上报改用CBOR
+// 上报相关配置（HTTP 与 MQTT 通道）
+#define FEEDBACK_DELTA 0     // 1: 增量上报，只发送与最近确认的上报相比有变化的字段，附序号 seq
+#define FEEDBACK_KEYFRAME 10 // 增量上报时每多少次发送一次全部字段（关键帧，附 "key": true）
+// MQTT相关配置（components/u4g 中 U4G_MQTT_ENABLE 为1时使用）
+#define MQTT_HOST "api.iot.zsyxlife.cn"
+#define MQTT_PORT 8883
+#define MQTT_TLS true
+// 二进制上报相关配置（a_feedback_bin.h 中 A_FEEDBACK_BIN_ENABLE 为1时使用）
+#define BIN_HOST "api.iot.zsyxlife.cn"
+#define BIN_PORT 9510
+#define BIN_UDP false
 
 // 制水GPIO配置
 #define CONFIG_WATER_GPIO_NUM GPIO_NUM_4      // 制水接口
@@ -78,9 +90,9 @@ typedef struct
     char MCCID[32];            // 设备MCCID
     char IMEI[25];             // 设备IMEI-设备ID
     // char KEY[64];   // 设备秘钥
-    uint64_t total_water_time;   // 累计制水时间
+    uint64_t total_water_time;   // 累计制水时间，只经 gpio_water_timer.h 中的接口读写
     bool WATER_LEAK;             // 设备状态
-    volatile uint32_t flowmeter; // 流量计
+    volatile uint32_t flowmeter; // 流量计，只经 gpio_flowmeter.h 中的接口读写
     int32_t expire_time;         // 到期时间
     uint32_t duration_s;         // 步长(秒)
     uint8_t signal;              // 信号值
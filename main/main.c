@@ -3,6 +3,9 @@
 #include "a_nvs_flash.h" // nvs_flash应用类
 #include "a_led_event.h"
 #include "a_network.h" // 网络工作类
+#include "a_boot.h"    // 启动编排
+#include "a_console.h" // 调试命令行
+#include "a_journal.h" // 离线上报日志
 #include "gpio_water.h"
 #include "gpio_blackout.h"
 #include "gpio_tds.h"
@@ -11,6 +14,7 @@
 #include "u4g_uart.h"
 #include "u4g_at_cmd.h"
 #include "u4g_at_http.h"
+#include "u4g_at_sched.h"
 #include "u4g.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -18,25 +22,22 @@
 #include "esp_log.h"
 #include <string.h>
 #define TAG "MAIN" // 日志标签
+#define BOOT_TIMEOUT_MS 60000 // 启动步骤全部完成的最长时间
 #include "hal/wdt_hal.h"
 // #include "esp_wifi.h"
 
 TaskHandle_t net_task_handle = NULL;
 // xtensa-esp32s3-elf-addr2line -pfiaC -e build/CXSZN-WATER.elf 0x403c8b01
 
-// 主任务初始化
-static esp_err_t main_task_init(void)
+// -------- 启动步骤 --------
+static esp_err_t boot_nvs(void)
 {
-    DEVICE.RUNSTATE = READY_RUN; // 就绪中
-    esp_err_t ret;
+    return a_nvs_flash_init(); // 初始化NVS应用类
+}
 
-    ret = a_nvs_flash_init(); // 初始化NVS应用类
-    if (ret != ESP_OK)
-    {
-        ESP_LOGE(TAG, "a_nvs_flash_init初始化失败(错误码：%s)，执行重启", esp_err_to_name(ret));
-        return ESP_FAIL;
-    }
-    // -------- LED控制初始化 -------
+// LED控制初始化（显示驱动在事件任务中初始化）
+static esp_err_t boot_display(void)
+{
     if (a_led_event_queue == NULL)
     {
         a_led_event_queue = xQueueCreate(10, sizeof(a_led_event_t));
@@ -52,59 +53,95 @@ static esp_err_t main_task_init(void)
         ESP_LOGE(TAG, "创建LED事件处理任务失败");
         return ESP_FAIL;
     }
-    if (gpio_water_init() != ESP_OK)
-    {
-        ESP_LOGE(TAG, "gpio_water_init create fail");
-        return ESP_FAIL;
-    }
-    if (gpio_tds_init() != ESP_OK)
-    {
-        ESP_LOGE(TAG, "gpio_tds_init create fail");
-        return ESP_FAIL;
-    }
-    if (gpio_flowmeter_init() != ESP_OK)
+    return ESP_OK;
+}
+
+// GPIO中断服务：制水、流量计、掉电检测共用，先于它们安装，避免并行初始化时重复安装
+static esp_err_t boot_gpio_isr(void)
+{
+    if (!is_isr_service_installed)
     {
-        ESP_LOGE(TAG, "gpio_flowmeter_init create fail");
-        return ESP_FAIL;
+        esp_err_t ret = gpio_install_isr_service(ESP_INTR_FLAG_LEVEL1);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "安装GPIO中断服务失败: %s", esp_err_to_name(ret));
+            return ret;
+        }
+        is_isr_service_installed = true;
     }
+    return ESP_OK;
+}
+
+// AT初始化：复位模块、协商波特率
+static esp_err_t boot_modem(void)
+{
+    return u4g_init() == U4G_OK ? ESP_OK : ESP_FAIL;
+}
 
-    if (gpio_blackout_init() != ESP_OK)
+// 创建网络初始化任务
+static esp_err_t boot_network(void)
+{
+    if (xTaskCreate(a_network_init, "a_network_init", 10240, NULL, 6, &net_task_handle) != pdPASS)
     {
-        ESP_LOGE(TAG, "gpio_blackout_init fail");
+        ESP_LOGE(TAG, "a_network_init create fail");
         return ESP_FAIL;
     }
-
-    ESP_LOGI(TAG, "主任务初始化完成");
     return ESP_OK;
 }
 
-// 联网任务初始化
-static esp_err_t net_task_init(void)
+// 调试命令行，失败不影响启动
+static esp_err_t boot_console(void)
 {
-    // AT初始化
-    if (u4g_init() != U4G_OK)
+    if (a_console_init() != ESP_OK)
     {
-        ESP_LOGE(TAG, "u4g_init初始化失败");
-        return ESP_FAIL;
+        ESP_LOGW(TAG, "调试命令行启动失败");
     }
-    // 创建网络初始化
-    if (xTaskCreate(a_network_init, "a_network_init", 10240, NULL, 6, &net_task_handle) != pdPASS)
+    return ESP_OK;
+}
+
+// 离线上报日志，失败时不记录离线数据，不影响启动
+static esp_err_t boot_journal(void)
+{
+    if (a_journal_init() != ESP_OK)
     {
-        ESP_LOGE(TAG, "a_network_init create fail");
-        return ESP_FAIL;
+        ESP_LOGW(TAG, "离线上报日志不可用");
     }
-    // xTaskCreatePinnedToCore(
-    //     a_network_init,   // 任务函数
-    //     "a_network_init", // 任务名称
-    //     8192,             // 栈大小
-    //     NULL,             // 参数
-    //     0,                // 优先级（数值越低优先级越低）
-    //     NULL,             // 任务句柄
-    //     1                 // 核心编号（0=核心0，1=核心1）
-    // );
     return ESP_OK;
 }
 
+enum
+{
+    BOOT_NVS,
+    BOOT_DISPLAY,
+    BOOT_GPIO_ISR,
+    BOOT_WATER,
+    BOOT_TDS,
+    BOOT_FLOWMETER,
+    BOOT_BLACKOUT,
+    BOOT_MODEM,
+    BOOT_NETWORK,
+    BOOT_CONSOLE,
+    BOOT_JOURNAL,
+    BOOT_STEP_NUM,
+};
+/**
+ * 启动步骤表：模块复位与波特率协商(数秒)、TDS通道识别(3秒)与本地外设初始化并行，
+ * 制水只依赖本地外设，不等待联网
+ */
+static const a_boot_step_t boot_steps[BOOT_STEP_NUM] = {
+    [BOOT_NVS] = {"nvs", boot_nvs, 0, 0},
+    [BOOT_DISPLAY] = {"display", boot_display, 0, 0},
+    [BOOT_GPIO_ISR] = {"gpio_isr", boot_gpio_isr, 0, 0},
+    [BOOT_WATER] = {"water", gpio_water_init, A_BOOT_DEP(BOOT_NVS) | A_BOOT_DEP(BOOT_DISPLAY) | A_BOOT_DEP(BOOT_GPIO_ISR), 0},
+    [BOOT_TDS] = {"tds", gpio_tds_init, A_BOOT_DEP(BOOT_DISPLAY), 0},
+    [BOOT_FLOWMETER] = {"flowmeter", gpio_flowmeter_init, A_BOOT_DEP(BOOT_GPIO_ISR), 0},
+    [BOOT_BLACKOUT] = {"blackout", gpio_blackout_init, A_BOOT_DEP(BOOT_NVS) | A_BOOT_DEP(BOOT_GPIO_ISR), 0},
+    [BOOT_MODEM] = {"modem", boot_modem, A_BOOT_DEP(BOOT_NVS), 6144},
+    [BOOT_NETWORK] = {"network", boot_network, A_BOOT_DEP(BOOT_MODEM) | A_BOOT_DEP(BOOT_DISPLAY) | A_BOOT_DEP(BOOT_WATER), 0},
+    [BOOT_CONSOLE] = {"console", boot_console, 0, 0},
+    [BOOT_JOURNAL] = {"journal", boot_journal, 0, 0},
+};
+
 /** 监控任务 */
 void task_jk(void *arg)
 {
@@ -120,6 +157,7 @@ void task_jk(void *arg)
         printf("名称 | 数量 | CPU占用率\n");
         printf(" %s\n", pcWriteBuffer);
         printf("└───────────────────────────────────────────────────┘\n");
+        u4g_at_sched_stat_log(); // AT指令各等级排队耗时
 
         printf("┌─────────────────────获取内存分布详情────────────────────┐\n");
         printf("Free DRAM: %d B | Free IRAM: %d B\n",
@@ -174,20 +212,11 @@ void app_main(void)
     }
     gpio_buzzer_timer(0);   // 关闭蜂鸣器
     gpio_buzzer_timer(1.5); // 开启蜂鸣器
-    for (int i = 0; i < 5; i++)
-    {
-        ESP_LOGE(TAG, "等待时间：%d秒", i);
-        vTaskDelay(pdMS_TO_TICKS(1000));
-    }
-    if (main_task_init() != ESP_OK)
-    {
-        ESP_LOGE(TAG, "主任务初始化失败-执行esp重启");
-        gpio_buzzer_timer(0); // 关闭蜂鸣器
-        esp_restart();
-    }
-    if (net_task_init() != ESP_OK)
+    DEVICE.RUNSTATE = READY_RUN; // 就绪中
+    // 按依赖并行初始化，结束后输出启动时间线
+    if (a_boot_run(boot_steps, BOOT_STEP_NUM, BOOT_TIMEOUT_MS) != ESP_OK)
     {
-        ESP_LOGE(TAG, "联网任务初始化失败-执行esp重启");
+        ESP_LOGE(TAG, "启动初始化失败-执行esp重启");
         gpio_buzzer_timer(0); // 关闭蜂鸣器
         esp_restart();
     }
@@ -0,0 +1,359 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+二进制上报协议的参考服务器，用于本地联调 main/a_feedback_bin.c（协议说明见 main/a_feedback_bin.h）。
+
+用法:
+    python tools/feedback_bin_server.py --key 8612345678901234=SECRET            # TCP 9510
+    python tools/feedback_bin_server.py --udp --default-key SECRET --config cfg.json
+
+--config 为 JSON 文件，键为配置名（见 CFG_IDS），例如:
+    {"charging": 1, "expire_time": 1767196800, "filter_level": 80, "duration_s": 600,
+     "flush_power_on": 10, "flush_low_end": 5, "flush_high_start": 5, "flush_high_end": 5,
+     "flush_water_total": 3600, "flush_water_time": 20}
+设备认证后下发一次；文件修改后向所有已认证的设备重新下发。
+"""
+import argparse
+import asyncio
+import hashlib
+import hmac
+import json
+import os
+import struct
+import sys
+import time
+
+MAGIC = 0xA5
+VERSION = 3
+HEAD_FMT = ">BBBHH"
+HEAD_LEN = struct.calcsize(HEAD_FMT)
+PAYLOAD_MAX = 96
+MAC_LEN = 16
+FRAME_MAC_LEN = 8
+SESSION_LABEL = b"session"
+NONCE_LEN = 8
+ACK_TIMEOUT = 5.0
+RETRY = 3
+
+T_HELLO, T_ACK, T_TELEMETRY, T_CONFIG, T_AUTH = 1, 2, 3, 4, 5
+S_OK, S_ERR_AUTH, S_ERR_FORMAT, S_ERR_INVALID = 0, 1, 2, 3
+
+# 与 a_feedback_bin_cfg_t 一致
+CFG_IDS = {
+    "charging": 1, "expire_time": 2, "filter_level": 3, "duration_s": 4,
+    "flush_power_on": 5, "flush_low_end": 6, "flush_high_start": 7, "flush_high_end": 8,
+    "flush_water_total": 9, "flush_water_time": 10,
+}
+
+TELEMETRY_FMT = ">IIihhBBBb"
+TELEMETRY_KEYS = ("total_water_time", "flowmeter", "expire_time", "temp_raw", "temp_pure",
+                  "tds_raw", "tds_pure", "water_leak", "signal")
+
+
+def crc16(data):
+    """CRC16-CCITT，初值 0xFFFF，不取反"""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def session_key(key, imei, nonce):
+    """会话秘钥 HMAC-SHA256(秘钥, IMEI|挑战随机数|"session")"""
+    return hmac.new(key.encode(), imei.encode() + nonce + SESSION_LABEL, hashlib.sha256).digest()
+
+
+def frame_mac(key, data):
+    return hmac.new(key, data, hashlib.sha256).digest()[:FRAME_MAC_LEN]
+
+
+def build(ftype, seq, payload=b"", key=None):
+    """组帧，给出会话秘钥时附上会话认证码"""
+    frame = struct.pack(HEAD_FMT, MAGIC, VERSION, ftype, seq & 0xFFFF, len(payload)) + payload
+    if key:
+        frame += frame_mac(key, frame)
+    return frame + struct.pack(">H", crc16(frame))
+
+
+class Parser:
+    """按帧头长度拼帧，帧头或校验错误时丢弃一个字节重新同步。
+    设备发来的帧除 HELLO 外都带会话认证码，返回 (类型, 序号, 内容, 认证码覆盖的字节, 认证码)"""
+
+    def __init__(self):
+        self.buf = bytearray()
+
+    def feed(self, data):
+        self.buf += data
+        frames = []
+        while self.buf:
+            if (self.buf[0] != MAGIC or (len(self.buf) > 1 and self.buf[1] != VERSION)
+                    or (len(self.buf) >= HEAD_LEN and struct.unpack_from(">H", self.buf, 5)[0] > PAYLOAD_MAX)):
+                del self.buf[0]
+                continue
+            if len(self.buf) < HEAD_LEN:
+                break
+            _, _, ftype, seq, length = struct.unpack_from(HEAD_FMT, self.buf)
+            signed = HEAD_LEN + length
+            size = signed + (0 if ftype == T_HELLO else FRAME_MAC_LEN) + 2
+            if len(self.buf) < size:
+                break
+            if struct.unpack_from(">H", self.buf, size - 2)[0] != crc16(self.buf[:size - 2]):
+                log("-", "帧校验失败，重新同步")
+                del self.buf[0]
+                continue
+            mac = bytes(self.buf[signed:size - 2]) if ftype != T_HELLO else None
+            frames.append((ftype, seq, bytes(self.buf[HEAD_LEN:signed]), bytes(self.buf[:signed]), mac))
+            del self.buf[:size]
+        return frames
+
+
+def log(peer, msg):
+    print("%s %-21s %s" % (time.strftime("%H:%M:%S"), peer, msg), flush=True)
+
+
+class Server:
+    def __init__(self, args):
+        self.keys = dict(kv.split("=", 1) for kv in args.key)
+        self.default_key = args.default_key
+        self.config_path = args.config
+        self.config = {}
+        self.config_mtime = None
+        self.sessions = set()
+        self.last_seq = {}  # IMEI -> 最近处理的上报序号（去重）
+        self.load_config()
+
+    def load_config(self):
+        if not self.config_path:
+            return False
+        try:
+            mtime = os.path.getmtime(self.config_path)
+            if mtime == self.config_mtime:
+                return False
+            with open(self.config_path, encoding="utf-8") as f:
+                cfg = json.load(f)
+        except (OSError, ValueError) as e:
+            log("-", "配置文件读取失败: %s" % e)
+            return False
+        self.config_mtime = mtime
+        self.config = {CFG_IDS[k]: int(v) for k, v in cfg.items() if k in CFG_IDS}
+        log("-", "配置已加载: %d项" % len(self.config))
+        return True
+
+    def config_payload(self):
+        return b"".join(struct.pack(">Bi", k, v) for k, v in sorted(self.config.items()))
+
+    def key_of(self, imei):
+        return self.keys.get(imei, self.default_key)
+
+    async def watch_config(self):
+        while True:
+            await asyncio.sleep(1.0)
+            if self.load_config():
+                for s in list(self.sessions):
+                    if s.imei:
+                        asyncio.ensure_future(s.push_config())
+
+
+class Session:
+    """一个设备连接：TCP 连接或 UDP 对端地址"""
+
+    def __init__(self, server, send, peer):
+        self.server = server
+        self.send = send
+        self.peer = peer
+        self.parser = Parser()
+        self.imei = None
+        self.challenge = None  # (HELLO序号, IMEI, 挑战随机数, 会话秘钥)，一次有效
+        self.key = None  # 认证通过后的会话秘钥
+        self.tx_seq = 0
+        self.ack_waiter = None
+
+    def feed(self, data):
+        for ftype, seq, payload, signed, mac in self.parser.feed(data):
+            if mac is not None:
+                # AUTH 用挑战对应的会话秘钥校验，其余帧用认证通过后的会话秘钥
+                key = self.challenge[3] if ftype == T_AUTH and self.challenge else self.key
+                if key is None or not hmac.compare_digest(mac, frame_mac(key, signed)):
+                    log(self.peer, "帧认证码错误，丢弃（类型%d 序号%d）" % (ftype, seq))
+                    continue
+            self.handle(ftype, seq, payload)
+
+    def ack(self, seq, status, extra=b"", key=None):
+        """回复ACK，默认带会话认证码（HELLO 时尚无会话秘钥，不带）"""
+        self.send(build(T_ACK, 0, struct.pack(">HB", seq, status) + extra, key or self.key))
+
+    def handle(self, ftype, seq, payload):
+        if ftype == T_ACK:
+            if len(payload) >= 3 and self.ack_waiter and not self.ack_waiter.done():
+                acked, status = struct.unpack_from(">HB", payload)
+                if acked == self.tx_seq:
+                    self.ack_waiter.set_result(status)
+        elif ftype == T_HELLO:
+            self.hello(seq, payload)
+        elif ftype == T_AUTH:
+            self.auth(seq, payload)
+        elif ftype == T_TELEMETRY:
+            self.telemetry(seq, payload)
+        else:
+            log(self.peer, "未知帧类型 %d" % ftype)
+            self.ack(seq, S_ERR_FORMAT)
+
+    def hello(self, seq, payload):
+        """下发一次性挑战；同一 HELLO 重发（ACK 丢失）时回复同一个挑战"""
+        try:
+            n = payload[0]
+            imei = payload[1:1 + n].decode("ascii")
+        except (IndexError, UnicodeDecodeError):
+            self.ack(seq, S_ERR_FORMAT)
+            return
+        if len(imei) != n or not self.server.key_of(imei):
+            log(self.peer, "认证失败 %s" % imei)
+            self.imei = None
+            self.key = None
+            self.ack(seq, S_ERR_AUTH)
+            return
+        self.imei = None
+        self.key = None
+        if not self.challenge or self.challenge[:2] != (seq, imei):
+            nonce = os.urandom(NONCE_LEN)
+            self.challenge = (seq, imei, nonce, session_key(self.server.key_of(imei), imei, nonce))
+        self.ack(seq, S_OK, self.challenge[2])
+
+    def auth(self, seq, payload):
+        """校验对挑战的认证码，挑战随即作废，截获的 AUTH 无法重放"""
+        if self.imei is not None and self.challenge is None:
+            self.ack(seq, S_OK)  # 已认证，AUTH 的 ACK 丢失后的重发
+            return
+        challenge, self.challenge = self.challenge, None
+        if challenge is None:
+            self.ack(seq, S_ERR_AUTH)
+            return
+        _, imei, nonce, skey = challenge
+        key = self.server.key_of(imei)
+        expect = hmac.new(key.encode(), imei.encode() + nonce, hashlib.sha256).digest()[:MAC_LEN]
+        if len(payload) != MAC_LEN or not hmac.compare_digest(payload, expect):
+            log(self.peer, "认证失败 %s" % imei)
+            self.ack(seq, S_ERR_AUTH, key=skey)
+            return
+        self.imei = imei
+        self.key = skey
+        log(self.peer, "认证成功 %s" % imei)
+        self.ack(seq, S_OK)
+        if self.server.config:
+            asyncio.ensure_future(self.push_config())
+
+    def telemetry(self, seq, payload):
+        if self.imei is None:
+            self.ack(seq, S_ERR_AUTH)
+            return
+        if len(payload) < struct.calcsize(TELEMETRY_FMT):
+            self.ack(seq, S_ERR_FORMAT)
+            return
+        if self.server.last_seq.get(self.imei) == seq:
+            log(self.peer, "重复上报 %d（ACK丢失后的重发），不重复计入" % seq)
+            self.ack(seq, S_OK)
+            return
+        values = dict(zip(TELEMETRY_KEYS, struct.unpack_from(TELEMETRY_FMT, payload)))
+        values["temp_raw"] /= 10.0
+        values["temp_pure"] /= 10.0
+        values["water_leak"] = bool(values["water_leak"])
+        self.server.last_seq[self.imei] = seq
+        log(self.peer, "上报 %d %s %s" % (seq, self.imei, json.dumps(values, ensure_ascii=False)))
+        self.ack(seq, S_OK)
+
+    async def push_config(self):
+        """下发配置并等待ACK，超时按原序号重发"""
+        self.tx_seq = (self.tx_seq + 1) & 0xFFFF
+        frame = build(T_CONFIG, self.tx_seq, self.server.config_payload(), self.key)
+        for attempt in range(RETRY + 1):
+            self.ack_waiter = asyncio.get_event_loop().create_future()
+            self.send(frame)
+            try:
+                status = await asyncio.wait_for(self.ack_waiter, ACK_TIMEOUT)
+            except asyncio.TimeoutError:
+                log(self.peer, "配置 %d 第%d次下发无应答" % (self.tx_seq, attempt + 1))
+                continue
+            log(self.peer, "配置 %d 已确认，结果 %d" % (self.tx_seq, status))
+            return
+        log(self.peer, "配置 %d 下发失败" % self.tx_seq)
+
+
+async def serve_tcp(server, host, port):
+    async def client(reader, writer):
+        peer = "%s:%d" % writer.get_extra_info("peername")[:2]
+        session = Session(server, writer.write, peer)
+        server.sessions.add(session)
+        log(peer, "TCP 连接")
+        try:
+            while True:
+                data = await reader.read(1024)
+                if not data:
+                    break
+                session.feed(data)
+        except ConnectionError:
+            pass
+        finally:
+            server.sessions.discard(session)
+            writer.close()
+            log(peer, "TCP 断开")
+
+    srv = await asyncio.start_server(client, host, port)
+    log("-", "TCP 监听 %s:%d" % (host, port))
+    async with srv:
+        await srv.serve_forever()
+
+
+class UdpProtocol(asyncio.DatagramProtocol):
+    def __init__(self, server):
+        self.server = server
+        self.by_addr = {}
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def datagram_received(self, data, addr):
+        session = self.by_addr.get(addr)
+        if session is None:
+            peer = "%s:%d" % addr[:2]
+            session = Session(self.server, lambda d, a=addr: self.transport.sendto(d, a), peer)
+            self.by_addr[addr] = session
+            self.server.sessions.add(session)
+        session.parser = Parser()  # 每个数据报独立成帧
+        session.feed(data)
+
+
+async def main_async(args):
+    server = Server(args)
+    asyncio.ensure_future(server.watch_config())
+    if args.udp:
+        loop = asyncio.get_event_loop()
+        await loop.create_datagram_endpoint(lambda: UdpProtocol(server), local_addr=(args.host, args.port))
+        log("-", "UDP 监听 %s:%d" % (args.host, args.port))
+        await asyncio.Event().wait()
+    else:
+        await serve_tcp(server, args.host, args.port)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="二进制上报协议参考服务器")
+    ap.add_argument("--host", default="0.0.0.0", help="监听地址")
+    ap.add_argument("--port", type=int, default=9510, help="监听端口（与 head.h 中 BIN_PORT 一致）")
+    ap.add_argument("--udp", action="store_true", help="使用UDP（与 head.h 中 BIN_UDP 一致）")
+    ap.add_argument("--key", action="append", default=[], metavar="IMEI=KEY", help="设备秘钥，可重复")
+    ap.add_argument("--default-key", help="未单独指定秘钥的设备使用的秘钥")
+    ap.add_argument("--config", help="下发的配置（JSON 文件，修改后自动重新下发）")
+    args = ap.parse_args()
+    if not args.key and not args.default_key:
+        ap.error("至少需要 --key 或 --default-key")
+    try:
+        asyncio.run(main_async(args))
+    except KeyboardInterrupt:
+        return 0
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+解析串口日志中 `trace dump` 导出的AT收发轨迹，输出逐条时间线与按指令的耗时分解。
+
+用法:
+    python tools/u4g_trace_decode.py monitor.log            # 耗时分解
+    python tools/u4g_trace_decode.py monitor.log --timeline # 同时输出时间线
+    idf.py monitor | tee monitor.log                        # 采集日志后在设备上执行 trace dump
+
+记录格式见 components/u4g/include/u4g_trace.h (u4g_trace_rec_t)，每条指令的耗时分解为：
+    首包   发送(TX) -> 收到第一个数据块(RX)，模块处理 + 串口传输
+    末包   发送(TX) -> 最后一个数据块，长应答的传输时间计入
+    完成   发送(TX) -> 指令结束(DONE)，含接收侧解析与任务唤醒
+"""
+import argparse
+import base64
+import re
+import struct
+import sys
+
+TRACE_VERSION = 1
+DATA_MAX = 48
+REC_FMT = "<IHBB%ds" % DATA_MAX
+REC_SIZE = struct.calcsize(REC_FMT)
+CMD_NONE = 0xFF
+DIR_NAMES = ("TX", "RX", "DONE")
+
+# 与 components/u4g/include/u4g_at_cmd.h 中 emATCmd 的顺序一致，新增指令时同步追加
+CMD_NAMES = (
+    "AT", "CEREG", "REBOOT", "IMEI", "ATE", "SSL_AUTH",
+    "HTTP_CREATE", "HTTP_HEADER", "HTTP_TIMEOUT", "HTTP_ENCODING", "HTTP_SSL", "HTTP_FRAGMENT",
+    "HTTP_BODY", "HTTP_REQUEST", "HTTP_DELETE", "TIME", "MCCID", "CSQ", "CEREG_SET",
+    "IPR", "IFC", "CPIN", "CGATT", "CMUX", "CGDCONT", "DIAL",
+    "MQTT_CFG", "MQTT_CONN", "MQTT_SUB", "MQTT_PUB", "MQTT_DISC",
+    "SOCK_CFG", "SOCK_OPEN", "SOCK_SEND", "SOCK_CLOSE",
+)
+
+LINE_RE = re.compile(r"U4G-TRACE (BEGIN .*|END|[A-Za-z0-9+/=]+)\s*$")
+
+
+def cmd_name(cmd):
+    if cmd == CMD_NONE:
+        return "-"
+    return CMD_NAMES[cmd] if cmd < len(CMD_NAMES) else "CMD%d" % cmd
+
+
+def parse_dumps(lines):
+    """返回日志中每次导出的记录列表 [(t_us, len, dir, cmd, data), ...]，时间戳已展开回绕"""
+    dumps, cur = [], None
+    for line in lines:
+        m = LINE_RE.search(line)
+        if not m:
+            continue
+        body = m.group(1)
+        if body.startswith("BEGIN"):
+            head = dict(kv.split("=", 1) for kv in body.split()[1:])
+            if int(head.get("ver", 0)) != TRACE_VERSION or int(head.get("rec", 0)) != REC_SIZE:
+                sys.exit("不支持的轨迹格式: %s" % body)
+            cur = bytearray()
+        elif body == "END":
+            if cur is not None:
+                dumps.append(unpack(bytes(cur)))
+            cur = None
+        elif cur is not None:
+            cur += base64.b64decode(body)
+    return dumps
+
+
+def unpack(raw):
+    recs, high, last = [], 0, None
+    for off in range(0, len(raw) - REC_SIZE + 1, REC_SIZE):
+        t, n, d, cmd, data = struct.unpack_from(REC_FMT, raw, off)
+        if last is not None and t < last:
+            high += 1 << 32  # 32位微秒时间戳回绕
+        last = t
+        recs.append((t + high, n, d, cmd, data[:min(n, DATA_MAX)]))
+    return recs
+
+
+def show(data, n):
+    text = data.decode("ascii", "backslashreplace").replace("\r", "\\r").replace("\n", "\\n")
+    return text + ("...(+%d)" % (n - len(data)) if n > len(data) else "")
+
+
+def timeline(recs):
+    t0 = recs[0][0]
+    for t, n, d, cmd, data in recs:
+        if d == 2:
+            desc = "result=%d" % struct.unpack("<i", data[:4])[0] if len(data) >= 4 else ""
+        else:
+            desc = show(data, n)
+        print("%12.3f ms  %-4s %-14s %5d  %s" % ((t - t0) / 1000.0, DIR_NAMES[d] if d < 3 else d, cmd_name(cmd), n, desc))
+
+
+def breakdown(recs):
+    """以指令的第一个TX为起点，统计同一指令下的首包、末包与结束耗时"""
+    stats, cur = {}, None
+    for t, n, d, cmd, data in recs:
+        if cmd == CMD_NONE:
+            continue
+        if cur is None or cur["cmd"] != cmd:
+            if d != 0:
+                continue  # 导出起点截断了该指令的发送记录
+            cur = {"cmd": cmd, "tx": t, "first": None, "last": None, "tx_bytes": 0, "rx_bytes": 0}
+        if d == 0:
+            cur["tx_bytes"] += n
+        elif d == 1:
+            cur["first"] = cur["first"] or t
+            cur["last"] = t
+            cur["rx_bytes"] += n
+        elif d == 2:
+            res = struct.unpack("<i", data[:4])[0] if len(data) >= 4 else 0
+            s = stats.setdefault(cmd, {"first": [], "last": [], "done": [], "fail": 0, "tx": 0, "rx": 0})
+            if cur["first"] is not None:
+                s["first"].append(cur["first"] - cur["tx"])
+                s["last"].append(cur["last"] - cur["tx"])
+            s["done"].append(t - cur["tx"])
+            s["fail"] += res != 0
+            s["tx"] += cur["tx_bytes"]
+            s["rx"] += cur["rx_bytes"]
+            cur = None
+    return stats
+
+
+def pct(values, p):
+    if not values:
+        return float("nan")
+    v = sorted(values)
+    return v[min(len(v) - 1, int(round(p / 100.0 * (len(v) - 1))))] / 1000.0
+
+
+def report(stats):
+    print("%-14s %5s %4s | %8s %8s | %8s %8s | %8s %8s %8s | %7s %7s" % (
+        "指令", "次数", "失败", "首包p50", "首包p95", "末包p50", "末包p95", "完成p50", "完成p95", "完成max", "TX字节", "RX字节"))
+    for cmd in sorted(stats, key=lambda c: -sum(stats[c]["done"])):
+        s = stats[cmd]
+        print("%-14s %5d %4d | %8.1f %8.1f | %8.1f %8.1f | %8.1f %8.1f %8.1f | %7d %7d" % (
+            cmd_name(cmd), len(s["done"]), s["fail"],
+            pct(s["first"], 50), pct(s["first"], 95), pct(s["last"], 50), pct(s["last"], 95),
+            pct(s["done"], 50), pct(s["done"], 95), max(s["done"]) / 1000.0, s["tx"], s["rx"]))
+    print("(单位 ms，按累计完成耗时排序)")
+
+
+def main():
+    ap = argparse.ArgumentParser(description="解析 u4g AT 收发轨迹")
+    ap.add_argument("log", nargs="?", help="串口日志文件，缺省读标准输入")
+    ap.add_argument("--timeline", action="store_true", help="输出逐条时间线")
+    ap.add_argument("--all", action="store_true", help="解析全部导出（默认只取最后一次）")
+    args = ap.parse_args()
+    with (open(args.log, encoding="utf-8", errors="replace") if args.log else sys.stdin) as f:
+        dumps = parse_dumps(f)
+    if not dumps:
+        sys.exit("日志中没有找到 U4G-TRACE 导出")
+    for recs in (dumps if args.all else dumps[-1:]):
+        print("== %d 条记录，跨度 %.1f ms ==" % (len(recs), (recs[-1][0] - recs[0][0]) / 1000.0 if recs else 0))
+        if not recs:
+            continue
+        if args.timeline:
+            timeline(recs)
+        report(breakdown(recs))
+
+
+if __name__ == "__main__":
+    main()